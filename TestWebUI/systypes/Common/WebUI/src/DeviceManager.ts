@@ -55,6 +55,25 @@ export class DeviceManager {
     private MSG_TIMESTAMP_SIZE_HEX_CHARS = 4;
     private MSG_TIMESTAMP_WRAP_VALUE = 65536;
 
+    // Microsecond delta timestamps (14 bit mantissa, 2 bit exponent in units of 32x)
+    private MSG_TIMESTAMP_US_MANTISSA_MASK = 0x3fff;
+    private MSG_TIMESTAMP_US_EXPONENT_SHIFT = 14;
+    private MSG_TIMESTAMP_US_EXPONENT_MULT = 32;
+    private MSG_TIMESTAMP_US_REBASED = 0xffff;
+
+    // Downsampled devices ("_w" results per window) have minimum, maximum then mean records for each window
+    // ("_wi" is the position in its window of the first record)
+    private WINDOW_SUMMARY_RESULTS = 3;
+    private WINDOW_RECORD_MIN = 0;
+    private WINDOW_RECORD_MAX = 1;
+    private WINDOW_RECORD_NONE = -1;
+
+    // Count of timeline entries when a us delta timestamp was last re-based (gap too long to code)
+    private _numTimelinePushesAtRebase = 0;
+
+    // Count of timeline entries added (to find those added for a message)
+    private _numTimelinePushes = 0;
+
     // Get instance
     public static getInstance(): DeviceManager {
         if (!DeviceManager._instance) {
@@ -452,7 +471,10 @@ export class DeviceManager {
                         deviceStateChanged: false,
                         lastReportTimestampMs: 0,
                         reportTimestampOffsetMs: 0,
-                        deviceIsOnline: true
+                        reportTimeUs: 0,
+                        deviceIsOnline: true,
+                        windowMin: {},
+                        windowMax: {}
                     };
                 }
                 
@@ -461,6 +483,14 @@ export class DeviceManager {
                     this._devicesState[deviceKey].deviceIsOnline = ((attrGroups._o === "1") || (attrGroups._o === 1));
                 }
 
+                // Devices with us delta timestamps include the time of the last record in us
+                const timeBaseUs = (attrGroups && typeof attrGroups === "object" && "_b" in attrGroups) ? Number(attrGroups._b) : undefined;
+                this._numTimelinePushesAtRebase = this._numTimelinePushes;
+
+                // Downsampled devices
+                const resultsPerWindow = (attrGroups && typeof attrGroups === "object" && "_w" in attrGroups) ? Number(attrGroups._w) : 0;
+                const firstWindowIdx = (attrGroups && typeof attrGroups === "object" && "_wi" in attrGroups) ? Number(attrGroups._wi) : 0;
+
                 // Iterate attribute groups
                 Object.entries(attrGroups).forEach(([attrGroup, msgHexStr]) => {
 
@@ -471,14 +501,32 @@ export class DeviceManager {
 
                     // Work through the message which may contain multiple data instances
                     let msgHexStrIdx = 0;
+                    let recordIdx = 0;
 
                     // Loop
                     while (msgHexStrIdx < msgHexStr.length) {
-                        msgHexStrIdx = this.processMsgAttrGroup(msgHexStr, msgHexStrIdx, deviceKey, attrGroup);
+                        const windowRecord = resultsPerWindow === this.WINDOW_SUMMARY_RESULTS ? 
+                                    (firstWindowIdx + recordIdx) % this.WINDOW_SUMMARY_RESULTS : this.WINDOW_RECORD_NONE;
+                        msgHexStrIdx = this.processMsgAttrGroup(msgHexStr, msgHexStrIdx, deviceKey, attrGroup, 
+                                    timeBaseUs !== undefined, windowRecord);
                         if (msgHexStrIdx < 0)
                             break;
+                        recordIdx++;
                     }
                 });
+
+                // Move the times of the records just added so the last is at the time base (records before a
+                // re-based one follow on from the previous message so they aren't moved)
+                if (timeBaseUs !== undefined) {
+                    const deviceState = this._devicesState[deviceKey];
+                    const offsetMs = (timeBaseUs - deviceState.reportTimeUs) / 1000;
+                    deviceState.reportTimeUs = timeBaseUs;
+                    const timeline = deviceState.deviceTimeline;
+                    const numAdded = Math.min(this._numTimelinePushes - this._numTimelinePushesAtRebase, timeline.length);
+                    for (let i = timeline.length - numAdded; i < timeline.length; i++) {
+                        timeline[i] += offsetMs;
+                    }
+                }
             });
 
             // Remove devices no longer present
@@ -511,7 +559,8 @@ export class DeviceManager {
         return 0;
     }
 
-    private processMsgAttrGroup(msgHexStr: string, msgHexStrIdx: number, deviceKey: string, attrGroup: string): number {
+    private processMsgAttrGroup(msgHexStr: string, msgHexStrIdx: number, deviceKey: string, attrGroup: string, isUsDelta: boolean,
+                windowRecord: number): number {
 
         // Check there are enough characters for the timestamp
         if (msgHexStrIdx + 4 > msgHexStr.length) {
@@ -521,15 +570,27 @@ export class DeviceManager {
         // Extract timestamp which is the first MSG_TIMESTAMP_SIZE_HEX_CHARS chars of the hex string
         let timestamp = parseInt(msgHexStr.slice(msgHexStrIdx, msgHexStrIdx+this.MSG_TIMESTAMP_SIZE_HEX_CHARS), 16);
 
-        // Check if time is before lastReportTimeMs - in which case a wrap around occurred to add on the max value
-        if (timestamp < this._devicesState[deviceKey].lastReportTimestampMs) {
-            this._devicesState[deviceKey].reportTimestampOffsetMs += this.MSG_TIMESTAMP_WRAP_VALUE;
-        }
-        this._devicesState[deviceKey].lastReportTimestampMs = timestamp;
-
-        // Offset timestamp
         const origTimestamp = timestamp;
-        timestamp += this._devicesState[deviceKey].reportTimestampOffsetMs;
+        if (isUsDelta) {
+            // Delta from the previous record in us (times are moved to the time base once the message is processed)
+            if (timestamp === this.MSG_TIMESTAMP_US_REBASED) {
+                this._numTimelinePushesAtRebase = this._numTimelinePushes;
+            } else {
+                const deltaUs = (timestamp & this.MSG_TIMESTAMP_US_MANTISSA_MASK) * 
+                            Math.pow(this.MSG_TIMESTAMP_US_EXPONENT_MULT, timestamp >> this.MSG_TIMESTAMP_US_EXPONENT_SHIFT);
+                this._devicesState[deviceKey].reportTimeUs += deltaUs;
+            }
+            timestamp = this._devicesState[deviceKey].reportTimeUs / 1000;
+        } else {
+            // Check if time is before lastReportTimeMs - in which case a wrap around occurred to add on the max value
+            if (timestamp < this._devicesState[deviceKey].lastReportTimestampMs) {
+                this._devicesState[deviceKey].reportTimestampOffsetMs += this.MSG_TIMESTAMP_WRAP_VALUE;
+            }
+            this._devicesState[deviceKey].lastReportTimestampMs = timestamp;
+
+            // Offset timestamp
+            timestamp += this._devicesState[deviceKey].reportTimestampOffsetMs;
+        }
 
         console.log(`processMsgAttrGroup msg ${msgHexStr} timestamp ${timestamp} origTimestamp ${origTimestamp} deviceKey ${deviceKey} attrGroup ${attrGroup} msgHexStrIdx ${msgHexStrIdx}`)
 
@@ -656,15 +717,29 @@ export class DeviceManager {
                 // console.log(`DeviceManager msg attrGroup ${attrGroup} devkey ${deviceKey} valueHexChars ${valueHexChars} msgHexStr ${msgHexStr} ts ${timestamp} attr ${attr.n} type ${attr.t} value ${value} signExtendableMaskSignPos ${signExtendableMaskSignPos} attrTypeDefForStruct ${attrTypeDefForStruct} attr ${attr}`);
                 msgHexStrIdx += attrUsesAbsPos ? 0 : attrReadHexChars;
 
+                // Window minimum and maximum are held until the mean (which goes on the timeline) - if the start of
+                // a window was read in an earlier message the mean stands in for them
+                const deviceState = this._devicesState[deviceKey];
+                if (windowRecord === this.WINDOW_RECORD_MIN) {
+                    deviceState.windowMin[attr.n] = value;
+                    continue;
+                } else if (windowRecord === this.WINDOW_RECORD_MAX) {
+                    deviceState.windowMax[attr.n] = value;
+                    continue;
+                }
+
                 // Check if attribute already exists in the device state
                 if (attr.n in this._devicesState[deviceKey].deviceAttributes) {
 
                     // Limit to MAX_DATA_POINTS_TO_STORE
-                    if (this._devicesState[deviceKey].deviceAttributes[attr.n].values.length >= this.MAX_DATA_POINTS_TO_STORE) {
-                        this._devicesState[deviceKey].deviceAttributes[attr.n].values.shift();
+                    const deviceAttr = this._devicesState[deviceKey].deviceAttributes[attr.n];
+                    if (deviceAttr.values.length >= this.MAX_DATA_POINTS_TO_STORE) {
+                        deviceAttr.values.shift();
+                        deviceAttr.valuesMin?.shift();
+                        deviceAttr.valuesMax?.shift();
                     }
-                    this._devicesState[deviceKey].deviceAttributes[attr.n].values.push(value);
-                    this._devicesState[deviceKey].deviceAttributes[attr.n].newData = true;
+                    deviceAttr.values.push(value);
+                    deviceAttr.newData = true;
                 } else {
                     this._devicesState[deviceKey].deviceAttributes[attr.n] = {
                         name: attr.n,
@@ -678,6 +753,15 @@ export class DeviceManager {
                         visibleForm: "vf" in attr ? (attr.vf === 0 || attr.vf === false ? false : !!attr.vf) : true,
                     };
                 }
+                if (windowRecord !== this.WINDOW_RECORD_NONE) {
+                    const deviceAttr = deviceState.deviceAttributes[attr.n];
+                    deviceAttr.valuesMin = deviceAttr.valuesMin || [];
+                    deviceAttr.valuesMax = deviceAttr.valuesMax || [];
+                    deviceAttr.valuesMin.push(attr.n in deviceState.windowMin ? deviceState.windowMin[attr.n] : value);
+                    deviceAttr.valuesMax.push(attr.n in deviceState.windowMax ? deviceState.windowMax[attr.n] : value);
+                    delete deviceState.windowMin[attr.n];
+                    delete deviceState.windowMax[attr.n];
+                }
                 attrsAdded = true;
             }
         }
@@ -689,6 +773,7 @@ export class DeviceManager {
                 this._devicesState[deviceKey].deviceTimeline.shift();
             }
             this._devicesState[deviceKey].deviceTimeline.push(timestamp);
+            this._numTimelinePushes++;
         }
         return msgHexStrIdx;
     }
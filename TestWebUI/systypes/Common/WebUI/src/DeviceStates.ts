@@ -40,6 +40,9 @@ export interface DeviceAttribute {
     newAttribute: boolean;
     newData: boolean;
     values: number[];
+    // Minimum and maximum over each window for downsampled devices (values holds the mean)
+    valuesMin?: number[];
+    valuesMax?: number[];
     units: string;
     range: number[];
     format: string;
@@ -60,6 +63,10 @@ export interface DeviceState {
     deviceIsOnline: boolean;
     lastReportTimestampMs: number;
     reportTimestampOffsetMs: number;
+    reportTimeUs: number;
+    // Minimum and maximum of each attribute in the window whose mean is still to come (downsampled devices)
+    windowMin: { [attributeName: string]: number };
+    windowMax: { [attributeName: string]: number };
 }
 
 export class DevicesState {
@@ -9,6 +9,7 @@
 #include "BusAccessor.h"
 #include "Logger.h"
 #include "RaftUtils.h"
+#include "BusI2CClock.h"
 
 // Warnings
 #define WARN_ON_REQUEST_BUFFER_FULL
@@ -193,7 +194,7 @@ void BusAccessor::processPolling()
             // Check valid - if list is empty or has shrunk this test can fail
             // Polling can be suspended if too many failures occur
             BusI2CRequestRec* pReqRec = NULL;
-            if ((pollListIdx < _pollingVector.size()) &&
+            if (((uint32_t)pollListIdx < _pollingVector.size()) &&
                             (_pollingVector[pollListIdx].suspendCount < MAX_CONSEC_FAIL_POLLS_BEFORE_SUSPEND))
             {
                 // Get request details
@@ -209,8 +210,8 @@ void BusAccessor::processPolling()
                 {
                     LOG_I(MODULE_PREFIX, "i2cWorker polling addr@slot+1 %s elapsed %ld", 
                                 pReqRec->getAddrAndSlot().toString().c_str(), 
-                                Raft::timeElapsed(millis(), _debugLastPollTimeMs));
-                    _debugLastPollTimeMs = millis();
+                                Raft::timeElapsed(BusI2CClock::nowMs(), _debugLastPollTimeMs));
+                    _debugLastPollTimeMs = BusI2CClock::nowMs();
                 }
 #endif
                 // Send poll request
@@ -219,7 +220,7 @@ void BusAccessor::processPolling()
                 if ((sendResult != RaftI2CCentralIF::ACCESS_RESULT_OK) && (sendResult != RaftI2CCentralIF::ACCESS_RESULT_BARRED))
                 {
                     // Increment the suspend count if required
-                    if (pollListIdx < _pollingVector.size())
+                    if ((uint32_t)pollListIdx < _pollingVector.size())
                         if (_pollingVector[pollListIdx].suspendCount < MAX_CONSEC_FAIL_POLLS_BEFORE_SUSPEND)
                             _pollingVector[pollListIdx].suspendCount++;
                 }
@@ -289,13 +290,13 @@ void BusAccessor::handleResponse(const BusI2CRequestRec* pReqRec, RaftI2CCentral
         {
             // Warn
 #ifdef WARN_ON_RESPONSE_BUFFER_FULL
-            if (Raft::isTimeout(millis(), _respBufferFullLastWarnMs, BETWEEN_BUF_FULL_WARNINGS_MIN_MS))
+            if (Raft::isTimeout(BusI2CClock::nowMs(), _respBufferFullLastWarnMs, BETWEEN_BUF_FULL_WARNINGS_MIN_MS))
             {
                 int msgsWaiting = _responseQueue.count();
                 LOG_W(MODULE_PREFIX, "sendHelper %s resp buffer full - waiting %d",
                         _busBase.getBusName().c_str(), msgsWaiting
                     );
-                _respBufferFullLastWarnMs = millis();
+                _respBufferFullLastWarnMs = BusI2CClock::nowMs();
             }
 #endif
 
@@ -409,13 +410,13 @@ bool BusAccessor::addToQueuedReqFIFO(BusRequestInfo& busReqInfo)
         _busBase.getBusStats().reqBufferFull();
 
 #ifdef WARN_ON_REQUEST_BUFFER_FULL
-        if (Raft::isTimeout(millis(), _reqBufferFullLastWarnMs, BETWEEN_BUF_FULL_WARNINGS_MIN_MS))
+        if (Raft::isTimeout(BusI2CClock::nowMs(), _reqBufferFullLastWarnMs, BETWEEN_BUF_FULL_WARNINGS_MIN_MS))
         {
             int msgsWaiting = _requestQueue.count();
             LOG_W(MODULE_PREFIX, "addToQueuedReqFIFO %s req buffer full - waiting %d", 
                     _busBase.getBusName().c_str(), msgsWaiting
                 );
-            _reqBufferFullLastWarnMs = millis();
+            _reqBufferFullLastWarnMs = BusI2CClock::nowMs();
         }
 #endif
     }
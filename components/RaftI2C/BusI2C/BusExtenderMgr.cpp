@@ -180,10 +180,7 @@ RaftI2CCentralIF::AccessResultCode BusExtenderMgr::setSlotEnables(uint32_t exten
         return RaftI2CCentralIF::ACCESS_RESULT_INVALID;
     // Check if slot initialized
     if (!_busExtenderRecs[extenderIdx].maskWrittenOk)
-    {
         force = true;
-        _busExtenderRecs[extenderIdx].maskWrittenOk = true;
-    }
     // Check if status indicates that the mask is already correct
     if (!force)
     {
@@ -209,6 +206,7 @@ RaftI2CCentralIF::AccessResultCode BusExtenderMgr::setSlotEnables(uint32_t exten
     if (rslt == RaftI2CCentralIF::ACCESS_RESULT_OK)
     {
         _busExtenderRecs[extenderIdx].curBitMask = slotMask;
+        _busExtenderRecs[extenderIdx].maskWrittenOk = true;
     }
     else
     {
@@ -353,6 +351,29 @@ void BusExtenderMgr::initBusExtenderRecs()
     _busExtenderCount = 0;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the slot currently enabled on the bus extenders
+/// @return Slot number (1-based), 0 if no slot is enabled or -1 if more than one slot is enabled or the
+///         state of an extender is not known
+int BusExtenderMgr::getSingleEnabledSlotPlus1() const
+{
+    int enabledSlotPlus1 = 0;
+    for (uint32_t extenderIdx = 0; extenderIdx < _busExtenderRecs.size(); extenderIdx++)
+    {
+        const BusExtender& busExtender = _busExtenderRecs[extenderIdx];
+        if (!busExtender.isOnline)
+            continue;
+        if (!busExtender.maskWrittenOk)
+            return -1;
+        if (busExtender.curBitMask == 0)
+            continue;
+        if ((enabledSlotPlus1 != 0) || (__builtin_popcount(busExtender.curBitMask) != 1))
+            return -1;
+        enabledSlotPlus1 = extenderIdx * I2C_BUS_EXTENDER_SLOT_COUNT + __builtin_ctz(busExtender.curBitMask) + 1;
+    }
+    return enabledSlotPlus1;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Get extender and slot index from slotPlus1
 /// @param slotPlus1 Slot number (1-based)
@@ -99,6 +99,12 @@ public:
     /// @return Next slot number (1-based)
     uint32_t getNextSlot(uint32_t slotPlus1);
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the slot currently enabled on the bus extenders
+    /// @return Slot number (1-based), 0 if no slot is enabled or -1 if more than one slot is enabled or the
+    ///         state of an extender is not known
+    int getSingleEnabledSlotPlus1() const;
+
     // Bus extender slot count
     static const uint32_t I2C_BUS_EXTENDER_SLOT_COUNT = 8;
 
@@ -13,10 +13,13 @@
 #include "RaftJsonPrefixed.h"
 #include "esp_task_wdt.h"
 #include "BusI2CConsts.h"
+#include "BusI2CClock.h"
 
 static const char* MODULE_PREFIX = "BusI2C";
 
-#if defined(I2C_USE_RAFT_I2C)
+#if defined(RAFT_I2C_HOST_BUILD)
+// No hardware I2C central on host
+#elif defined(I2C_USE_RAFT_I2C)
 #include "RaftI2CCentral.h"
 #elif (defined(I2C_USE_ESP_IDF_5) || defined(I2C_USE_RAFT_I2C)) && (defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S3))
 #include "ESPIDF5I2CCentral.h"
@@ -34,7 +37,9 @@ static const char* MODULE_PREFIX = "BusI2C";
 // #define DEBUG_NO_POLLING
 // #define DEBUG_I2C_ASYNC_SEND_HELPER
 // #define DEBUG_I2C_SYNC_SEND_HELPER
+// #define DEBUG_I2C_SUBMIT_HELPER
 // #define DEBUG_BUS_HIATUS
+// #define DEBUG_BUS_FREQ_CHANGE
 // #define DEBUG_LOOP_TIMING_WITH_GPIO_NUM 19
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -55,18 +60,20 @@ BusI2C::BusI2C(BusElemStatusCB busElemStatusCB, BusOperationStatusCB busOperatio
         _deviceIdentMgr(_busExtenderMgr,
             std::bind(&BusI2C::i2cSendSync, this, std::placeholders::_1, std::placeholders::_2)
         ),
-        _busScanner(_busStatusMgr, _busExtenderMgr, _deviceIdentMgr,
+        _busScanner(_busStatusMgr, _busExtenderMgr, _deviceIdentMgr, _busSpeedMgr,
             std::bind(&BusI2C::i2cSendSync, this, std::placeholders::_1, std::placeholders::_2) 
         ),
         _devicePollingMgr(_busStatusMgr, _busExtenderMgr,
-            std::bind(&BusI2C::i2cSendSync, this, std::placeholders::_1, std::placeholders::_2)
+            std::bind(&BusI2C::i2cSendSync, this, std::placeholders::_1, std::placeholders::_2),
+            std::bind(&BusI2C::i2cSubmit, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+            std::bind(&BusI2C::i2cWait, this, std::placeholders::_1)
         ),
         _busAccessor(*this,
             std::bind(&BusI2C::i2cSendAsync, this, std::placeholders::_1, std::placeholders::_2)
         )
 {
     // Init
-    _lastI2CCommsUs = micros();
+    _lastI2CCommsUs = BusI2CClock::nowUs();
 
     // Clear barring
     for (uint32_t i = 0; i < ELEM_BAR_I2C_ADDRESS_MAX; i++)
@@ -76,7 +83,10 @@ BusI2C::BusI2C(BusElemStatusCB busElemStatusCB, BusOperationStatusCB busOperatio
     _pI2CCentral = pI2CCentralIF;
     if (!_pI2CCentral)
     {
-#if defined(I2C_USE_RAFT_I2C) 
+#if defined(RAFT_I2C_HOST_BUILD)
+        // Setup will fail as there is no central
+        _pI2CCentral = nullptr;
+#elif defined(I2C_USE_RAFT_I2C) 
         _pI2CCentral = new RaftI2CCentral();
 #elif (defined(I2C_USE_ESP_IDF_5) || defined(I2C_USE_RAFT_I2C)) && (defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S3))
         _pI2CCentral = new ESPIDF5I2CCentral();
@@ -126,6 +136,10 @@ bool BusI2C::setup(const RaftJsonIF& config)
     UBaseType_t taskCore = config.getLong("taskCore", DEFAULT_TASK_CORE);
     BaseType_t taskPriority = config.getLong("taskPriority", DEFAULT_TASK_PRIORITY);
     int taskStackSize = config.getLong("taskStack", DEFAULT_TASK_STACK_SIZE_BYTES);
+    _workerTaskEnabled = config.getBool("workerTask", true);
+
+    // Transaction trace (number of records, 0 to disable)
+    _traceRecorder.setup(config.getLong("traceRecs", 0));
 
     // Yield values
     _loopYieldMs = config.getLong("loopYieldMs", I2C_BUS_LOOP_YIELD_MS);
@@ -139,6 +153,9 @@ bool BusI2C::setup(const RaftJsonIF& config)
     RaftJsonPrefixed busExtenderConfig(config, "mux");
     _busExtenderMgr.setup(busExtenderConfig);
 
+    // Bus speed manager setup
+    _busSpeedMgr.setup(config);
+
     // Bus power controller setup
     RaftJsonPrefixed busPowerConfig(config, "pwr");
     _busPowerController.setup(busPowerConfig);
@@ -179,8 +196,17 @@ bool BusI2C::setup(const RaftJsonIF& config)
         return false;
     }
 
+    // Slot speeds (from slotFreqs config or device maxFreq) can only be used if the central can switch frequency
+    if (!_pI2CCentral->setBusFrequency(_freq))
+    {
+        if (_busSpeedMgr.isSpeedSwitching())
+            LOG_W(MODULE_PREFIX, "setup name %s slotFreqs IGNORED - central can't set bus frequency", _busName.c_str());
+        _busSpeedMgr.setSwitchingSupported(false);
+    }
+
     // Ok
     _initOk = true;
+    _curBusFreq = _freq;
 
     // Reset pause status
     _pauseRequested = false;
@@ -188,7 +214,7 @@ bool BusI2C::setup(const RaftJsonIF& config)
 
     // Start the worker task
     BaseType_t retc = pdPASS;
-    if (_i2cWorkerTaskHandle == nullptr)
+    if (_workerTaskEnabled && (_i2cWorkerTaskHandle == nullptr))
     {
         retc = xTaskCreatePinnedToCore(
                     i2cWorkerTaskStatic,
@@ -215,6 +241,9 @@ bool BusI2C::setup(const RaftJsonIF& config)
 /// @brief Close
 void BusI2C::close()
 {
+    // Stop pushing poll results to subscribers
+    _busStatusMgr.getPollDataDispatcher().close();
+
     if (_i2cWorkerTaskHandle != nullptr) 
     {
         // Shutdown task
@@ -255,6 +284,10 @@ void BusI2C::service()
 
     // Service bus accessor
     _busAccessor.service();
+
+    // Push poll results to subscribers if there is no dispatch task
+    if (!_busStatusMgr.getPollDataDispatcher().isTaskEnabled())
+        _busStatusMgr.getPollDataDispatcher().dispatchService(BusI2CClock::nowUs());
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -290,7 +323,7 @@ void BusI2C::i2cWorkerTask()
     digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
 #endif
 
-    _debugLastBusLoopMs = millis();
+    _debugLastBusLoopMs = BusI2CClock::nowMs();
     while (ulTaskNotifyTake(pdTRUE, 0) == 0)
     {
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
@@ -305,137 +338,146 @@ void BusI2C::i2cWorkerTask()
         // Allow other tasks to run
         vTaskDelay(pdMS_TO_TICKS(_loopYieldMs));
 
+        // Service the bus
+        workerService();
+    }
+
+    LOG_I(MODULE_PREFIX, "i2cWorkerTask exiting");
+
+    // Task has exited
+    _i2cWorkerTaskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Worker service - performs one iteration of the bus worker loop
+/// @note Called from the worker task or directly (when workerTask is disabled in config) e.g. for simulation
+void BusI2C::workerService()
+{
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif        
 
 #ifdef DEBUG_RAFT_BUSI2C_MEASURE_I2C_LOOP_TIME
-        uint64_t startUs = micros();
+    uint64_t startUs = BusI2CClock::nowUs();
 #endif
 
-        // Check I2C initialised
-        if (!_initOk)
-            continue;
+    // Check I2C initialised
+    if (!_initOk)
+        return;
 
-        // Cur loop microseconds
-        uint64_t curTimeUs = micros();
-        uint32_t curTimeMs = curTimeUs / 1000;
+    // Cur loop microseconds
+    uint64_t curTimeUs = BusI2CClock::nowUs();
+    uint32_t curTimeMs = curTimeUs / 1000;
 
-        // Check bus hiatus
-        if (_hiatusActive)
-        {
-            if (!Raft::isTimeout(curTimeMs, _hiatusStartMs, _hiatusForMs))
-                continue;
-            _hiatusActive = false;
+    // Check bus hiatus
+    if (_hiatusActive)
+    {
+        if (!Raft::isTimeout(curTimeMs, _hiatusStartMs, _hiatusForMs))
+            return;
+        _hiatusActive = false;
 #ifdef DEBUG_BUS_HIATUS
-            LOG_I(MODULE_PREFIX, "i2cWorkerTask hiatus over");
+        LOG_I(MODULE_PREFIX, "i2cWorkerTask hiatus over");
 #endif
-        }
+    }
 
-        // Stats
-        _busStats.activity();
+    // Stats
+    _busStats.activity();
 
-        // Check pause status
-        if ((_isPaused) && (!_pauseRequested))
-            _isPaused = false;
-        else if ((!_isPaused) && (_pauseRequested))
-            _isPaused = true;
+    // Check pause status
+    if ((_isPaused) && (!_pauseRequested))
+        _isPaused = false;
+    else if ((!_isPaused) && (_pauseRequested))
+        _isPaused = true;
 
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif
 
-        // Handle bus scanning
+    // Handle bus scanning
 #ifndef DEBUG_NO_SCANNING
-        if (!_isPaused)
+    if (!_isPaused)
+    {
+        // Service bus scanner
+        if (_busScanner.isScanPending(curTimeMs))
         {
-            // Service bus scanner
-            if (_busScanner.isScanPending(curTimeMs))
-            {
-                _busScanner.taskService(curTimeUs, _loopFastUnyieldUs, _loopSlowUnyieldUs);
-            }
+            _busScanner.taskService(curTimeUs, _loopFastUnyieldUs, _loopSlowUnyieldUs);
         }
+    }
 #endif
 
-        // Handle requests
-        _busAccessor.processRequestQueue(_isPaused);
+    // Handle requests
+    _busAccessor.processRequestQueue(_isPaused);
 
-        // Don't do any polling when paused
-        if (_isPaused)
-            continue;
+    // Don't do any polling when paused
+    if (_isPaused)
+        return;
 
 #ifdef DEBUG_NO_POLLING
-        continue;
+    return;
 #endif
 
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif
 
-        // Bus extender service
-        _busExtenderMgr.taskService();
+    // Bus extender service
+    _busExtenderMgr.taskService();
 
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif
 
-        // Bus power controller service
-        _busPowerController.taskService(micros());
+    // Bus power controller service
+    _busPowerController.taskService(BusI2CClock::nowUs());
 
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif
 
-        // Device polling
-        _devicePollingMgr.taskService(micros());
+    // Device polling
+    _devicePollingMgr.taskService(BusI2CClock::nowUs());
 
 #ifdef DEBUG_LOOP_TIMING_WITH_GPIO_NUM
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
-        delayMicroseconds(1);
-        digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
-        delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 1);
+    delayMicroseconds(1);
+    digitalWrite(DEBUG_LOOP_TIMING_WITH_GPIO_NUM, 0);
+    delayMicroseconds(1);
 #endif
 
-        // Perform any user-defined access
-        // TODO - remove or reconsider how polling works
-        _busAccessor.processPolling();
+    // Perform any user-defined access
+    // TODO - remove or reconsider how polling works
+    _busAccessor.processPolling();
 
 #ifdef DEBUG_RAFT_BUSI2C_MEASURE_I2C_LOOP_TIME
-        // Debug
-        uint64_t timeUs = micros() - startUs;
-        if (timeUs > _i2cLoopWorstTimeUs)
-            _i2cLoopWorstTimeUs = timeUs;
-        _i2cMainLoopCount++;
-        if (millis() - _i2cDebugLastReportMs > 30000)
-        {
-            _i2cDebugLastReportMs = millis();
-            LOG_I(MODULE_PREFIX, "i2cWorkerTask timeUs %lld worstTimeUs %lld loopCount %d", 
-                        timeUs, _i2cLoopWorstTimeUs, _i2cMainLoopCount);
-            _i2cLoopWorstTimeUs = 0;
-        }
-#endif
+    // Debug
+    uint64_t timeUs = BusI2CClock::nowUs() - startUs;
+    if (timeUs > _i2cLoopWorstTimeUs)
+        _i2cLoopWorstTimeUs = timeUs;
+    _i2cMainLoopCount++;
+    if (BusI2CClock::nowMs() - _i2cDebugLastReportMs > 30000)
+    {
+        _i2cDebugLastReportMs = BusI2CClock::nowMs();
+        LOG_I(MODULE_PREFIX, "i2cWorkerTask timeUs %lld worstTimeUs %lld loopCount %d", 
+                    timeUs, _i2cLoopWorstTimeUs, _i2cMainLoopCount);
+        _i2cLoopWorstTimeUs = 0;
     }
-
-    LOG_I(MODULE_PREFIX, "i2cWorkerTask exiting");
-
-    // Task has exited
-    _i2cWorkerTaskHandle = nullptr;
-    vTaskDelete(NULL);
+#endif
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -457,7 +499,15 @@ RaftI2CCentralIF::AccessResultCode BusI2C::i2cSendSync(const BusI2CRequestRec* p
     BusI2CAddrAndSlot addrAndSlot = pReqRec->getAddrAndSlot();
     RaftI2CCentralIF::AccessResultCode rslt = checkAddrValidAndNotBarred(addrAndSlot);
     if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+    {
+        if (_traceRecorder.isEnabled())
+        {
+            uint64_t timeNowUs = BusI2CClock::nowUs();
+            _traceRecorder.record(timeNowUs, timeNowUs, addrAndSlot, pReqRec->getReqType(),
+                        pReqRec->getWriteDataLen(), pReqRec->getReadReqLen(), rslt);
+        }
         return rslt;
+    }
 
     // Buffer for read
     uint32_t readReqLen = 0;
@@ -475,18 +525,130 @@ RaftI2CCentralIF::AccessResultCode BusI2C::i2cSendSync(const BusI2CRequestRec* p
     RaftI2CCentralIF::AccessResultCode rsltCode = RaftI2CCentralIF::AccessResultCode::ACCESS_RESULT_NOT_INIT;
     if (!_pI2CCentral)
         return rsltCode;
+    rsltCode = setBusFreqForAccess(addrAndSlot);
+    if (rsltCode != RaftI2CCentralIF::ACCESS_RESULT_OK)
+    {
+        if (_traceRecorder.isEnabled())
+        {
+            uint64_t timeNowUs = BusI2CClock::nowUs();
+            _traceRecorder.record(timeNowUs, timeNowUs, addrAndSlot, pReqRec->getReqType(),
+                        writeReqLen, readReqLen, rsltCode);
+        }
+        return rsltCode;
+    }
+    uint64_t startUs = _traceRecorder.isEnabled() ? BusI2CClock::nowUs() : 0;
     rsltCode = _pI2CCentral->access(addrAndSlot.addr, pReqRec->getWriteData(), writeReqLen, 
             pReadData ? pReadData->data() : pDummyReadBuf, readReqLen, numBytesRead);
 
+    // Record time of comms
+    _lastI2CCommsUs = BusI2CClock::nowUs();
+
+    // Trace
+    _traceRecorder.record(startUs, _lastI2CCommsUs, addrAndSlot, pReqRec->getReqType(),
+                writeReqLen, readReqLen, rsltCode);
+
     // Bar access to element if requested
     if (barAccessAfterSendMs > 0)
-        _busStatusMgr.barElemAccessSet(millis(), addrAndSlot, barAccessAfterSendMs);
-
-    // Record time of comms
-    _lastI2CCommsUs = micros();
+        _busStatusMgr.barElemAccessSet(BusI2CClock::nowMs(), addrAndSlot, barAccessAfterSendMs);
     return rsltCode;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Submit I2C message without waiting for it to complete
+/// @param pReqRec - contains the request details including address, write data, read data length, etc
+/// @param pReadBuf - buffer for read data (at least getReadReqLen() bytes)
+/// @param completeCB - called (from i2cWait or a later access) when the message has completed
+/// @return false if the central's transaction queue is full (nothing submitted)
+/// @note The request record and read buffer must remain valid until completeCB is called. As with i2cSendSync
+///       the bus extender is not set
+bool BusI2C::i2cSubmit(const BusI2CRequestRec* pReqRec, uint8_t* pReadBuf, BusI2CReqCompleteCB completeCB)
+{
+#ifdef DEBUG_I2C_SUBMIT_HELPER
+    LOG_I(MODULE_PREFIX, "i2cSubmit addr@slot+1 %s writeLen %d readLen %d reqType %d",
+                    pReqRec->getAddrAndSlot().toString().c_str(), pReqRec->getWriteDataLen(),
+                    pReqRec->getReadReqLen(), pReqRec->getReqType());
+#endif
+
+    // Check address is within valid range and not barred
+    BusI2CAddrAndSlot addrAndSlot = pReqRec->getAddrAndSlot();
+    RaftI2CCentralIF::AccessResultCode rslt = checkAddrValidAndNotBarred(addrAndSlot);
+    if ((rslt == RaftI2CCentralIF::ACCESS_RESULT_OK) && !_pI2CCentral)
+        rslt = RaftI2CCentralIF::ACCESS_RESULT_NOT_INIT;
+    if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+    {
+        if (_traceRecorder.isEnabled())
+        {
+            uint64_t timeNowUs = BusI2CClock::nowUs();
+            _traceRecorder.record(timeNowUs, timeNowUs, addrAndSlot, pReqRec->getReqType(),
+                        pReqRec->getWriteDataLen(), pReqRec->getReadReqLen(), rslt);
+        }
+        if (completeCB)
+            completeCB(rslt, 0);
+        return true;
+    }
+
+    // Transaction
+    RaftI2CCentralIF::Transaction trans;
+    trans.address = addrAndSlot.addr;
+    trans.pWriteBuf = pReqRec->getWriteData();
+    trans.numToWrite = pReqRec->getWriteDataLen();
+    trans.pReadBuf = pReadBuf;
+    trans.numToRead = pReadBuf ? pReqRec->getReadReqLen() : 0;
+
+    // Set the bus frequency (waits for any queued transactions if it changes)
+    rslt = setBusFreqForAccess(addrAndSlot);
+    if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+    {
+        if (_traceRecorder.isEnabled())
+        {
+            uint64_t timeNowUs = BusI2CClock::nowUs();
+            _traceRecorder.record(timeNowUs, timeNowUs, addrAndSlot, pReqRec->getReqType(),
+                        trans.numToWrite, trans.numToRead, rslt);
+        }
+        if (completeCB)
+            completeCB(rslt, 0);
+        return true;
+    }
+
+    // Submit - the trace start time is the submission time as the transaction may be queued
+    uint64_t startUs = _traceRecorder.isEnabled() ? BusI2CClock::nowUs() : 0;
+    uint32_t reqType = pReqRec->getReqType();
+    uint32_t barAccessAfterSendMs = pReqRec->getBarAccessForMsAfterSend();
+    return _pI2CCentral->submit(trans, 
+            [this, addrAndSlot, startUs, reqType, barAccessAfterSendMs, completeCB](const RaftI2CCentralIF::Transaction& doneTrans)
+            {
+                // Record time of comms
+                _lastI2CCommsUs = BusI2CClock::nowUs();
+
+                // Trace
+                _traceRecorder.record(startUs, _lastI2CCommsUs, addrAndSlot, reqType,
+                            doneTrans.numToWrite, doneTrans.numToRead, doneTrans.rslt);
+
+                // Bar access to element if requested
+                if (barAccessAfterSendMs > 0)
+                    _busStatusMgr.barElemAccessSet(BusI2CClock::nowMs(), addrAndSlot, barAccessAfterSendMs);
+                if (completeCB)
+                    completeCB(doneTrans.rslt, doneTrans.numRead);
+            });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Wait for submitted I2C messages to complete
+/// @param waitAll - true to wait for all submitted messages, false to wait for at least one
+/// @return number of messages still outstanding
+uint32_t BusI2C::i2cWait(bool waitAll)
+{
+    if (!_pI2CCentral)
+        return 0;
+    while (_pI2CCentral->getNumQueued() > 0)
+    {
+        _pI2CCentral->waitAny(UINT32_MAX);
+        if (!waitAll)
+            break;
+    }
+    return _pI2CCentral->getNumQueued();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Send I2C message asynchronously and store result in the response queue
 /// @param pReqRec - contains the request details including address, write data, read data length, etc
@@ -504,7 +666,16 @@ RaftI2CCentralIF::AccessResultCode BusI2C::i2cSendAsync(const BusI2CRequestRec*
     BusI2CAddrAndSlot addrAndSlot = pReqRec->getAddrAndSlot();
     auto rslt = checkAddrValidAndNotBarred(addrAndSlot);
     if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+    {
+        if (_traceRecorder.isEnabled())
+        {
+            uint64_t timeNowUs = BusI2CClock::nowUs();
+            _traceRecorder.record(timeNowUs, timeNowUs, addrAndSlot, 
+                        pReqRec->getReqType() | BusI2CTraceRecorder::TRACE_FLAG_ASYNC,
+                        pReqRec->getWriteDataLen(), pReqRec->getReadReqLen(), rslt);
+        }
         return rslt;
+    }
 
     // Check if a bus extender slot is specified
     rslt = _busExtenderMgr.enableOneSlot(addrAndSlot.slotPlus1);
@@ -522,8 +693,15 @@ RaftI2CCentralIF::AccessResultCode BusI2C::i2cSendAsync(const BusI2CRequestRec*
     rslt = RaftI2CCentralIF::AccessResultCode::ACCESS_RESULT_NOT_INIT;
     if (!_pI2CCentral)
         return rslt;
-    rslt = _pI2CCentral->access(addrAndSlot.addr, pReqRec->getWriteData(), writeReqLen, 
-            readBuf, readReqLen, numBytesRead);
+    rslt = setBusFreqForAccess(addrAndSlot);
+    uint64_t startUs = _traceRecorder.isEnabled() ? BusI2CClock::nowUs() : 0;
+    if (rslt == RaftI2CCentralIF::ACCESS_RESULT_OK)
+        rslt = _pI2CCentral->access(addrAndSlot.addr, pReqRec->getWriteData(), writeReqLen, 
+                readBuf, readReqLen, numBytesRead);
+    if (_traceRecorder.isEnabled())
+        _traceRecorder.record(startUs, BusI2CClock::nowUs(), addrAndSlot,
+                    pReqRec->getReqType() | BusI2CTraceRecorder::TRACE_FLAG_ASYNC,
+                    writeReqLen, readReqLen, rslt);
 
     // Reset bus extenders to turn off all slots
     _busExtenderMgr.disableAllSlots(false);
@@ -537,10 +715,10 @@ RaftI2CCentralIF::AccessResultCode BusI2C::i2cSendAsync(const BusI2CRequestRec*
 
     // Bar access to element if requested
     if (barAccessAfterSendMs > 0)
-        _busStatusMgr.barElemAccessSet(millis(), addrAndSlot, barAccessAfterSendMs);
+        _busStatusMgr.barElemAccessSet(BusI2CClock::nowMs(), addrAndSlot, barAccessAfterSendMs);
 
     // Record time of comms
-    _lastI2CCommsUs = micros();
+    _lastI2CCommsUs = BusI2CClock::nowUs();
     return rslt;
 }
 
@@ -561,18 +739,55 @@ RaftI2CCentralIF::AccessResultCode BusI2C::checkAddrValidAndNotBarred(BusI2CAddr
 #ifdef ENFORCE_MIN_TIME_BETWEEN_I2C_COMMS_US
     // Check the last time a communication occurred - if less than the minimum between sends
     // then delay
-    while (!Raft::isTimeout(micros(), _lastI2CCommsUs, MIN_TIME_BETWEEN_I2C_COMMS_US))
+    while (!Raft::isTimeout(BusI2CClock::nowUs(), _lastI2CCommsUs, MIN_TIME_BETWEEN_I2C_COMMS_US))
     {
     }
 #endif
 
     // Check if this address is barred for a period
-    if (_busStatusMgr.barElemAccessGet(millis(), addrAndSlot))
+    if (_busStatusMgr.barElemAccessGet(BusI2CClock::nowMs(), addrAndSlot))
         return RaftI2CCentralIF::ACCESS_RESULT_BARRED;
 
     return RaftI2CCentralIF::ACCESS_RESULT_OK;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set the bus frequency to suit the element being accessed and any slot that is enabled
+/// @param addrAndSlot - address and slot of element
+/// @return ACCESS_RESULT_OK if the bus is at the required frequency, ACCESS_RESULT_NOT_READY if the central
+///         refused the change (the access must not go ahead as the devices may not support the current frequency)
+RaftI2CCentralIF::AccessResultCode BusI2C::setBusFreqForAccess(BusI2CAddrAndSlot addrAndSlot)
+{
+    // Check if any slot runs at other than the base frequency
+    if (!_busSpeedMgr.isSpeedSwitching() && (_curBusFreq == _freq))
+        return RaftI2CCentralIF::ACCESS_RESULT_OK;
+
+    // Devices on the enabled slot see the access too
+    uint32_t busFreq = _busSpeedMgr.getAccessFreq(addrAndSlot.slotPlus1, _busExtenderMgr.getSingleEnabledSlotPlus1());
+    if (busFreq == _curBusFreq)
+        return RaftI2CCentralIF::ACCESS_RESULT_OK;
+    // Submitted transactions must complete at the current frequency
+    while (_pI2CCentral->getNumQueued() > 0)
+        _pI2CCentral->waitAny(UINT32_MAX);
+    if (!_pI2CCentral->setBusFrequency(busFreq))
+    {
+        _busFreqChangeFailCount++;
+        if (Raft::isTimeout(BusI2CClock::nowMs(), _busFreqChangeFailLastWarnMs, BUS_FREQ_CHANGE_FAIL_WARN_INTERVAL_MS))
+        {
+            LOG_W(MODULE_PREFIX, "setBusFreqForAccess %s freq %d FAILED (cur %d) failCount %d",
+                        addrAndSlot.toString().c_str(), busFreq, _curBusFreq, _busFreqChangeFailCount);
+            _busFreqChangeFailLastWarnMs = BusI2CClock::nowMs();
+        }
+        return RaftI2CCentralIF::ACCESS_RESULT_NOT_READY;
+    }
+    _curBusFreq = busFreq;
+    _busFreqChangeCount++;
+#ifdef DEBUG_BUS_FREQ_CHANGE
+    LOG_I(MODULE_PREFIX, "setBusFreqForAccess %s freq %d", addrAndSlot.toString().c_str(), busFreq);
+#endif
+    return RaftI2CCentralIF::ACCESS_RESULT_OK;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Check if a bus element is responding
 /// @param address - address of element
@@ -599,7 +814,7 @@ void BusI2C::requestScan(bool enableSlowScan, bool requestFastScan)
 /// @param forPeriodMs - period in ms
 void BusI2C::hiatus(uint32_t forPeriodMs)
 {
-    _hiatusStartMs = millis();
+    _hiatusStartMs = BusI2CClock::nowMs();
     _hiatusForMs = forPeriodMs;
     _hiatusActive = true;
 #ifdef DEBUG_BUS_HIATUS
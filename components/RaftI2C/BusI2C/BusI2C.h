@@ -19,6 +19,8 @@
 #include "DevicePollingMgr.h"
 #include "BusPowerController.h"
 #include "BusStuckHandler.h"
+#include "BusI2CTraceRecorder.h"
+#include "BusSpeedMgr.h"
 
 // #define DEBUG_RAFT_BUSI2C_MEASURE_I2C_LOOP_TIME
 
@@ -62,6 +64,12 @@ public:
     /// @brief service (should be called frequently to service the bus)
     virtual void service() override final;
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief worker service - performs one iteration of the bus worker loop
+    /// @note Only call directly when the worker task is disabled ("workerTask":false in config) - this allows
+    ///       a simulation to step the bus deterministically (e.g. with a BusI2CVirtualClock)
+    void workerService();
+
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief clear response queue (and optionally clear polling data)
     /// @param incPolling - clear polling data
@@ -178,6 +186,77 @@ public:
         return _busStatusMgr.getBusElemPollResponses(address, isOnline, deviceTypeIndex, devicePollResponseData, responseSize, maxResponsesToReturn);
     }
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get bus element poll responses for a specific address along with the element's poll record counters
+    /// @param stats - (out) records produced, consumed, overwritten and dropped, the number unread and the age of
+    ///                the oldest unread record (after the responses are taken)
+    uint32_t getBusElemPollResponses(uint32_t address, bool& isOnline, uint16_t& deviceTypeIndex, 
+                std::vector<uint8_t>& devicePollResponseData, 
+                uint32_t& responseSize, uint32_t maxResponsesToReturn, PollDataAggregator::Stats& stats)
+    {
+        return _busStatusMgr.getBusElemPollResponses(address, isOnline, deviceTypeIndex, devicePollResponseData, 
+                    responseSize, maxResponsesToReturn, stats);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Subscribe to poll results as they are stored (pushed from a dispatch task - see PollDataDispatcher)
+    /// @param options - scope (one device, a device type or all devices), max deliveries per second, max results
+    ///                  per callback and queue size
+    /// @param callback - called with results for one device (return false to have them offered again later)
+    /// @return subscription ID (0 if failed)
+    uint32_t subscribePollData(const PollDataDispatcher::SubscriptionOptions& options, PollDataSubscriberCB callback)
+    {
+        return _busStatusMgr.getPollDataDispatcher().subscribe(options, callback);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Unsubscribe from poll results
+    /// @param subscriptionId - subscription ID
+    /// @return true if found
+    bool unsubscribePollData(uint32_t subscriptionId)
+    {
+        return _busStatusMgr.getPollDataDispatcher().unsubscribe(subscriptionId);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get stats for a poll result subscription
+    /// @param subscriptionId - subscription ID
+    /// @param stats - (out) results queued, delivered, dropped (queue full) and deferred (callback returned false)
+    /// @return true if found
+    bool getPollSubscriptionStats(uint32_t subscriptionId, PollDataDispatcher::SubscriptionStats& stats) const
+    {
+        return _busStatusMgr.getPollDataDispatcher().getSubscriptionStats(subscriptionId, stats);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get poll record counters for a bus element
+    /// @param address - address of device
+    /// @param stats - (out) record counters and age of the oldest unread record
+    /// @return true if the element was found
+    bool getBusElemPollStats(uint32_t address, PollDataAggregator::Stats& stats) const
+    {
+        return _busStatusMgr.getBusElemPollStats(address, stats);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get poll record counters summed over the bus (the age is of the oldest unread record on the bus)
+    /// @param stats - (out) record counters
+    void getBusPollStats(PollDataAggregator::Stats& stats) const
+    {
+        _busStatusMgr.getBusPollStats(stats);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Keep the oldest unread poll results of a bus element when its ring is full (new results are dropped
+    ///        and counted instead of overwriting)
+    /// @param address - address of device
+    /// @param blockOldest - true to keep the oldest results
+    /// @return true if the element was found
+    bool setBusElemPollBlockOldest(uint32_t address, bool blockOldest)
+    {
+        return _busStatusMgr.setBusElemPollBlockOldest(address, blockOldest);
+    }
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Get time of last bus status update
     /// @return time of last bus status update in ms
@@ -194,6 +273,92 @@ public:
         return _busStatusMgr.getBusPollResponsesJson(_deviceIdentMgr);
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get a snapshot of the poll responses of bus elements (taken with a single lock so it can be formatted
+    ///        without holding up the I2C task)
+    /// @param snapshot (out) snapshot (memory is reused between calls)
+    /// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+    /// @param pGeneration (out) generation to pass to the next call (can be nullptr)
+    /// @return true if the snapshot was taken
+    bool getBusPollSnapshot(BusI2CPollSnapshot& snapshot, uint32_t sinceGeneration = 0, uint32_t* pGeneration = nullptr)
+    {
+        return _busStatusMgr.getBusPollSnapshot(snapshot, sinceGeneration, pGeneration);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Decode poll responses (e.g. from a snapshot entry) into the poll record structs for the device type
+    ///        (poll_<deviceType> in DevicePollRecords_generated.h)
+    /// @param deviceTypeIndex device type index
+    /// @param pPollResponses poll responses (each is a timestamp followed by the poll result)
+    /// @param pollResponsesLen length of poll responses
+    /// @param pStructOut (out) array of poll record structs
+    /// @param maxRecs size of the array
+    /// @return number of records decoded (0 if the device type has no decoder)
+    uint32_t decodePollResponses(uint16_t deviceTypeIndex, const uint8_t* pPollResponses, uint32_t pollResponsesLen,
+                void* pStructOut, uint32_t maxRecs) const
+    {
+        return _deviceIdentMgr.decodePollResponses(deviceTypeIndex, pPollResponses, pollResponsesLen, pStructOut, maxRecs);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the number of probes made to identify devices (each distinct probe in the detection values of the
+    ///        device types which can be at an address is made at most once when identifying a device)
+    /// @return number of probes
+    uint32_t getNumDetectProbes() const
+    {
+        return _deviceIdentMgr.getNumDetectProbes();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get bus poll JSON for bus elements which have changed since a generation
+    /// @param sinceGeneration generation returned by a previous call (0 for all elements)
+    /// @param generation (out) generation to pass to the next call
+    /// @return JSON string
+    String getBusPollResponsesJson(uint32_t sinceGeneration, uint32_t& generation)
+    {
+        return _busStatusMgr.getBusPollResponsesJson(_deviceIdentMgr, sinceGeneration, &generation);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get bus poll responses for all identified bus elements in binary form (see BusStatusMgr for the format)
+    /// @param busNum bus number to put in the frame header
+    /// @param pBuf buffer to write to
+    /// @param bufMaxLen size of buffer
+    /// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+    /// @param pGeneration (out) generation to pass to the next call (can be nullptr)
+    /// @return number of bytes written
+    uint32_t getBusPollResponsesBinary(uint8_t busNum, uint8_t* pBuf, uint32_t bufMaxLen, 
+                uint32_t sinceGeneration = 0, uint32_t* pGeneration = nullptr)
+    {
+        return _busStatusMgr.getBusPollResponsesBinary(busNum, pBuf, bufMaxLen, sinceGeneration, pGeneration);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the status generation (incremented when any bus element changes online state or has new poll data)
+    /// @return generation
+    uint32_t getStatusGeneration() const
+    {
+        return _busStatusMgr.getStatusGeneration();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get addresses of bus elements which have changed since a generation
+    /// @param sinceGeneration generation returned by a previous call (0 for all elements)
+    /// @param addresses (out) addresses of changed elements
+    /// @return current generation (pass to the next call)
+    uint32_t getBusElemsChangedSince(uint32_t sinceGeneration, std::vector<uint32_t>& addresses) const
+    {
+        return _busStatusMgr.getBusElemsChangedSince(sinceGeneration, addresses);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get usage of the arena holding the poll results of all bus elements
+    /// @param stats (out) arena stats (including high-water mark and fragmentation)
+    void getPollArenaStats(PollDataArena::Stats& stats) const
+    {
+        _busStatusMgr.getPollArenaStats(stats);
+    }
+
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Convert bus address to string
     /// @param addr - address
@@ -215,6 +380,33 @@ public:
         return addrAndSlot.toCompositeAddrAndSlot();
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get transaction trace (enabled by "traceRecs" in config)
+    /// @param traceData - (out) binary trace (see BusI2CTraceRecorder::getTrace() for the format)
+    /// @param clearAfter - true to discard the returned records
+    /// @return number of records returned
+    /// @note scripts/ConvertI2CTraceToChrome.py converts the binary trace to Chrome trace / Perfetto JSON
+    uint32_t getTrace(std::vector<uint8_t>& traceData, bool clearAfter = false)
+    {
+        return _traceRecorder.getTrace(traceData, clearAfter);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get count of bus frequency changes made to suit the devices on each slot
+    /// @return count of changes
+    uint32_t getBusFreqChangeCount() const
+    {
+        return _busFreqChangeCount;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get count of bus frequency changes refused by the central (the access is failed with notReady)
+    /// @return count of failures
+    uint32_t getBusFreqChangeFailCount() const
+    {
+        return _busFreqChangeFailCount;
+    }
+
     // Yield value on each bus processing loop
     static const uint32_t I2C_BUS_LOOP_YIELD_MS = 5;
 
@@ -248,6 +440,9 @@ private:
     // Init ok
     bool _initOk = false;
 
+    // Worker task enabled (if disabled workerService() must be called by the owner)
+    bool _workerTaskEnabled = true;
+
     // Task that operates the bus
     volatile TaskHandle_t _i2cWorkerTaskHandle = nullptr;
     static const int DEFAULT_TASK_CORE = 0;
@@ -283,6 +478,16 @@ private:
     // Bus extender manager
     BusExtenderMgr _busExtenderMgr;
 
+    // Bus speed manager
+    BusSpeedMgr _busSpeedMgr;
+
+    // Current bus frequency and count of changes (and of changes refused by the central)
+    uint32_t _curBusFreq = 0;
+    uint32_t _busFreqChangeCount = 0;
+    uint32_t _busFreqChangeFailCount = 0;
+    uint32_t _busFreqChangeFailLastWarnMs = 0;
+    static const uint32_t BUS_FREQ_CHANGE_FAIL_WARN_INTERVAL_MS = 10000;
+
     // Device identifier
     DeviceIdentMgr _deviceIdentMgr;
 
@@ -299,6 +504,9 @@ private:
     static const uint32_t ELEM_BAR_I2C_ADDRESS_MAX = 127;
     uint32_t _busAccessBarMs[ELEM_BAR_I2C_ADDRESS_MAX+1];
 
+    // Transaction trace
+    BusI2CTraceRecorder _traceRecorder;
+
     // Debug
     uint32_t _debugLastBusLoopMs = 0;
 
@@ -309,5 +517,8 @@ private:
     // Helpers
     RaftI2CCentralIF::AccessResultCode i2cSendAsync(const BusI2CRequestRec* pReqRec, uint32_t pollListIdx);
     RaftI2CCentralIF::AccessResultCode i2cSendSync(const BusI2CRequestRec* pReqRec, std::vector<uint8_t>* pReadData);
+    bool i2cSubmit(const BusI2CRequestRec* pReqRec, uint8_t* pReadBuf, BusI2CReqCompleteCB completeCB);
+    uint32_t i2cWait(bool waitAll);
     RaftI2CCentralIF::AccessResultCode checkAddrValidAndNotBarred(BusI2CAddrAndSlot addrAndSlot);
+    RaftI2CCentralIF::AccessResultCode setBusFreqForAccess(BusI2CAddrAndSlot addrAndSlot);
 };
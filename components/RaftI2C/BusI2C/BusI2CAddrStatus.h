@@ -27,6 +27,12 @@ public:
     bool wasOnceOnline : 1 = false;
     bool slotResolved : 1 = false;
 
+    // Keep the oldest unread poll results when the ring is full (drop new ones) - kept over re-identification
+    bool pollBlockOldest : 1 = false;
+
+    // Generation of last change (online state or poll data) - see BusStatusMgr
+    uint32_t generation = 0;
+
     // Access barring
     uint32_t barStartMs = 0;
     uint16_t barDurationMs = 0;
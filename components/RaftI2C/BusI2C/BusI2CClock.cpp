@@ -0,0 +1,13 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Clock
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BusI2CClock.h"
+
+// System clock is used unless another clock is set
+BusI2CClock BusI2CClock::_systemClock;
+BusI2CClock* BusI2CClock::_pClock = &BusI2CClock::_systemClock;
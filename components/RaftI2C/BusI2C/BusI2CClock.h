@@ -0,0 +1,87 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Clock
+// Single source of time for the I2C bus subsystems - can be replaced (e.g. by a virtual clock) for simulation
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "RaftArduino.h"
+
+class BusI2CClock
+{
+public:
+    virtual ~BusI2CClock()
+    {
+    }
+
+    /// @brief Get time in microseconds
+    /// @return time in microseconds
+    virtual uint64_t getMicros() const
+    {
+        return micros();
+    }
+
+    /// @brief Get time in milliseconds
+    /// @return time in milliseconds
+    virtual uint32_t getMillis() const
+    {
+        return getMicros() / 1000;
+    }
+
+    /// @brief Set the clock used by all I2C bus subsystems
+    /// @param pClock clock (nullptr to restore the system clock) - must remain valid while in use
+    /// @note Set before BusI2C::setup() as subsystems retain timestamps from the clock in use
+    static void setClock(BusI2CClock* pClock)
+    {
+        _pClock = pClock ? pClock : &_systemClock;
+    }
+
+    /// @brief Get time now in microseconds from the clock in use
+    static uint64_t nowUs()
+    {
+        return _pClock->getMicros();
+    }
+
+    /// @brief Get time now in milliseconds from the clock in use
+    static uint32_t nowMs()
+    {
+        return _pClock->getMillis();
+    }
+
+private:
+    static BusI2CClock _systemClock;
+    static BusI2CClock* _pClock;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Virtual clock which only advances when told to
+/// @note Used for deterministic simulation - time can be advanced much faster than real time
+class BusI2CVirtualClock : public BusI2CClock
+{
+public:
+    BusI2CVirtualClock(uint64_t startUs = 0)
+        : _timeUs(startUs)
+    {
+    }
+    virtual uint64_t getMicros() const override
+    {
+        return _timeUs.load();
+    }
+    void setUs(uint64_t timeUs)
+    {
+        _timeUs.store(timeUs);
+    }
+    void advanceUs(uint64_t deltaUs)
+    {
+        _timeUs.fetch_add(deltaUs);
+    }
+
+private:
+    std::atomic<uint64_t> _timeUs;
+};
@@ -12,7 +12,10 @@
 #include "RaftArduino.h"
 
 // Use replacement I2C library - if not defined use original ESP IDF I2C implementation
+// Host builds (RAFT_I2C_HOST_BUILD) have no hardware central - one must be passed to BusI2C
+#ifndef RAFT_I2C_HOST_BUILD
 #define I2C_USE_RAFT_I2C
+#endif
 // #define I2C_USE_ESP_IDF_5
 
 // I2C addresses
@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus JSON Writer
+//
+// Writes JSON into a single buffer sized up front by the caller (using the length helpers) so publishing
+// bus status doesn't build temporary strings
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "BusI2CAddrAndSlot.h"
+
+class BusI2CJsonWriter
+{
+public:
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Constructor
+    /// @param pBuf buffer to write to (a terminator is written after the content)
+    /// @param bufLen size of buffer including space for the terminator
+    BusI2CJsonWriter(char* pBuf, uint32_t bufLen)
+        : _pBuf(pBuf), _bufLen(bufLen)
+    {
+        if (_pBuf && (_bufLen > 0))
+            _pBuf[0] = 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Add a string
+    void addStr(const char* pStr, uint32_t len)
+    {
+        char* pOut = reserve(len);
+        if (pOut)
+            memcpy(pOut, pStr, len);
+    }
+    void addStr(const char* pStr)
+    {
+        addStr(pStr, strlen(pStr));
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Add a character
+    void addChar(char c)
+    {
+        char* pOut = reserve(1);
+        if (pOut)
+            *pOut = c;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Add an address and slot in the same form as BusI2CAddrAndSlot::toString() (e.g. 0x60@3)
+    void addAddrAndSlot(BusI2CAddrAndSlot addrAndSlot)
+    {
+        char* pOut = reserve(addrAndSlotLen(addrAndSlot));
+        if (!pOut)
+            return;
+        *pOut++ = '0';
+        *pOut++ = 'x';
+        for (int shift = (numHexDigits(addrAndSlot.addr) - 1) * 4; shift >= 0; shift -= 4)
+            *pOut++ = HEX_CHARS[(addrAndSlot.addr >> shift) & 0x0f];
+        *pOut++ = '@';
+        uint32_t divisor = 1;
+        for (uint32_t i = 1; i < numDecDigits(addrAndSlot.slotPlus1); i++)
+            divisor *= 10;
+        for (; divisor > 0; divisor /= 10)
+            *pOut++ = '0' + (addrAndSlot.slotPlus1 / divisor) % 10;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Add an unsigned decimal number
+    void addUint(uint64_t val)
+    {
+        uint32_t numDigits = numDecDigits(val);
+        char* pOut = reserve(numDigits);
+        if (!pOut)
+            return;
+        for (uint32_t i = numDigits; i > 0; i--, val /= 10)
+            pOut[i - 1] = '0' + val % 10;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Add bytes as hex
+    void addHex(const uint8_t* pData, uint32_t len)
+    {
+        char* pOut = reserve(hexLen(len));
+        if (pOut)
+            hexEncode(pOut, pData, len);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Reserve space to be written directly
+    /// @param len number of characters
+    /// @return pointer to write to or nullptr if there isn't room (the writer is then marked as overflowed)
+    char* reserve(uint32_t len)
+    {
+        if (!_pBuf || (_pos + len + 1 > _bufLen))
+        {
+            _isOverflow = true;
+            return nullptr;
+        }
+        char* pOut = _pBuf + _pos;
+        _pos += len;
+        _pBuf[_pos] = 0;
+        return pOut;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get length written (excluding terminator)
+    uint32_t length() const
+    {
+        return _pos;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if anything didn't fit
+    bool isOverflow() const
+    {
+        return _isOverflow;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Encode bytes as lower-case hex (2 characters per byte, no terminator)
+    static void hexEncode(char* pOut, const uint8_t* pData, uint32_t len)
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            *pOut++ = HEX_CHARS[pData[i] >> 4];
+            *pOut++ = HEX_CHARS[pData[i] & 0x0f];
+        }
+    }
+
+    // Lengths for sizing the buffer
+    static uint32_t hexLen(uint32_t numBytes)
+    {
+        return numBytes * 2;
+    }
+    static uint32_t addrAndSlotLen(BusI2CAddrAndSlot addrAndSlot)
+    {
+        return 3 + numHexDigits(addrAndSlot.addr) + numDecDigits(addrAndSlot.slotPlus1);
+    }
+    static uint32_t uintLen(uint64_t val)
+    {
+        return numDecDigits(val);
+    }
+
+private:
+    char* _pBuf = nullptr;
+    uint32_t _bufLen = 0;
+    uint32_t _pos = 0;
+    bool _isOverflow = false;
+
+    // Nibble table
+    static constexpr const char* HEX_CHARS = "0123456789abcdef";
+
+    static uint32_t numHexDigits(uint32_t val)
+    {
+        uint32_t numDigits = 1;
+        while (val >= 16)
+        {
+            val >>= 4;
+            numDigits++;
+        }
+        return numDigits;
+    }
+    static uint32_t numDecDigits(uint64_t val)
+    {
+        uint32_t numDigits = 1;
+        while (val >= 10)
+        {
+            val /= 10;
+            numDigits++;
+        }
+        return numDigits;
+    }
+};
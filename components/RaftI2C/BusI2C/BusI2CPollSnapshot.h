@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Poll Snapshot
+//
+// Poll responses from all bus elements taken in one go (see BusStatusMgr::getBusPollSnapshot) so they can be
+// formatted without holding the bus element status lock
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "BusI2CAddrAndSlot.h"
+#include "PollTimestamp.h"
+
+class BusI2CPollSnapshot
+{
+public:
+    // Index entry for each bus element
+    struct Entry
+    {
+        BusI2CAddrAndSlot addrAndSlot;
+        bool isOnline = false;
+        uint16_t deviceTypeIndex = 0;
+        uint32_t resultSize = 0;
+        uint32_t numResults = 0;
+        uint32_t dataOffset = 0;
+        // Timestamp format of the results and time of the last result in us (see PollTimestamp::getTimesUs)
+        PollTimestamp::Format timestampFormat = PollTimestamp::FORMAT_MS16;
+        uint64_t lastTimeUs = 0;
+        // Results stored for each downsampling window (0 if not downsampled - see PollDataWindow) and the
+        // position within its window of the first result (0 minimum, 1 maximum, 2 mean)
+        uint32_t resultsPerWindow = 0;
+        uint32_t windowIdx = 0;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Clear (keeps the memory for the next snapshot)
+    void clear()
+    {
+        _entries.clear();
+        _dataLen = 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the entries
+    const std::vector<Entry>& entries() const
+    {
+        return _entries;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the results for an entry (numResults results of resultSize bytes, oldest first)
+    const uint8_t* getData(const Entry& entry) const
+    {
+        return _data.data() + entry.dataOffset;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get total length of result data
+    uint32_t getDataLen() const
+    {
+        return _dataLen;
+    }
+
+private:
+    friend class BusStatusMgr;
+
+    // Index table
+    std::vector<Entry> _entries;
+
+    // Result data for all entries (only grows so snapshots after the first don't allocate)
+    std::vector<uint8_t> _data;
+    uint32_t _dataLen = 0;
+};
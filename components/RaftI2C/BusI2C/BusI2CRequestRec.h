@@ -154,3 +154,14 @@ typedef std::function<RaftI2CCentralIF::AccessResultCode(const BusI2CRequestRec*
 
 // Callback to send i2c message (sync)
 typedef std::function<RaftI2CCentralIF::AccessResultCode(const BusI2CRequestRec* pReqRec, std::vector<uint8_t>* pReadData)> BusI2CReqSyncFn;
+
+// Callback when a submitted i2c message completes
+typedef std::function<void(RaftI2CCentralIF::AccessResultCode rslt, uint32_t numRead)> BusI2CReqCompleteCB;
+
+// Callback to submit i2c message without waiting for it to complete (returns false if the queue is full)
+// The request and read buffer must remain valid until completeCB is called
+typedef std::function<bool(const BusI2CRequestRec* pReqRec, uint8_t* pReadBuf, BusI2CReqCompleteCB completeCB)> BusI2CReqSubmitFn;
+
+// Callback to wait for submitted i2c messages (waitAll false waits for at least one to complete)
+// Returns the number still outstanding
+typedef std::function<uint32_t(bool waitAll)> BusI2CReqWaitFn;
@@ -7,6 +7,7 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BusI2CScheduler.h"
+#include "BusI2CClock.h"
 
 static const char* MODULE_PREFIX = "BusI2CSched";
 
@@ -102,17 +103,17 @@ int BusI2CScheduler::getNext()
         _pollCurIdx = 0;
 
     // Check if poll time elapsed for fastest element
-    if ((_pollCurIdx == _elemWithFastestRateIdx) && (!Raft::isTimeout(millis(), _pollLastTimeMs, _pollMinTimeMs)))
+    if ((_pollCurIdx == _elemWithFastestRateIdx) && (!Raft::isTimeout(BusI2CClock::nowMs(), _pollLastTimeMs, _pollMinTimeMs)))
         return -1;
 
 #ifdef DEBUG_POLLING_NEXT
     LOG_I(MODULE_PREFIX, "getNext time for next poll lastTimeMs %d elapsed %d fastestRateIdx %d curIdx %d curCount[curIdx] %d totalCount[curIdx] %d", 
-                _pollLastTimeMs, (int)Raft::timeElapsed(millis(), _pollLastTimeMs), _elemWithFastestRateIdx, 
+                _pollLastTimeMs, (int)Raft::timeElapsed(BusI2CClock::nowMs(), _pollLastTimeMs), _elemWithFastestRateIdx, 
                 _pollCurIdx, _pollCountCur[_pollCurIdx], _pollCountTotal[_pollCurIdx]);
 #endif
 
     // Loop through to find the next element to service
-    for (int i = 0; i < _pollFreqsHz.size(); i++)
+    for (uint32_t i = 0; i < _pollFreqsHz.size(); i++)
     {
         // Bump the current index and ensure valid
         _pollCurIdx++;
@@ -126,7 +127,7 @@ int BusI2CScheduler::getNext()
             _pollCountCur[_pollCurIdx] = 0;
             // ESP_LOGV("SchedulerRRP", "returning %d", _pollCurIdx);
             if (_pollCurIdx == _elemWithFastestRateIdx)
-                _pollLastTimeMs = millis();
+                _pollLastTimeMs = BusI2CClock::nowMs();
 
             // When we come back check the next index
 #ifdef DEBUG_POLLING_NEXT
@@ -137,7 +138,7 @@ int BusI2CScheduler::getNext()
     }
 
     // Should never get here
-    _pollLastTimeMs = millis();
+    _pollLastTimeMs = BusI2CClock::nowMs();
     LOG_D(MODULE_PREFIX, "SchedulerRRP: dropped out");
     return -1;
 }
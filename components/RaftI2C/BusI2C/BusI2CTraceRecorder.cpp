@@ -0,0 +1,104 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Trace Recorder
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "BusI2CTraceRecorder.h"
+#include "Logger.h"
+
+// #define DEBUG_BUS_I2C_TRACE_SETUP
+
+#ifdef DEBUG_BUS_I2C_TRACE_SETUP
+static const char* MODULE_PREFIX = "BusI2CTrace";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Setup the trace buffer
+/// @param maxRecs number of records to keep (rounded up to a power of 2 of at least 2, 0 disables tracing)
+void BusI2CTraceRecorder::setup(uint32_t maxRecs)
+{
+    // Round up to power of 2 so the ring index is a mask (a ring of 1 would have a mask of 0 which means
+    // disabled)
+    if (maxRecs > TRACE_MAX_RECS)
+        maxRecs = TRACE_MAX_RECS;
+    uint32_t numRecs = 0;
+    if (maxRecs > 0)
+    {
+        numRecs = 2;
+        while (numRecs < maxRecs)
+            numRecs <<= 1;
+    }
+
+    // Allocate
+    _recMask = 0;
+    _recs.clear();
+    _recs.shrink_to_fit();
+    _recs.resize(numRecs);
+    _writeCount.store(0);
+    _readCount = 0;
+    _recMask = numRecs > 0 ? numRecs - 1 : 0;
+
+#ifdef DEBUG_BUS_I2C_TRACE_SETUP
+    LOG_I(MODULE_PREFIX, "setup numRecs %d bytes %d", numRecs, numRecs * sizeof(BusI2CTraceRec));
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the trace as a binary dump (header followed by records oldest first)
+/// @param traceData (out) binary trace data
+/// @param clearAfter true to discard the returned records from the buffer
+/// @return number of records returned
+/// @note Header is: magic (u32), version (u8), record size (u8), reserved (u16), num records (u32),
+///       total recorded (u32) - all little-endian
+uint32_t BusI2CTraceRecorder::getTrace(std::vector<uint8_t>& traceData, bool clearAfter)
+{
+    // Records available
+    uint32_t numBufRecs = _recMask ? _recMask + 1 : 0;
+    uint32_t writeCountBefore = _writeCount.load(std::memory_order_acquire);
+    uint32_t numRecs = writeCountBefore - _readCount;
+    if (numRecs > numBufRecs)
+        numRecs = numBufRecs;
+    uint32_t firstIdx = writeCountBefore - numRecs;
+
+    // Copy records
+    std::vector<BusI2CTraceRec> recs(numRecs);
+    for (uint32_t i = 0; i < numRecs; i++)
+        recs[i] = _recs[(firstIdx + i) & _recMask];
+
+    // Discard any records which the worker may have overwritten during the copy (the record at the
+    // current write index may be partially written so is also excluded)
+    uint32_t writeCountAfter = _writeCount.load(std::memory_order_acquire);
+    uint32_t numDiscard = 0;
+    if (numRecs > 0)
+    {
+        int32_t overlap = (int32_t)(writeCountAfter - numBufRecs + 1 - firstIdx);
+        if (overlap > 0)
+            numDiscard = (uint32_t)overlap > numRecs ? numRecs : overlap;
+    }
+    numRecs -= numDiscard;
+
+    // Header
+    traceData.resize(TRACE_HEADER_BYTES + numRecs * sizeof(BusI2CTraceRec));
+    uint8_t* pData = traceData.data();
+    uint32_t magic = TRACE_MAGIC;
+    memcpy(pData, &magic, sizeof(magic));
+    pData[4] = TRACE_VERSION;
+    pData[5] = sizeof(BusI2CTraceRec);
+    pData[6] = 0;
+    pData[7] = 0;
+    memcpy(pData + 8, &numRecs, sizeof(numRecs));
+    memcpy(pData + 12, &writeCountAfter, sizeof(writeCountAfter));
+
+    // Records
+    if (numRecs > 0)
+        memcpy(pData + TRACE_HEADER_BYTES, recs.data() + numDiscard, numRecs * sizeof(BusI2CTraceRec));
+
+    // Clear if required
+    if (clearAfter)
+        _readCount = firstIdx + numDiscard + numRecs;
+    return numRecs;
+}
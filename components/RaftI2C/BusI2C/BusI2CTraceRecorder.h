@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Trace Recorder
+// Fixed-size binary ring buffer of I2C transactions for timing analysis without logging from the hot path
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "RaftI2CCentralIF.h"
+#include "BusI2CAddrAndSlot.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Trace record (16 bytes, little-endian when dumped)
+struct BusI2CTraceRec
+{
+    // Start time (low 32 bits of BusI2CClock::nowUs())
+    uint32_t startUs;
+    // Duration of the transaction (0 if rejected before reaching the bus)
+    uint32_t durationUs;
+    // Composite address and slot (see BusI2CAddrAndSlot::toCompositeAddrAndSlot)
+    uint16_t addrAndSlot;
+    // Write and read lengths (saturated at 0xffff)
+    uint16_t writeLen;
+    uint16_t readLen;
+    // Request type (BusReqType) with TRACE_FLAG_ASYNC set for i2cSendAsync
+    uint8_t reqType;
+    // RaftI2CCentralIF::AccessResultCode
+    uint8_t resultCode;
+};
+static_assert(sizeof(BusI2CTraceRec) == 16, "BusI2CTraceRec must be 16 bytes");
+
+class BusI2CTraceRecorder
+{
+public:
+    BusI2CTraceRecorder()
+    {
+    }
+
+    /// @brief Setup the trace buffer
+    /// @param maxRecs number of records to keep (rounded up to a power of 2 of at least 2, 0 disables tracing)
+    void setup(uint32_t maxRecs);
+
+    /// @brief Check if tracing is enabled
+    bool isEnabled() const
+    {
+        return _recMask != 0;
+    }
+
+    /// @brief Record a transaction
+    /// @param startUs time the transaction started
+    /// @param endUs time the transaction ended
+    /// @param addrAndSlot address and slot
+    /// @param reqType request type (and TRACE_FLAG_ASYNC if sent asynchronously)
+    /// @param writeLen number of bytes written
+    /// @param readLen number of bytes requested
+    /// @param resultCode result of the access
+    /// @note Must only be called from one thread (the I2C worker)
+    inline void record(uint64_t startUs, uint64_t endUs, BusI2CAddrAndSlot addrAndSlot, uint32_t reqType,
+                uint32_t writeLen, uint32_t readLen, RaftI2CCentralIF::AccessResultCode resultCode)
+    {
+        if (!_recMask)
+            return;
+        uint32_t writeCount = _writeCount.load(std::memory_order_relaxed);
+        BusI2CTraceRec& rec = _recs[writeCount & _recMask];
+        rec.startUs = (uint32_t)startUs;
+        rec.durationUs = (uint32_t)(endUs - startUs);
+        rec.addrAndSlot = addrAndSlot.toCompositeAddrAndSlot();
+        rec.writeLen = writeLen > 0xffff ? 0xffff : writeLen;
+        rec.readLen = readLen > 0xffff ? 0xffff : readLen;
+        rec.reqType = reqType;
+        rec.resultCode = resultCode;
+        _writeCount.store(writeCount + 1, std::memory_order_release);
+    }
+
+    /// @brief Get the trace as a binary dump (header followed by records oldest first)
+    /// @param traceData (out) binary trace data
+    /// @param clearAfter true to discard the returned records from the buffer
+    /// @return number of records returned
+    /// @note Safe to call from any thread - records overwritten while copying are discarded (as is the oldest
+    ///       record of a full buffer as the worker may be overwriting it)
+    uint32_t getTrace(std::vector<uint8_t>& traceData, bool clearAfter);
+
+    /// @brief Get total number of records made since setup (including those overwritten)
+    uint32_t getTotalRecorded() const
+    {
+        return _writeCount.load(std::memory_order_acquire);
+    }
+
+    // Flag ORed into the request type for asynchronous sends
+    static const uint32_t TRACE_FLAG_ASYNC = 0x80;
+
+    // Binary dump header
+    static const uint32_t TRACE_MAGIC = 0x54324952; // "RI2T" little-endian
+    static const uint32_t TRACE_VERSION = 1;
+    static const uint32_t TRACE_HEADER_BYTES = 16;
+
+    // Max records
+    static const uint32_t TRACE_MAX_RECS = 65536;
+
+private:
+    // Records
+    std::vector<BusI2CTraceRec> _recs;
+    uint32_t _recMask = 0;
+
+    // Count of records written (index of next record is _writeCount & _recMask)
+    std::atomic<uint32_t> _writeCount = 0;
+
+    // Count of records at the last getTrace() with clearAfter set
+    uint32_t _readCount = 0;
+};
@@ -10,6 +10,7 @@
 #include "RaftUtils.h"
 #include "Logger.h"
 #include "RaftJson.h"
+#include "BusI2CClock.h"
 
 #define DEBUG_POWER_CONTROL_SETUP
 // #define DEBUG_POWER_CONTROL_STATES
@@ -158,7 +159,7 @@ void BusPowerController::powerCycleSlot(uint32_t slotPlus1)
         pPwrCtrlRec->setVoltageLevel(slotIdx, POWER_CONTROL_OFF);
 
         // Set the state to power off pending cycling
-        slotRec.setState(SLOT_POWER_OFF_PENDING_CYCLING, millis());
+        slotRec.setState(SLOT_POWER_OFF_PENDING_CYCLING, BusI2CClock::nowMs());
     }
 }
 
@@ -182,7 +183,7 @@ void BusPowerController::taskService(uint64_t timeNowUs)
                 case SLOT_POWER_OFF_PERMANENTLY:
                     break;
                 case SLOT_POWER_OFF_PRE_INIT:
-                    if (Raft::isTimeout(millis(), slotRec.pwrCtrlStateLastMs, STARTUP_POWER_OFF_MS))
+                    if (Raft::isTimeout(timeNowMs, slotRec.pwrCtrlStateLastMs, STARTUP_POWER_OFF_MS))
                     {
 #ifdef DEBUG_POWER_CONTROL_STATES
                         LOG_I(MODULE_PREFIX, "taskService slotPlus1 %d slotIdx %d init voltage off", pwrCtrlRec.minSlotPlus1 + slotIdx, slotIdx);
@@ -192,7 +193,7 @@ void BusPowerController::taskService(uint64_t timeNowUs)
                     }
                     break;
                 case SLOT_POWER_ON_WAIT_STABLE:
-                    if (Raft::isTimeout(millis(), slotRec.pwrCtrlStateLastMs, VOLTAGE_STABILIZING_TIME_MS))
+                    if (Raft::isTimeout(timeNowMs, slotRec.pwrCtrlStateLastMs, VOLTAGE_STABILIZING_TIME_MS))
                     {
 #ifdef DEBUG_POWER_CONTROL_STATES
                         LOG_I(MODULE_PREFIX, "taskService slotPlus1 %d slotIdx %d voltage is stable", pwrCtrlRec.minSlotPlus1 + slotIdx, slotIdx);
@@ -201,7 +202,7 @@ void BusPowerController::taskService(uint64_t timeNowUs)
                     }
                     break;
                 case SLOT_POWER_OFF_PENDING_CYCLING:
-                    if (Raft::isTimeout(millis(), slotRec.pwrCtrlStateLastMs, POWER_CYCLE_OFF_TIME_MS))
+                    if (Raft::isTimeout(timeNowMs, slotRec.pwrCtrlStateLastMs, POWER_CYCLE_OFF_TIME_MS))
                     {
 #ifdef DEBUG_POWER_CONTROL_STATES
                         LOG_I(MODULE_PREFIX, "taskService slotPlus1 %d slotIdx %d voltage 3V3", pwrCtrlRec.minSlotPlus1 + slotIdx, slotIdx);
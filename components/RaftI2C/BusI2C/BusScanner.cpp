@@ -9,6 +9,7 @@
 #include "RaftUtils.h"
 #include "BusScanner.h"
 #include "BusI2CRequestRec.h"
+#include "BusI2CClock.h"
 
 // #define DEBUG_BUS_SCANNER
 // #define DEBUG_MOVE_TO_NORMAL_SCANNING
@@ -23,10 +24,11 @@ static const char* MODULE_PREFIX = "BusScanner";
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Constructor
 BusScanner::BusScanner(BusStatusMgr& busStatusMgr, BusExtenderMgr& busExtenderMgr, 
-                DeviceIdentMgr& deviceIdentMgr, BusI2CReqSyncFn busI2CReqSyncFn) :
+                DeviceIdentMgr& deviceIdentMgr, BusSpeedMgr& busSpeedMgr, BusI2CReqSyncFn busI2CReqSyncFn) :
     _busStatusMgr(busStatusMgr),
     _busExtenderMgr(busExtenderMgr),
     _deviceIdentMgr(deviceIdentMgr),
+    _busSpeedMgr(busSpeedMgr),
     _busI2CReqSyncFn(busI2CReqSyncFn)
 {
 }
@@ -114,7 +116,7 @@ bool BusScanner::taskService(uint64_t curTimeUs, uint64_t maxFastTimeInLoopUs, u
     // Time of last scan
     uint32_t curTimeMs = curTimeUs / 1000;
     _scanLastMs = curTimeMs;
-    uint64_t scanLoopStartTimeUs = micros();
+    uint64_t scanLoopStartTimeUs = BusI2CClock::nowUs();
     bool sweepCompleted = false;
 
 #ifdef DEBUG_SCANNING_SWEEP_TIME
@@ -150,12 +152,16 @@ bool BusScanner::taskService(uint64_t curTimeUs, uint64_t maxFastTimeInLoopUs, u
                     break;
 
                 // Scan main bus elements - simple linear scanning with all slots turned off
+                // (not ready means the access wasn't attempted, e.g. the bus frequency couldn't be set)
                 RaftI2CCentralIF::AccessResultCode rslt = scanOneAddress(addr);
-                _busExtenderMgr.elemStateChange(addr, rslt == RaftI2CCentralIF::ACCESS_RESULT_OK);
-                updateBusElemState(addr, 0, rslt);
+                if (rslt != RaftI2CCentralIF::ACCESS_RESULT_NOT_READY)
+                {
+                    _busExtenderMgr.elemStateChange(addr, rslt == RaftI2CCentralIF::ACCESS_RESULT_OK);
+                    updateBusElemState(addr, 0, rslt);
+                }
 
                 // Check sweep completed or timeout
-                if (sweepCompleted || Raft::isTimeout(micros(), scanLoopStartTimeUs, maxFastTimeInLoopUs))
+                if (sweepCompleted || Raft::isTimeout(BusI2CClock::nowUs(), scanLoopStartTimeUs, maxFastTimeInLoopUs))
                     break;
             }
             break;
@@ -193,7 +199,8 @@ bool BusScanner::taskService(uint64_t curTimeUs, uint64_t maxFastTimeInLoopUs, u
                 {
                     // Handle the scan
                     rslt = scanOneAddress(addr);
-                    updateBusElemState(addr, slotPlus1, rslt);
+                    if (rslt != RaftI2CCentralIF::ACCESS_RESULT_NOT_READY)
+                        updateBusElemState(addr, slotPlus1, rslt);
                 }
                 else if (rslt == RaftI2CCentralIF::ACCESS_RESULT_BUS_STUCK)
                 {
@@ -208,7 +215,7 @@ bool BusScanner::taskService(uint64_t curTimeUs, uint64_t maxFastTimeInLoopUs, u
                 }
 
                 // Check sweepComplete or timeout
-                if (sweepCompleted || Raft::isTimeout(micros(), scanLoopStartTimeUs, _scanState == SCAN_STATE_SCAN_FAST ? maxFastTimeInLoopUs : maxSlowTimeInLoopUs))
+                if (sweepCompleted || Raft::isTimeout(BusI2CClock::nowUs(), scanLoopStartTimeUs, _scanState == SCAN_STATE_SCAN_FAST ? maxFastTimeInLoopUs : maxSlowTimeInLoopUs))
                     break;
             }
 
@@ -227,7 +234,7 @@ bool BusScanner::taskService(uint64_t curTimeUs, uint64_t maxFastTimeInLoopUs, u
             uint32_t sweepTimeMs = Raft::timeElapsed(curTimeMs, _scanPriorityRecs[startingScanAddressList]._debugScanSweepStartMs);
             LOG_I(MODULE_PREFIX, "taskService %s priority %d sweep completed time %dms (next priority %d)", 
                         getScanStateStr(_scanState), startingScanAddressList, sweepTimeMs, _scanAddressesCurrentList);
-            _scanPriorityRecs[startingScanAddressList]._debugScanSweepStartMs = millis();
+            _scanPriorityRecs[startingScanAddressList]._debugScanSweepStartMs = BusI2CClock::nowMs();
         }
 #endif
 
@@ -306,7 +313,7 @@ bool BusScanner::getAddrAndGetSlotToScanNext(uint32_t& addr, uint32_t& slotPlus1
         if (addressesOnSlotDone)
         {
             // Find the next list that is ready to process
-            for (int i = 0; i < _scanPriorityLists.size(); i++)
+            for (uint32_t i = 0; i < _scanPriorityLists.size(); i++)
             {
                 // Get the next list
                 _scanAddressesCurrentList++;
@@ -535,5 +542,14 @@ void BusScanner::updateBusElemState(uint32_t addr, uint32_t slot, RaftI2CCentral
 
         // Set device status into bus status manager for this address
         _busStatusMgr.setBusElemDeviceStatus(BusI2CAddrAndSlot(addr, slot), deviceStatus);
+
+        // Limit bus speed if the device type requires it
+        if (deviceStatus.isValid())
+            _busSpeedMgr.setElemMaxFreq(BusI2CAddrAndSlot(addr, slot), _deviceIdentMgr.getDeviceMaxFreq(deviceStatus.getDeviceTypeIndex()));
+    }
+    else if (isChange)
+    {
+        // Device gone so remove any speed limit
+        _busSpeedMgr.setElemMaxFreq(BusI2CAddrAndSlot(addr, slot), 0);
     }
 }
@@ -16,6 +16,7 @@
 #include "RaftI2CCentralIF.h"
 #include "BusI2CRequestRec.h"
 #include "DeviceIdentMgr.h"
+#include "BusSpeedMgr.h"
 
 // #define DEBUG_SCANNING_SWEEP_TIME
 
@@ -23,7 +24,7 @@ class BusScanner {
 
 public:
     BusScanner(BusStatusMgr& busStatusMgr, BusExtenderMgr& BusExtenderMgr,
-                DeviceIdentMgr& deviceIdentMgr, BusI2CReqSyncFn busI2CReqSyncFn);
+                DeviceIdentMgr& deviceIdentMgr, BusSpeedMgr& busSpeedMgr, BusI2CReqSyncFn busI2CReqSyncFn);
     ~BusScanner();
     void setup(const RaftJsonIF& config);
     void service();
@@ -118,6 +119,9 @@ private:
     // Device ident manager
     DeviceIdentMgr& _deviceIdentMgr;
 
+    // Bus speed manager
+    BusSpeedMgr& _busSpeedMgr;
+
     // Bus i2c request function (synchronous)
     BusI2CReqSyncFn _busI2CReqSyncFn = nullptr;
 
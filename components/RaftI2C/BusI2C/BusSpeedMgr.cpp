@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Speed Manager
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BusSpeedMgr.h"
+#include "Logger.h"
+#include "RaftJson.h"
+
+// #define DEBUG_BUS_SPEED_MGR_SETUP
+// #define DEBUG_BUS_SPEED_MGR_ELEM_MAX_FREQ
+
+static const char* MODULE_PREFIX = "BusSpeedMgr";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Constructor
+BusSpeedMgr::BusSpeedMgr()
+{
+    updateAccessFreqs();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Destructor
+BusSpeedMgr::~BusSpeedMgr()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Setup
+/// @param config Configuration
+/// @note slotFreqs is an array of objects of the form {"slotPlus1":N,"freq":F} and allows slots which only have
+///       fast devices to run faster (or slow devices to run slower) than i2cFreq
+void BusSpeedMgr::setup(const RaftJsonIF& config)
+{
+    // Base frequency
+    _baseFreq = config.getLong("i2cFreq", DEFAULT_BUS_FREQ);
+    if (_baseFreq == 0)
+        _baseFreq = DEFAULT_BUS_FREQ;
+
+    // Slot frequencies
+    for (uint32_t i = 0; i < SLOTS_PLUS1_MAX; i++)
+        _slotConfigFreq[i] = 0;
+    std::vector<String> slotFreqArray;
+    config.getArrayElems("slotFreqs", slotFreqArray);
+    for (RaftJson slotFreqElem : slotFreqArray)
+    {
+        uint32_t slotPlus1 = slotFreqElem.getLong("slotPlus1", 0);
+        uint32_t freq = slotFreqElem.getLong("freq", 0);
+        if ((slotPlus1 == 0) || (slotPlus1 >= SLOTS_PLUS1_MAX) || (freq == 0))
+        {
+            LOG_W(MODULE_PREFIX, "setup slotFreqs slotPlus1 %d freq %d INVALID", slotPlus1, freq);
+            continue;
+        }
+        _slotConfigFreq[slotPlus1] = freq;
+#ifdef DEBUG_BUS_SPEED_MGR_SETUP
+        LOG_I(MODULE_PREFIX, "setup slotPlus1 %d freq %d", slotPlus1, freq);
+#endif
+    }
+
+    // Element limits are from a previous session
+    _elemMaxFreqs.clear();
+    _isSwitchingSupported = true;
+    updateAccessFreqs();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set whether the I2C central can switch bus frequency
+/// @param isSupported false to run every access at the base frequency (slotFreqs and maxFreq are ignored)
+void BusSpeedMgr::setSwitchingSupported(bool isSupported)
+{
+    _isSwitchingSupported = isSupported;
+    updateAccessFreqs();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set (or clear) the maximum frequency an element supports
+/// @param addrAndSlot address and slot of the element
+/// @param maxFreq maximum frequency in Hz (0 if unknown or the element has gone offline)
+void BusSpeedMgr::setElemMaxFreq(BusI2CAddrAndSlot addrAndSlot, uint32_t maxFreq)
+{
+    // Warn if the element can't be slowed down to suit
+    if (!_isSwitchingSupported)
+    {
+        if ((maxFreq != 0) && (maxFreq < _baseFreq))
+            LOG_W(MODULE_PREFIX, "setElemMaxFreq %s maxFreq %d IGNORED - bus frequency %d can't be changed",
+                        addrAndSlot.toString().c_str(), maxFreq, _baseFreq);
+        return;
+    }
+
+    // Find existing record
+    for (auto it = _elemMaxFreqs.begin(); it != _elemMaxFreqs.end(); ++it)
+    {
+        if (it->addrAndSlot == addrAndSlot)
+        {
+            if (it->maxFreq == maxFreq)
+                return;
+            if (maxFreq == 0)
+                _elemMaxFreqs.erase(it);
+            else
+                it->maxFreq = maxFreq;
+            updateAccessFreqs();
+            return;
+        }
+    }
+
+    // New record
+    if (maxFreq == 0)
+        return;
+    _elemMaxFreqs.push_back({addrAndSlot, maxFreq});
+    updateAccessFreqs();
+
+#ifdef DEBUG_BUS_SPEED_MGR_ELEM_MAX_FREQ
+    LOG_I(MODULE_PREFIX, "setElemMaxFreq %s maxFreq %d slotAccessFreq %d",
+                addrAndSlot.toString().c_str(), maxFreq, getSlotAccessFreq(addrAndSlot.slotPlus1));
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Update the frequency used for accesses to each slot
+void BusSpeedMgr::updateAccessFreqs()
+{
+    // Start from configured frequencies (all at the base frequency if the central can't switch)
+    for (uint32_t slotPlus1 = 0; slotPlus1 < SLOTS_PLUS1_MAX; slotPlus1++)
+        _slotAccessFreq[slotPlus1] = (_isSwitchingSupported && (_slotConfigFreq[slotPlus1] != 0)) ? 
+                    _slotConfigFreq[slotPlus1] : _baseFreq;
+
+    // Limit by elements on each slot - main bus elements limit every slot
+    uint32_t mainBusMaxFreq = UINT32_MAX;
+    for (const ElemMaxFreq& elem : _elemMaxFreqs)
+    {
+        if (elem.addrAndSlot.slotPlus1 == 0)
+        {
+            if (elem.maxFreq < mainBusMaxFreq)
+                mainBusMaxFreq = elem.maxFreq;
+        }
+        else if ((elem.addrAndSlot.slotPlus1 < SLOTS_PLUS1_MAX) && (elem.maxFreq < _slotAccessFreq[elem.addrAndSlot.slotPlus1]))
+        {
+            _slotAccessFreq[elem.addrAndSlot.slotPlus1] = elem.maxFreq;
+        }
+    }
+    _minAccessFreq = UINT32_MAX;
+    _isSpeedSwitching = false;
+    for (uint32_t slotPlus1 = 0; slotPlus1 < SLOTS_PLUS1_MAX; slotPlus1++)
+    {
+        if (mainBusMaxFreq < _slotAccessFreq[slotPlus1])
+            _slotAccessFreq[slotPlus1] = mainBusMaxFreq;
+        if (_slotAccessFreq[slotPlus1] < _minAccessFreq)
+            _minAccessFreq = _slotAccessFreq[slotPlus1];
+        if (_slotAccessFreq[slotPlus1] != _baseFreq)
+            _isSpeedSwitching = true;
+    }
+}
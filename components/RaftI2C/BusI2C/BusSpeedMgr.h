@@ -0,0 +1,103 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus Speed Manager
+//
+// Works out the bus frequency to use for each access so that slots with only fast devices can run faster
+// than slots which have slower devices on them. Devices on the main bus are visible whichever slot is enabled
+// so they limit the speed of every access.
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include "RaftJsonIF.h"
+#include "BusI2CConsts.h"
+#include "BusI2CAddrAndSlot.h"
+
+class BusSpeedMgr
+{
+public:
+    // Constructor and destructor
+    BusSpeedMgr();
+    virtual ~BusSpeedMgr();
+
+    // Setup
+    void setup(const RaftJsonIF& config);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the base bus frequency (from i2cFreq in config)
+    /// @return frequency in Hz
+    uint32_t getBaseFreq() const
+    {
+        return _baseFreq;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Set (or clear) the maximum frequency an element supports
+    /// @param addrAndSlot address and slot of the element
+    /// @param maxFreq maximum frequency in Hz (0 if unknown or the element has gone offline)
+    void setElemMaxFreq(BusI2CAddrAndSlot addrAndSlot, uint32_t maxFreq);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the frequency to use for an access
+    /// @param slotPlus1 slot of the element being accessed (0 for main bus)
+    /// @param enabledSlotPlus1 slot currently enabled on the bus extenders (0 if none, -1 if not known)
+    /// @return frequency in Hz
+    uint32_t getAccessFreq(uint32_t slotPlus1, int enabledSlotPlus1) const
+    {
+        uint32_t freq = getSlotAccessFreq(slotPlus1);
+        uint32_t enabledFreq = enabledSlotPlus1 < 0 ? _minAccessFreq : getSlotAccessFreq(enabledSlotPlus1);
+        return freq < enabledFreq ? freq : enabledFreq;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Set whether the I2C central can switch bus frequency
+    /// @param isSupported false to run every access at the base frequency (slotFreqs and maxFreq are ignored)
+    void setSwitchingSupported(bool isSupported);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if any access can run at other than the base frequency
+    bool isSpeedSwitching() const
+    {
+        return _isSpeedSwitching;
+    }
+
+    // Number of slots handled (including main bus)
+    static const uint32_t SLOTS_PLUS1_MAX = I2C_BUS_EXTENDERS_MAX * 8 + 1;
+
+    // Default frequency
+    static const uint32_t DEFAULT_BUS_FREQ = 100000;
+
+private:
+    // Base frequency
+    uint32_t _baseFreq = DEFAULT_BUS_FREQ;
+
+    // Configured slot frequencies (0 to use the base frequency)
+    uint32_t _slotConfigFreq[SLOTS_PLUS1_MAX] = {};
+
+    // Elements with a known maximum frequency
+    struct ElemMaxFreq
+    {
+        BusI2CAddrAndSlot addrAndSlot;
+        uint32_t maxFreq;
+    };
+    std::vector<ElemMaxFreq> _elemMaxFreqs;
+
+    // Frequency for accesses to each slot and the lowest of these
+    uint32_t _slotAccessFreq[SLOTS_PLUS1_MAX] = {};
+    uint32_t _minAccessFreq = DEFAULT_BUS_FREQ;
+    bool _isSpeedSwitching = false;
+
+    // Central can switch frequency
+    bool _isSwitchingSupported = true;
+
+    // Helpers
+    uint32_t getSlotAccessFreq(uint32_t slotPlus1) const
+    {
+        return slotPlus1 < SLOTS_PLUS1_MAX ? _slotAccessFreq[slotPlus1] : _minAccessFreq;
+    }
+    void updateAccessFreqs();
+};
@@ -9,7 +9,9 @@
 #include "BusStatusMgr.h"
 #include "Logger.h"
 #include "RaftUtils.h"
+#include "BusI2CClock.h"
 #include "DeviceIdentMgr.h"
+#include "BusI2CJsonWriter.h"
 
 // #define DEBUG_HANDLE_BUS_ELEM_STATE_CHANGES
 // #define DEBUG_CONSECUTIVE_ERROR_HANDLING
@@ -20,6 +22,8 @@
 // #define DEBUG_SERVICE_BUS_ELEM_STATUS_CHANGE
 // #define DEBUG_ACCESS_BARRING_FOR_MS
 // #define DEBUG_HANDLE_BUS_DEVICE_INFO
+// #define DEBUG_POLL_RESP_JSON
+// #define DEBUG_POLL_ARENA
 
 static const char* MODULE_PREFIX = "BusStatusMgr";
 
@@ -32,12 +36,17 @@ BusStatusMgr::BusStatusMgr(BusBase& busBase) :
 {
     // Bus element status change detection
     _busElemStatusMutex = xSemaphoreCreateMutex();
+
+    // Poll response formatting
+    _pollRespFormatMutex = xSemaphoreCreateMutex();
 }
 
 BusStatusMgr::~BusStatusMgr()
 {
     if (_busElemStatusMutex)
         vSemaphoreDelete(_busElemStatusMutex);
+    if (_pollRespFormatMutex)
+        vSemaphoreDelete(_pollRespFormatMutex);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -58,14 +67,25 @@ void BusStatusMgr::setup(const RaftJsonIF& config)
     _busOperationStatus = BUS_OPERATION_UNKNOWN;
     _busElemStatusChangeDetected = false;
     _i2cAddrStatus.clear();
+    _statusGeneration = 0;
+
+    // Max number of bus elements tracked
+    _addrStatusMax = config.getLong("maxElems", I2C_ADDR_STATUS_MAX);
+
+    // Poll results arena
+    uint32_t pollArenaBytes = config.getLong("pollArenaBytes", _addrStatusMax * POLL_ARENA_BYTES_PER_ELEM_DEFAULT);
+    _pollDataArena.setup(pollArenaBytes);
+
+    // Poll result subscriptions
+    _pollDataDispatcher.setup(config);
 
     // Clear found on main bus bits
-    for (int i = 0; i < SIZE_OF_MAIN_BUS_ADDR_BITS_ARRAY; i++)
+    for (uint32_t i = 0; i < SIZE_OF_MAIN_BUS_ADDR_BITS_ARRAY; i++)
         _mainBusAddrBits[i] = 0;
 
     // Debug
-    LOG_I(MODULE_PREFIX, "task lockupDetect addr %02x (valid %s)",
-                _addrForLockupDetect, _addrForLockupDetectValid ? "Y" : "N");
+    LOG_I(MODULE_PREFIX, "task lockupDetect addr %02x (valid %s) maxElems %d pollArenaBytes %d",
+                _addrForLockupDetect, _addrForLockupDetectValid ? "Y" : "N", _addrStatusMax, pollArenaBytes);
 
 }
 
@@ -75,6 +95,28 @@ void BusStatusMgr::setup(const RaftJsonIF& config)
 
 void BusStatusMgr::service(bool hwIsOperatingOk)
 {
+    // Compact the poll results arena if it has holes and no poll results are being stored (don't wait for
+    // the semaphore as the I2C task may be using it)
+    if (_pollDataArena.hasHoles() && (xSemaphoreTake(_busElemStatusMutex, 0) == pdTRUE))
+    {
+        if (Raft::isTimeout(BusI2CClock::nowUs(), _lastIdentPollUpdateTimeUs, POLL_ARENA_COMPACT_IDLE_US))
+            pollArenaCompact();
+        xSemaphoreGive(_busElemStatusMutex);
+    }
+
+    // Store the summary of downsampling windows which have ended without a later poll result (e.g. when the
+    // device is no longer polled)
+    if (xSemaphoreTake(_busElemStatusMutex, 0) == pdTRUE)
+    {
+        uint64_t timeNowUs = BusI2CClock::nowUs();
+        for (BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+        {
+            if (addrStatus.deviceStatus.dataWindow.isWindowEnded(timeNowUs))
+                pollWindowFlush(addrStatus);
+        }
+        xSemaphoreGive(_busElemStatusMutex);
+    }
+
     // Check for any changes detected
     if (!_busElemStatusChangeDetected)
         return;
@@ -203,13 +245,14 @@ bool BusStatusMgr::updateBusElemState(BusI2CAddrAndSlot addrAndSlot, bool elemRe
         BusI2CAddrStatus* pAddrStatus = findAddrStatusRecordEditable(addrAndSlot);
 
         // If not found and element is responding then add a new record
-        if ((pAddrStatus == nullptr) && elemResponding && (_i2cAddrStatus.size() < I2C_ADDR_STATUS_MAX))
+        if ((pAddrStatus == nullptr) && elemResponding && (_i2cAddrStatus.size() < _addrStatusMax))
         {
             // Add new record
             BusI2CAddrStatus newAddrStatus;
             newAddrStatus.addrAndSlot = addrAndSlot;
             _i2cAddrStatus.push_back(newAddrStatus);
             pAddrStatus = &_i2cAddrStatus.back();
+            bumpGeneration(*pAddrStatus);
         }
 
         // Check if we found a record
@@ -223,6 +266,12 @@ bool BusStatusMgr::updateBusElemState(BusI2CAddrAndSlot addrAndSlot, bool elemRe
             // Handle element response
             isNewStatusChange = pAddrStatus->handleResponding(elemResponding, flagSpuriousRecord);
             isOnline = pAddrStatus->isOnline;
+            if (isNewStatusChange)
+                bumpGeneration(*pAddrStatus);
+
+            // Return poll result storage to the arena when going offline or removed
+            if ((isNewStatusChange && !isOnline) || flagSpuriousRecord)
+                pollDataRelease(*pAddrStatus);
 
             // Check if this is a main-bus address (not on an extender) and keep track of all main-bus addresses if so
             if (isNewStatusChange && isOnline && (addrAndSlot.slotPlus1 == 0))
@@ -241,7 +290,7 @@ bool BusStatusMgr::updateBusElemState(BusI2CAddrAndSlot addrAndSlot, bool elemRe
         if (isNewStatusChange)
         {
             _busElemStatusChangeDetected = true;
-            _lastBusElemOnlineStatusUpdateTimeUs = micros();
+            _lastBusElemOnlineStatusUpdateTimeUs = BusI2CClock::nowUs();
         }
 
         // Check for spurious record detected
@@ -449,14 +498,127 @@ void BusStatusMgr::setBusElemDeviceStatus(BusI2CAddrAndSlot addrAndSlot, const D
     BusI2CAddrStatus* pAddrStatus = findAddrStatusRecordEditable(addrAndSlot);
     if (pAddrStatus)
     {
-        // Set device type
+        // Set device type (storage for poll results is allocated for the new device type)
+        pollDataRelease(*pAddrStatus);
         pAddrStatus->deviceStatus = deviceStatus;
+        pollDataAlloc(*pAddrStatus);
+        bumpGeneration(*pAddrStatus);
     }
 
     // Return semaphore
     xSemaphoreGive(_busElemStatusMutex);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Allocate storage for poll results of a bus element from the arena
+/// @param addrStatus bus element (the device status must be set)
+/// @note Assumes semaphore already taken. If the arena is full after compaction the storage is allocated on
+///       the heap instead
+void BusStatusMgr::pollDataAlloc(BusI2CAddrStatus& addrStatus)
+{
+    DeviceStatus& deviceStatus = addrStatus.deviceStatus;
+    deviceStatus.dataAggregator.setBlockOldest(addrStatus.pollBlockOldest);
+    deviceStatus.dataAggregator.setTimestampFormat(deviceStatus.deviceIdentPolling.timestampFormat);
+    uint32_t numResults = deviceStatus.deviceIdentPolling.numPollResultsToStore;
+    uint32_t resultSize = deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp;
+    if (!deviceStatus.isValid() || (numResults * resultSize == 0))
+    {
+        deviceStatus.dataAggregator.initInArena(_pollDataArena, 0, 0);
+        return;
+    }
+    if (deviceStatus.dataAggregator.initInArena(_pollDataArena, numResults, resultSize))
+        return;
+    if (pollArenaCompact() && deviceStatus.dataAggregator.initInArena(_pollDataArena, numResults, resultSize))
+        return;
+    LOG_W(MODULE_PREFIX, "pollDataAlloc addr@slot+1 %s arena full (%d bytes) - using heap", 
+                addrStatus.addrAndSlot.toString().c_str(), numResults * resultSize);
+    deviceStatus.dataAggregator.init(numResults, resultSize);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Store the summary of a bus element's pending downsampling window
+/// @param addrStatus bus element
+/// @note Assumes semaphore already taken. Used when the window ends without a later poll result and before the
+///       storage is released so the last window isn't lost
+void BusStatusMgr::pollWindowFlush(BusI2CAddrStatus& addrStatus)
+{
+    DeviceStatus& deviceStatus = addrStatus.deviceStatus;
+    uint32_t numPutBefore = deviceStatus.dataAggregator.getNumPut();
+    if (deviceStatus.dataWindow.flush(deviceStatus.dataAggregator))
+        bumpGeneration(addrStatus);
+    pollResultsDispatch(addrStatus, numPutBefore);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Pass poll results stored for a bus element to subscribers
+/// @param addrStatus bus element
+/// @param numPutBefore aggregator count of results put before the results to pass on were stored
+/// @note Assumes semaphore already taken
+void BusStatusMgr::pollResultsDispatch(BusI2CAddrStatus& addrStatus, uint32_t numPutBefore)
+{
+    PollDataAggregator& aggregator = addrStatus.deviceStatus.dataAggregator;
+    uint32_t numNew = aggregator.getNumPut() - numPutBefore;
+    if ((numNew == 0) || !_pollDataDispatcher.hasSubscriptions())
+        return;
+    uint32_t resultSize = aggregator.getResultSize();
+    if (_pollDispatchBuf.size() < numNew * resultSize)
+        _pollDispatchBuf.resize(numNew * resultSize);
+    numNew = aggregator.getNewest(_pollDispatchBuf.data(), _pollDispatchBuf.size(), numNew);
+    _pollDataDispatcher.resultsStored(addrStatus.addrAndSlot.toCompositeAddrAndSlot(), 
+                addrStatus.deviceStatus.getDeviceTypeIndex(), _pollDispatchBuf.data(), resultSize, numNew);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the position within its downsampling window of a bus element's oldest unread poll result
+/// @param deviceStatus device status
+/// @return 0 (minimum), 1 (maximum) or 2 (mean) - 0 if results aren't stored as window summaries
+/// @note Assumes semaphore already taken. Window summaries are put whole so this follows from the number put
+///       (results overwritten or read leave a partial window at the start)
+uint32_t BusStatusMgr::getWindowIdxOfOldest(const DeviceStatus& deviceStatus)
+{
+    uint32_t resultsPerWindow = deviceStatus.dataWindow.getResultsPerWindow();
+    if (resultsPerWindow <= 1)
+        return 0;
+    const PollDataAggregator& aggregator = deviceStatus.dataAggregator;
+    return (aggregator.getNumPut() - aggregator.count()) % resultsPerWindow;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Compact the poll results arena
+/// @return true if compacted
+/// @note Assumes semaphore already taken
+bool BusStatusMgr::pollArenaCompact()
+{
+    std::vector<PollDataArena::Region*> regions;
+    regions.reserve(_i2cAddrStatus.size());
+    for (BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        PollDataArena::Region* pRegion = addrStatus.deviceStatus.dataAggregator.getArenaRegion();
+        if (pRegion)
+            regions.push_back(pRegion);
+    }
+    bool rslt = _pollDataArena.compact(regions);
+#ifdef DEBUG_POLL_ARENA
+    PollDataArena::Stats stats;
+    _pollDataArena.getStats(stats);
+    LOG_I(MODULE_PREFIX, "pollArenaCompact %s used %d free %d highWater %d regions %d", 
+                rslt ? "OK" : "FAILED", stats.usedBytes, stats.freeBytes, stats.highWaterBytes, stats.numRegions);
+#endif
+    return rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get usage of the arena holding the poll results of all bus elements
+/// @param stats (out) arena stats
+void BusStatusMgr::getPollArenaStats(PollDataArena::Stats& stats) const
+{
+    stats = PollDataArena::Stats();
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return;
+    _pollDataArena.getStats(stats);
+    xSemaphoreGive(_busElemStatusMutex);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Get device type index by address
 /// @param addrAndSlot address and slot of device
@@ -495,10 +657,15 @@ void BusStatusMgr::slotPoweringDown(uint32_t slotPlus1)
     {
         if (addrStatus.addrAndSlot.slotPlus1 == slotPlus1)
         {
+            if (addrStatus.isOnline)
+            {
+                bumpGeneration(addrStatus);
+                pollDataRelease(addrStatus);
+            }
             addrStatus.isChange = addrStatus.isOnline;
             addrStatus.isOnline = false;
             _busElemStatusChangeDetected = true;
-            _lastBusElemOnlineStatusUpdateTimeUs = micros();
+            _lastBusElemOnlineStatusUpdateTimeUs = BusI2CClock::nowUs();
         }
     }
 
@@ -517,10 +684,15 @@ void BusStatusMgr::informBusStuck()
     // Go through all devices and set status to offline
     for (BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
     {
+        if (addrStatus.isOnline)
+        {
+            bumpGeneration(addrStatus);
+            pollDataRelease(addrStatus);
+        }
         addrStatus.isChange = addrStatus.isOnline;
         addrStatus.isOnline = false;
         _busElemStatusChangeDetected = true;
-        _lastBusElemOnlineStatusUpdateTimeUs = micros();
+        _lastBusElemOnlineStatusUpdateTimeUs = BusI2CClock::nowUs();
     }
 
     // Return semaphore
@@ -574,7 +746,14 @@ bool BusStatusMgr::pollResultStore(uint64_t timeNowUs, const DevicePollingInfo&
     if (pAddrStatus)
     {
         // Add result to aggregator
+        PollDataAggregator& aggregator = pAddrStatus->deviceStatus.dataAggregator;
+        uint32_t numPutBefore = aggregator.getNumPut();
         putResult = pAddrStatus->deviceStatus.pollResultStore(timeNowUs, pollInfo, pollResultData);
+        if (putResult)
+            bumpGeneration(*pAddrStatus);
+
+        // Pass results stored (which may be downsampled) to subscribers
+        pollResultsDispatch(*pAddrStatus, numPutBefore);
     }
 
     // Store time of last status update
@@ -635,6 +814,43 @@ bool BusStatusMgr::getBusElemAddresses(std::vector<uint32_t>& addresses, bool on
     return addresses.size() > 0;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the status generation
+/// @return generation of the most recent change to any bus element
+uint32_t BusStatusMgr::getStatusGeneration() const
+{
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return 0;
+    uint32_t generation = _statusGeneration;
+    xSemaphoreGive(_busElemStatusMutex);
+    return generation;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get addresses of bus elements which have changed since a generation
+/// @param sinceGeneration - generation from a previous call (0 for all elements)
+/// @param addresses - (out) vector to store the addresses of changed elements
+/// @return current generation (pass to the next call)
+uint32_t BusStatusMgr::getBusElemsChangedSince(uint32_t sinceGeneration, std::vector<uint32_t>& addresses) const
+{
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return sinceGeneration;
+
+    // Changed elements
+    for (const BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        if (addrStatus.generation > sinceGeneration)
+            addresses.push_back(addrStatus.addrAndSlot.toCompositeAddrAndSlot());
+    }
+    uint32_t generation = _statusGeneration;
+
+    // Return semaphore
+    xSemaphoreGive(_busElemStatusMutex);
+    return generation;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////    
 /// @brief Get bus element poll responses for a specific address
 /// @param address - address of device to get responses for
@@ -646,8 +862,10 @@ bool BusStatusMgr::getBusElemAddresses(std::vector<uint32_t>& addresses, bool on
 /// @return number of responses returned
 uint32_t BusStatusMgr::getBusElemPollResponses(uint32_t address, bool& isOnline, uint16_t& deviceTypeIndex, 
             std::vector<uint8_t>& devicePollResponseData, 
-            uint32_t& responseSize, uint32_t maxResponsesToReturn)
+            uint32_t& responseSize, uint32_t maxResponsesToReturn, PollDataAggregator::Stats& stats)
 {
+    stats = PollDataAggregator::Stats();
+
     // Obtain semaphore
     if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
         return 0;
@@ -665,6 +883,10 @@ uint32_t BusStatusMgr::getBusElemPollResponses(uint32_t address, bool& isOnline,
 
         // Get results from aggregator
         numResponses = pAddrStatus->deviceStatus.dataAggregator.get(devicePollResponseData, responseSize, maxResponsesToReturn);
+
+        // Record counters
+        pAddrStatus->deviceStatus.dataAggregator.getStats(stats, BusI2CClock::nowUs() / 1000, 
+                    DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
     }
 
     // Return semaphore
@@ -672,34 +894,319 @@ uint32_t BusStatusMgr::getBusElemPollResponses(uint32_t address, bool& isOnline,
     return numResponses;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get poll record counters for a bus element
+/// @param address - address of device
+/// @param stats - (out) record counters
+/// @return true if the element was found
+bool BusStatusMgr::getBusElemPollStats(uint32_t address, PollDataAggregator::Stats& stats) const
+{
+    stats = PollDataAggregator::Stats();
+
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return false;
+
+    // Find address record
+    const BusI2CAddrStatus* pAddrStatus = findAddrStatusRecord(BusI2CAddrAndSlot::fromCompositeAddrAndSlot(address));
+    if (pAddrStatus)
+        pAddrStatus->deviceStatus.dataAggregator.getStats(stats, BusI2CClock::nowUs() / 1000, 
+                    DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+
+    // Return semaphore
+    xSemaphoreGive(_busElemStatusMutex);
+    return pAddrStatus != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get poll record counters for the whole bus
+/// @param stats - (out) counters summed over all bus elements
+void BusStatusMgr::getBusPollStats(PollDataAggregator::Stats& stats) const
+{
+    stats = PollDataAggregator::Stats();
+
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return;
+
+    // Sum counters
+    uint32_t timeNowMs = BusI2CClock::nowUs() / 1000;
+    for (const BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        PollDataAggregator::Stats elemStats;
+        addrStatus.deviceStatus.dataAggregator.getStats(elemStats, timeNowMs, DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+        stats.numProduced += elemStats.numProduced;
+        stats.numConsumed += elemStats.numConsumed;
+        stats.numOverwritten += elemStats.numOverwritten;
+        stats.numDropped += elemStats.numDropped;
+        stats.numUnread += elemStats.numUnread;
+        if (elemStats.oldestUnreadAgeMs > stats.oldestUnreadAgeMs)
+            stats.oldestUnreadAgeMs = elemStats.oldestUnreadAgeMs;
+    }
+
+    // Return semaphore
+    xSemaphoreGive(_busElemStatusMutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set whether a bus element keeps its oldest unread poll results when its ring is full
+/// @param address - address of device
+/// @param blockOldest - true to drop new results when full rather than overwriting
+/// @return true if the element was found
+bool BusStatusMgr::setBusElemPollBlockOldest(uint32_t address, bool blockOldest)
+{
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return false;
+
+    // Find address record
+    BusI2CAddrStatus* pAddrStatus = findAddrStatusRecordEditable(BusI2CAddrAndSlot::fromCompositeAddrAndSlot(address));
+    if (pAddrStatus)
+    {
+        pAddrStatus->pollBlockOldest = blockOldest;
+        pAddrStatus->deviceStatus.dataAggregator.setBlockOldest(blockOldest);
+    }
+
+    // Return semaphore
+    xSemaphoreGive(_busElemStatusMutex);
+    return pAddrStatus != nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get a snapshot of the poll responses of bus elements
+/// @param snapshot (out) snapshot (previous contents are replaced)
+/// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+/// @param pGeneration (out) generation to pass to the next call (can be nullptr)
+/// @return true if the snapshot was taken
+bool BusStatusMgr::getBusPollSnapshot(BusI2CPollSnapshot& snapshot, uint32_t sinceGeneration, uint32_t* pGeneration)
+{
+    // Obtain semaphore
+    snapshot.clear();
+    if (pGeneration)
+        *pGeneration = sinceGeneration;
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return false;
+
+    // Size the data for full result buffers (so each aggregator is only accessed once) - the snapshot's memory
+    // only grows so this rarely allocates
+    uint32_t dataLen = 0;
+    for (const BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        if (addrStatus.generation > sinceGeneration)
+            dataLen += addrStatus.deviceStatus.dataAggregator.getCapacityBytes();
+    }
+    if (snapshot._data.size() < dataLen)
+        snapshot._data.resize(dataLen);
+
+    // Move results into the snapshot
+    for (BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        if (addrStatus.generation <= sinceGeneration)
+            continue;
+        PollDataAggregator& aggregator = addrStatus.deviceStatus.dataAggregator;
+        BusI2CPollSnapshot::Entry entry;
+        entry.addrAndSlot = addrStatus.addrAndSlot;
+        entry.isOnline = addrStatus.isOnline;
+        entry.deviceTypeIndex = addrStatus.deviceStatus.getDeviceTypeIndex();
+        entry.resultSize = aggregator.getResultSize();
+        entry.dataOffset = snapshot._dataLen;
+        entry.timestampFormat = aggregator.getTimestampFormat();
+        entry.resultsPerWindow = addrStatus.deviceStatus.dataWindow.getResultsPerWindow();
+        entry.windowIdx = getWindowIdxOfOldest(addrStatus.deviceStatus);
+        entry.numResults = aggregator.get(snapshot._data.data() + snapshot._dataLen, dataLen - snapshot._dataLen, 0,
+                    &entry.lastTimeUs);
+        snapshot._dataLen += entry.numResults * entry.resultSize;
+        snapshot._entries.push_back(entry);
+    }
+
+    // Return semaphore
+    if (pGeneration)
+        *pGeneration = _statusGeneration;
+    xSemaphoreGive(_busElemStatusMutex);
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Get bus poll responses json
 /// @param deviceIdentMgr device identity manager
+/// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+/// @param pGeneration (out) generation to pass to the next call (can be nullptr)
 /// @return bus poll responses json
-String BusStatusMgr::getBusPollResponsesJson(const DeviceIdentMgr& deviceIdentMgr)
-{
-    // Return string
-    String jsonStr;
-
-    // Get list of all bus element addresses
-    std::vector<uint32_t> addresses;
-    getBusElemAddresses(addresses, false);
-    for (uint32_t address : addresses)
-    {
-        // Get bus status for each address
-        bool isOnline = false;
-        uint16_t deviceTypeIndex = 0;
-        std::vector<uint8_t> devicePollResponseData;
-        uint32_t responseSize = 0;
-        getBusElemPollResponses(address, isOnline, deviceTypeIndex, devicePollResponseData, responseSize, 0);
-
-        // Use device identity manager to convert to JSON
-        String jsonData = deviceIdentMgr.deviceStatusToJson(BusI2CAddrAndSlot::fromCompositeAddrAndSlot(address), 
-                        isOnline, deviceTypeIndex, devicePollResponseData, responseSize);
-        if (jsonData.length() > 0)
+String BusStatusMgr::getBusPollResponsesJson(const DeviceIdentMgr& deviceIdentMgr, uint32_t sinceGeneration, 
+            uint32_t* pGeneration)
+{
+    // The snapshot and JSON buffers are reused so only one caller can format at a time
+    if (pGeneration)
+        *pGeneration = sinceGeneration;
+    if (xSemaphoreTake(_pollRespFormatMutex, portMAX_DELAY) != pdTRUE)
+        return "{}";
+
+    // Take the responses (the bus element status lock is only held for this)
+    if (!getBusPollSnapshot(_pollRespSnapshot, sinceGeneration, pGeneration))
+    {
+        xSemaphoreGive(_pollRespFormatMutex);
+        return "{}";
+    }
+
+    // Size the output exactly - each identified device is "<addr@slot>":{"x":"<hex>","_o":N,"_t":"<type>"}
+    // preceded by { or , (devices with us delta timestamps also have "_b":<time of last result in us> and
+    // downsampled devices have "_w":<results per window>,"_wi":<position in its window of the first result>)
+    static const char* JSON_X_PREFIX = "\":{\"x\":\"";
+    static const char* JSON_ONLINE_PREFIX = "\",\"_o\":";
+    static const char* JSON_TYPE_PREFIX = ",\"_t\":\"";
+    static const char* JSON_TIME_BASE_PREFIX = "\",\"_b\":";
+    static const char* JSON_WINDOW_PREFIX = ",\"_w\":";
+    static const char* JSON_WINDOW_IDX_PREFIX = ",\"_wi\":";
+    const uint32_t JSON_FIXED_LEN = 2 + strlen(JSON_X_PREFIX) + strlen(JSON_ONLINE_PREFIX) + 1 + strlen(JSON_TYPE_PREFIX) + 2;
+    uint32_t jsonLen = 2;
+    for (const BusI2CPollSnapshot::Entry& entry : _pollRespSnapshot.entries())
+    {
+        const char* pTypeName = deviceIdentMgr.getDeviceTypeName(entry.deviceTypeIndex);
+        if (pTypeName)
+            jsonLen += JSON_FIXED_LEN + BusI2CJsonWriter::addrAndSlotLen(entry.addrAndSlot) + strlen(pTypeName) +
+                        BusI2CJsonWriter::hexLen(entry.numResults * entry.resultSize);
+        if (pTypeName && isJsonTimeBaseEntry(entry))
+            jsonLen += strlen(JSON_TIME_BASE_PREFIX) - 1 + BusI2CJsonWriter::uintLen(entry.lastTimeUs);
+        if (pTypeName && isJsonWindowEntry(entry))
+            jsonLen += strlen(JSON_WINDOW_PREFIX) + BusI2CJsonWriter::uintLen(entry.resultsPerWindow) + 
+                        strlen(JSON_WINDOW_IDX_PREFIX) + BusI2CJsonWriter::uintLen(entry.windowIdx);
+    }
+
+    // Write into a single buffer (reused between calls)
+    _pollRespJsonBuf.resize(jsonLen + 1);
+    BusI2CJsonWriter writer(_pollRespJsonBuf.data(), _pollRespJsonBuf.size());
+    for (const BusI2CPollSnapshot::Entry& entry : _pollRespSnapshot.entries())
+    {
+        const char* pTypeName = deviceIdentMgr.getDeviceTypeName(entry.deviceTypeIndex);
+        if (!pTypeName)
+            continue;
+        writer.addChar(writer.length() == 0 ? '{' : ',');
+        writer.addChar('"');
+        writer.addAddrAndSlot(entry.addrAndSlot);
+        writer.addStr(JSON_X_PREFIX);
+        writer.addHex(_pollRespSnapshot.getData(entry), entry.numResults * entry.resultSize);
+        writer.addStr(JSON_ONLINE_PREFIX);
+        writer.addChar(entry.isOnline ? '1' : '0');
+        writer.addStr(JSON_TYPE_PREFIX);
+        writer.addStr(pTypeName);
+        if (isJsonTimeBaseEntry(entry))
+        {
+            writer.addStr(JSON_TIME_BASE_PREFIX);
+            writer.addUint(entry.lastTimeUs);
+        }
+        else
+        {
+            writer.addChar('"');
+        }
+        if (isJsonWindowEntry(entry))
+        {
+            writer.addStr(JSON_WINDOW_PREFIX);
+            writer.addUint(entry.resultsPerWindow);
+            writer.addStr(JSON_WINDOW_IDX_PREFIX);
+            writer.addUint(entry.windowIdx);
+        }
+        writer.addChar('}');
+    }
+    if (writer.length() != 0)
+        writer.addChar('}');
+#ifdef DEBUG_POLL_RESP_JSON
+    LOG_I(MODULE_PREFIX, "getBusPollResponsesJson len %d sized %d overflow %s", 
+                writer.length(), jsonLen, writer.isOverflow() ? "Y" : "N");
+#endif
+    String jsonStr = writer.length() == 0 ? "{}" : _pollRespJsonBuf.data();
+    xSemaphoreGive(_pollRespFormatMutex);
+    return jsonStr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get bus poll responses in binary form
+/// @param busNum - bus number to put in the frame header
+/// @param pBuf - buffer to write to
+/// @param bufMaxLen - size of buffer
+/// @param sinceGeneration - only include elements which have changed since this generation (0 for all)
+/// @param pGeneration - (out) generation to pass to the next call (can be nullptr)
+/// @return number of bytes written (0 if the buffer is too small for the frame header)
+uint32_t BusStatusMgr::getBusPollResponsesBinary(uint8_t busNum, uint8_t* pBuf, uint32_t bufMaxLen, 
+            uint32_t sinceGeneration, uint32_t* pGeneration)
+{
+    // Frame header
+    if (pGeneration)
+        *pGeneration = sinceGeneration;
+    if (!pBuf || (bufMaxLen < POLL_RESP_BIN_FRAME_HEADER_SIZE))
+        return 0;
+    pBuf[0] = POLL_RESP_BIN_VERSION;
+    pBuf[1] = busNum;
+    uint32_t pos = POLL_RESP_BIN_FRAME_HEADER_SIZE;
+
+    // Obtain semaphore
+    if (xSemaphoreTake(_busElemStatusMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return pos;
+
+    // Records go straight from each device's aggregator into the buffer
+    static const uint32_t TS_SIZE = DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE;
+    uint32_t nextGeneration = _statusGeneration;
+    for (BusI2CAddrStatus& addrStatus : _i2cAddrStatus)
+    {
+        // Only identified devices (as for JSON) with records that fit the format
+        DeviceStatus& deviceStatus = addrStatus.deviceStatus;
+        uint32_t resultSize = deviceStatus.dataAggregator.getResultSize();
+        if ((addrStatus.generation <= sinceGeneration) || !deviceStatus.isValid() || 
+                    (resultSize < TS_SIZE) || (resultSize - TS_SIZE > UINT8_MAX))
+            continue;
+
+        // Elements which don't fit (or still have records left) must be included in the next call
+        bool isUsDelta = deviceStatus.dataAggregator.getTimestampFormat() == PollTimestamp::FORMAT_US_DELTA16;
+        uint32_t devHeaderSize = isUsDelta ? POLL_RESP_BIN_DEVICE_HEADER_SIZE_US : POLL_RESP_BIN_DEVICE_HEADER_SIZE;
+        if (pos + devHeaderSize > bufMaxLen)
+        {
+            if (addrStatus.generation <= nextGeneration)
+                nextGeneration = addrStatus.generation - 1;
+            continue;
+        }
+
+        // Records (us delta timestamps are already deltas so records are copied as stored)
+        uint8_t* pDevHeader = pBuf + pos;
+        uint32_t resultsPerWindow = deviceStatus.dataWindow.getResultsPerWindow();
+        uint32_t windowIdx = getWindowIdxOfOldest(deviceStatus);
+        uint32_t baseTimestamp = 0;
+        uint32_t numRecords = 0;
+        uint32_t recordsLen = 0;
+        if (isUsDelta)
         {
-            jsonStr += (jsonStr.length() == 0 ? "{" : ",") + jsonData;
+            uint64_t lastTimeUs = 0;
+            numRecords = deviceStatus.dataAggregator.get(pDevHeader + devHeaderSize, bufMaxLen - pos - devHeaderSize, 
+                        UINT8_MAX, &lastTimeUs);
+            recordsLen = numRecords * resultSize;
+            baseTimestamp = lastTimeUs & 0xffffffff;
         }
+        else
+        {
+            recordsLen = deviceStatus.dataAggregator.getTimestampDeltas(pDevHeader + devHeaderSize,
+                        bufMaxLen - pos - devHeaderSize, TS_SIZE, UINT8_MAX, baseTimestamp, numRecords);
+        }
+
+        // Device header
+        uint16_t compositeAddr = addrStatus.addrAndSlot.toCompositeAddrAndSlot();
+        pDevHeader[0] = compositeAddr >> 8;
+        pDevHeader[1] = compositeAddr & 0xff;
+        pDevHeader[2] = (addrStatus.isOnline ? POLL_RESP_BIN_FLAG_ONLINE : 0) | (isUsDelta ? POLL_RESP_BIN_FLAG_US_DELTA : 0) |
+                    ((resultsPerWindow << POLL_RESP_BIN_FLAG_WINDOW_SIZE_SHIFT) & POLL_RESP_BIN_FLAG_WINDOW_SIZE_MASK) |
+                    ((windowIdx << POLL_RESP_BIN_FLAG_WINDOW_IDX_SHIFT) & POLL_RESP_BIN_FLAG_WINDOW_IDX_MASK);
+        pDevHeader[3] = deviceStatus.getDeviceTypeIndex() >> 8;
+        pDevHeader[4] = deviceStatus.getDeviceTypeIndex() & 0xff;
+        pDevHeader[5] = resultSize - TS_SIZE;
+        pDevHeader[6] = numRecords;
+        for (uint32_t i = 7; i < devHeaderSize; i++)
+            pDevHeader[i] = (baseTimestamp >> ((devHeaderSize - 1 - i) * 8)) & 0xff;
+        pos += devHeaderSize + recordsLen;
+        bool mayHaveMore = (numRecords == UINT8_MAX) || (pos + 1 + resultSize > bufMaxLen);
+        if (mayHaveMore && (deviceStatus.dataAggregator.count() > 0) && (addrStatus.generation <= nextGeneration))
+            nextGeneration = addrStatus.generation - 1;
     }
-    return jsonStr.length() == 0 ? "{}" : jsonStr + "}";
+
+    // Return semaphore
+    if (pGeneration)
+        *pGeneration = nextGeneration;
+    xSemaphoreGive(_busElemStatusMutex);
+    return pos;
 }
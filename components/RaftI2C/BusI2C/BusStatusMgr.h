@@ -17,6 +17,9 @@
 #include "RaftUtils.h"
 #include "DeviceStatus.h"
 #include "BusI2CAddrStatus.h"
+#include "BusI2CPollSnapshot.h"
+#include "PollDataArena.h"
+#include "PollDataDispatcher.h"
 #include <list>
 
 class DeviceIdentMgr;
@@ -91,13 +94,128 @@ public:
     /// @return number of responses returned
     uint32_t getBusElemPollResponses(uint32_t address, bool& isOnline, uint16_t& deviceTypeIndex, 
                 std::vector<uint8_t>& devicePollResponseData, 
-                uint32_t& responseSize, uint32_t maxResponsesToReturn);
+                uint32_t& responseSize, uint32_t maxResponsesToReturn)
+    {
+        PollDataAggregator::Stats stats;
+        return getBusElemPollResponses(address, isOnline, deviceTypeIndex, devicePollResponseData, 
+                    responseSize, maxResponsesToReturn, stats);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////    
+    /// @brief Get bus element poll responses for a specific address along with the element's poll record counters
+    /// @param stats - (out) record counters and age of the oldest unread record after the responses are taken
+    uint32_t getBusElemPollResponses(uint32_t address, bool& isOnline, uint16_t& deviceTypeIndex, 
+                std::vector<uint8_t>& devicePollResponseData, 
+                uint32_t& responseSize, uint32_t maxResponsesToReturn, PollDataAggregator::Stats& stats);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get poll record counters for a bus element
+    /// @param address - address of device
+    /// @param stats - (out) records produced, consumed, overwritten and dropped, the number unread and the age of
+    ///                the oldest unread record
+    /// @return true if the element was found
+    bool getBusElemPollStats(uint32_t address, PollDataAggregator::Stats& stats) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get poll record counters for the whole bus
+    /// @param stats - (out) counters summed over all bus elements (the age is of the oldest unread record on the bus)
+    void getBusPollStats(PollDataAggregator::Stats& stats) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Set whether a bus element keeps its oldest unread poll results when its ring is full
+    /// @param address - address of device
+    /// @param blockOldest - true to drop new results when full (counted as dropped) rather than overwriting
+    /// @return true if the element was found
+    bool setBusElemPollBlockOldest(uint32_t address, bool blockOldest);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the status generation
+    /// @return generation of the most recent change to any bus element
+    /// @note Each bus element record holds the generation of its last change (online state or new poll data) taken
+    ///       from a bus-wide counter so changes since any earlier generation can be found
+    uint32_t getStatusGeneration() const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get addresses of bus elements which have changed since a generation
+    /// @param sinceGeneration - generation from a previous call (0 for all elements)
+    /// @param addresses - (out) vector to store the addresses of changed elements
+    /// @return current generation (pass to the next call)
+    uint32_t getBusElemsChangedSince(uint32_t sinceGeneration, std::vector<uint32_t>& addresses) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get a snapshot of the poll responses of bus elements
+    /// @param snapshot (out) snapshot (previous contents are replaced)
+    /// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+    /// @param pGeneration (out) generation to pass to the next call (can be nullptr)
+    /// @return true if the snapshot was taken
+    /// @note The responses of all elements are moved into the snapshot with a single take of the bus element
+    ///       status lock so they can be formatted without holding it
+    bool getBusPollSnapshot(BusI2CPollSnapshot& snapshot, uint32_t sinceGeneration = 0, uint32_t* pGeneration = nullptr);
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Get bus poll responses json
     /// @param deviceIdentMgr device identity manager
+    /// @param sinceGeneration only include elements which have changed since this generation (0 for all)
+    /// @param pGeneration (out) generation to pass to the next call (can be nullptr)
     /// @return JSON string
-    String getBusPollResponsesJson(const DeviceIdentMgr& deviceIdentMgr);
+    /// @note The responses are taken with getBusPollSnapshot() then sized exactly and written into a single
+    ///       reused buffer. Downsampled devices (see PollDataWindow) have "_w" (number of results per window -
+    ///       3 for minimum, maximum and mean results in that order or 1 for the latest result in each window)
+    ///       and "_wi" (position within its window of the first result)
+    String getBusPollResponsesJson(const DeviceIdentMgr& deviceIdentMgr, uint32_t sinceGeneration = 0, 
+                uint32_t* pGeneration = nullptr);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get bus poll responses in binary form
+    /// @param busNum - bus number to put in the frame header
+    /// @param pBuf - buffer to write to
+    /// @param bufMaxLen - size of buffer
+    /// @param sinceGeneration - only include elements which have changed since this generation (0 for all)
+    /// @param pGeneration - (out) generation to pass to the next call (can be nullptr)
+    /// @return number of bytes written (0 if the buffer is too small for the frame header)
+    /// @note The frame is a POLL_RESP_BIN_VERSION byte and the bus number followed by a block for each identified
+    ///       device: composite address (2 bytes), flags (1 byte - bit 0 online), device type index (2 bytes), record
+    ///       size excluding timestamp (1 byte), number of records (1 byte), timestamp of the first record
+    ///       (DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE bytes) then the records. Each record is the timestamp
+    ///       delta from the previous record (1 byte, or 0xff followed by the full delta) and the raw poll data.
+    ///       For devices with us delta timestamps flags bit 1 is set, the timestamp in the device header is
+    ///       replaced by the time in us (low 32 bits) of the last record and each record is as stored (coded
+    ///       delta from the previous record then the poll data - see PollTimestamp). The time is 0xffffffff if it
+    ///       is unknown (a record left for the next call is re-based) so times follow on from the previous call.
+    ///       For downsampled devices (see PollDataWindow) flags bits 2-3 are the number of records per window
+    ///       (3 for minimum, maximum and mean records in that order or 1 for the latest result in each window)
+    ///       and bits 4-5 are the position within its window of the first record.
+    ///       Multi-byte values are big-endian. Responses which don't fit are left for the next call
+    uint32_t getBusPollResponsesBinary(uint8_t busNum, uint8_t* pBuf, uint32_t bufMaxLen, 
+                uint32_t sinceGeneration = 0, uint32_t* pGeneration = nullptr);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the dispatcher which pushes stored poll results to subscribers
+    PollDataDispatcher& getPollDataDispatcher()
+    {
+        return _pollDataDispatcher;
+    }
+    const PollDataDispatcher& getPollDataDispatcher() const
+    {
+        return _pollDataDispatcher;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get usage of the arena holding the poll results of all bus elements
+    /// @param stats (out) arena stats (including high-water mark and fragmentation)
+    void getPollArenaStats(PollDataArena::Stats& stats) const;
+
+    // Binary poll response format version and sizes
+    static const uint8_t POLL_RESP_BIN_VERSION = 2;
+    static const uint32_t POLL_RESP_BIN_FRAME_HEADER_SIZE = 2;
+    static const uint32_t POLL_RESP_BIN_DEVICE_HEADER_SIZE = 7 + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE;
+    static const uint32_t POLL_RESP_BIN_DEVICE_HEADER_SIZE_US = 7 + 4;
+    static const uint8_t POLL_RESP_BIN_FLAG_ONLINE = 0x01;
+    static const uint8_t POLL_RESP_BIN_FLAG_US_DELTA = 0x02;
+    static const uint8_t POLL_RESP_BIN_FLAG_WINDOW_SIZE_MASK = 0x0c;
+    static const uint8_t POLL_RESP_BIN_FLAG_WINDOW_SIZE_SHIFT = 2;
+    static const uint8_t POLL_RESP_BIN_FLAG_WINDOW_IDX_MASK = 0x30;
+    static const uint8_t POLL_RESP_BIN_FLAG_WINDOW_IDX_SHIFT = 4;
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Is address found on main bus
@@ -146,6 +264,7 @@ private:
     // I2C address status
     std::vector<BusI2CAddrStatus> _i2cAddrStatus;
     static const uint32_t I2C_ADDR_STATUS_MAX = 50;
+    uint32_t _addrStatusMax = I2C_ADDR_STATUS_MAX;
 
     // Find address record
     // Assumes semaphore already taken
@@ -173,6 +292,46 @@ private:
         return nullptr;
     }
 
+    // Arena for the poll results of all bus elements (regions are allocated when a device is identified and
+    // freed when it goes offline or is removed)
+    PollDataArena _pollDataArena;
+    static const uint32_t POLL_ARENA_BYTES_PER_ELEM_DEFAULT = 128;
+
+    // Poll arena is compacted in service() when no poll results have been stored for this long
+    static const uint32_t POLL_ARENA_COMPACT_IDLE_US = 2000;
+
+    // Poll result storage in the arena
+    // Assumes semaphore already taken
+    void pollDataAlloc(BusI2CAddrStatus& addrStatus);
+    void pollDataRelease(BusI2CAddrStatus& addrStatus)
+    {
+        pollWindowFlush(addrStatus);
+        addrStatus.deviceStatus.dataAggregator.release();
+    }
+    bool pollArenaCompact();
+
+    // Store the summary of a pending downsampling window (and pass it to subscribers)
+    // Assumes semaphore already taken
+    void pollWindowFlush(BusI2CAddrStatus& addrStatus);
+
+    // Pass results stored since numPutBefore to subscribers
+    // Assumes semaphore already taken
+    void pollResultsDispatch(BusI2CAddrStatus& addrStatus, uint32_t numPutBefore);
+
+    // Dispatcher for poll result subscriptions (and buffer for results being passed to it)
+    PollDataDispatcher _pollDataDispatcher;
+    std::vector<uint8_t> _pollDispatchBuf;
+
+    // Status generation (incremented on each change to a bus element)
+    uint32_t _statusGeneration = 0;
+
+    // Record a change to a bus element
+    // Assumes semaphore already taken
+    void bumpGeneration(BusI2CAddrStatus& addrStatus)
+    {
+        addrStatus.generation = ++_statusGeneration;
+    }
+
     // Address for lockup detect
     uint8_t _addrForLockupDetect = 0;
     bool _addrForLockupDetectValid = false;
@@ -187,6 +346,20 @@ private:
     uint64_t _lastIdentPollUpdateTimeUs = 0;
     uint64_t _lastBusElemOnlineStatusUpdateTimeUs = 0;
 
+    // Snapshot and buffer for forming poll responses JSON (and mutex for their use)
+    SemaphoreHandle_t _pollRespFormatMutex = nullptr;
+    BusI2CPollSnapshot _pollRespSnapshot;
+    std::vector<char> _pollRespJsonBuf;
+    static bool isJsonTimeBaseEntry(const BusI2CPollSnapshot::Entry& entry)
+    {
+        return (entry.timestampFormat == PollTimestamp::FORMAT_US_DELTA16) && (entry.numResults > 0);
+    }
+    static bool isJsonWindowEntry(const BusI2CPollSnapshot::Entry& entry)
+    {
+        return (entry.resultsPerWindow != 0) && (entry.numResults > 0);
+    }
+    static uint32_t getWindowIdxOfOldest(const DeviceStatus& deviceStatus);
+
     // Addresses found online on main bus at any time
     uint32_t _mainBusAddrBits[(I2C_BUS_ADDRESS_MAX+31)/32] = {0};
     static const uint32_t SIZE_OF_MAIN_BUS_ADDR_BITS_ARRAY = sizeof(_mainBusAddrBits)/sizeof(_mainBusAddrBits[0]);
@@ -70,7 +70,7 @@ bool BusStuckHandler::isStuck()
 void BusStuckHandler::clearStuckByClocking()
 {
     // Iterate
-    for (int i = 0; i < I2C_BUS_STUCK_REPEAT_COUNT; i++)
+    for (uint32_t i = 0; i < I2C_BUS_STUCK_REPEAT_COUNT; i++)
     {
         // Attempt to clear bus stuck by clocking
         BusI2CAddrAndSlot addrAndSlot(I2C_BUS_STUCK_CLEAR_ADDR, 0);
@@ -59,54 +59,123 @@ void DeviceIdentMgr::identifyDevice(const BusI2CAddrAndSlot& addrAndSlot, Device
         return;
     }
 
-    // Check if this address is in the range of any known device
-    std::vector<uint16_t> deviceTypesForAddr = _deviceTypeRecords.getDeviceTypeIdxsForAddr(addrAndSlot);
-    for (const auto& deviceTypeIdx : deviceTypesForAddr)
+    // Walk the detection decision tree for the address - each distinct probe is made at most once and the first
+    // device type (in record order) whose detection values all match is chosen
+    _detectProbeResults.clear();
+    uint16_t nodeIdx = _deviceTypeRecords.getDetectTreeRoot(addrAndSlot);
+    const BusI2CDevDetectNode* pNode = _deviceTypeRecords.getDetectNode(nodeIdx);
+    for (uint32_t i = 0; pNode && (pNode->probeIdx != DEV_DETECT_NONE) && (i < _deviceTypeRecords.getNumDetectNodes()); i++)
     {
-        // Get JSON definition for device
-        const BusI2CDevTypeRecord* pDevTypeRec = _deviceTypeRecords.getDeviceInfo(deviceTypeIdx);
-        if (!pDevTypeRec)
-            continue;
+        nodeIdx = checkDetectNode(addrAndSlot, pNode) ? pNode->passNode : pNode->failNode;
+        pNode = _deviceTypeRecords.getDetectNode(nodeIdx);
+    }
+    if (!pNode || (pNode->probeIdx != DEV_DETECT_NONE))
+        return;
 
-#ifdef DEBUG_DEVICE_IDENT_MGR
-        LOG_I(MODULE_PREFIX, "identifyDevice potential deviceType %s addr@slot+1 %s", 
-                    pDevTypeRec->deviceType, addrAndSlot.toString().c_str());
+    // Get device type record
+    uint16_t deviceTypeIdx = pNode->devTypeIdx;
+    const BusI2CDevTypeRecord* pDevTypeRec = _deviceTypeRecords.getDeviceInfo(deviceTypeIdx);
+    if (!pDevTypeRec)
+    {
+#ifdef DEBUG_DEVICE_IDENT_MGR_DETAIL
+        LOG_I(MODULE_PREFIX, "identifyDevice NOT IDENTIFIED addr@slot+1 %s probes %d", 
+                    addrAndSlot.toString().c_str(), _detectProbeResults.size());
 #endif
+        return;
+    }
 
-        // Check if the detection value(s) match responses from the device
-        // Generate a bus request to read the detection value
-        if (checkDeviceTypeMatch(addrAndSlot, pDevTypeRec))
-        {
 #ifdef DEBUG_DEVICE_IDENT_MGR_DETAIL
-            LOG_I(MODULE_PREFIX, "identifyDevice FOUND %s", pDevTypeRec->devInfoJson);
+    LOG_I(MODULE_PREFIX, "identifyDevice FOUND %s probes %d", pDevTypeRec->devInfoJson, _detectProbeResults.size());
 #endif
-            // Initialise the device if required
-            processDeviceInit(addrAndSlot, pDevTypeRec);
 
-            // Set device type index
-            deviceStatus.deviceTypeIndex = deviceTypeIdx;
+    // Initialise the device if required
+    processDeviceInit(addrAndSlot, pDevTypeRec);
 
-            // Get polling info
-            _deviceTypeRecords.getPollInfo(addrAndSlot, pDevTypeRec, deviceStatus.deviceIdentPolling);
+    // Set device type index
+    deviceStatus.deviceTypeIndex = deviceTypeIdx;
+
+    // Get polling info
+    _deviceTypeRecords.getPollInfo(addrAndSlot, pDevTypeRec, deviceStatus.deviceIdentPolling);
 
-            // Set polling results size
-            deviceStatus.dataAggregator.init(deviceStatus.deviceIdentPolling.numPollResultsToStore, 
-                    deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp);
+    // Storage for polling results is allocated from the poll arena when the device status is set
+    // (see BusStatusMgr::setBusElemDeviceStatus)
+
+    // Set up downsampling (if a window is configured)
+    deviceStatus.dataWindow.init(deviceStatus.deviceIdentPolling.windowUs, pDevTypeRec->pollResultFields,
+            pDevTypeRec->numPollResultFields, deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp);
 
 #ifdef DEBUG_HANDLE_BUS_DEVICE_INFO
-            LOG_I(MODULE_PREFIX, "setBusElemDevInfo addr@slot+1 %s numPollResToStore %d pollResSizeIncTimestamp %d", 
-                    addrAndSlot.toString().c_str(),
-                    deviceStatus.deviceIdentPolling.numPollResultsToStore,
-                    deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp);
+    LOG_I(MODULE_PREFIX, "setBusElemDevInfo addr@slot+1 %s numPollResToStore %d pollResSizeIncTimestamp %d", 
+            addrAndSlot.toString().c_str(),
+            deviceStatus.deviceIdentPolling.numPollResultsToStore,
+            deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp);
 #endif
-        }
-        else
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check a detection decision tree node (making the node's probe if it hasn't been made for this device)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DeviceIdentMgr::checkDetectNode(const BusI2CAddrAndSlot& addrAndSlot, const BusI2CDevDetectNode* pNode)
+{
+    // Get the probe
+    const uint8_t* pWriteData = nullptr;
+    const BusI2CDevDetectProbe* pProbe = _deviceTypeRecords.getDetectProbe(pNode->probeIdx, pWriteData);
+    if (!pProbe)
+        return false;
+
+    // Check if already made
+    const DetectProbeResult* pResult = nullptr;
+    for (const auto& probeResult : _detectProbeResults)
+    {
+        if (probeResult.probeIdx == pNode->probeIdx)
         {
-#ifdef DEBUG_DEVICE_IDENT_MGR_DETAIL
-            LOG_I(MODULE_PREFIX, "identifyDevice CHECK FAILED %s", pDevTypeRec->devInfoJson);
-#endif
+            pResult = &probeResult;
+            break;
         }
     }
+
+    // Make the probe
+    if (!pResult)
+    {
+        BusI2CRequestRec reqRec(BUS_REQ_TYPE_FAST_SCAN, 
+                addrAndSlot,
+                0, 
+                pProbe->writeLen, 
+                pWriteData,
+                pProbe->readLen,
+                0, 
+                nullptr, 
+                this);
+        DetectProbeResult probeResult;
+        probeResult.probeIdx = pNode->probeIdx;
+        RaftI2CCentralIF::AccessResultCode rslt = _busI2CReqSyncFn(&reqRec, &probeResult.readData);
+        probeResult.isOk = (rslt == RaftI2CCentralIF::ACCESS_RESULT_OK) && (probeResult.readData.size() == pProbe->readLen);
+        _detectProbeResults.push_back(probeResult);
+        pResult = &_detectProbeResults.back();
+        _numDetectProbes++;
+
+#ifdef DEBUG_DEVICE_IDENT_MGR
+        String writeHexStr;
+        Raft::getHexStrFromBytes(pWriteData, pProbe->writeLen, writeHexStr);
+        String readHexStr;
+        Raft::getHexStrFromBytes(probeResult.readData.data(), probeResult.readData.size(), readHexStr);
+        LOG_I(MODULE_PREFIX, "checkDetectNode addr@slot+1 %s writeData %s rslt %d readData %s", 
+                    addrAndSlot.toString().c_str(), writeHexStr.c_str(), rslt, readHexStr.c_str());
+#endif
+    }
+
+    // Check the masked value
+    if (!pResult->isOk)
+        return false;
+    const uint8_t* pMask = _deviceTypeRecords.getDetectNodeMaskAndValue(pNode);
+    const uint8_t* pValue = pMask + pProbe->readLen;
+    for (uint32_t i = 0; i < pProbe->readLen; i++)
+    {
+        if ((pResult->readData[i] & pMask[i]) != pValue[i])
+            return false;
+    }
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -173,7 +242,7 @@ bool DeviceIdentMgr::checkDeviceTypeMatch(const BusI2CAddrAndSlot& addrAndSlot,
 #endif
             return false;
         }
-        for (int i = 0; i < readData.size(); i++)
+        for (uint32_t i = 0; i < readData.size(); i++)
         {
             uint8_t readDataMaskedVal = readData[i] & detectionRec.readDataMask[i];
 #ifdef DEBUG_DEVICE_IDENT_MGR
@@ -30,6 +30,12 @@ public:
     // Communicate with device to check identity
     bool checkDeviceTypeMatch(const BusI2CAddrAndSlot& addrAndSlot, const BusI2CDevTypeRecord* pDevTypeRec);
 
+    // Number of detection probes made (each distinct probe is made at most once when identifying a device)
+    uint32_t getNumDetectProbes() const
+    {
+        return _numDetectProbes;
+    }
+
     // Process device initialisation
     bool processDeviceInit(const BusI2CAddrAndSlot& addrAndSlot, const BusI2CDevTypeRecord* pDevTypeRec);
 
@@ -49,6 +55,31 @@ public:
         return _deviceTypeRecords.getDevTypeInfoJsonByTypeName(deviceTypeName, includePlugAndPlayInfo);
     }
 
+    // Get device type name (nullptr if the index is invalid)
+    const char* getDeviceTypeName(uint16_t deviceTypeIdx) const
+    {
+        const BusI2CDevTypeRecord* pDevTypeRec = _deviceTypeRecords.getDeviceInfo(deviceTypeIdx);
+        return pDevTypeRec ? pDevTypeRec->deviceType : nullptr;
+    }
+
+    // Get maximum bus frequency supported by a device type (0 if not specified)
+    uint32_t getDeviceMaxFreq(uint16_t deviceTypeIdx) const
+    {
+        const BusI2CDevTypeRecord* pDevTypeRec = _deviceTypeRecords.getDeviceInfo(deviceTypeIdx);
+        return pDevTypeRec ? pDevTypeRec->maxFreq : 0;
+    }
+
+    // Decode poll responses into the poll record structs for the device type (see DevicePollRecords_generated.h)
+    // Returns the number of records decoded (0 if the device type has no decoder)
+    uint32_t decodePollResponses(uint16_t deviceTypeIdx, const uint8_t* pPollResponses, uint32_t pollResponsesLen,
+                    void* pStructOut, uint32_t maxRecs) const
+    {
+        const BusI2CDevTypeRecord* pDevTypeRec = _deviceTypeRecords.getDeviceInfo(deviceTypeIdx);
+        if (!pDevTypeRec || !pDevTypeRec->pollResultDecodeFn)
+            return 0;
+        return pDevTypeRec->pollResultDecodeFn(pPollResponses, pollResponsesLen, pStructOut, maxRecs);
+    }
+
 private:
     // Device indentification enabled
     bool _isEnabled = false;
@@ -62,4 +93,17 @@ private:
     // Device type records
     DeviceTypeRecords _deviceTypeRecords;
 
+    // Results of detection probes made while identifying a device (reused)
+    struct DetectProbeResult
+    {
+        uint16_t probeIdx = DEV_DETECT_NONE;
+        bool isOk = false;
+        std::vector<uint8_t> readData;
+    };
+    std::vector<DetectProbeResult> _detectProbeResults;
+    uint32_t _numDetectProbes = 0;
+
+    // Helpers
+    bool checkDetectNode(const BusI2CAddrAndSlot& addrAndSlot, const BusI2CDevDetectNode* pNode);
+
 };
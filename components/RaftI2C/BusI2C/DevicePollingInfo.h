@@ -11,6 +11,26 @@
 #include <stdint.h>
 #include <list>
 #include "BusI2CRequestRec.h"
+#include "PollTimestamp.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Location of a value in a poll result (after the timestamp) - generated from the device type attributes
+struct BusI2CPollField
+{
+    // Start of the value in nibbles
+    uint8_t nibbleOffset;
+
+    // Number of nibbles (whole bytes for little endian values)
+    uint8_t numNibbles;
+
+    // Number of low-order bits holding the value (including the sign bit if signed)
+    uint8_t valueBits;
+
+    // Flags
+    uint8_t flags;
+    static const uint8_t IS_LITTLE_ENDIAN = 0x01;
+    static const uint8_t IS_SIGNED = 0x02;
+};
 
 class DevicePollingInfo 
 {
@@ -24,6 +44,8 @@ public:
         lastPollTimeUs = 0;
         pollIntervalUs = 0;
         pollResultSizeIncTimestamp = 0;
+        windowUs = 0;
+        timestampFormat = PollTimestamp::FORMAT_MS16;
         pollReqs.clear();
     }
 
@@ -42,6 +64,12 @@ public:
     // Size of poll result (including timestamp)
     uint32_t pollResultSizeIncTimestamp = 0;
 
+    // Downsampling window (0 to store every poll result)
+    uint32_t windowUs = 0;
+
+    // Format of the timestamp at the start of each poll result
+    PollTimestamp::Format timestampFormat = PollTimestamp::FORMAT_MS16;
+
     // Poll request rec
     std::vector<BusI2CRequestRec> pollReqs;
 
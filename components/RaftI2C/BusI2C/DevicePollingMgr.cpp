@@ -18,10 +18,13 @@ static const char* MODULE_PREFIX = "DevicePollingMgr";
 // Constructor
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-DevicePollingMgr::DevicePollingMgr(BusStatusMgr& busStatusMgr, BusExtenderMgr& BusExtenderMgr, BusI2CReqSyncFn busI2CReqSyncFn) :
+DevicePollingMgr::DevicePollingMgr(BusStatusMgr& busStatusMgr, BusExtenderMgr& BusExtenderMgr, BusI2CReqSyncFn busI2CReqSyncFn,
+            BusI2CReqSubmitFn busI2CReqSubmitFn, BusI2CReqWaitFn busI2CReqWaitFn) :
     _busStatusMgr(busStatusMgr),
     _busExtenderMgr(BusExtenderMgr),
-    _busI2CReqSyncFn(busI2CReqSyncFn)
+    _busI2CReqSyncFn(busI2CReqSyncFn),
+    _busI2CReqSubmitFn(busI2CReqSubmitFn),
+    _busI2CReqWaitFn(busI2CReqWaitFn)
 {
 }
 
@@ -31,6 +34,8 @@ DevicePollingMgr::DevicePollingMgr(BusStatusMgr& busStatusMgr, BusExtenderMgr& B
 
 void DevicePollingMgr::setup(const RaftJsonIF& config)
 {
+    // Pipelined polling (requires submit and wait functions)
+    _isPipelined = config.getBool("pipelined", false) && _busI2CReqSubmitFn && _busI2CReqWaitFn;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -39,57 +44,179 @@ void DevicePollingMgr::setup(const RaftJsonIF& config)
 
 void DevicePollingMgr::taskService(uint64_t timeNowUs)
 {
+    // Check for pipelined polling
+    if (_isPipelined)
+    {
+        taskServicePipelined(timeNowUs);
+        return;
+    }
+
     // See if any devices need polling
     DevicePollingInfo pollInfo;
     if (_busStatusMgr.getPendingIdentPoll(timeNowUs, pollInfo))
-    {
-        // Get the address and slot
-        if (pollInfo.pollReqs.size() == 0)
-            return;
-        BusI2CAddrAndSlot addrAndSlot = pollInfo.pollReqs[0].getAddrAndSlot();
-
-        // Check if a bus extender slot can be set (if required)
-        auto rslt = _busExtenderMgr.enableOneSlot(addrAndSlot.slotPlus1);
-        if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
-            return;
+        pollDeviceSync(timeNowUs, pollInfo);
+}
 
-        // Prep poll req data
-        pollResultPrepare(timeNowUs, pollInfo);
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Poll a device using synchronous requests (setting the bus extender slot if required)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        // Loop through the requests
-        bool allResultsOk = true;
-        for (auto& busReqRec : pollInfo.pollReqs)
+void DevicePollingMgr::pollDeviceSync(uint64_t timeNowUs, DevicePollingInfo& pollInfo)
+{
+    // Get the address and slot
+    if (pollInfo.pollReqs.size() == 0)
+        return;
+    BusI2CAddrAndSlot addrAndSlot = pollInfo.pollReqs[0].getAddrAndSlot();
+
+    // Check if a bus extender slot can be set (if required)
+    auto rslt = _busExtenderMgr.enableOneSlot(addrAndSlot.slotPlus1);
+    if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+        return;
+
+    // Prep poll req data
+    pollResultPrepare(timeNowUs, pollInfo);
+
+    // Loop through the requests
+    bool allResultsOk = true;
+    for (auto& busReqRec : pollInfo.pollReqs)
+    {
+        // Perform the polling
+        std::vector<uint8_t> readData;
+        auto rslt = _busI2CReqSyncFn(&busReqRec, &readData);
+        if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
         {
-            // Perform the polling
-            std::vector<uint8_t> readData;
-            auto rslt = _busI2CReqSyncFn(&busReqRec, &readData);
-            if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
-            {
-                allResultsOk = false;
-                break;
-            }
+            allResultsOk = false;
+            break;
+        }
 
-            // Add to data aggregator
-            pollResultAdd(pollInfo, readData);
+        // Add to data aggregator
+        pollResultAdd(pollInfo, readData);
 
 #ifdef DEBUG_POLL_RESULT
-            String writeDataHexStr;
-            Raft::getHexStrFromBytes(busReqRec.getWriteData(), busReqRec.getWriteDataLen(), writeDataHexStr);
-            String readDataHexStr;
-            Raft::getHexStrFromBytes(readData.data(), readData.size(), readDataHexStr);
-            LOG_I(MODULE_PREFIX, "taskService poll %s writeData %s readData %s rslt %s", 
-                            busReqRec.getAddrAndSlot().toString().c_str(),
-                            writeDataHexStr.c_str(),
-                            readDataHexStr.c_str(),
-                            RaftI2CCentralIF::getAccessResultStr(rslt));
+        String writeDataHexStr;
+        Raft::getHexStrFromBytes(busReqRec.getWriteData(), busReqRec.getWriteDataLen(), writeDataHexStr);
+        String readDataHexStr;
+        Raft::getHexStrFromBytes(readData.data(), readData.size(), readDataHexStr);
+        LOG_I(MODULE_PREFIX, "pollDeviceSync poll %s writeData %s readData %s rslt %s", 
+                        busReqRec.getAddrAndSlot().toString().c_str(),
+                        writeDataHexStr.c_str(),
+                        readDataHexStr.c_str(),
+                        RaftI2CCentralIF::getAccessResultStr(rslt));
 #endif
+    }
+
+    // Store the poll result if all requests succeeded
+    if (allResultsOk)
+        _busStatusMgr.pollResultStore(timeNowUs, pollInfo, addrAndSlot, _pollDataResult);
+
+    // Restore the bus extender(s) if necessary
+    _busExtenderMgr.disableAllSlots(false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipelined service from I2C task
+// The next device's poll requests are submitted before the result of the previous poll is stored so that
+// finding the next device and storing the previous result overlap the time the bus is busy. Only devices on
+// the main bus are pipelined - setting and restoring a bus extender slot are synchronous accesses so devices
+// on extender slots are polled as when not pipelined (once the poll in flight has completed)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DevicePollingMgr::taskServicePipelined(uint64_t timeNowUs)
+{
+    // The previous poll may still be in flight
+    PipelinedPoll& prevPoll = _pipelinedPolls[_pipelinedPollIdx];
+    PipelinedPoll& nextPoll = _pipelinedPolls[(_pipelinedPollIdx + 1) % NUM_PIPELINED_POLLS];
+
+    // See if any devices need polling
+    bool isNextActive = false;
+    if (_busStatusMgr.getPendingIdentPoll(timeNowUs, nextPoll.pollInfo) && (nextPoll.pollInfo.pollReqs.size() > 0))
+    {
+        nextPoll.addrAndSlot = nextPoll.pollInfo.pollReqs[0].getAddrAndSlot();
+        nextPoll.timeNowUs = timeNowUs;
+
+        // Devices on bus extender slots aren't pipelined
+        if (nextPoll.addrAndSlot.slotPlus1 != 0)
+        {
+            if (prevPoll.isActive)
+                completePipelinedPoll(prevPoll);
+            pollDeviceSync(timeNowUs, nextPoll.pollInfo);
+            return;
         }
+        isNextActive = submitPipelinedPoll(nextPoll);
+    }
+
+    // Store the previous result while the bus is busy with the next poll
+    if (prevPoll.isActive)
+        completePipelinedPoll(prevPoll);
+
+    // Next poll becomes the one in flight
+    if (isNextActive)
+        _pipelinedPollIdx = (_pipelinedPollIdx + 1) % NUM_PIPELINED_POLLS;
+}
 
-        // Store the poll result if all requests succeeded
-        if (allResultsOk)
-            _busStatusMgr.pollResultStore(timeNowUs, pollInfo, addrAndSlot, _pollDataResult);
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Submit the requests for a pipelined poll
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        // Restore the bus extender(s) if necessary
-        _busExtenderMgr.disableAllSlots(false);
+bool DevicePollingMgr::submitPipelinedPoll(PipelinedPoll& poll)
+{
+    // Read buffers must not move while requests are in flight
+    uint32_t numReqs = poll.pollInfo.pollReqs.size();
+    poll.readData.resize(numReqs);
+    poll.numSubmitted = 0;
+    poll.numDone = 0;
+    poll.allResultsOk = true;
+    poll.isActive = true;
+    for (uint32_t reqIdx = 0; reqIdx < numReqs; reqIdx++)
+    {
+        const BusI2CRequestRec& busReqRec = poll.pollInfo.pollReqs[reqIdx];
+        std::vector<uint8_t>& readData = poll.readData[reqIdx];
+        readData.resize(busReqRec.getReadReqLen());
+
+        // Submit - waiting for the queue to have space
+        auto completeCB = [&poll](RaftI2CCentralIF::AccessResultCode rslt, uint32_t numRead)
+            {
+                poll.numDone++;
+                if (rslt != RaftI2CCentralIF::ACCESS_RESULT_OK)
+                    poll.allResultsOk = false;
+            };
+        bool isSubmitted = _busI2CReqSubmitFn(&busReqRec, readData.data(), completeCB);
+        if (!isSubmitted)
+        {
+            _busI2CReqWaitFn(false);
+            isSubmitted = _busI2CReqSubmitFn(&busReqRec, readData.data(), completeCB);
+        }
+        if (!isSubmitted)
+        {
+            poll.allResultsOk = false;
+            poll.isActive = poll.numSubmitted > 0;
+            return poll.isActive;
+        }
+        poll.numSubmitted++;
     }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wait for a pipelined poll to complete and store the result
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DevicePollingMgr::completePipelinedPoll(PipelinedPoll& poll)
+{
+    // Wait for requests (if the queue empties without them completing they have been abandoned)
+    while ((poll.numDone < poll.numSubmitted) && (_busI2CReqWaitFn(false) > 0))
+        ;
+    poll.isActive = false;
+    if ((poll.numDone < poll.numSubmitted) || !poll.allResultsOk)
+        return;
+
+    // Aggregate and store the poll result
+    pollResultPrepare(poll.timeNowUs, poll.pollInfo);
+    for (std::vector<uint8_t>& readData : poll.readData)
+        pollResultAdd(poll.pollInfo, readData);
+    _busStatusMgr.pollResultStore(poll.timeNowUs, poll.pollInfo, poll.addrAndSlot, _pollDataResult);
+
+#ifdef DEBUG_POLL_RESULT
+    LOG_I(MODULE_PREFIX, "completePipelinedPoll %s numReqs %d", poll.addrAndSlot.toString().c_str(), poll.numSubmitted);
+#endif
 }
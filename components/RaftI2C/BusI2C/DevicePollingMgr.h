@@ -17,7 +17,8 @@ class DevicePollingMgr
 {
 public:
     // Constructor
-    DevicePollingMgr(BusStatusMgr& busStatusMgr, BusExtenderMgr& BusExtenderMgr, BusI2CReqSyncFn busI2CReqSyncFn);
+    DevicePollingMgr(BusStatusMgr& busStatusMgr, BusExtenderMgr& BusExtenderMgr, BusI2CReqSyncFn busI2CReqSyncFn,
+                BusI2CReqSubmitFn busI2CReqSubmitFn = nullptr, BusI2CReqWaitFn busI2CReqWaitFn = nullptr);
 
     // Setup
     void setup(const RaftJsonIF& config);
@@ -25,6 +26,14 @@ public:
     // Service from I2C task
     void taskService(uint64_t timeNowUs);
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if polling is pipelined (the next device's poll is submitted before the previous result is stored
+    ///        - only for devices on the main bus)
+    bool isPipelined() const
+    {
+        return _isPipelined;
+    }
+
     // Poll result handling
     void pollResultPrepare(uint64_t timeNowUs, const DevicePollingInfo& pollInfo)
     {
@@ -63,7 +72,35 @@ private:
     // I2C request sync function
     BusI2CReqSyncFn _busI2CReqSyncFn;
 
+    // I2C request submit and wait functions (used when pipelined)
+    BusI2CReqSubmitFn _busI2CReqSubmitFn;
+    BusI2CReqWaitFn _busI2CReqWaitFn;
+
+    // Pipelined polling - finding the next device to poll and storing the previous result happen while
+    // the bus is busy with submitted requests (devices on bus extender slots are polled synchronously)
+    bool _isPipelined = false;
+    struct PipelinedPoll
+    {
+        bool isActive = false;
+        DevicePollingInfo pollInfo;
+        BusI2CAddrAndSlot addrAndSlot;
+        uint64_t timeNowUs = 0;
+        std::vector<std::vector<uint8_t>> readData;
+        uint32_t numSubmitted = 0;
+        uint32_t numDone = 0;
+        bool allResultsOk = true;
+    };
+    static const uint32_t NUM_PIPELINED_POLLS = 2;
+    PipelinedPoll _pipelinedPolls[NUM_PIPELINED_POLLS];
+    uint32_t _pipelinedPollIdx = 0;
+
     // Poll data result
     std::vector<uint8_t> _pollDataResult;
     uint8_t* _pPollDataResult = nullptr;
+
+    // Helpers
+    void pollDeviceSync(uint64_t timeNowUs, DevicePollingInfo& pollInfo);
+    void taskServicePipelined(uint64_t timeNowUs);
+    bool submitPipelinedPoll(PipelinedPoll& poll);
+    void completePipelinedPoll(PipelinedPoll& poll);
 };
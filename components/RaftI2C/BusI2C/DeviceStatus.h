@@ -5,6 +5,7 @@
 #include "RaftUtils.h"
 #include "DevicePollingInfo.h"
 #include "PollDataAggregator.h"
+#include "PollDataWindow.h"
 
 class DeviceStatus
 {
@@ -20,6 +21,7 @@ public:
         deviceTypeIndex = DEVICE_TYPE_INDEX_INVALID;
         deviceIdentPolling.clear();
         dataAggregator.clear();
+        dataWindow.clear();
     }
 
     bool isValid() const
@@ -30,10 +32,12 @@ public:
     // Get pending ident poll info
     bool getPendingIdentPollInfo(uint64_t timeNowUs, DevicePollingInfo& pollInfo);
 
-    // Store poll results
+    // Store poll results (returns true if results were added to the aggregator)
     bool pollResultStore(uint64_t timeNowUs, const DevicePollingInfo& pollInfo, const std::vector<uint8_t>& pollResult)
     {
-        return dataAggregator.put(pollResult);
+        if (dataWindow.isEnabled())
+            return dataWindow.add(timeNowUs, pollResult, dataAggregator);
+        return dataAggregator.put(pollResult, timeNowUs);
     }
 
     // Get device type index
@@ -50,4 +54,7 @@ public:
 
     // Data aggregator
     PollDataAggregator dataAggregator;
+
+    // Downsampling of poll results into the aggregator
+    PollDataWindow dataWindow;
 };
@@ -6,6 +6,7 @@
 //
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <string.h>
 #include "DeviceTypeRecords.h"
 #include "BusRequestInfo.h"
 
@@ -81,17 +82,34 @@ const BusI2CDevTypeRecord* DeviceTypeRecords::getDeviceInfo(uint16_t deviceTypeI
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Get device type for a device type name
-/// @param deviceTypeName device type name
+/// @param pDeviceTypeName device type name
 /// @return pointer to device type record if device type found, nullptr if not
-const BusI2CDevTypeRecord* DeviceTypeRecords::getDeviceInfo(const String& deviceTypeName) const
+const BusI2CDevTypeRecord* DeviceTypeRecords::getDeviceInfo(const char* pDeviceTypeName) const
 {
-    // Iterate the device types
-    for (uint16_t i = 0; i < BASE_DEV_TYPE_ARRAY_SIZE; i++)
-    {
-        if (deviceTypeName == baseDevTypeRecords[i].deviceType)
-            return &baseDevTypeRecords[i];
-    }
-    return nullptr;
+    uint16_t deviceTypeIdx = 0;
+    if (!getDeviceTypeIdx(pDeviceTypeName, deviceTypeIdx))
+        return nullptr;
+    return &baseDevTypeRecords[deviceTypeIdx];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get device type index for a device type name
+/// @param pDeviceTypeName device type name
+/// @param deviceTypeIdx (out) device type index
+/// @return true if device type found
+bool DeviceTypeRecords::getDeviceTypeIdx(const char* pDeviceTypeName, uint16_t& deviceTypeIdx) const
+{
+    if (!pDeviceTypeName)
+        return false;
+
+    // The generated perfect hash gives the only record the name can match
+    uint32_t bucket = devTypeNameHash(pDeviceTypeName, 0) % DEV_TYPE_NAME_HASH_NUM_BUCKETS;
+    uint32_t slot = devTypeNameHash(pDeviceTypeName, devTypeNameHashSeeds[bucket]) % DEV_TYPE_NAME_HASH_NUM_SLOTS;
+    uint16_t recIdx = devTypeNameHashSlots[slot];
+    if ((recIdx >= BASE_DEV_TYPE_ARRAY_SIZE) || (strcmp(pDeviceTypeName, baseDevTypeRecords[recIdx].deviceType) != 0))
+        return false;
+    deviceTypeIdx = recIdx;
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -175,6 +193,12 @@ void DeviceTypeRecords::getPollInfo(BusI2CAddrAndSlot addrAndSlot, const BusI2CD
     // Get polling interval
     pollingInfo.pollIntervalUs = pollInfo.getLong("i", 0) * 1000;
 
+    // Get downsampling window
+    pollingInfo.windowUs = pollInfo.getLong("w", 0) * 1000;
+
+    // Get timestamp format
+    pollingInfo.timestampFormat = PollTimestamp::formatFromStr(pollInfo.getString("t", "").c_str());
+
     // Set the poll result size
     pollingInfo.pollResultSizeIncTimestamp = pollResultDataSize + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE;
 }
@@ -260,7 +284,7 @@ bool DeviceTypeRecords::extractMaskAndDataFromHexStr(const String& readStr, std:
         // Extract the read data
         readDataMask.resize(lenBytes);
         readDataCheck.resize(lenBytes);
-        for (int i = 1; i < readStrLC.length(); i++)
+        for (uint32_t i = 1; i < readStrLC.length(); i++)
         {
             readDataMask[i - 1] = maskToZeros ? 0xff : 0;
             readDataCheck[i - 1] = 0;
@@ -278,7 +302,7 @@ bool DeviceTypeRecords::extractMaskAndDataFromHexStr(const String& readStr, std:
         readDataCheck.resize(lenBytes);
         uint32_t bitMask = 0x80;
         uint32_t byteIdx = 0;
-        for (int i = 2; i < readStrLC.length(); i++)
+        for (uint32_t i = 2; i < readStrLC.length(); i++)
         {
             if (bitMask == 0x80)
             {
@@ -342,6 +366,57 @@ void DeviceTypeRecords::getDetectionRecs(const BusI2CDevTypeRecord* pDevTypeRec,
 #endif
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the root of the detection decision tree for an address
+/// @param addrAndSlot i2c address and slot
+/// @return root node index (DEV_DETECT_NONE if no device types can be at the address)
+uint16_t DeviceTypeRecords::getDetectTreeRoot(BusI2CAddrAndSlot addrAndSlot) const
+{
+    if ((addrAndSlot.addr < BASE_DEV_INDEX_BY_ARRAY_MIN_ADDR) || (addrAndSlot.addr > BASE_DEV_INDEX_BY_ARRAY_MAX_ADDR))
+        return DEV_DETECT_NONE;
+    return devDetectRootByAddr[addrAndSlot.addr - BASE_DEV_INDEX_BY_ARRAY_MIN_ADDR];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get a detection decision tree node
+/// @param nodeIdx node index
+/// @return pointer to node (nullptr if invalid)
+const BusI2CDevDetectNode* DeviceTypeRecords::getDetectNode(uint16_t nodeIdx) const
+{
+    if (nodeIdx >= DEV_DETECT_NUM_NODES)
+        return nullptr;
+    return &devDetectNodes[nodeIdx];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get a detection probe
+/// @param probeIdx probe index
+/// @param pWriteData (out) bytes to write
+/// @return pointer to probe (nullptr if invalid)
+const BusI2CDevDetectProbe* DeviceTypeRecords::getDetectProbe(uint16_t probeIdx, const uint8_t*& pWriteData) const
+{
+    if (probeIdx >= DEV_DETECT_NUM_PROBES)
+        return nullptr;
+    pWriteData = devDetectData + devDetectProbes[probeIdx].writeOffset;
+    return &devDetectProbes[probeIdx];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the mask and value checked by a detection node
+/// @param pNode node
+/// @return pointer to mask (followed by value)
+const uint8_t* DeviceTypeRecords::getDetectNodeMaskAndValue(const BusI2CDevDetectNode* pNode) const
+{
+    return devDetectData + pNode->dataOffset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the number of detection tree nodes
+uint32_t DeviceTypeRecords::getNumDetectNodes() const
+{
+    return DEV_DETECT_NUM_NODES;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Convert poll response to JSON
 /// @param addrAndSlot i2c address and slot
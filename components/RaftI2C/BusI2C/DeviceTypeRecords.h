@@ -18,8 +18,10 @@
 /// @brief Get length of a data record
 typedef uint32_t (*BusI2CDevTypeRecordLengthFn)();
 
-/// @brief Get decoded data record
-typedef void (*BusI2CDevTypeRecordDecodeFn)(uint8_t* pPollResult, uint32_t pollResultLen, void* pDest);
+/// @brief Decode poll records (timestamp and data as stored by the poll data aggregator) into an array of the
+///        poll record structs for the device type (see DevicePollRecords_generated.h)
+/// @return number of records decoded
+typedef uint32_t (*BusI2CDevTypeRecordDecodeFn)(const uint8_t* pPollResult, uint32_t pollResultLen, void* pStructOut, uint32_t maxRecs);
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @class BusI2CDevTypeRecord
@@ -35,6 +37,9 @@ public:
     const char* devInfoJson = nullptr;
     BusI2CDevTypeRecordLengthFn pollResultLenFn = nullptr;
     BusI2CDevTypeRecordDecodeFn pollResultDecodeFn = nullptr;
+    uint32_t maxFreq = 0;
+    const BusI2CPollField* pollResultFields = nullptr;
+    uint32_t numPollResultFields = 0;
 
     String getJson(bool includePlugAndPlayInfo) const
     {
@@ -57,6 +62,31 @@ public:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Device detection probe (bytes written then number of bytes read) - each distinct probe is made at most
+///        once when identifying a device
+struct BusI2CDevDetectProbe
+{
+    // Offset of write data in the detection data
+    uint16_t writeOffset;
+    uint8_t writeLen;
+    uint8_t readLen;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Device detection decision tree node - checks the bytes read by a probe against a masked value (mask
+///        then value, readLen bytes each, at dataOffset in the detection data) and goes to passNode or failNode.
+///        Leaf nodes have probeIdx DEV_DETECT_NONE and give the device type index (DEV_DETECT_NONE if no match)
+struct BusI2CDevDetectNode
+{
+    uint16_t probeIdx;
+    uint16_t dataOffset;
+    uint16_t passNode;
+    uint16_t failNode;
+    uint16_t devTypeIdx;
+};
+static const uint16_t DEV_DETECT_NONE = 0xffff;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @class DeviceTypeRecords
 /// @brief Device type records
@@ -81,7 +111,18 @@ public:
     /// @brief Get device type record for a device type name
     /// @param deviceType device type name
     /// @return pointer to info record if device type found, nullptr if not
-    const BusI2CDevTypeRecord* getDeviceInfo(const String& deviceType) const;
+    const BusI2CDevTypeRecord* getDeviceInfo(const String& deviceType) const
+    {
+        return getDeviceInfo(deviceType.c_str());
+    }
+    const BusI2CDevTypeRecord* getDeviceInfo(const char* pDeviceType) const;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get device type index for a device type name
+    /// @param pDeviceType device type name
+    /// @param deviceTypeIdx (out) device type index (the same in all builds with the same device type records)
+    /// @return true if device type found
+    bool getDeviceTypeIdx(const char* pDeviceType, uint16_t& deviceTypeIdx) const;
 
     /// @brief Get device polling info
     /// @param addrAndSlot i2c address and slot
@@ -118,6 +159,36 @@ public:
     /// @param detectionRecs (out) detection records
     void getDetectionRecs(const BusI2CDevTypeRecord* pDevTypeRec, std::vector<DeviceDetectionRec>& detectionRecs);
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the root of the detection decision tree for an address (generated from the detection values of
+    ///        the device types which can be at the address)
+    /// @param addrAndSlot i2c address and slot
+    /// @return root node index (DEV_DETECT_NONE if no device types can be at the address)
+    uint16_t getDetectTreeRoot(BusI2CAddrAndSlot addrAndSlot) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get a detection decision tree node
+    /// @param nodeIdx node index
+    /// @return pointer to node (nullptr if invalid)
+    const BusI2CDevDetectNode* getDetectNode(uint16_t nodeIdx) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get a detection probe
+    /// @param probeIdx probe index
+    /// @param pWriteData (out) bytes to write
+    /// @return pointer to probe (nullptr if invalid)
+    const BusI2CDevDetectProbe* getDetectProbe(uint16_t probeIdx, const uint8_t*& pWriteData) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the mask and value checked by a detection node (readLen bytes each)
+    /// @param pNode node
+    /// @return pointer to mask (followed by value)
+    const uint8_t* getDetectNodeMaskAndValue(const BusI2CDevDetectNode* pNode) const;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the number of detection tree nodes
+    uint32_t getNumDetectNodes() const;
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Get initialisation bus requests
     /// @param addrAndSlot i2c address and slot
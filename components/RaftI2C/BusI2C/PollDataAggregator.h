@@ -9,31 +9,119 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <vector>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "PollDataArena.h"
+#include "PollTimestamp.h"
 
 class PollDataAggregator
 {
 public:
+    // Record counters (since the buffer was initialised or cleared) - numProduced is the sum of the others
+    struct Stats
+    {
+        uint32_t numProduced = 0;
+        uint32_t numConsumed = 0;
+        uint32_t numOverwritten = 0;
+        uint32_t numDropped = 0;
+        uint32_t numUnread = 0;
+        uint32_t oldestUnreadAgeMs = 0;
+    };
+
     PollDataAggregator()
     {
-        // Access semaphore
-        _accessMutex = xSemaphoreCreateMutex();
+    }
+
+    // Copies get their own access mutex (if the original has one) and share an arena region with the original
+    // (the owner of the arena decides which copy frees it)
+    PollDataAggregator(const PollDataAggregator& other)
+    {
+        copyFrom(other);
+    }
+    PollDataAggregator& operator=(const PollDataAggregator& other)
+    {
+        if (this != &other)
+            copyFrom(other);
+        return *this;
+    }
+
+    ~PollDataAggregator()
+    {
+        if (_accessMutex)
+            vSemaphoreDelete(_accessMutex);
     }
 
     ////////////////////////////////////////////////////////////////////////////
-    /// @brief Initialise circular buffer
+    /// @brief Initialise circular buffer (allocated on the heap)
     /// @param numResultsToStore Number of results to store
     /// @param resultSize Size of each result
     void init(uint32_t numResultsToStore, uint32_t resultSize)
     {
+        // Access semaphore
+        if (!_accessMutex)
+            _accessMutex = xSemaphoreCreateMutex();
+
+        _pArena = nullptr;
+        _arenaRegion = PollDataArena::Region();
         _ringBuffer.resize(numResultsToStore*resultSize);
+        _ringBufSize = numResultsToStore*resultSize;
+        _ringBufHeadOffset = 0;
+        _ringBufCount = 0;
+        _maxElems = numResultsToStore;
+        _resultSize = resultSize;
+        _stats = Stats();
+        _hasTimeBase = false;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Initialise circular buffer in a region of an arena
+    /// @param arena Arena to allocate from
+    /// @param numResultsToStore Number of results to store
+    /// @param resultSize Size of each result
+    /// @return true if the region was allocated
+    /// @note No access mutex is used - the owner of the arena must serialise access. Any previous buffer is
+    ///       dropped without being freed (use release() first if it is owned by this aggregator)
+    bool initInArena(PollDataArena& arena, uint32_t numResultsToStore, uint32_t resultSize)
+    {
+        _pArena = nullptr;
+        _arenaRegion = PollDataArena::Region();
+        std::vector<uint8_t>().swap(_ringBuffer);
+        _ringBufSize = 0;
         _ringBufHeadOffset = 0;
         _ringBufCount = 0;
         _maxElems = numResultsToStore;
         _resultSize = resultSize;
+        _stats = Stats();
+        _hasTimeBase = false;
+        if (!arena.alloc(numResultsToStore*resultSize, _arenaRegion))
+            return false;
+        _pArena = &arena;
+        _ringBufSize = _arenaRegion.len;
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Release the circular buffer (returning it to the arena if in one)
+    void release()
+    {
+        if (_pArena)
+            _pArena->free(_arenaRegion);
+        _pArena = nullptr;
+        _arenaRegion = PollDataArena::Region();
+        std::vector<uint8_t>().swap(_ringBuffer);
+        _ringBufSize = 0;
+        _ringBufHeadOffset = 0;
+        _ringBufCount = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the arena region used (nullptr if not in an arena)
+    PollDataArena::Region* getArenaRegion()
+    {
+        return _pArena ? &_arenaRegion : nullptr;
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -41,41 +129,95 @@ public:
     void clear()
     {
         // Obtain access
-        if (xSemaphoreTake(_accessMutex, portMAX_DELAY) != pdTRUE)
+        if (!lock())
             return;
         _ringBufHeadOffset = 0;
         _ringBufCount = 0;
-        xSemaphoreGive(_accessMutex);
+        _stats = Stats();
+        _hasTimeBase = false;
+        unlock();
     }
 
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Put a vector of uint8_t data to one slot in the circular buffer
     /// @param data Data to add
-    bool put(const std::vector<uint8_t>& data)
+    /// @param timeUs Time of the result (the base for result times on read - a FORMAT_US_DELTA16 timestamp is
+    ///               coded from it)
+    bool put(const std::vector<uint8_t>& data, uint64_t timeUs = 0)
     {
         // Check buffer size > size of a single result
-        if (data.size() != _resultSize)
+        if ((data.size() != _resultSize) || (_ringBufSize == 0))
             return false;
 
         // Obtain access
-        if (xSemaphoreTake(_accessMutex, portMAX_DELAY) != pdTRUE)
+        if (!lock())
             return false;
 
+        // Check if full (the new result is dropped if the oldest unread result mustn't be overwritten)
+        _stats.numProduced++;
+        if (_ringBufCount >= _maxElems)
+        {
+            if (_blockOldest)
+            {
+                _stats.numDropped++;
+                unlock();
+                return false;
+            }
+            _stats.numOverwritten++;
+        }
+
         // Add data
-        memcpy(_ringBuffer.data() + _ringBufHeadOffset, data.data(), _resultSize);
+        uint8_t* pResult = ringBufData() + _ringBufHeadOffset;
+        memcpy(pResult, data.data(), _resultSize);
+
+        // Replace the timestamp with the delta from the previous result if required
+        if ((_timestampFormat == PollTimestamp::FORMAT_US_DELTA16) && (_resultSize >= PollTimestamp::SIZE_BYTES))
+        {
+            uint32_t codedDeltaUs = 0;
+            uint16_t code = PollTimestamp::encodeDeltaUs(
+                        _hasTimeBase && (timeUs > _newestTimeUs) ? timeUs - _newestTimeUs : 0, codedDeltaUs);
+            pResult[0] = code >> 8;
+            pResult[1] = code & 0xff;
+            _newestTimeUs = _hasTimeBase && (code != PollTimestamp::CODE_REBASED) ? _newestTimeUs + codedDeltaUs : timeUs;
+        }
+        else
+        {
+            _newestTimeUs = timeUs;
+        }
+        _hasTimeBase = true;
 
         // Update ring buffer
         _ringBufHeadOffset += _resultSize;
-        if (_ringBufHeadOffset >= _ringBuffer.size())
+        if (_ringBufHeadOffset >= _ringBufSize)
             _ringBufHeadOffset = 0;
         if (_ringBufCount < _maxElems)
             _ringBufCount++;
 
         // Release access
-        xSemaphoreGive(_accessMutex);
+        unlock();
         return true;
     }
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Check there is room to put a group of results which must be stored whole
+    /// @param numResults Number of results in the group
+    /// @return false if the oldest unread result mustn't be overwritten and the group doesn't fit (the results
+    ///         are then counted as dropped)
+    bool checkRoomFor(uint32_t numResults)
+    {
+        // Obtain access
+        if (!lock())
+            return false;
+        bool isRoom = !_blockOldest || (_ringBufCount + numResults <= _maxElems);
+        if (!isRoom)
+        {
+            _stats.numProduced += numResults;
+            _stats.numDropped += numResults;
+        }
+        unlock();
+        return isRoom;
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Get the last vector of uint8_t data from the circular buffer
     /// @param data (output) Data to get
@@ -86,7 +228,7 @@ public:
         data.clear();
 
         // Obtain access
-        if (xSemaphoreTake(_accessMutex, portMAX_DELAY) != pdTRUE)
+        if (!lock())
             return false;
 
         // Check if buffer empty
@@ -94,18 +236,19 @@ public:
         if (dataAvailble)
         {        
             // Get position of tail
-            uint32_t pos = (_ringBufHeadOffset + _ringBuffer.size() - _ringBufCount*_resultSize) % _ringBuffer.size();
+            uint32_t pos = (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
 
             // Copy data
             data.resize(_resultSize);
-            memcpy(data.data(), _ringBuffer.data() + pos, _resultSize);
+            memcpy(data.data(), ringBufData() + pos, _resultSize);
 
             // Update ring buffer count
             _ringBufCount--;
+            _stats.numConsumed++;
         }
 
         // Release access
-        xSemaphoreGive(_accessMutex);
+        unlock();
         return dataAvailble;
     }
 
@@ -114,14 +257,17 @@ public:
     /// @param data (output) Data to get
     /// @param responseSize (output) Size of each response
     /// @param maxResponsesToReturn Maximum number of responses to return (pass 0 for all available)
+    /// @param pLastTimeUs (output) Time of the last response returned (can be nullptr) - PollTimestamp::TIME_UNKNOWN
+    ///                    if a result left unread is re-based
     /// @return number of responses returned
-    uint32_t get(std::vector<uint8_t>& data, uint32_t& responseSize, uint32_t maxResponsesToReturn)
+    uint32_t get(std::vector<uint8_t>& data, uint32_t& responseSize, uint32_t maxResponsesToReturn,
+                uint64_t* pLastTimeUs = nullptr)
     {
         // Clear data
         data.clear();
 
         // Obtain access
-        if (xSemaphoreTake(_accessMutex, portMAX_DELAY) != pdTRUE)
+        if (!lock())
             return 0;
 
         // Num responses to return
@@ -132,12 +278,12 @@ public:
         if (numResponsesToReturn == 0)
         {
             // Release access
-            xSemaphoreGive(_accessMutex);
+            unlock();
             return 0;
         }
 
         // Get position of tail
-        uint32_t pos = (_ringBufHeadOffset + _ringBuffer.size() - _ringBufCount*_resultSize) % _ringBuffer.size();
+        uint32_t pos = (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
 
         // Output data
         data.resize(numResponsesToReturn*_resultSize);
@@ -147,45 +293,336 @@ public:
         for (uint32_t i = 0; i < numResponsesToReturn; i++)
         {
             // Copy data
-            memcpy(pOutData, _ringBuffer.data() + pos, _resultSize);
+            memcpy(pOutData, ringBufData() + pos, _resultSize);
 
             // Update positions
             pOutData += _resultSize;
             pos += _resultSize;
-            if (pos >= _ringBuffer.size())
+            if (pos >= _ringBufSize)
                 pos = 0;
         }
 
         // Update records remaining count
+        if (pLastTimeUs)
+            *pLastTimeUs = unreadTimeUs(numResponsesToReturn - 1);
         _ringBufCount -= numResponsesToReturn;
+        _stats.numConsumed += numResponsesToReturn;
 
         // Release access
-        xSemaphoreGive(_accessMutex);
+        unlock();
         return numResponsesToReturn;
     }
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get results into a buffer with the timestamp of each replaced by the delta from the previous one
+    /// @param pOut Buffer to write to
+    /// @param outMaxLen Size of buffer
+    /// @param timestampSize Size of the big-endian timestamp at the start of each result
+    /// @param maxResponsesToReturn Maximum number of responses to return (pass 0 for all that fit)
+    /// @param baseTimestamp (output) Timestamp of the first result returned
+    /// @param numResponses (output) Number of results returned
+    /// @return number of bytes written
+    /// @note Each result is written as a 1 byte delta (or DELTA_ESCAPE followed by a timestampSize delta)
+    ///       followed by the data without its timestamp - the first delta is 0. Results which don't fit stay
+    ///       in the buffer
+    uint32_t getTimestampDeltas(uint8_t* pOut, uint32_t outMaxLen, uint32_t timestampSize, uint32_t maxResponsesToReturn,
+                uint32_t& baseTimestamp, uint32_t& numResponses)
+    {
+        baseTimestamp = 0;
+        numResponses = 0;
+        if ((timestampSize == 0) || (timestampSize > 4) || (_resultSize < timestampSize))
+            return 0;
+
+        // Obtain access
+        if (!lock())
+            return 0;
+
+        // Get position of tail
+        uint32_t pos = _ringBufCount == 0 ? 0 : 
+                    (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
+        uint32_t dataSize = _resultSize - timestampSize;
+        uint32_t tsMask = timestampSize >= 4 ? UINT32_MAX : (1UL << (timestampSize * 8)) - 1;
+        uint32_t outPos = 0;
+        uint32_t prevTimestamp = 0;
+        while ((numResponses < _ringBufCount) && ((maxResponsesToReturn == 0) || (numResponses < maxResponsesToReturn)))
+        {
+            // Timestamp and delta
+            const uint8_t* pResult = ringBufData() + pos;
+            uint32_t timestamp = 0;
+            for (uint32_t i = 0; i < timestampSize; i++)
+                timestamp = (timestamp << 8) | pResult[i];
+            uint32_t delta = numResponses == 0 ? 0 : (timestamp - prevTimestamp) & tsMask;
+            uint32_t deltaSize = delta < DELTA_ESCAPE ? 1 : 1 + timestampSize;
+            if (outPos + deltaSize + dataSize > outMaxLen)
+                break;
+
+            // Write delta and data
+            if (delta < DELTA_ESCAPE)
+            {
+                pOut[outPos++] = delta;
+            }
+            else
+            {
+                pOut[outPos++] = DELTA_ESCAPE;
+                for (uint32_t i = 0; i < timestampSize; i++)
+                    pOut[outPos++] = (delta >> ((timestampSize - 1 - i) * 8)) & 0xff;
+            }
+            memcpy(pOut + outPos, pResult + timestampSize, dataSize);
+            outPos += dataSize;
+            if (numResponses == 0)
+                baseTimestamp = timestamp;
+            prevTimestamp = timestamp;
+            numResponses++;
+
+            // Next result
+            pos += _resultSize;
+            if (pos >= _ringBufSize)
+                pos = 0;
+        }
+
+        // Update records remaining count
+        _ringBufCount -= numResponses;
+        _stats.numConsumed += numResponses;
+
+        // Release access
+        unlock();
+        return outPos;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get results into a buffer (oldest first)
+    /// @param pOut Buffer to write to
+    /// @param outMaxLen Size of buffer
+    /// @param maxResponsesToReturn Maximum number of responses to return (pass 0 for all that fit)
+    /// @param pLastTimeUs (output) Time of the last response returned (can be nullptr) - PollTimestamp::TIME_UNKNOWN
+    ///                    if a result left unread is re-based
+    /// @return number of responses returned
+    uint32_t get(uint8_t* pOut, uint32_t outMaxLen, uint32_t maxResponsesToReturn, uint64_t* pLastTimeUs = nullptr)
+    {
+        // Obtain access
+        if (!lock())
+            return 0;
+
+        // Num responses to return
+        uint32_t numResponses = (maxResponsesToReturn == 0) || (_ringBufCount < maxResponsesToReturn) ? _ringBufCount : maxResponsesToReturn;
+        if ((_resultSize > 0) && (numResponses * _resultSize > outMaxLen))
+            numResponses = outMaxLen / _resultSize;
+
+        // Copy in at most two parts (the ring buffer may wrap)
+        if (numResponses > 0)
+        {
+            uint32_t pos = (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
+            uint32_t len = numResponses * _resultSize;
+            uint32_t firstLen = len < _ringBufSize - pos ? len : _ringBufSize - pos;
+            memcpy(pOut, ringBufData() + pos, firstLen);
+            memcpy(pOut + firstLen, ringBufData(), len - firstLen);
+        }
+
+        // Update records remaining count
+        if (pLastTimeUs)
+            *pLastTimeUs = numResponses > 0 ? unreadTimeUs(numResponses - 1) : 0;
+        _ringBufCount -= numResponses;
+        _stats.numConsumed += numResponses;
+
+        // Release access
+        unlock();
+        return numResponses;
+    }
+
+    // Timestamp delta escape value (followed by the full delta)
+    static const uint8_t DELTA_ESCAPE = 0xff;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the size of each result (including timestamp)
+    uint32_t getResultSize() const
+    {
+        return _resultSize;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the maximum number of bytes of results that can be stored
+    uint32_t getCapacityBytes() const
+    {
+        return _ringBufSize;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Set the format of the timestamp at the start of each result
+    /// @param format Format (results put with FORMAT_US_DELTA16 have their timestamp replaced by the coded delta)
+    void setTimestampFormat(PollTimestamp::Format format)
+    {
+        _timestampFormat = format;
+        _hasTimeBase = false;
+    }
+    PollTimestamp::Format getTimestampFormat() const
+    {
+        return _timestampFormat;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Set whether the oldest unread result is kept when the buffer is full
+    /// @param blockOldest true to drop new results when full (false to overwrite the oldest)
+    void setBlockOldest(bool blockOldest)
+    {
+        _blockOldest = blockOldest;
+    }
+    bool isBlockOldest() const
+    {
+        return _blockOldest;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get record counters and the age of the oldest unread result
+    /// @param stats (out) stats
+    /// @param timeNowMs Time now in ms (same clock as the result timestamps)
+    /// @param timestampSize Size of the big-endian ms timestamp at the start of each result (ages wrap at the
+    ///                      range of the timestamp - not used for FORMAT_US_DELTA16)
+    void getStats(Stats& stats, uint32_t timeNowMs, uint32_t timestampSize) const
+    {
+        stats = Stats();
+        if (!lock())
+            return;
+        stats = _stats;
+        stats.numUnread = _ringBufCount;
+        if ((_ringBufCount > 0) && (_timestampFormat == PollTimestamp::FORMAT_US_DELTA16))
+        {
+            // Time of the oldest unread result can be unknown (before a re-based result) so use the oldest known
+            stats.oldestUnreadAgeMs = timeNowMs - (uint32_t)(unreadTimeUs(0, true) / 1000);
+        }
+        else if ((_ringBufCount > 0) && (timestampSize > 0) && (timestampSize <= 4) && (_resultSize >= timestampSize))
+        {
+            const uint8_t* pOldest = ringBufData() + 
+                        (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
+            uint32_t timestamp = 0;
+            for (uint32_t i = 0; i < timestampSize; i++)
+                timestamp = (timestamp << 8) | pOldest[i];
+            uint32_t tsMask = timestampSize >= 4 ? UINT32_MAX : (1UL << (timestampSize * 8)) - 1;
+            stats.oldestUnreadAgeMs = (timeNowMs - timestamp) & tsMask;
+        }
+        unlock();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the total number of results put into the buffer (including those since consumed or overwritten)
+    uint32_t getNumPut() const
+    {
+        return _stats.numProduced - _stats.numDropped;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the newest results without consuming them
+    /// @param pOut Buffer to write to
+    /// @param outMaxLen Size of buffer
+    /// @param numResults Number of results wanted
+    /// @param pLastTimeUs (output) Time of the newest result (can be nullptr)
+    /// @return number of results returned (oldest first)
+    uint32_t getNewest(uint8_t* pOut, uint32_t outMaxLen, uint32_t numResults, uint64_t* pLastTimeUs = nullptr) const
+    {
+        if (!lock())
+            return 0;
+        if (pLastTimeUs)
+            *pLastTimeUs = _newestTimeUs;
+        if (numResults > _ringBufCount)
+            numResults = _ringBufCount;
+        if ((_resultSize > 0) && (numResults * _resultSize > outMaxLen))
+            numResults = outMaxLen / _resultSize;
+        uint32_t pos = (_ringBufHeadOffset + _ringBufSize - numResults*_resultSize) % (_ringBufSize ? _ringBufSize : 1);
+        for (uint32_t i = 0; i < numResults; i++)
+        {
+            memcpy(pOut + i * _resultSize, ringBufData() + pos, _resultSize);
+            pos += _resultSize;
+            if (pos >= _ringBufSize)
+                pos = 0;
+        }
+        unlock();
+        return numResults;
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Get the number of results stored
     uint32_t count() const
     {
         // Obtain access
-        if (!_accessMutex)
-            return 0;
-        if (xSemaphoreTake(_accessMutex, portMAX_DELAY) != pdTRUE)
+        if (!lock())
             return 0;
 
         uint32_t resultCount = _ringBufCount;
 
         // Release access
-        xSemaphoreGive(_accessMutex);
+        unlock();
         return resultCount;
     }
 
 private:
+    // Ring buffer (on the heap or in an arena region)
     std::vector<uint8_t> _ringBuffer;
+    PollDataArena* _pArena = nullptr;
+    PollDataArena::Region _arenaRegion;
+    uint32_t _ringBufSize = 0;
     uint16_t _ringBufHeadOffset = 0;
     uint16_t _ringBufCount = 0;
     uint16_t _resultSize = 0;
     uint16_t _maxElems = 0;
+
+    // Full buffer policy and record counters
+    bool _blockOldest = false;
+    Stats _stats;
+
+    // Timestamp format and time of the newest result (results are timed back from it on read)
+    PollTimestamp::Format _timestampFormat = PollTimestamp::FORMAT_MS16;
+    bool _hasTimeBase = false;
+    uint64_t _newestTimeUs = 0;
+
+    // Access mutex (only for a buffer on the heap)
     SemaphoreHandle_t _accessMutex = nullptr;
+
+    uint8_t* ringBufData() const
+    {
+        return _pArena ? _pArena->getData() + _arenaRegion.offset : const_cast<uint8_t*>(_ringBuffer.data());
+    }
+    bool lock() const
+    {
+        return !_accessMutex || (xSemaphoreTake(_accessMutex, portMAX_DELAY) == pdTRUE);
+    }
+    void unlock() const
+    {
+        if (_accessMutex)
+            xSemaphoreGive(_accessMutex);
+    }
+    // Time of an unread result (0 is the oldest) worked back from the newest - access must be held - the time is
+    // PollTimestamp::TIME_UNKNOWN before a re-based result (or the time of the oldest known if stopAtRebased)
+    uint64_t unreadTimeUs(uint32_t unreadIdx, bool stopAtRebased = false) const
+    {
+        uint64_t timeUs = _newestTimeUs;
+        if (_ringBufCount == 0)
+            return timeUs;
+        uint32_t tailPos = (_ringBufHeadOffset + _ringBufSize - _ringBufCount*_resultSize) % _ringBufSize;
+        for (uint32_t i = _ringBufCount - 1; i > unreadIdx; i--)
+        {
+            const uint8_t* pPrevResult = ringBufData() + (tailPos + (i - 1) * _resultSize) % _ringBufSize;
+            const uint8_t* pResult = ringBufData() + (tailPos + i * _resultSize) % _ringBufSize;
+            if (PollTimestamp::isRebased(_timestampFormat, pResult))
+                return stopAtRebased ? timeUs : PollTimestamp::TIME_UNKNOWN;
+            timeUs -= PollTimestamp::getDeltaUs(_timestampFormat, pPrevResult, pResult);
+        }
+        return timeUs;
+    }
+    void copyFrom(const PollDataAggregator& other)
+    {
+        if (other._accessMutex && !_accessMutex)
+            _accessMutex = xSemaphoreCreateMutex();
+        _ringBuffer = other._ringBuffer;
+        _pArena = other._pArena;
+        _arenaRegion = other._arenaRegion;
+        _ringBufSize = other._ringBufSize;
+        _ringBufHeadOffset = other._ringBufHeadOffset;
+        _ringBufCount = other._ringBufCount;
+        _resultSize = other._resultSize;
+        _maxElems = other._maxElems;
+        _blockOldest = other._blockOldest;
+        _stats = other._stats;
+        _timestampFormat = other._timestampFormat;
+        _hasTimeBase = other._hasTimeBase;
+        _newestTimeUs = other._newestTimeUs;
+    }
 };
@@ -0,0 +1,169 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll data arena
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <algorithm>
+#include "PollDataArena.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set up the arena (all regions are discarded)
+/// @param capacityBytes size of the arena
+void PollDataArena::setup(uint32_t capacityBytes)
+{
+    _buffer.resize(capacityBytes);
+    _buffer.shrink_to_fit();
+    _holes.clear();
+    _top = 0;
+    _usedBytes = 0;
+    _numRegions = 0;
+    _highWaterBytes = 0;
+    _numCompactions = 0;
+    _numAllocFailures = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Allocate a region
+/// @param len length of region
+/// @param region (out) region allocated
+/// @return true if allocated
+bool PollDataArena::alloc(uint32_t len, Region& region)
+{
+    region = Region();
+    if (len == 0)
+        return false;
+
+    // First hole which fits
+    bool found = false;
+    for (auto it = _holes.begin(); it != _holes.end(); ++it)
+    {
+        if (it->len >= len)
+        {
+            region.offset = it->offset;
+            region.len = len;
+            it->offset += len;
+            it->len -= len;
+            if (it->len == 0)
+                _holes.erase(it);
+            found = true;
+            break;
+        }
+    }
+
+    // Otherwise from the top
+    if (!found)
+    {
+        if (_top + len > _buffer.size())
+        {
+            _numAllocFailures++;
+            return false;
+        }
+        region.offset = _top;
+        region.len = len;
+        _top += len;
+        if (_top > _highWaterBytes)
+            _highWaterBytes = _top;
+    }
+
+    // Stats
+    _usedBytes += len;
+    _numRegions++;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Free a region
+/// @param region region to free (cleared on return)
+void PollDataArena::free(Region& region)
+{
+    if (region.len == 0)
+        return;
+
+    // Insert hole in offset order and merge with neighbours
+    auto it = std::lower_bound(_holes.begin(), _holes.end(), region.offset,
+                [](const Region& hole, uint32_t offset) { return hole.offset < offset; });
+    it = _holes.insert(it, region);
+    auto next = it + 1;
+    if ((next != _holes.end()) && (it->offset + it->len == next->offset))
+    {
+        it->len += next->len;
+        _holes.erase(next);
+    }
+    if (it != _holes.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->len == it->offset)
+        {
+            prev->len += it->len;
+            it = _holes.erase(it) - 1;
+        }
+    }
+
+    // A hole at the top just lowers the top
+    if (it->offset + it->len == _top)
+    {
+        _top = it->offset;
+        _holes.erase(it);
+    }
+
+    // Stats
+    _usedBytes -= region.len;
+    _numRegions--;
+    region = Region();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Compact the arena by moving regions down over the holes
+/// @param regions all regions currently allocated (offsets are updated)
+/// @return true if compacted
+bool PollDataArena::compact(std::vector<Region*>& regions)
+{
+    // Check the regions account for everything allocated (otherwise moving would overwrite one not listed)
+    uint32_t totalLen = 0;
+    for (const Region* pRegion : regions)
+        totalLen += pRegion->len;
+    if ((totalLen != _usedBytes) || (regions.size() != _numRegions))
+        return false;
+
+    // Move regions down in offset order
+    std::sort(regions.begin(), regions.end(),
+                [](const Region* pA, const Region* pB) { return pA->offset < pB->offset; });
+    uint32_t newOffset = 0;
+    for (Region* pRegion : regions)
+    {
+        if (pRegion->offset != newOffset)
+            memmove(_buffer.data() + newOffset, _buffer.data() + pRegion->offset, pRegion->len);
+        pRegion->offset = newOffset;
+        newOffset += pRegion->len;
+    }
+    _holes.clear();
+    _top = newOffset;
+    _numCompactions++;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get usage stats
+/// @param stats (out) stats
+void PollDataArena::getStats(Stats& stats) const
+{
+    stats.capacityBytes = _buffer.size();
+    stats.usedBytes = _usedBytes;
+    stats.highWaterBytes = _highWaterBytes;
+    stats.freeBytes = _buffer.size() - _usedBytes;
+    stats.largestFreeBytes = _buffer.size() - _top;
+    for (const Region& hole : _holes)
+        if (hole.len > stats.largestFreeBytes)
+            stats.largestFreeBytes = hole.len;
+    stats.numRegions = _numRegions;
+    stats.numHoles = _holes.size();
+
+    // Fragmentation is the proportion of free space not in the largest free block
+    stats.fragmentationPct = stats.freeBytes == 0 ? 0 : 100 - (stats.largestFreeBytes * 100) / stats.freeBytes;
+    stats.numCompactions = _numCompactions;
+    stats.numAllocFailures = _numAllocFailures;
+}
@@ -0,0 +1,99 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll data arena
+//
+// A single bus-wide buffer carved into regions for the poll result rings of each device (see
+// PollDataAggregator::initInArena) so devices don't each allocate their own ring on the heap. Freed regions
+// leave holes which are reused first-fit and can be removed by compaction. Access is serialised by the owner
+// (the bus status manager holds its bus element status lock)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class PollDataArena
+{
+public:
+    // Region of the arena
+    struct Region
+    {
+        uint32_t offset = 0;
+        uint32_t len = 0;
+    };
+
+    // Usage stats
+    struct Stats
+    {
+        uint32_t capacityBytes = 0;
+        uint32_t usedBytes = 0;
+        uint32_t highWaterBytes = 0;
+        uint32_t freeBytes = 0;
+        uint32_t largestFreeBytes = 0;
+        uint32_t numRegions = 0;
+        uint32_t numHoles = 0;
+        uint32_t fragmentationPct = 0;
+        uint32_t numCompactions = 0;
+        uint32_t numAllocFailures = 0;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Set up the arena (all regions are discarded)
+    /// @param capacityBytes size of the arena
+    void setup(uint32_t capacityBytes);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Allocate a region
+    /// @param len length of region
+    /// @param region (out) region allocated
+    /// @return true if allocated (false if len is 0 or there is no hole or space at the top big enough)
+    bool alloc(uint32_t len, Region& region);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Free a region
+    /// @param region region to free (cleared on return)
+    void free(Region& region);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if there are holes which compaction would remove
+    bool hasHoles() const
+    {
+        return !_holes.empty();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Compact the arena by moving regions down over the holes
+    /// @param regions all regions currently allocated (offsets are updated)
+    /// @return true if compacted (false if the regions don't account for all allocated bytes)
+    bool compact(std::vector<Region*>& regions);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get data
+    uint8_t* getData()
+    {
+        return _buffer.data();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get usage stats
+    void getStats(Stats& stats) const;
+
+private:
+    // Arena
+    std::vector<uint8_t> _buffer;
+
+    // Regions are allocated from holes (sorted by offset) or from the top of the allocated area
+    std::vector<Region> _holes;
+    uint32_t _top = 0;
+
+    // Stats
+    uint32_t _usedBytes = 0;
+    uint32_t _numRegions = 0;
+    uint32_t _highWaterBytes = 0;
+    uint32_t _numCompactions = 0;
+    uint32_t _numAllocFailures = 0;
+};
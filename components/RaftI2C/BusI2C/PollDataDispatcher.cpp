@@ -0,0 +1,426 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll data dispatcher
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "PollDataDispatcher.h"
+#include "BusI2CClock.h"
+#include "Logger.h"
+
+// #define DEBUG_POLL_DATA_DISPATCHER
+
+static const char* MODULE_PREFIX = "PollDataDispatcher";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor and destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PollDataDispatcher::PollDataDispatcher()
+{
+    _queueMutex = xSemaphoreCreateMutex();
+    _dispatchMutex = xSemaphoreCreateMutex();
+}
+
+PollDataDispatcher::~PollDataDispatcher()
+{
+    close();
+    if (_queueMutex)
+        vSemaphoreDelete(_queueMutex);
+    if (_dispatchMutex)
+        vSemaphoreDelete(_dispatchMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Setup
+/// @param config bus configuration
+void PollDataDispatcher::setup(const RaftJsonIF& config)
+{
+    _taskEnabled = config.getBool("subsTask", true);
+    _taskCore = config.getLong("subsTaskCore", DEFAULT_TASK_CORE);
+    _taskPriority = config.getLong("subsTaskPriority", DEFAULT_TASK_PRIORITY);
+    _taskStackSize = config.getLong("subsTaskStack", DEFAULT_TASK_STACK_SIZE_BYTES);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Stop the dispatch task
+void PollDataDispatcher::close()
+{
+    if (_dispatchTaskHandle == nullptr)
+        return;
+    _taskStopRequested = true;
+    xTaskNotifyGive(_dispatchTaskHandle);
+    for (uint32_t i = 0; (i < WAIT_FOR_TASK_EXIT_MS) && (_dispatchTaskHandle != nullptr); i++)
+        vTaskDelay(pdMS_TO_TICKS(1));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Subscribe
+/// @param options subscription options
+/// @param callback callback for results
+/// @return subscription ID (0 if failed)
+uint32_t PollDataDispatcher::subscribe(const SubscriptionOptions& options, PollDataSubscriberCB callback)
+{
+    if (!callback || (options.queueBytes == 0))
+        return 0;
+
+    // Subscriber (queue memory is allocated up front)
+    Subscriber subscriber;
+    subscriber.options = options;
+    subscriber.options.batchSize = options.batchSize == 0 ? 1 : options.batchSize;
+    subscriber.callback = callback;
+    subscriber.minIntervalUs = options.maxRateHz == 0 ? 0 : 1000000 / options.maxRateHz;
+    subscriber.queued.reserve(options.queueBytes);
+    subscriber.delivering.reserve(options.queueBytes);
+
+    // Add (the dispatch mutex is already held if called from a callback)
+    bool isDispatching = isDispatchingTask();
+    if (!isDispatching && (xSemaphoreTake(_dispatchMutex, portMAX_DELAY) != pdTRUE))
+        return 0;
+    if (xSemaphoreTake(_queueMutex, portMAX_DELAY) != pdTRUE)
+    {
+        if (!isDispatching)
+            xSemaphoreGive(_dispatchMutex);
+        return 0;
+    }
+    subscriber.id = _nextSubscriptionId++;
+    uint32_t subscriptionId = subscriber.id;
+    _subscribers.push_back(std::move(subscriber));
+    _numSubscriptions = _numSubscriptions + 1;
+    xSemaphoreGive(_queueMutex);
+    if (!isDispatching)
+        xSemaphoreGive(_dispatchMutex);
+
+    // Start the task if required
+    startTask();
+
+#ifdef DEBUG_POLL_DATA_DISPATCHER
+    LOG_I(MODULE_PREFIX, "subscribe id %d scope %d addr %04x devTypeIdx %d maxRateHz %d batchSize %d queueBytes %d",
+                subscriptionId, options.scope, options.address, options.deviceTypeIndex,
+                options.maxRateHz, options.batchSize, options.queueBytes);
+#endif
+    return subscriptionId;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Unsubscribe
+/// @param subscriptionId subscription ID
+/// @return true if found
+bool PollDataDispatcher::unsubscribe(uint32_t subscriptionId)
+{
+    // Waits for any callback in progress unless called from a callback (in which case the subscription is
+    // removed when dispatching finishes)
+    bool isDispatching = isDispatchingTask();
+    if (!isDispatching && (xSemaphoreTake(_dispatchMutex, portMAX_DELAY) != pdTRUE))
+        return false;
+    if (xSemaphoreTake(_queueMutex, portMAX_DELAY) != pdTRUE)
+    {
+        if (!isDispatching)
+            xSemaphoreGive(_dispatchMutex);
+        return false;
+    }
+    bool found = false;
+    for (auto it = _subscribers.begin(); it != _subscribers.end(); ++it)
+    {
+        if ((it->id != subscriptionId) || it->isRemoved)
+            continue;
+        if (isDispatching)
+            it->isRemoved = true;
+        else
+            _subscribers.erase(it);
+        _numSubscriptions = _numSubscriptions - 1;
+        found = true;
+        break;
+    }
+    xSemaphoreGive(_queueMutex);
+    if (!isDispatching)
+        xSemaphoreGive(_dispatchMutex);
+    return found;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get stats for a subscription
+/// @param subscriptionId subscription ID
+/// @param stats (out) stats
+/// @return true if found
+bool PollDataDispatcher::getSubscriptionStats(uint32_t subscriptionId, SubscriptionStats& stats) const
+{
+    stats = SubscriptionStats();
+    if (xSemaphoreTake(_queueMutex, pdMS_TO_TICKS(1)) != pdTRUE)
+        return false;
+    bool found = false;
+    for (const Subscriber& subscriber : _subscribers)
+    {
+        if ((subscriber.id == subscriptionId) && !subscriber.isRemoved)
+        {
+            stats = subscriber.stats;
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(_queueMutex);
+    return found;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Queue results which have been stored for a device
+/// @param address composite address of device
+/// @param deviceTypeIndex device type index
+/// @param pResults results oldest first
+/// @param resultSize size of each result
+/// @param numResults number of results
+void PollDataDispatcher::resultsStored(uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults,
+            uint32_t resultSize, uint32_t numResults)
+{
+    if ((_numSubscriptions == 0) || (resultSize == 0) || (resultSize > UINT16_MAX))
+        return;
+
+    // Wait for the queues (the mutex is only held briefly) so results are always queued or counted as dropped
+    if (xSemaphoreTake(_queueMutex, portMAX_DELAY) != pdTRUE)
+        return;
+
+    // Queue for each matching subscriber (each entry is address, device type index and size then the result)
+    bool anyQueued = false;
+    for (Subscriber& subscriber : _subscribers)
+    {
+        if (subscriber.isRemoved || !isMatch(subscriber, address, deviceTypeIndex))
+            continue;
+        for (uint32_t i = 0; i < numResults; i++)
+        {
+            if (subscriber.queued.size() + subscriber.deliveringBytes + QUEUE_ENTRY_HEADER_SIZE + resultSize >
+                        subscriber.options.queueBytes)
+            {
+                subscriber.stats.numDropped += numResults - i;
+                break;
+            }
+            uint8_t header[QUEUE_ENTRY_HEADER_SIZE];
+            memcpy(header, &address, sizeof(uint32_t));
+            memcpy(header + 4, &deviceTypeIndex, sizeof(uint16_t));
+            uint16_t entrySize = resultSize;
+            memcpy(header + 6, &entrySize, sizeof(uint16_t));
+            subscriber.queued.insert(subscriber.queued.end(), header, header + QUEUE_ENTRY_HEADER_SIZE);
+            subscriber.queued.insert(subscriber.queued.end(), pResults + i * resultSize, pResults + (i + 1) * resultSize);
+            subscriber.stats.numQueued++;
+            anyQueued = true;
+        }
+    }
+    xSemaphoreGive(_queueMutex);
+
+    // Wake the dispatch task
+    if (anyQueued && _dispatchTaskHandle)
+        xTaskNotifyGive(_dispatchTaskHandle);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Deliver queued results to subscribers
+/// @param timeNowUs time in us
+/// @return time in us until results held back should be retried (0 if none)
+uint32_t PollDataDispatcher::dispatchService(uint64_t timeNowUs)
+{
+    if (xSemaphoreTake(_dispatchMutex, portMAX_DELAY) != pdTRUE)
+        return 0;
+    _dispatchingTask = xTaskGetCurrentTaskHandle();
+
+    // Deliver to each subscriber
+    uint32_t retryUs = 0;
+    for (Subscriber& subscriber : _subscribers)
+    {
+        if (subscriber.isRemoved)
+            continue;
+        uint32_t subscriberRetryUs = deliver(subscriber, timeNowUs);
+        if ((subscriberRetryUs != 0) && ((retryUs == 0) || (subscriberRetryUs < retryUs)))
+            retryUs = subscriberRetryUs;
+    }
+
+    // Remove subscriptions unsubscribed from callbacks
+    if (xSemaphoreTake(_queueMutex, portMAX_DELAY) == pdTRUE)
+    {
+        _subscribers.remove_if([](const Subscriber& subscriber) { return subscriber.isRemoved; });
+        xSemaphoreGive(_queueMutex);
+    }
+
+    _dispatchingTask = nullptr;
+    xSemaphoreGive(_dispatchMutex);
+    return retryUs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Check if results for a device match a subscription
+bool PollDataDispatcher::isMatch(const Subscriber& subscriber, uint32_t address, uint16_t deviceTypeIndex) const
+{
+    switch (subscriber.options.scope)
+    {
+        case SCOPE_DEVICE: return subscriber.options.address == address;
+        case SCOPE_DEVICE_TYPE: return subscriber.options.deviceTypeIndex == deviceTypeIndex;
+        default: return true;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Deliver queued results to a subscriber
+/// @param subscriber subscriber
+/// @param timeNowUs time in us
+/// @return time in us until results held back should be retried (0 if none)
+uint32_t PollDataDispatcher::deliver(Subscriber& subscriber, uint64_t timeNowUs)
+{
+    // Check the rate limit (or retry time after a callback returned false)
+    uint32_t waitUs = subscriber.isDeferred ? DEFERRED_RETRY_US : subscriber.minIntervalUs;
+    bool hasDelivered = (subscriber.stats.numDelivered != 0) || (subscriber.stats.numDeferred != 0);
+    if (hasDelivered && (timeNowUs - subscriber.lastDeliveryUs < waitUs))
+    {
+        bool anyQueued = !subscriber.delivering.empty();
+        if (!anyQueued && (xSemaphoreTake(_queueMutex, portMAX_DELAY) == pdTRUE))
+        {
+            anyQueued = !subscriber.queued.empty();
+            xSemaphoreGive(_queueMutex);
+        }
+        return anyQueued ? waitUs - (timeNowUs - subscriber.lastDeliveryUs) : 0;
+    }
+
+    // Take queued results (once the previous ones have all been delivered)
+    if (subscriber.delivering.empty())
+    {
+        if (xSemaphoreTake(_queueMutex, portMAX_DELAY) != pdTRUE)
+            return 0;
+        subscriber.queued.swap(subscriber.delivering);
+        subscriber.deliveringBytes = subscriber.delivering.size();
+        xSemaphoreGive(_queueMutex);
+    }
+    if (subscriber.delivering.empty())
+        return 0;
+
+    // Make callbacks for each device in turn with up to batchSize results each
+    uint8_t* pQueue = subscriber.delivering.data();
+    uint32_t queueLen = subscriber.delivering.size();
+    bool isDeferred = false;
+    for (uint32_t pos = 0; (pos < queueLen) && !isDeferred && !subscriber.isRemoved; )
+    {
+        uint32_t address = 0;
+        uint16_t deviceTypeIndex = 0;
+        uint16_t resultSize = 0;
+        memcpy(&address, pQueue + pos, sizeof(uint32_t));
+        memcpy(&deviceTypeIndex, pQueue + pos + 4, sizeof(uint16_t));
+        memcpy(&resultSize, pQueue + pos + 6, sizeof(uint16_t));
+        uint32_t nextPos = pos + QUEUE_ENTRY_HEADER_SIZE + resultSize;
+        if (address == ENTRY_DELIVERED)
+        {
+            pos = nextPos;
+            continue;
+        }
+
+        // Gather results for this device
+        _batchBuf.clear();
+        _batchEntryPositions.clear();
+        for (uint32_t scanPos = pos; scanPos < queueLen; )
+        {
+            uint32_t scanAddress = 0;
+            uint16_t scanResultSize = 0;
+            memcpy(&scanAddress, pQueue + scanPos, sizeof(uint32_t));
+            memcpy(&scanResultSize, pQueue + scanPos + 6, sizeof(uint16_t));
+            if ((scanAddress == address) && (scanResultSize == resultSize))
+            {
+                const uint8_t* pResult = pQueue + scanPos + QUEUE_ENTRY_HEADER_SIZE;
+                _batchBuf.insert(_batchBuf.end(), pResult, pResult + resultSize);
+                _batchEntryPositions.push_back(scanPos);
+            }
+            scanPos += QUEUE_ENTRY_HEADER_SIZE + scanResultSize;
+
+            // Callback when the batch is full or there are no more results
+            bool isLast = scanPos >= queueLen;
+            if (!_batchEntryPositions.empty() && ((_batchEntryPositions.size() >= subscriber.options.batchSize) || isLast))
+            {
+                uint32_t numResults = _batchEntryPositions.size();
+                if (!subscriber.callback(address, deviceTypeIndex, _batchBuf.data(), resultSize, numResults))
+                {
+                    subscriber.stats.numDeferred++;
+                    isDeferred = true;
+                    break;
+                }
+                subscriber.stats.numDelivered += numResults;
+                uint32_t deliveredMarker = ENTRY_DELIVERED;
+                for (uint32_t entryPos : _batchEntryPositions)
+                    memcpy(pQueue + entryPos, &deliveredMarker, sizeof(uint32_t));
+                _batchBuf.clear();
+                _batchEntryPositions.clear();
+            }
+        }
+        pos = nextPos;
+    }
+
+    // Keep results which weren't delivered (in order)
+    uint32_t keepLen = 0;
+    for (uint32_t pos = 0; pos < queueLen; )
+    {
+        uint32_t address = 0;
+        uint16_t resultSize = 0;
+        memcpy(&address, pQueue + pos, sizeof(uint32_t));
+        memcpy(&resultSize, pQueue + pos + 6, sizeof(uint16_t));
+        uint32_t entryLen = QUEUE_ENTRY_HEADER_SIZE + resultSize;
+        if (address != ENTRY_DELIVERED)
+        {
+            if (keepLen != pos)
+                memmove(pQueue + keepLen, pQueue + pos, entryLen);
+            keepLen += entryLen;
+        }
+        pos += entryLen;
+    }
+    subscriber.delivering.resize(keepLen);
+    if (xSemaphoreTake(_queueMutex, portMAX_DELAY) == pdTRUE)
+    {
+        subscriber.deliveringBytes = keepLen;
+        xSemaphoreGive(_queueMutex);
+    }
+    subscriber.lastDeliveryUs = timeNowUs;
+    subscriber.isDeferred = isDeferred;
+
+    // Retry later if results are held back
+    if (isDeferred)
+        return DEFERRED_RETRY_US;
+    return subscriber.minIntervalUs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Start the dispatch task if enabled and not already running
+void PollDataDispatcher::startTask()
+{
+    if (!_taskEnabled || (_dispatchTaskHandle != nullptr))
+        return;
+    _taskStopRequested = false;
+    BaseType_t retc = xTaskCreatePinnedToCore(
+                dispatchTaskStatic,
+                "I2CSubsTask",                          // task name
+                _taskStackSize,                         // stack size of task
+                this,                                   // parameter passed to task on execute
+                _taskPriority,                          // priority
+                (TaskHandle_t*)&_dispatchTaskHandle,    // task handle
+                _taskCore);                             // pin task to core N
+    LOG_I(MODULE_PREFIX, "startTask %s core %d priority %d stackBytes %d",
+                (retc == pdPASS) ? "OK" : "FAILED", _taskCore, _taskPriority, _taskStackSize);
+}
+
+void PollDataDispatcher::dispatchTaskStatic(void* pParam)
+{
+    ((PollDataDispatcher*)pParam)->dispatchTask();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Dispatch task - waits for results to be stored (or for rate limited results to be due)
+void PollDataDispatcher::dispatchTask()
+{
+    uint32_t retryUs = 0;
+    while (true)
+    {
+        TickType_t waitTicks = retryUs == 0 ? portMAX_DELAY : pdMS_TO_TICKS((retryUs + 999) / 1000);
+        ulTaskNotifyTake(pdTRUE, waitTicks == 0 ? 1 : waitTicks);
+        if (_taskStopRequested)
+            break;
+        retryUs = dispatchService(BusI2CClock::nowUs());
+    }
+
+    // Task has exited
+    _dispatchTaskHandle = nullptr;
+    vTaskDelete(NULL);
+}
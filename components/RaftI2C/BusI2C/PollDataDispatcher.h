@@ -0,0 +1,203 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll data dispatcher
+//
+// Pushes poll results to subscribers as they are stored (see BusStatusMgr::pollResultStore) so consumers don't
+// need to poll for them. Each subscription is for one device, a device type or all devices and has its own
+// bounded queue - results which don't fit are dropped for that subscriber only. Callbacks are made on a
+// dispatch task (or from dispatchService() if the task is disabled) at up to a maximum rate with up to a
+// batch size of results for one device in each call. A callback returning false leaves the results queued
+// to be retried later
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <list>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "RaftJson.h"
+
+// Subscriber callback
+// Results are resultSize bytes each (timestamp then poll data) oldest first - return false if the results
+// can't be accepted now (they are offered again later)
+typedef std::function<bool(uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults,
+            uint32_t resultSize, uint32_t numResults)> PollDataSubscriberCB;
+
+class PollDataDispatcher
+{
+public:
+    // Scope of a subscription
+    enum SubscriptionScope
+    {
+        SCOPE_ALL_DEVICES,
+        SCOPE_DEVICE,
+        SCOPE_DEVICE_TYPE
+    };
+
+    // Subscription options
+    struct SubscriptionOptions
+    {
+        SubscriptionScope scope = SCOPE_ALL_DEVICES;
+        // Composite address for SCOPE_DEVICE
+        uint32_t address = 0;
+        // Device type index for SCOPE_DEVICE_TYPE
+        uint16_t deviceTypeIndex = 0;
+        // Maximum deliveries per second (0 for as soon as results are stored)
+        uint32_t maxRateHz = 0;
+        // Maximum results in each callback
+        uint32_t batchSize = 1;
+        // Queue size in bytes (each result takes its size plus QUEUE_ENTRY_HEADER_SIZE) - results being delivered
+        // count towards this until they are delivered
+        uint32_t queueBytes = DEFAULT_QUEUE_BYTES;
+    };
+
+    // Subscription stats
+    struct SubscriptionStats
+    {
+        uint32_t numQueued = 0;
+        uint32_t numDelivered = 0;
+        uint32_t numDropped = 0;
+        uint32_t numDeferred = 0;
+    };
+
+    PollDataDispatcher();
+    ~PollDataDispatcher();
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Setup
+    /// @param config bus configuration (subsTask, subsTaskCore, subsTaskPriority, subsTaskStack)
+    void setup(const RaftJsonIF& config);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Stop the dispatch task (subscriptions are kept)
+    void close();
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Subscribe
+    /// @param options subscription options
+    /// @param callback callback for results
+    /// @return subscription ID (0 if failed)
+    /// @note The dispatch task is started on the first subscription
+    uint32_t subscribe(const SubscriptionOptions& options, PollDataSubscriberCB callback);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Unsubscribe
+    /// @param subscriptionId subscription ID
+    /// @return true if found
+    /// @note When called from outside a callback no further callbacks are made for the subscription once this
+    ///       returns
+    bool unsubscribe(uint32_t subscriptionId);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get stats for a subscription
+    /// @param subscriptionId subscription ID
+    /// @param stats (out) results queued, delivered, dropped (queue full) and deferred (callback returned false)
+    /// @return true if found
+    bool getSubscriptionStats(uint32_t subscriptionId, SubscriptionStats& stats) const;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if there are any subscriptions (cheap check before forming results)
+    bool hasSubscriptions() const
+    {
+        return _numSubscriptions != 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Queue results which have been stored for a device (called on the I2C task)
+    /// @param address composite address of device
+    /// @param deviceTypeIndex device type index
+    /// @param pResults results (timestamp then poll data) oldest first
+    /// @param resultSize size of each result
+    /// @param numResults number of results
+    void resultsStored(uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults,
+                uint32_t resultSize, uint32_t numResults);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Deliver queued results to subscribers (called from the dispatch task or from a service loop if the
+    ///        task is disabled)
+    /// @param timeNowUs time in us
+    /// @return time in us until results held back by rate limits or callbacks should be retried (0 if none)
+    uint32_t dispatchService(uint64_t timeNowUs);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if the dispatch task is enabled
+    bool isTaskEnabled() const
+    {
+        return _taskEnabled;
+    }
+
+    // Sizes
+    static const uint32_t DEFAULT_QUEUE_BYTES = 1024;
+    static const uint32_t QUEUE_ENTRY_HEADER_SIZE = 8;
+
+private:
+    // Subscriber
+    struct Subscriber
+    {
+        uint32_t id = 0;
+        SubscriptionOptions options;
+        PollDataSubscriberCB callback;
+        uint32_t minIntervalUs = 0;
+        uint64_t lastDeliveryUs = 0;
+        bool isDeferred = false;
+        bool isRemoved = false;
+        SubscriptionStats stats;
+
+        // Results queued on the I2C task (protected by _queueMutex) and results being delivered (only used by
+        // the dispatcher) - swapped when all results being delivered have been delivered
+        std::vector<uint8_t> queued;
+        std::vector<uint8_t> delivering;
+
+        // Size of delivering (protected by _queueMutex) so the total is kept within queueBytes
+        uint32_t deliveringBytes = 0;
+    };
+    std::list<Subscriber> _subscribers;
+    volatile uint32_t _numSubscriptions = 0;
+    uint32_t _nextSubscriptionId = 1;
+
+    // Mutex for queues (only ever held briefly as the I2C task waits for it) and mutex held while dispatching
+    // (so unsubscribe can wait for callbacks to finish)
+    SemaphoreHandle_t _queueMutex = nullptr;
+    SemaphoreHandle_t _dispatchMutex = nullptr;
+    volatile TaskHandle_t _dispatchingTask = nullptr;
+
+    // Results for a callback (reused)
+    std::vector<uint8_t> _batchBuf;
+    std::vector<uint32_t> _batchEntryPositions;
+
+    // Dispatch task
+    bool _taskEnabled = true;
+    UBaseType_t _taskCore = DEFAULT_TASK_CORE;
+    BaseType_t _taskPriority = DEFAULT_TASK_PRIORITY;
+    uint32_t _taskStackSize = DEFAULT_TASK_STACK_SIZE_BYTES;
+    volatile TaskHandle_t _dispatchTaskHandle = nullptr;
+    volatile bool _taskStopRequested = false;
+    static const int DEFAULT_TASK_CORE = 0;
+    static const int DEFAULT_TASK_PRIORITY = 3;
+    static const int DEFAULT_TASK_STACK_SIZE_BYTES = 4096;
+    static const uint32_t WAIT_FOR_TASK_EXIT_MS = 100;
+
+    // Time before offering results again after a callback returns false
+    static const uint32_t DEFERRED_RETRY_US = 10000;
+
+    // Marker for a queue entry which has been delivered
+    static const uint32_t ENTRY_DELIVERED = 0xffffffff;
+
+    // Helpers
+    bool isMatch(const Subscriber& subscriber, uint32_t address, uint16_t deviceTypeIndex) const;
+    uint32_t deliver(Subscriber& subscriber, uint64_t timeNowUs);
+    bool isDispatchingTask() const
+    {
+        return _dispatchingTask && (_dispatchingTask == xTaskGetCurrentTaskHandle());
+    }
+    void startTask();
+    static void dispatchTaskStatic(void* pParam);
+    void dispatchTask();
+};
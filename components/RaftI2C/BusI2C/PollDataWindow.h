@@ -0,0 +1,233 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll data window
+//
+// Downsamples poll results by summarising each window of time. At the end of a window the minimum, maximum
+// and mean of each value field are put into the poll data aggregator as three results in the same layout as
+// the poll results (with the timestamp of the first result in the window) in that order. Parts of the result
+// which aren't value fields (e.g. status bits) are taken from the latest result. The three results are stored
+// whole or not at all so the position of a result within its window follows from the aggregator's count of
+// results put (see BusStatusMgr::getWindowIdxOfOldest)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "DevicePollingInfo.h"
+#include "PollDataAggregator.h"
+
+class PollDataWindow
+{
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Initialise
+    /// @param windowUs Window length (0 to disable)
+    /// @param pFields Value fields in the poll result (can be nullptr in which case only the latest result in
+    ///                each window is stored)
+    /// @param numFields Number of value fields
+    /// @param resultSize Size of each poll result (including timestamp)
+    void init(uint32_t windowUs, const BusI2CPollField* pFields, uint32_t numFields, uint32_t resultSize)
+    {
+        _windowUs = resultSize >= DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE ? windowUs : 0;
+        _pFields = pFields;
+        _numFields = pFields ? numFields : 0;
+        _fieldStats.resize(_numFields);
+        _latestResult.resize(resultSize);
+        _summaryResult.resize(resultSize);
+        _numInWindow = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Clear (disables downsampling)
+    void clear()
+    {
+        _windowUs = 0;
+        _numInWindow = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if downsampling is enabled
+    bool isEnabled() const
+    {
+        return _windowUs != 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the number of results stored for each window
+    /// @return 0 if downsampling is disabled, RESULTS_PER_WINDOW (minimum, maximum then mean) or 1 (the latest
+    ///         result in the window) if there are no value fields
+    uint32_t getResultsPerWindow() const
+    {
+        return !isEnabled() ? 0 : _numFields == 0 ? 1 : RESULTS_PER_WINDOW;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Add a poll result (the summary of the current window is stored first if the window has ended)
+    /// @param timeNowUs Time of the result
+    /// @param pollResult Poll result (including timestamp)
+    /// @param aggregator Aggregator to store summaries in
+    /// @return true if a summary was stored
+    bool add(uint64_t timeNowUs, const std::vector<uint8_t>& pollResult, PollDataAggregator& aggregator)
+    {
+        if (pollResult.size() != _latestResult.size())
+            return false;
+
+        // Store the summary if the window has ended
+        bool summaryStored = isWindowEnded(timeNowUs) && flush(aggregator);
+
+        // Accumulate
+        const uint8_t* pData = pollResult.data() + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE;
+        for (uint32_t i = 0; i < _numFields; i++)
+        {
+            int64_t value = getFieldValue(pData, _pFields[i]);
+            FieldStats& stats = _fieldStats[i];
+            if ((_numInWindow == 0) || (value < stats.minVal))
+                stats.minVal = value;
+            if ((_numInWindow == 0) || (value > stats.maxVal))
+                stats.maxVal = value;
+            stats.sum = _numInWindow == 0 ? value : stats.sum + value;
+        }
+        if (_numInWindow == 0)
+        {
+            _windowStartUs = timeNowUs;
+            memcpy(_windowTimestamp, pollResult.data(), DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+        }
+        memcpy(_latestResult.data(), pollResult.data(), pollResult.size());
+        _numInWindow++;
+        return summaryStored;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if the current window has ended (and has results to summarise)
+    /// @param timeNowUs Time now
+    bool isWindowEnded(uint64_t timeNowUs) const
+    {
+        return (_numInWindow > 0) && (timeNowUs - _windowStartUs >= _windowUs);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Store the summary of the current window (if it has any results) and start a new window
+    /// @param aggregator Aggregator to store the summary in
+    /// @return true if a summary was stored
+    bool flush(PollDataAggregator& aggregator)
+    {
+        if (_numInWindow == 0)
+            return false;
+        bool rslt = storeSummary(aggregator);
+        _numInWindow = 0;
+        return rslt;
+    }
+
+    // Number of results stored for each window (minimum, maximum and mean)
+    static const uint32_t RESULTS_PER_WINDOW = 3;
+
+private:
+    // Window
+    uint32_t _windowUs = 0;
+    uint64_t _windowStartUs = 0;
+    uint32_t _numInWindow = 0;
+    uint8_t _windowTimestamp[DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE] = {};
+
+    // Value fields
+    const BusI2CPollField* _pFields = nullptr;
+    uint32_t _numFields = 0;
+
+    // Stats for each field
+    struct FieldStats
+    {
+        int64_t minVal = 0;
+        int64_t maxVal = 0;
+        int64_t sum = 0;
+    };
+    std::vector<FieldStats> _fieldStats;
+
+    // Latest result and summary being formed
+    std::vector<uint8_t> _latestResult;
+    std::vector<uint8_t> _summaryResult;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Store the summary of the window
+    bool storeSummary(PollDataAggregator& aggregator)
+    {
+        // Based on the latest result with the timestamp of the start of the window
+        memcpy(_summaryResult.data(), _latestResult.data(), _latestResult.size());
+        memcpy(_summaryResult.data(), _windowTimestamp, DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+        if (_numFields == 0)
+            return aggregator.put(_summaryResult, _windowStartUs);
+
+        // Minimum, maximum and mean (all or none)
+        if (!aggregator.checkRoomFor(RESULTS_PER_WINDOW))
+            return false;
+        uint8_t* pData = _summaryResult.data() + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE;
+        bool rslt = true;
+        for (uint32_t resultIdx = 0; resultIdx < RESULTS_PER_WINDOW; resultIdx++)
+        {
+            for (uint32_t i = 0; i < _numFields; i++)
+            {
+                const FieldStats& stats = _fieldStats[i];
+                int64_t halfCount = _numInWindow / 2;
+                int64_t mean = stats.sum >= 0 ? (stats.sum + halfCount) / _numInWindow : (stats.sum - halfCount) / _numInWindow;
+                setFieldValue(pData, _pFields[i], resultIdx == 0 ? stats.minVal : resultIdx == 1 ? stats.maxVal : mean);
+            }
+            rslt = aggregator.put(_summaryResult, _windowStartUs) && rslt;
+        }
+        return rslt;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Field access
+    static uint64_t getFieldRaw(const uint8_t* pData, const BusI2CPollField& field)
+    {
+        uint64_t raw = 0;
+        if (field.flags & BusI2CPollField::IS_LITTLE_ENDIAN)
+        {
+            for (uint32_t i = field.numNibbles / 2; i > 0; i--)
+                raw = (raw << 8) | pData[field.nibbleOffset / 2 + i - 1];
+        }
+        else
+        {
+            for (uint32_t i = field.nibbleOffset; i < field.nibbleOffset + field.numNibbles; i++)
+                raw = (raw << 4) | ((i % 2 == 0) ? pData[i / 2] >> 4 : pData[i / 2] & 0x0f);
+        }
+        return raw;
+    }
+    static void setFieldRaw(uint8_t* pData, const BusI2CPollField& field, uint64_t raw)
+    {
+        if (field.flags & BusI2CPollField::IS_LITTLE_ENDIAN)
+        {
+            for (uint32_t i = 0; i < field.numNibbles / 2; i++, raw >>= 8)
+                pData[field.nibbleOffset / 2 + i] = raw & 0xff;
+        }
+        else
+        {
+            for (uint32_t i = field.nibbleOffset + field.numNibbles; i > field.nibbleOffset; i--, raw >>= 4)
+            {
+                uint8_t& dataByte = pData[(i - 1) / 2];
+                dataByte = ((i - 1) % 2 == 0) ? (dataByte & 0x0f) | ((raw & 0x0f) << 4) : (dataByte & 0xf0) | (raw & 0x0f);
+            }
+        }
+    }
+    static uint64_t valueMask(const BusI2CPollField& field)
+    {
+        return field.valueBits >= 64 ? UINT64_MAX : (1ULL << field.valueBits) - 1;
+    }
+    static int64_t getFieldValue(const uint8_t* pData, const BusI2CPollField& field)
+    {
+        uint64_t raw = getFieldRaw(pData, field) & valueMask(field);
+        if ((field.flags & BusI2CPollField::IS_SIGNED) && (field.valueBits > 0) && (field.valueBits < 64) &&
+                    ((raw >> (field.valueBits - 1)) & 1))
+            return (int64_t)raw - (int64_t)(1ULL << field.valueBits);
+        return raw;
+    }
+    static void setFieldValue(uint8_t* pData, const BusI2CPollField& field, int64_t value)
+    {
+        // Bits outside the value (e.g. flags above a sign bit) are kept
+        uint64_t mask = valueMask(field);
+        setFieldRaw(pData, field, (getFieldRaw(pData, field) & ~mask) | ((uint64_t)value & mask));
+    }
+};
@@ -0,0 +1,126 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Poll timestamp
+//
+// Formats of the timestamp at the start of each stored poll result. FORMAT_MS16 is the time in ms (wrapping
+// every 65.5s). FORMAT_US_DELTA16 is the time in us since the previous result stored for the device, coded in
+// 2 bytes as a 14 bit mantissa and a 2 bit exponent (units of 1, 32, 1024 or 32768us) - deltas up to 16ms are
+// exact. Deltas are taken from the coded time of the previous result so rounding doesn't accumulate. The full
+// time of the newest result is kept by the aggregator so the time of every result can be worked out on read.
+// A gap too long to code (over MAX_DELTA_US) is stored as CODE_REBASED - the time is re-based at that result so
+// the times of results before it can't be worked back from the ones after it (they are TIME_UNKNOWN)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+class PollTimestamp
+{
+public:
+    // Timestamp formats
+    enum Format
+    {
+        FORMAT_MS16,
+        FORMAT_US_DELTA16
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get format from a string in pollingConfigJson ("us" for us deltas, otherwise ms)
+    static Format formatFromStr(const char* pStr)
+    {
+        return pStr && (strcmp(pStr, "us") == 0) ? FORMAT_US_DELTA16 : FORMAT_MS16;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Code a delta
+    /// @param deltaUs delta in us
+    /// @param codedDeltaUs (out) delta represented by the code (rounded down, 0 for CODE_REBASED)
+    /// @return code (CODE_REBASED if the delta is over MAX_DELTA_US)
+    static uint16_t encodeDeltaUs(uint64_t deltaUs, uint32_t& codedDeltaUs)
+    {
+        codedDeltaUs = 0;
+        for (uint32_t exponent = 0; exponent < NUM_EXPONENTS; exponent++)
+        {
+            uint64_t mantissa = deltaUs >> (exponent * EXPONENT_SHIFT_BITS);
+            if (mantissa <= MANTISSA_MASK)
+            {
+                uint16_t code = (exponent << MANTISSA_BITS) | mantissa;
+                if (code == CODE_REBASED)
+                    return CODE_REBASED;
+                codedDeltaUs = mantissa << (exponent * EXPONENT_SHIFT_BITS);
+                return code;
+            }
+        }
+        return CODE_REBASED;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the delta represented by a code
+    static uint32_t decodeDeltaUs(uint16_t code)
+    {
+        return (uint32_t)(code & MANTISSA_MASK) << ((code >> MANTISSA_BITS) * EXPONENT_SHIFT_BITS);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Check if the time is re-based at a result (so it can't be worked back across)
+    static bool isRebased(Format format, const uint8_t* pResult)
+    {
+        return (format == FORMAT_US_DELTA16) && ((((uint16_t)pResult[0] << 8) | pResult[1]) == CODE_REBASED);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the time from one result to the next
+    /// @param format timestamp format
+    /// @param pPrevResult previous result (timestamp first, big-endian)
+    /// @param pResult result
+    /// @return time between the results in us (ms timestamps are taken to be less than 65.5s apart)
+    static uint32_t getDeltaUs(Format format, const uint8_t* pPrevResult, const uint8_t* pResult)
+    {
+        uint16_t timestamp = ((uint16_t)pResult[0] << 8) | pResult[1];
+        if (format == FORMAT_US_DELTA16)
+            return decodeDeltaUs(timestamp);
+        uint16_t prevTimestamp = ((uint16_t)pPrevResult[0] << 8) | pPrevResult[1];
+        return (uint16_t)(timestamp - prevTimestamp) * 1000UL;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the time of each result
+    /// @param format timestamp format
+    /// @param pResults results (oldest first)
+    /// @param resultSize size of each result (including timestamp)
+    /// @param numResults number of results
+    /// @param lastTimeUs time of the last result in us
+    /// @param pTimesUs (out) time of each result in us (TIME_UNKNOWN for results before a re-based result)
+    static void getTimesUs(Format format, const uint8_t* pResults, uint32_t resultSize, uint32_t numResults,
+                uint64_t lastTimeUs, uint64_t* pTimesUs)
+    {
+        if ((numResults == 0) || (resultSize < SIZE_BYTES))
+            return;
+        pTimesUs[numResults - 1] = lastTimeUs;
+        for (uint32_t i = numResults - 1; i > 0; i--)
+        {
+            const uint8_t* pResult = pResults + i * resultSize;
+            pTimesUs[i - 1] = (pTimesUs[i] == TIME_UNKNOWN) || isRebased(format, pResult) ? TIME_UNKNOWN :
+                        pTimesUs[i] - getDeltaUs(format, pResult - resultSize, pResult);
+        }
+    }
+
+    // Size of timestamp
+    static const uint32_t SIZE_BYTES = 2;
+
+    // Delta coding
+    static const uint32_t MANTISSA_BITS = 14;
+    static const uint32_t MANTISSA_MASK = (1 << MANTISSA_BITS) - 1;
+    static const uint32_t EXPONENT_SHIFT_BITS = 5;
+    static const uint32_t NUM_EXPONENTS = 4;
+    static const uint16_t CODE_REBASED = 0xffff;
+    static const uint32_t MAX_DELTA_US = (MANTISSA_MASK << ((NUM_EXPONENTS - 1) * EXPONENT_SHIFT_BITS)) - 1;
+
+    // Time of a result which can't be worked out
+    static const uint64_t TIME_UNKNOWN = UINT64_MAX;
+};
@@ -51,7 +51,7 @@ bool ESPIDF5I2CCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL,
     _busFrequency = busFrequency;
     _busFilteringLevel = busFilteringLevel;
 
-    // I2C master config
+    // I2C master config - a non-zero transaction queue depth enables asynchronous transactions
     i2c_master_bus_config_t i2c_mst_config = {
         .i2c_port = i2cPort,
         .sda_io_num = (gpio_num_t)pinSDA,
@@ -59,7 +59,7 @@ bool ESPIDF5I2CCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL,
         .clk_source = I2C_CLK_SRC_DEFAULT,
         .glitch_ignore_cnt = 7,
         .intr_priority = 0,
-        .trans_queue_depth = 0,
+        .trans_queue_depth = TRANS_QUEUE_DEPTH,
         .flags = {
             .enable_internal_pullup = true,
         }
@@ -72,6 +72,16 @@ bool ESPIDF5I2CCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL,
         return false;
     }
 
+    // Transaction done semaphore
+    _transDoneSemaphore = xSemaphoreCreateBinary();
+    if (!_transDoneSemaphore)
+    {
+        LOG_E(MODULE_PREFIX, "Failed to create semaphore");
+        i2c_del_master_bus(_i2cMasterBusHandle);
+        _i2cMasterBusHandle = nullptr;
+        return false;
+    }
+
     // Set initialisation flag
     _isInitialised = true;
 
@@ -84,8 +94,20 @@ void ESPIDF5I2CCentral::deinit()
 {
     if (_isInitialised)
     {
+        // Remove devices
+        for (uint32_t i = 0; i < DEV_HANDLE_TABLE_SIZE; i++)
+        {
+            if (_devHandles[i])
+                i2c_master_bus_rm_device(_devHandles[i]);
+            _devHandles[i] = nullptr;
+        }
+
         // Delete I2C master bus
         i2c_del_master_bus(_i2cMasterBusHandle);
+        _i2cMasterBusHandle = nullptr;
+        vSemaphoreDelete(_transDoneSemaphore);
+        _transDoneSemaphore = nullptr;
+        _isTransAbandoned = false;
         _isInitialised = false;
     }
 }
@@ -113,13 +135,34 @@ bool ESPIDF5I2CCentral::isOperatingOk() const
     return _isInitialised;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Set I2C bus frequency
+// Takes effect from the next access - the IDF sets the SCL speed per device so device handles are re-created
+// at the new frequency when next used
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ESPIDF5I2CCentral::setBusFrequency(uint32_t busFreq)
+{
+    // Check valid
+    if (busFreq == 0)
+        return false;
+
+    // Can't change while the driver may still be using a device handle
+    if (_isInitialised && !checkAbandonedTransDone(0))
+        return false;
+    _busFrequency = busFreq;
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Access the I2C bus
 // Note:
 // - a zero length read and zero length write sends address with R/W flag indicating write to test if a node ACKs
 // - a write of non-zero length alone does what it says and can be of arbitrary length
 // - a read on non-zero length also can be of arbitrary length
-// - a write of non-zero length and read of non-zero length is allowed - write occurs first and can only be of max 14 bytes
+// - a write of non-zero length and read of non-zero length is allowed - write occurs first (then a repeated start)
+// - transactions are started asynchronously and the calling task blocks on a semaphore given by the
+//   transaction done callback (rather than inside the driver)
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 RaftI2CCentralIF::AccessResultCode ESPIDF5I2CCentral::access(uint32_t address, const uint8_t *pWriteBuf, uint32_t numToWrite,
@@ -128,20 +171,33 @@ RaftI2CCentralIF::AccessResultCode ESPIDF5I2CCentral::access(uint32_t address, c
     // Check valid
     if (!_isInitialised)
         return ACCESS_RESULT_INVALID;
+    if (address >= DEV_HANDLE_TABLE_SIZE)
+        return ACCESS_RESULT_INVALID;
     if ((numToWrite > 0) && !pWriteBuf)
         return ACCESS_RESULT_INVALID;
     if ((numToRead > 0) && !pReadBuf)
         return ACCESS_RESULT_INVALID;
 
+    // Timeout derived from the transfer length (the IDF driver and task notifications work in whole ms/ticks)
+    uint32_t timeoutUs = calcTimeoutUs(numToWrite, numToRead);
+    uint32_t timeoutMs = (timeoutUs + 999) / 1000;
+
+    // Don't start another transaction until the driver has finished with an abandoned one
+    if (!checkAbandonedTransDone(timeoutMs))
+        return ACCESS_RESULT_NOT_READY;
+
     // Check for scan (probe) operation
     if ((numToWrite == 0) && (numToRead == 0))
     {
-        esp_err_t err = i2c_master_probe(_i2cMasterBusHandle, address, 2);
+        esp_err_t err = i2c_master_probe(_i2cMasterBusHandle, address, timeoutMs);
         switch (err)
         {
             case ESP_OK:
             {
                 // LOG_I(MODULE_PREFIX, "access probe address 0x%02x OK", address);
+
+                // Create the device handle now so that it is ready for identification and polling
+                getDevHandle(address);
                 return ACCESS_RESULT_OK;
             }
             case ESP_ERR_NOT_FOUND:
@@ -157,71 +213,158 @@ RaftI2CCentralIF::AccessResultCode ESPIDF5I2CCentral::access(uint32_t address, c
         }
     }
 
-    // Check if device is already added to the bus
-    i2c_master_dev_handle_t devHandle = nullptr;
-    for (const auto& devAddrHandle : _deviceAddrHandles)
+    // Get the device handle
+    i2c_master_dev_handle_t devHandle = getDevHandle(address);
+    if (!devHandle)
+        return ACCESS_RESULT_NOT_INIT;
+
+    // LOG_I(MODULE_PREFIX, "access addr 0x%02x numToWrite %d numToRead %d deviceHandle %p", address, numToWrite, numToRead, devHandle);
+
+    // Prepare for the transaction done callback
+    xSemaphoreTake(_transDoneSemaphore, 0);
+    _asyncResultCode = ACCESS_RESULT_PENDING;
+    _isTransWaiting = true;
+
+    // Start the transaction
+    uint64_t startUs = micros();
+    esp_err_t err = ESP_OK;
+    if (numToRead == 0)
+        err = i2c_master_transmit(devHandle, pWriteBuf, numToWrite, timeoutMs);
+    else if (numToWrite == 0)
+        err = i2c_master_receive(devHandle, pReadBuf, numToRead, timeoutMs);
+    else
+        err = i2c_master_transmit_receive(devHandle, pWriteBuf, numToWrite, pReadBuf, numToRead, timeoutMs);
+    if (err != ESP_OK)
     {
-        if (devAddrHandle.address == address)
-        {
-            devHandle = devAddrHandle.handle;
-            break;
-        }
+        _isTransWaiting = false;
+        LOG_W(MODULE_PREFIX, "access FAILED to start addr 0x%02x numToWrite %d numToRead %d err %d", 
+                    address, numToWrite, numToRead, err);
+        return err == ESP_ERR_TIMEOUT ? ACCESS_RESULT_HW_TIME_OUT : ACCESS_RESULT_ACK_ERROR;
     }
 
-    // If not found then add the device
-    if (devHandle == nullptr)
+    // Wait for the transaction done callback - one tick of margin as the first tick can end almost immediately
+    uint32_t timeoutTicks = (timeoutMs + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    bool isDone = xSemaphoreTake(_transDoneSemaphore, timeoutTicks + 1) == pdTRUE;
+    _isTransWaiting = false;
+    if (!isDone)
     {
-        i2c_device_config_t dev_cfg = {
-            .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-            .device_address = (uint16_t)address,
-            .scl_speed_hz = _busFrequency,
-        };
-        if (i2c_master_bus_add_device(_i2cMasterBusHandle, &dev_cfg, &devHandle) != ESP_OK)
-        {
-            LOG_E(MODULE_PREFIX, "access failed to create I2C device handle address 0x%02x", address);
-            return ACCESS_RESULT_NOT_INIT;
-        }
-        LOG_I(MODULE_PREFIX, "access adding device address 0x%02x devHandle %p", address, devHandle);
-        _deviceAddrHandles.push_back({address, devHandle});
+        // Abandon the transaction - the bus is reset and the next access waits for the driver to finish with it
+        i2c_master_bus_reset(_i2cMasterBusHandle);
+        _isTransAbandoned = true;
+        checkAbandonedTransDone(timeoutMs);
+        _i2cStats.recordSoftwareTimeout();
+        _i2cStats.recordTimeoutBusTime((uint32_t)(micros() - startUs));
+        LOG_W(MODULE_PREFIX, "access TIMEOUT addr 0x%02x numToWrite %d numToRead %d timeoutMs %d", 
+                    address, numToWrite, numToRead, timeoutMs);
+        return ACCESS_RESULT_SW_TIME_OUT;
     }
 
-    // LOG_I(MODULE_PREFIX, "access addr 0x%02x numToWrite %d numToRead %d deviceHandle %p", address, numToWrite, numToRead, devHandle);
+    // Check result
+    if (_asyncResultCode == ACCESS_RESULT_OK)
+        numRead = numToRead;
+    else if (_asyncResultCode == ACCESS_RESULT_HW_TIME_OUT)
+        _i2cStats.recordTimeoutBusTime((uint32_t)(micros() - startUs));
+    return _asyncResultCode;
+}
 
-    // Check for write only
-    if (numToWrite > 0 && numToRead == 0)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Check the driver has finished with an abandoned transaction (waiting for it if not)
+/// @param timeoutMs time to wait
+/// @return true if there is no abandoned transaction still in the driver
+bool ESPIDF5I2CCentral::checkAbandonedTransDone(uint32_t timeoutMs)
+{
+    if (!_isTransAbandoned)
+        return true;
+    if (i2c_master_bus_wait_all_done(_i2cMasterBusHandle, timeoutMs) != ESP_OK)
     {
-        // Write
-        if (i2c_master_transmit(devHandle, pWriteBuf, numToWrite, 10) != ESP_OK)
-        {
-            LOG_W(MODULE_PREFIX, "access FAILED to TX data addr 0x%02x numToWrite %d", address, numToWrite);
-            return ACCESS_RESULT_ACK_ERROR;
-        }
-        // LOG_I(MODULE_PREFIX, "access transmit OK addr 0x%02x numToWrite %d", address, numToWrite);
-        return ACCESS_RESULT_OK;
+        LOG_W(MODULE_PREFIX, "checkAbandonedTransDone driver still busy with abandoned transaction");
+        return false;
     }
+    xSemaphoreTake(_transDoneSemaphore, 0);
+    _isTransAbandoned = false;
+    return true;
+}
 
-    // Check for read only
-    if (numToRead > 0 && numToWrite == 0)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the device handle for an address (creating it if required)
+/// @param address I2C address
+/// @return handle or nullptr if it could not be created
+i2c_master_dev_handle_t ESPIDF5I2CCentral::getDevHandle(uint32_t address)
+{
+    // Check for existing handle (at the current frequency)
+    bool isFreqChange = false;
+    if (_devHandles[address])
     {
-        // Write
-        if (i2c_master_receive(devHandle, pReadBuf, numToRead, 10) != ESP_OK)
-        {
-            LOG_W(MODULE_PREFIX, "access failed to FAILED RX data addr 0x%02x numToRead %d", address, numToRead);
-            return ACCESS_RESULT_ACK_ERROR;
-        }
-        numRead = numToRead;
-        return ACCESS_RESULT_OK;
+        if (_devHandleFreqs[address] == _busFrequency)
+            return _devHandles[address];
+        i2c_master_bus_rm_device(_devHandles[address]);
+        _devHandles[address] = nullptr;
+        isFreqChange = true;
     }
 
+    // Add the device
+    i2c_master_dev_handle_t devHandle = nullptr;
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = (uint16_t)address,
+        .scl_speed_hz = _busFrequency,
+    };
+    if (i2c_master_bus_add_device(_i2cMasterBusHandle, &dev_cfg, &devHandle) != ESP_OK)
+    {
+        LOG_E(MODULE_PREFIX, "getDevHandle failed to create I2C device handle address 0x%02x", address);
+        return nullptr;
+    }
+
+    // Register the transaction done callback (which makes transactions on this device asynchronous)
+    i2c_master_event_callbacks_t callbacks = {
+        .on_trans_done = transDoneCBStatic,
+    };
+    if (i2c_master_register_event_callbacks(devHandle, &callbacks, this) != ESP_OK)
+    {
+        LOG_E(MODULE_PREFIX, "getDevHandle failed to register callbacks address 0x%02x", address);
+        i2c_master_bus_rm_device(devHandle);
+        return nullptr;
+    }
+    if (!isFreqChange)
+        LOG_I(MODULE_PREFIX, "getDevHandle adding device address 0x%02x devHandle %p", address, devHandle);
+    _devHandles[address] = devHandle;
+    _devHandleFreqs[address] = _busFrequency;
+    return devHandle;
+}
 
-    // Write and read
-    if (i2c_master_transmit_receive(devHandle, pWriteBuf, numToWrite, pReadBuf, numToRead, 10) != ESP_OK)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Calculate the timeout for an access from the number of bytes on the bus
+/// @param numToWrite number of bytes to write
+/// @param numToRead number of bytes to read
+/// @return timeout in us
+uint32_t ESPIDF5I2CCentral::calcTimeoutUs(uint32_t numToWrite, uint32_t numToRead) const
+{
+    uint32_t totalBytesTxAndRx = (numToRead + 1 + numToWrite + 1);
+    uint32_t minTotalUs = (totalBytesTxAndRx * 10 * 1000) / (_busFrequency / 1000);
+    return minTotalUs + START_RESTART_END_OVERHEAD_US + totalBytesTxAndRx * CLOCK_STRETCH_MAX_PER_BYTE_US;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Transaction done callback (called from the I2C ISR)
+/// @param devHandle device handle
+/// @param pEventData event data
+/// @param pArg ESPIDF5I2CCentral object
+/// @return true if a higher priority task was woken
+bool IRAM_ATTR ESPIDF5I2CCentral::transDoneCBStatic(i2c_master_dev_handle_t devHandle,
+            const i2c_master_event_data_t* pEventData, void* pArg)
+{
+    ESPIDF5I2CCentral* pCentral = (ESPIDF5I2CCentral*)pArg;
+    if (!pCentral || !pEventData || !pCentral->_isTransWaiting)
+        return false;
+    switch (pEventData->event)
     {
-        LOG_W(MODULE_PREFIX, "access FAILED TX/RX data addr 0x%02x numToWrite %d numToRead %d", address, numToWrite, numToRead);
-        return ACCESS_RESULT_ACK_ERROR;
+        case I2C_EVENT_DONE: pCentral->_asyncResultCode = ACCESS_RESULT_OK; break;
+        case I2C_EVENT_NACK: pCentral->_asyncResultCode = ACCESS_RESULT_ACK_ERROR; break;
+        default: pCentral->_asyncResultCode = ACCESS_RESULT_HW_TIME_OUT; break;
     }
-    numRead = numToRead;
-    return ACCESS_RESULT_OK;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    xSemaphoreGiveFromISR(pCentral->_transDoneSemaphore, &higherPriorityTaskWoken);
+    return higherPriorityTaskWoken == pdTRUE;
 }
 
 // /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,8 @@
 #include "RaftUtils.h"
 #include "sdkconfig.h"
 #include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 class ESPIDF5I2CCentral : public RaftI2CCentralIF
 {
@@ -34,6 +36,9 @@ public:
 
     // Check if bus operating ok
     virtual bool isOperatingOk() const override final;
+
+    // Set bus frequency for subsequent accesses
+    virtual bool setBusFrequency(uint32_t busFreq) override final;
      
 private:
     // Settings
@@ -47,16 +52,38 @@ private:
     bool _isInitialised = false;
 
     // I2C master bus handle
-    i2c_master_bus_handle_t _i2cMasterBusHandle;
-
-    // I2C device handles
-    class I2CAddrAndHandle
-    {
-    public:
-        uint32_t address;
-        i2c_master_dev_handle_t handle;
-    };
-
-    // Device handles
-    std::vector<I2CAddrAndHandle> _deviceAddrHandles;
+    i2c_master_bus_handle_t _i2cMasterBusHandle = nullptr;
+
+    // Device handles indexed by address - created when a device first ACKs a probe (or on first access)
+    // The IDF sets the SCL speed per device so each handle's frequency is kept and the handle is re-created
+    // when the bus frequency has changed
+    static const uint32_t DEV_HANDLE_TABLE_SIZE = 128;
+    i2c_master_dev_handle_t _devHandles[DEV_HANDLE_TABLE_SIZE] = {};
+    uint32_t _devHandleFreqs[DEV_HANDLE_TABLE_SIZE] = {};
+
+    // Asynchronous transaction state - the accessing task blocks on a semaphore given by the transaction
+    // done callback (a semaphore rather than a task notification as the bus worker task uses its
+    // notification to signal shutdown)
+    SemaphoreHandle_t _transDoneSemaphore = nullptr;
+    volatile AccessResultCode _asyncResultCode = ACCESS_RESULT_PENDING;
+
+    // Set while an access is waiting for its transaction (completions at other times are from an abandoned
+    // transaction and are ignored) and set when a transaction has been abandoned until the driver confirms it
+    // has finished with it (so its buffers aren't reused and its completion can't be taken for a later one)
+    volatile bool _isTransWaiting = false;
+    bool _isTransAbandoned = false;
+
+    // Depth of the IDF transaction queue (must be non-zero for asynchronous transactions)
+    static const uint32_t TRANS_QUEUE_DEPTH = 2;
+
+    // Timeout allows for clock stretching on every byte
+    static const uint32_t CLOCK_STRETCH_MAX_PER_BYTE_US = 250;
+    static const uint32_t START_RESTART_END_OVERHEAD_US = 500;
+
+    // Helpers
+    i2c_master_dev_handle_t getDevHandle(uint32_t address);
+    uint32_t calcTimeoutUs(uint32_t numToWrite, uint32_t numToRead) const;
+    bool checkAbandonedTransDone(uint32_t timeoutMs);
+    static bool IRAM_ATTR transDoneCBStatic(i2c_master_dev_handle_t devHandle,
+                const i2c_master_event_data_t* pEventData, void* pArg);
 };
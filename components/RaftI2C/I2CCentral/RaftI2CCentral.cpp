@@ -40,6 +40,7 @@ static const char *MODULE_PREFIX = "RaftI2CCentral";
 // #define DEBUG_TIMEOUT_CALCS
 // #define DEBUG_I2C_COMMANDS
 // #define DEBUG_ALL_REGS
+// #define DEBUG_SET_BUS_FREQUENCY
 // #define DEBUG_ISR_USING_GPIO_NUM 1
 // #define DEBUG_BUS_NOT_READY_WITH_GPIO_NUM 18
 
@@ -101,6 +102,14 @@ bool RaftI2CCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uin
     _busFrequency = busFrequency;
     _busFilteringLevel = busFilteringLevel;
 
+    // Timing register values depend on clock source frequencies so recalculate
+    _timingCacheCount = 0;
+    _timingCacheNextIdx = 0;
+
+    // Observed transaction timing is for the devices on this bus
+    for (uint32_t i = 0; i < ADDR_TIMING_NUM_ADDRS; i++)
+        _addrTiming[i] = AddrTiming();
+
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
     // Enable peripheral on ESP32 S3
     periph_module_enable((i2cPort == 0) ? PERIPH_I2C0_MODULE : PERIPH_I2C1_MODULE);
@@ -221,12 +230,150 @@ bool RaftI2CCentral::isOperatingOk() const
 // - a zero length read and zero length write sends address with R/W flag indicating write to test if a node ACKs
 // - a write of non-zero length alone does what it says and can be of arbitrary length
 // - a read on non-zero length also can be of arbitrary length
-// - a write of non-zero length and read of non-zero length is allowed - write occurs first and can only be of max 14 bytes
+// - a write of non-zero length and read of non-zero length is allowed - write occurs first, then a restart and read
+// - all accesses are a single bus transaction (the command queue is refilled by the ISR when required)
+// - this is a thin wrapper which queues the transaction (with no callback) and waits for it to complete
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, const uint8_t *pWriteBuf, uint32_t numToWrite,
                                                           uint8_t *pReadBuf, uint32_t numToRead, uint32_t &numRead)
 {
+    // Transaction
+    Transaction transaction;
+    transaction.address = address;
+    transaction.pWriteBuf = pWriteBuf;
+    transaction.numToWrite = numToWrite;
+    transaction.pReadBuf = pReadBuf;
+    transaction.numToRead = numToRead;
+
+    // Queue without a callback - the completed transaction is copied back when it leaves the queue (waiting
+    // for space in the queue if transactions have been submitted without waiting)
+    Transaction doneTrans;
+    while (!queueTransaction(transaction, nullptr, &doneTrans))
+        waitAny(UINT32_MAX);
+
+    // Wait for completion
+    while ((doneTrans.rslt == ACCESS_RESULT_PENDING) && (getNumQueued() > 0))
+        waitAny(UINT32_MAX);
+    numRead = doneTrans.numRead;
+    return doneTrans.rslt == ACCESS_RESULT_PENDING ? ACCESS_RESULT_NOT_READY : doneTrans.rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Submit a transaction - it is started immediately if the bus is free
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftI2CCentral::submit(const Transaction& transaction, TransCompleteCB completeCB)
+{
+    return queueTransaction(transaction, std::move(completeCB), nullptr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Add a transaction to the queue - on completion completeCB is called and/or the transaction is copied to
+// pAccessTrans (used by access() so no callback has to be made for it)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftI2CCentral::queueTransaction(const Transaction& transaction, TransCompleteCB completeCB, Transaction* pAccessTrans)
+{
+    if (_transQueueCount >= TRANSACTION_QUEUE_DEPTH)
+        return false;
+    QueuedTrans& queuedTrans = _transQueue[(_transQueueHead + _transQueueCount) % TRANSACTION_QUEUE_DEPTH];
+    queuedTrans.trans = transaction;
+    queuedTrans.trans.numRead = 0;
+    queuedTrans.trans.rslt = ACCESS_RESULT_PENDING;
+    queuedTrans.completeCB = std::move(completeCB);
+    queuedTrans.pAccessTrans = pAccessTrans;
+    queuedTrans.isStarted = false;
+    _transQueueCount++;
+    startQueuedTransaction();
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Complete finished transactions - the next transaction is started before the callback is made so the bus
+// runs while the caller handles the result
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::poll()
+{
+    uint32_t numCompleted = 0;
+    while (_transQueueCount > 0)
+    {
+        // Check if the transaction at the head of the queue has completed
+        startQueuedTransaction();
+        QueuedTrans& queuedTrans = _transQueue[_transQueueHead];
+        if ((queuedTrans.trans.rslt == ACCESS_RESULT_PENDING) && !checkTransactionDone(queuedTrans.trans))
+            break;
+
+        // Remove from the queue and start the next
+        Transaction trans = queuedTrans.trans;
+        TransCompleteCB completeCB = std::move(queuedTrans.completeCB);
+        queuedTrans.completeCB = nullptr;
+        if (queuedTrans.pAccessTrans)
+            *queuedTrans.pAccessTrans = trans;
+        queuedTrans.pAccessTrans = nullptr;
+        _transQueueHead = (_transQueueHead + 1) % TRANSACTION_QUEUE_DEPTH;
+        _transQueueCount--;
+        startQueuedTransaction();
+
+        // Callback
+        if (completeCB)
+            completeCB(trans);
+        numCompleted++;
+    }
+    return numCompleted;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wait until at least one transaction completes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::waitAny(uint32_t timeoutUs)
+{
+    uint64_t startUs = micros();
+    while (true)
+    {
+        uint32_t numCompleted = poll();
+        if ((numCompleted > 0) || (_transQueueCount == 0))
+            return numCompleted;
+        if (Raft::isTimeout((uint64_t)micros(), startUs, (uint64_t)timeoutUs))
+            return 0;
+        vTaskDelay(0);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Start the transaction at the head of the queue if it hasn't been started
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftI2CCentral::startQueuedTransaction()
+{
+    if (_transQueueCount == 0)
+        return;
+    QueuedTrans& queuedTrans = _transQueue[_transQueueHead];
+    if (queuedTrans.isStarted)
+        return;
+    queuedTrans.isStarted = true;
+
+    // A transaction which can't be started is complete with the failure code
+    AccessResultCode rslt = startTransaction(queuedTrans.trans);
+    if (rslt != ACCESS_RESULT_PENDING)
+        queuedTrans.trans.rslt = rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Start a transaction on the bus
+// Returns ACCESS_RESULT_PENDING if started or the failure code
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftI2CCentralIF::AccessResultCode RaftI2CCentral::startTransaction(const Transaction& trans)
+{
+    uint32_t address = trans.address;
+    const uint8_t* pWriteBuf = trans.pWriteBuf;
+    uint32_t numToWrite = trans.numToWrite;
+    uint8_t* pReadBuf = trans.pReadBuf;
+    uint32_t numToRead = trans.numToRead;
+
     // Check valid
     if ((numToWrite > 0) && !pWriteBuf)
         return ACCESS_RESULT_INVALID;
@@ -250,75 +397,21 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
     else if (numToWrite > 0)
         i2cOpType = ACCESS_WRITE_ONLY;
 
-    // The ESP32 I2C engine can accommodate up to 14 write/read commands
-    // each of which can request up to 255 bytes of writing/reading
-    // If writing and reading reading is involved then an RSTART command and second address is needed
-    // as well as a final command reading one byte which is NACKed
-    // Check max lengths to write/read (including the RSTART command if needed)
-    // don't result in exceeding these 14 commands
-    uint32_t writeCommands = 0;
-    writeCommands = (numToWrite + 1 + I2C_ENGINE_CMD_MAX_TX_BYTES - 1) / I2C_ENGINE_CMD_MAX_TX_BYTES;
-    uint32_t readCommands = 0;
-    if ((i2cOpType == ACCESS_READ_ONLY) || (i2cOpType == ACCESS_WRITE_RESTART_READ))
-        readCommands = 1 + ((numToRead + I2C_ENGINE_CMD_MAX_RX_BYTES - 2) / I2C_ENGINE_CMD_MAX_RX_BYTES);
-    uint32_t rstartAndSecondAddrCommands = (i2cOpType == ACCESS_READ_ONLY ? 1 : ((i2cOpType == ACCESS_WRITE_RESTART_READ) ? 2 : 0));
-    if (writeCommands + readCommands + rstartAndSecondAddrCommands > (I2C_ENGINE_CMD_QUEUE_SIZE - 2))
-        return ACCESS_RESULT_INVALID;
+    // The I2C engine command queue holds I2C_ENGINE_CMD_QUEUE_SIZE commands each of which can write/read
+    // up to 255 bytes - the address is written first, if writing and reading an RSTART command and second
+    // address is needed and the last byte read is in a command of its own (as it is NACKed)
+    // When more commands are needed than the queue can hold, the queue ends with an END command and the
+    // ISR refills it when the END is reached so the whole access remains a single bus transaction
+    _cmdWriteBytesLeft = numToWrite + 1;
+    _cmdRestartCmdsLeft = (i2cOpType == ACCESS_WRITE_RESTART_READ) ? 2 : 0;
+    _cmdReadBytesLeft = ((i2cOpType == ACCESS_READ_ONLY) || (i2cOpType == ACCESS_WRITE_RESTART_READ)) ? numToRead : 0;
+    _cmdStopRequired = true;
 
     // Prepare I2C engine for access
     prepareI2CAccess();
 
-    // Command index
-    uint32_t cmdIdx = 0;
-
-    // Start condition
-    setI2CCommand(cmdIdx++, ESP32_I2C_CMD_RSTART, 0, false, false, false);
-
-    // Set the address write command(s) - needed in all cases
-    // enable ACK processing and check we received an ACK
-    // an I2C_NACK_INT will be generated if there is a NACK
-    // Add one as the address needs to be written
-    uint32_t writeAmountLeft = numToWrite + 1;
-    for (uint32_t writeCmdIdx = 0; writeCmdIdx < writeCommands; writeCmdIdx++)
-    {
-        uint32_t writeAmount = (writeAmountLeft > I2C_ENGINE_CMD_MAX_TX_BYTES) ? I2C_ENGINE_CMD_MAX_TX_BYTES : writeAmountLeft;
-        setI2CCommand(cmdIdx++, ESP32_I2C_CMD_WRITE, writeAmount, false, false, true);
-        if (writeAmountLeft > 0)
-            writeAmountLeft -= writeAmount;
-#ifdef DEBUG_I2C_COMMANDS
-        LOG_I(MODULE_PREFIX, "access cmdIdx %d writeAmount %d writeAmountLeft %d",
-              cmdIdx - 1, writeAmount, writeAmountLeft);
-#endif
-    }
-
-    // Handle adding a re-start command which is needed only for ACCESS_WRITE_RESTART_READ
-    if (i2cOpType == ACCESS_WRITE_RESTART_READ)
-        setI2CCommand(cmdIdx++, ESP32_I2C_CMD_RSTART, 0, false, false, false);
-
-    // Handle adding an address+READ which is needed in ACCESS_WRITE_RESTART_READ
-    if (i2cOpType == ACCESS_WRITE_RESTART_READ)
-        setI2CCommand(cmdIdx++, ESP32_I2C_CMD_WRITE, 1, false, false, true);
-
-    // Handle adding of read commands
-    uint32_t readAmountLeft = numToRead;
-    for (uint32_t readCmdIdx = 0; readCmdIdx < readCommands; readCmdIdx++)
-    {
-        // Calculate the amount to read in this command - if it is the penultimate command then
-        // reduce the count by 1 to ensure only 1 byte is read in the last command (which is NACKed)
-        uint32_t readAmount = (readAmountLeft > I2C_ENGINE_CMD_MAX_RX_BYTES) ? I2C_ENGINE_CMD_MAX_RX_BYTES : readAmountLeft;
-        if (readCmdIdx == readCommands - 2)
-            readAmount -= 1;
-        // An ACK should be sent after each byte received
-        setI2CCommand(cmdIdx++, ESP32_I2C_CMD_READ, readAmount, readCmdIdx == readCommands - 1, false, false);
-        if (readAmountLeft > 0)
-            readAmountLeft -= readAmount;
-#ifdef DEBUG_I2C_COMMANDS
-        LOG_I(MODULE_PREFIX, "access cmdIdx %d readAmount %d readAmountLeft %d", cmdIdx - 1, readAmount, readAmountLeft);
-#endif
-    }
-
-    // Stop condition
-    setI2CCommand(cmdIdx++, ESP32_I2C_CMD_STOP, 0, false, false, false);
+    // Queue the start condition and as many commands as will fit
+    _cmdsQueued = queueI2CCommands(true);
 
     // Store the read and write buffer pointers and lengths
     _readBufStartPtr = pReadBuf;
@@ -339,8 +432,8 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
     _interruptEnFlags = INTERRUPT_BASE_ENABLES & ~interruptsToDisable;
 
 #ifdef DEBUG_I2C_COMMANDS
-    LOG_I(MODULE_PREFIX, "access numWriteCmds %d cmdIdx %d numReadCmds %d numRStarts+2ndAddr %d restartReqd %d\n",
-          writeCommands, cmdIdx, readCommands, rstartAndSecondAddrCommands, _restartAddrPlusRWRequired);
+    LOG_I(MODULE_PREFIX, "access cmdsQueued %d cmdsLeft %d restartReqd %d\n",
+          _cmdsQueued, numI2CCommandsLeft(), _restartAddrPlusRWRequired);
 #endif
 
     // Debug
@@ -354,13 +447,13 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
     uint32_t minTotalUs = (totalBitsTxAndRx * 1000) / (_busFrequency / 1000);
 
     // Add overhead for starting/restarting/ending transmission and any clock stretching, etc
-    static const uint32_t CLOCK_STRETCH_MAX_PER_BYTE_US = 250;
-    uint32_t I2C_START_RESTART_END_OVERHEAD_US = 500 + totalBytesTxAndRx * CLOCK_STRETCH_MAX_PER_BYTE_US;
-    uint64_t maxExpectedUs = minTotalUs + I2C_START_RESTART_END_OVERHEAD_US;
+    _transTotalBytes = totalBytesTxAndRx;
+    _transMinTotalUs = minTotalUs;
+    _transMaxExpectedUs = calcAccessTimeoutUs(address, totalBytesTxAndRx, minTotalUs);
 
 #ifdef DEBUG_TIMEOUT_CALCS
-    LOG_I(MODULE_PREFIX, "access totalBytesTxAndRx %d totalBitsTxAndRx %d minTotalUs %d overhead %d maxExpectedUs %lld",
-          totalBytesTxAndRx, totalBitsTxAndRx, minTotalUs, I2C_START_RESTART_END_OVERHEAD_US, maxExpectedUs);
+    LOG_I(MODULE_PREFIX, "access addr %02x totalBytesTxAndRx %d totalBitsTxAndRx %d minTotalUs %d maxExpectedUs %d",
+          address, totalBytesTxAndRx, totalBitsTxAndRx, minTotalUs, _transMaxExpectedUs);
 #endif
 
     // Clear interrupts and enable
@@ -386,15 +479,23 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
     I2C_DEVICE.ctr.clk_en = 1;
     I2C_DEVICE.ctr.conf_upgate = 1;
 #endif
+    _transStartUs = micros();
     I2C_DEVICE.ctr.trans_start = 1;
+    return ACCESS_RESULT_PENDING;
+}
 
-    // Wait for a result
-    uint64_t startUs = micros();
-    while ((_accessResultCode == ACCESS_RESULT_PENDING) &&
-           !Raft::isTimeout((uint64_t)micros(), startUs, maxExpectedUs))
-    {
-        vTaskDelay(0);
-    }
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if the transaction on the bus has completed (or timed out) and get the result if so
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftI2CCentral::checkTransactionDone(Transaction& trans)
+{
+    uint32_t address = trans.address;
+
+    // Check for completion or software time-out
+    uint64_t nowUs = micros();
+    if ((_accessResultCode == ACCESS_RESULT_PENDING) && !Raft::isTimeout(nowUs, _transStartUs, (uint64_t)_transMaxExpectedUs))
+        return false;
 
     // Check for software time-out
     if (_accessResultCode == ACCESS_RESULT_PENDING)
@@ -403,17 +504,17 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
         _i2cStats.recordSoftwareTimeout();
     }
 
-    // Check all of the I2C commands to ensure everything was marked done
+    // Check all of the I2C commands (in the last batch queued) to ensure everything was marked done
     if (_accessResultCode == ACCESS_RESULT_OK)
     {
-        for (uint32_t i = 0; i < cmdIdx; i++)
+        for (uint32_t i = 0; i < _cmdsQueued; i++)
         {
             I2C_COMMAND_REG_TYPE *pCmd = (I2C_COMMAND_REG_TYPE*) &(I2C_DEVICE.I2C_COMMAND_0_REGISTER_NAME);
             if (pCmd[i].done == 0)
             {
 #ifdef WARN_RICI2C_ACCESS_INCOMPLETE
                 LOG_I(MODULE_PREFIX, "access incomplete addr %02x writeLen %d readLen %d cmdIdx %d cmd %08lx not done",
-                      address, numToWrite, numToRead, i, pCmd[i]);
+                      address, trans.numToWrite, trans.numToRead, i, pCmd[i]);
 #endif
                 _accessResultCode = ACCESS_RESULT_INCOMPLETE;
                 _i2cStats.recordIncompleteTransaction();
@@ -422,11 +523,15 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
         }
     }
 
+    // Record the time taken (using the time the ISR saw completion as the check may be later) and the bus
+    // time lost if the access timed out
+    uint64_t doneUs = _accessResultCode == ACCESS_RESULT_SW_TIME_OUT ? nowUs : _accessDoneUs;
+    updateAddrTiming(address, _accessResultCode, _transTotalBytes, _transMinTotalUs, (uint32_t)(doneUs - _transStartUs));
+
     // Debug
 #ifdef DEBUG_TIMING
-    uint64_t nowUs = micros();
-    LOG_I(MODULE_PREFIX, "access timing now %lld elapsedUs %lld maxExpectedUs %lld startUs %lld accessResult %s linesHeld %d",
-          nowUs, nowUs - startUs, maxExpectedUs, startUs,
+    LOG_I(MODULE_PREFIX, "access timing now %lld elapsedUs %lld maxExpectedUs %d startUs %lld accessResult %s linesHeld %d",
+          nowUs, doneUs - _transStartUs, _transMaxExpectedUs, _transStartUs,
           getAccessResultStr(_accessResultCode), checkI2CLinesOk());
 #endif
 
@@ -445,7 +550,7 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
 
     // Empty Rx FIFO to extract any read data
     emptyRxFifo();
-    numRead = _readBufPos;
+    trans.numRead = _readBufPos;
 
     // Clear the read and write buffer pointers defensively - in case of spurious ISRs after this point
     _readBufStartPtr = nullptr;
@@ -457,7 +562,95 @@ RaftI2CCentralIF::AccessResultCode RaftI2CCentral::access(uint32_t address, cons
     debugShowStatus("access after: ", address);
 #endif
 
-    return _accessResultCode;
+    trans.rslt = _accessResultCode;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get the software timeout that would be used for an access
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::getAccessTimeoutUs(uint32_t address, uint32_t numToWrite, uint32_t numToRead) const
+{
+    uint32_t totalBytesTxAndRx = (numToRead + 1 + numToWrite + 1);
+    uint32_t minTotalUs = (totalBytesTxAndRx * 10 * 1000) / (_busFrequency / 1000);
+    return calcAccessTimeoutUs(address, totalBytesTxAndRx, minTotalUs);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Calculate the software timeout for an access
+// Until enough transactions to the address have completed the timeout allows for clock stretching on every
+// byte - after that it is the bit time plus a multiple of the peak overhead observed (which is never more
+// than the conservative timeout) so a device which stops responding holds up the bus for less time
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::calcAccessTimeoutUs(uint32_t address, uint32_t totalBytes, uint32_t minTotalUs) const
+{
+    uint32_t conservativeUs = minTotalUs + START_RESTART_END_OVERHEAD_US + totalBytes * CLOCK_STRETCH_MAX_PER_BYTE_US;
+    if (!_adaptiveTimeoutsEnabled || (address >= ADDR_TIMING_NUM_ADDRS))
+        return conservativeUs;
+    const AddrTiming& addrTiming = _addrTiming[address];
+    if ((addrTiming.numSamples < ADAPTIVE_TIMEOUT_MIN_SAMPLES) || (addrTiming.timeoutsInRow >= ADAPTIVE_TIMEOUT_PROBE_AFTER))
+        return conservativeUs;
+    uint32_t overheadUs = (addrTiming.peakOverheadPerByte16 * totalBytes * ADAPTIVE_TIMEOUT_PEAK_MULTIPLIER) / 16;
+    if (overheadUs < ADAPTIVE_TIMEOUT_MIN_OVERHEAD_US)
+        overheadUs = ADAPTIVE_TIMEOUT_MIN_OVERHEAD_US;
+    uint32_t adaptiveUs = minTotalUs + overheadUs;
+    return adaptiveUs < conservativeUs ? adaptiveUs : conservativeUs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Update observed transaction timing for an address
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftI2CCentral::updateAddrTiming(uint32_t address, AccessResultCode rslt, uint32_t totalBytes,
+            uint32_t minTotalUs, uint32_t elapsedUs)
+{
+    // Timeouts hold up the bus for the whole time waited
+    bool isTimeout = (rslt == ACCESS_RESULT_SW_TIME_OUT) || (rslt == ACCESS_RESULT_HW_TIME_OUT);
+    if (isTimeout)
+        _i2cStats.recordTimeoutBusTime(elapsedUs);
+    if (address >= ADDR_TIMING_NUM_ADDRS)
+        return;
+    AddrTiming& addrTiming = _addrTiming[address];
+
+    // Count timeouts in a row (the count restarts after a probe with the conservative timeout)
+    if (isTimeout)
+    {
+        if (addrTiming.timeoutsInRow >= ADAPTIVE_TIMEOUT_PROBE_AFTER)
+            addrTiming.timeoutsInRow = 0;
+        else
+            addrTiming.timeoutsInRow++;
+        return;
+    }
+
+    // Only completed transactions are timed
+    if (rslt != ACCESS_RESULT_OK)
+        return;
+    addrTiming.timeoutsInRow = 0;
+    uint32_t overheadPerByte16 = elapsedUs > minTotalUs ? ((elapsedUs - minTotalUs) * 16) / totalBytes : 0;
+    if (overheadPerByte16 > UINT16_MAX)
+        overheadPerByte16 = UINT16_MAX;
+
+    // First sample sets the average and peak
+    if (addrTiming.numSamples == 0)
+    {
+        addrTiming.avgOverheadPerByte16 = overheadPerByte16;
+        addrTiming.peakOverheadPerByte16 = overheadPerByte16;
+    }
+    else
+    {
+        int32_t avg = addrTiming.avgOverheadPerByte16;
+        avg += ((int32_t)overheadPerByte16 - avg) >> ADAPTIVE_TIMEOUT_AVG_SHIFT;
+        addrTiming.avgOverheadPerByte16 = avg;
+        if (overheadPerByte16 >= addrTiming.peakOverheadPerByte16)
+            addrTiming.peakOverheadPerByte16 = overheadPerByte16;
+        else if (addrTiming.peakOverheadPerByte16 > addrTiming.avgOverheadPerByte16)
+            addrTiming.peakOverheadPerByte16 -= (addrTiming.peakOverheadPerByte16 - addrTiming.avgOverheadPerByte16) >>
+                        ADAPTIVE_TIMEOUT_PEAK_DECAY_SHIFT;
+    }
+    if (addrTiming.numSamples < UINT8_MAX)
+        addrTiming.numSamples++;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -626,15 +819,102 @@ void RaftI2CCentral::reinitI2CModule()
 #endif
 
     // Set bus frequency
-    setBusFrequency(_busFrequency);
+    applyBusFrequency(_busFrequency);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Set I2C bus frequency
+// Takes effect from the next access - used to switch between bus speeds when different bus slots have devices
+// with different maximum speeds
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool RaftI2CCentral::setBusFrequency(uint32_t busFreq)
 {
+    // Check valid
+    if (busFreq == 0)
+        return false;
+
+    // If not initialised the frequency is applied on init
+    if (!_isInitialised)
+    {
+        _busFrequency = busFreq;
+        return true;
+    }
+
+    // Can't change during a transaction (or while transactions are queued)
+    if (I2C_DEVICE.I2C_STATUS_REGISTER_NAME.bus_busy || (_transQueueCount > 0))
+        return false;
+
+    // Check for change
+    if (busFreq == _busFrequency)
+        return true;
+    applyBusFrequency(busFreq);
+    _busFrequency = busFreq;
+
+#ifdef DEBUG_SET_BUS_FREQUENCY
+    LOG_I(MODULE_PREFIX, "setBusFrequency %d", busFreq);
+#endif
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Apply bus frequency to timing registers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftI2CCentral::applyBusFrequency(uint32_t busFreq)
+{
+    const TimingRegVals& regVals = getTimingRegVals(busFreq);
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C3)
+    // Ensure 32bit access
+    typeof(I2C_DEVICE.clk_conf) tmpReg;
+    tmpReg.val = I2C_DEVICE.clk_conf.val;
+    tmpReg.sclk_sel = 0;
+    tmpReg.sclk_div_num = regVals.clkDivNum;
+    I2C_DEVICE.clk_conf.val = tmpReg.val;
+    I2C_DEVICE.I2C_TIMEOUT_REG_NAME.val = regVals.timeout;
+#endif
+
+    // Timing registers
+    I2C_DEVICE.scl_low_period.val = regVals.sclLowPeriod;
+    I2C_DEVICE.scl_high_period.val = regVals.sclHighPeriod;
+    I2C_DEVICE.sda_hold.val = regVals.sdaHold;
+    I2C_DEVICE.sda_sample.val = regVals.sdaSample;
+    I2C_DEVICE.scl_rstart_setup.val = regVals.sclRstartSetup;
+    I2C_DEVICE.scl_stop_setup.val = regVals.sclStopSetup;
+    I2C_DEVICE.scl_start_hold.val = regVals.sclStartHold;
+    I2C_DEVICE.scl_stop_hold.val = regVals.sclStopHold;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get timing register values for a bus frequency (calculated on first use and then cached)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const RaftI2CCentral::TimingRegVals& RaftI2CCentral::getTimingRegVals(uint32_t busFreq)
+{
+    for (uint32_t i = 0; i < _timingCacheCount; i++)
+    {
+        if (_timingCache[i].busFreq == busFreq)
+            return _timingCache[i];
+    }
+
+    // Replace entries in rotation once full
+    uint32_t idx = _timingCacheNextIdx;
+    _timingCacheNextIdx = (_timingCacheNextIdx + 1) % TIMING_CACHE_SIZE;
+    if (_timingCacheCount < TIMING_CACHE_SIZE)
+        _timingCacheCount++;
+    calcTimingRegVals(busFreq, _timingCache[idx]);
+    return _timingCache[idx];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Calculate timing register values for a bus frequency
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftI2CCentral::calcTimingRegVals(uint32_t busFreq, TimingRegVals& regVals)
+{
+    regVals.busFreq = busFreq;
+
 #if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C3)
 
     i2c_hal_clk_config_t clk_cal;
@@ -659,15 +939,11 @@ bool RaftI2CCentral::setBusFrequency(uint32_t busFreq)
     // log(20*half_cycle)/log(2) = log(half_cycle)/log(2) +  log(20)/log(2)
     clk_cal.tout = (int)(sizeof(half_cycle) * 8 - __builtin_clz(5 * half_cycle)) + 2;
 
-    // LOG_I(MODULE_PREFIX, "setBusFrequency %ld, sourceClockFreq %ld, clkm_div %ld, sclk_freq %ld, half_cycle %ld, scl_low %ld, scl_wait_high %ld, scl_high %ld, sda_hold %ld, sda_sample %ld, setup %ld, hold %ld, tout %ld",
+    // LOG_I(MODULE_PREFIX, "calcTimingRegVals %ld, sourceClockFreq %ld, clkm_div %ld, sclk_freq %ld, half_cycle %ld, scl_low %ld, scl_wait_high %ld, scl_high %ld, sda_hold %ld, sda_sample %ld, setup %ld, hold %ld, tout %ld",
     //     busFreq, sourceClockFreq, clkm_div, sclk_freq, half_cycle, clk_cal.scl_low, clk_cal.scl_wait_high, clk_cal.scl_high, clk_cal.sda_hold, clk_cal.sda_sample, clk_cal.setup, clk_cal.hold, clk_cal.tout);
 
-    // Ensure 32bit access
-    typeof(I2C_DEVICE.clk_conf) tmpReg;
-    tmpReg.val = I2C_DEVICE.clk_conf.val;
-    tmpReg.sclk_sel = 0;
-    tmpReg.sclk_div_num = clk_cal.clkm_div - 1;
-    I2C_DEVICE.clk_conf.val = tmpReg.val;
+    // Clock divider
+    regVals.clkDivNum = clk_cal.clkm_div - 1;
 
     /* According to the Technical Reference Manual, the following timings must be subtracted by 1.
      * However, according to the practical measurement and some hardware behaviour, if wait_high_period and scl_high minus one.
@@ -677,22 +953,45 @@ bool RaftI2CCentral::setBusFrequency(uint32_t busFreq)
     typeof(I2C_DEVICE.scl_low_period) scl_low_period_reg;
     scl_low_period_reg.val = 0;
     scl_low_period_reg.I2C_SCL_LOW_PERIOD_PERIOD_NAME = clk_cal.scl_low - 1;
-    I2C_DEVICE.scl_low_period.val = scl_low_period_reg.val;
-    I2C_DEVICE.scl_high_period.I2C_SCL_HIGH_PERIOD_PERIOD_NAME = clk_cal.scl_high;
-    I2C_DEVICE.scl_high_period.scl_wait_high_period = clk_cal.scl_wait_high;
+    regVals.sclLowPeriod = scl_low_period_reg.val;
+    typeof(I2C_DEVICE.scl_high_period) scl_high_period_reg;
+    scl_high_period_reg.val = 0;
+    scl_high_period_reg.I2C_SCL_HIGH_PERIOD_PERIOD_NAME = clk_cal.scl_high;
+    scl_high_period_reg.scl_wait_high_period = clk_cal.scl_wait_high;
+    regVals.sclHighPeriod = scl_high_period_reg.val;
     //sda sample
-    I2C_DEVICE.sda_hold.I2C_SDA_HOLD_TIME_NAME = clk_cal.sda_hold - 1;
-    I2C_DEVICE.sda_sample.I2C_SDA_SAMPLE_TIME_NAME = clk_cal.sda_sample - 1;
+    typeof(I2C_DEVICE.sda_hold) sda_hold_reg;
+    sda_hold_reg.val = 0;
+    sda_hold_reg.I2C_SDA_HOLD_TIME_NAME = clk_cal.sda_hold - 1;
+    regVals.sdaHold = sda_hold_reg.val;
+    typeof(I2C_DEVICE.sda_sample) sda_sample_reg;
+    sda_sample_reg.val = 0;
+    sda_sample_reg.I2C_SDA_SAMPLE_TIME_NAME = clk_cal.sda_sample - 1;
+    regVals.sdaSample = sda_sample_reg.val;
     //setup
-    I2C_DEVICE.scl_rstart_setup.I2C_SCL_RSTART_SETUP_TIME_NAME = clk_cal.setup - 1;
-    I2C_DEVICE.scl_stop_setup.I2C_SCL_STOP_SETUP_TIME_NAME = clk_cal.setup - 1;
+    typeof(I2C_DEVICE.scl_rstart_setup) scl_rstart_setup_reg;
+    scl_rstart_setup_reg.val = 0;
+    scl_rstart_setup_reg.I2C_SCL_RSTART_SETUP_TIME_NAME = clk_cal.setup - 1;
+    regVals.sclRstartSetup = scl_rstart_setup_reg.val;
+    typeof(I2C_DEVICE.scl_stop_setup) scl_stop_setup_reg;
+    scl_stop_setup_reg.val = 0;
+    scl_stop_setup_reg.I2C_SCL_STOP_SETUP_TIME_NAME = clk_cal.setup - 1;
+    regVals.sclStopSetup = scl_stop_setup_reg.val;
     //hold
-    I2C_DEVICE.scl_start_hold.I2C_SCL_START_HOLD_TIME_NAME= clk_cal.hold - 1;
-    I2C_DEVICE.scl_stop_hold.I2C_SCL_STOP_HOLD_TIME_NAME = clk_cal.hold - 1;
-    I2C_DEVICE.I2C_TIMEOUT_REG_NAME.time_out_value = clk_cal.tout;
-    I2C_DEVICE.I2C_TIMEOUT_REG_NAME.time_out_en = 1;
-
-    // LOG_I(MODULE_PREFIX, "scl_low_period_reg_val %ld wrote %ld", I2C_DEVICE.scl_low_period.val, scl_low_period_reg.val);
+    typeof(I2C_DEVICE.scl_start_hold) scl_start_hold_reg;
+    scl_start_hold_reg.val = 0;
+    scl_start_hold_reg.I2C_SCL_START_HOLD_TIME_NAME = clk_cal.hold - 1;
+    regVals.sclStartHold = scl_start_hold_reg.val;
+    typeof(I2C_DEVICE.scl_stop_hold) scl_stop_hold_reg;
+    scl_stop_hold_reg.val = 0;
+    scl_stop_hold_reg.I2C_SCL_STOP_HOLD_TIME_NAME = clk_cal.hold - 1;
+    regVals.sclStopHold = scl_stop_hold_reg.val;
+    //timeout
+    typeof(I2C_DEVICE.I2C_TIMEOUT_REG_NAME) timeout_reg;
+    timeout_reg.val = 0;
+    timeout_reg.time_out_value = clk_cal.tout;
+    timeout_reg.time_out_en = 1;
+    regVals.timeout = timeout_reg.val;
 
 #else
 
@@ -728,27 +1027,49 @@ bool RaftI2CCentral::setBusFrequency(uint32_t busFreq)
     uint32_t quarterPeriod = period / 4;
 
     // Set the low-level and high-level width of SCL
-    I2C_DEVICE.scl_low_period.period = halfPeriod;
-    I2C_DEVICE.scl_high_period.period = halfPeriod;
+    typeof(I2C_DEVICE.scl_low_period) scl_low_period_reg;
+    scl_low_period_reg.val = 0;
+    scl_low_period_reg.period = halfPeriod;
+    regVals.sclLowPeriod = scl_low_period_reg.val;
+    typeof(I2C_DEVICE.scl_high_period) scl_high_period_reg;
+    scl_high_period_reg.val = 0;
+    scl_high_period_reg.period = halfPeriod;
+    regVals.sclHighPeriod = scl_high_period_reg.val;
 
     // Set the start-marker timing between SDA going low and SCL going low
-    I2C_DEVICE.scl_start_hold.time = halfPeriod;
+    typeof(I2C_DEVICE.scl_start_hold) scl_start_hold_reg;
+    scl_start_hold_reg.val = 0;
+    scl_start_hold_reg.time = halfPeriod;
+    regVals.sclStartHold = scl_start_hold_reg.val;
 
     // Set the restart-marker timing between SCL going high and SDA going low
-    I2C_DEVICE.scl_rstart_setup.time = halfPeriod;
+    typeof(I2C_DEVICE.scl_rstart_setup) scl_rstart_setup_reg;
+    scl_rstart_setup_reg.val = 0;
+    scl_rstart_setup_reg.time = halfPeriod;
+    regVals.sclRstartSetup = scl_rstart_setup_reg.val;
 
     // Set timing of stop-marker
-    I2C_DEVICE.scl_stop_hold.time = halfPeriod;
-    I2C_DEVICE.scl_stop_setup.time = halfPeriod;
+    typeof(I2C_DEVICE.scl_stop_hold) scl_stop_hold_reg;
+    scl_stop_hold_reg.val = 0;
+    scl_stop_hold_reg.time = halfPeriod;
+    regVals.sclStopHold = scl_stop_hold_reg.val;
+    typeof(I2C_DEVICE.scl_stop_setup) scl_stop_setup_reg;
+    scl_stop_setup_reg.val = 0;
+    scl_stop_setup_reg.time = halfPeriod;
+    regVals.sclStopSetup = scl_stop_setup_reg.val;
 
     // Set the time period to hold data after SCL goes low and sampling SDA after SCL going high
     // These are actually not used in master mode
-    I2C_DEVICE.sda_hold.time = quarterPeriod;
-    I2C_DEVICE.sda_sample.time = quarterPeriod;
+    typeof(I2C_DEVICE.sda_hold) sda_hold_reg;
+    sda_hold_reg.val = 0;
+    sda_hold_reg.time = quarterPeriod;
+    regVals.sdaHold = sda_hold_reg.val;
+    typeof(I2C_DEVICE.sda_sample) sda_sample_reg;
+    sda_sample_reg.val = 0;
+    sda_sample_reg.time = quarterPeriod;
+    regVals.sdaSample = sda_sample_reg.val;
 
 #endif
-
-    return true;
 }
 
 // Get APB frequency (used for I2C)
@@ -789,6 +1110,92 @@ void RaftI2CCentral::setI2CCommand(uint32_t cmdIdx, uint8_t op_code, uint8_t byt
 #endif    
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue I2C commands for the access (from the start of the command registers)
+// Commands are generated from the write/restart/read/stop counts remaining - if they don't all fit then
+// the queue ends with an END command and this is called again from the ISR when the END is reached
+// Returns the number of commands queued
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::queueI2CCommands(bool isFirst)
+{
+    uint32_t cmdIdx = 0;
+
+    // Start condition
+    if (isFirst)
+        setI2CCommand(cmdIdx++, ESP32_I2C_CMD_RSTART, 0, false, false, false);
+
+    while (cmdIdx < I2C_ENGINE_CMD_QUEUE_SIZE)
+    {
+        // Check if the remaining commands fit - if not then end this batch before the queue is full
+        // (the RSTART and address+READ commands are kept in the same batch)
+        uint32_t cmdsLeft = numI2CCommandsLeft();
+        if (cmdsLeft == 0)
+            break;
+        uint32_t slotsLeft = I2C_ENGINE_CMD_QUEUE_SIZE - cmdIdx;
+        uint32_t nextCmds = (_cmdWriteBytesLeft == 0) && (_cmdRestartCmdsLeft == 2) ? 2 : 1;
+        if ((cmdsLeft > slotsLeft) && (nextCmds > slotsLeft - 1))
+        {
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_END, 0, false, false, false);
+            break;
+        }
+
+        // Address and write data - enable ACK processing and check we received an ACK
+        // an I2C_NACK_INT will be generated if there is a NACK
+        if (_cmdWriteBytesLeft > 0)
+        {
+            uint32_t writeAmount = (_cmdWriteBytesLeft > I2C_ENGINE_CMD_MAX_TX_BYTES) ? I2C_ENGINE_CMD_MAX_TX_BYTES : _cmdWriteBytesLeft;
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_WRITE, writeAmount, false, false, true);
+            _cmdWriteBytesLeft -= writeAmount;
+        }
+
+        // Re-start and address+READ (only for ACCESS_WRITE_RESTART_READ)
+        else if (_cmdRestartCmdsLeft == 2)
+        {
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_RSTART, 0, false, false, false);
+            _cmdRestartCmdsLeft--;
+        }
+        else if (_cmdRestartCmdsLeft == 1)
+        {
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_WRITE, 1, false, false, true);
+            _cmdRestartCmdsLeft--;
+        }
+
+        // Read data - an ACK is sent after each byte received except the last which is NACKed
+        // so the last byte is read in a command of its own
+        else if (_cmdReadBytesLeft > 1)
+        {
+            uint32_t readAmount = (_cmdReadBytesLeft - 1 > I2C_ENGINE_CMD_MAX_RX_BYTES) ? I2C_ENGINE_CMD_MAX_RX_BYTES : _cmdReadBytesLeft - 1;
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_READ, readAmount, false, false, false);
+            _cmdReadBytesLeft -= readAmount;
+        }
+        else if (_cmdReadBytesLeft == 1)
+        {
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_READ, 1, true, false, false);
+            _cmdReadBytesLeft = 0;
+        }
+
+        // Stop condition
+        else
+        {
+            setI2CCommand(cmdIdx++, ESP32_I2C_CMD_STOP, 0, false, false, false);
+            _cmdStopRequired = false;
+        }
+    }
+    return cmdIdx;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Number of I2C commands still to be queued
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftI2CCentral::numI2CCommandsLeft() const
+{
+    uint32_t writeCmds = (_cmdWriteBytesLeft + I2C_ENGINE_CMD_MAX_TX_BYTES - 1) / I2C_ENGINE_CMD_MAX_TX_BYTES;
+    uint32_t readCmds = _cmdReadBytesLeft == 0 ? 0 : 1 + (_cmdReadBytesLeft - 1 + I2C_ENGINE_CMD_MAX_RX_BYTES - 1) / I2C_ENGINE_CMD_MAX_RX_BYTES;
+    return writeCmds + _cmdRestartCmdsLeft + readCmds + (_cmdStopRequired ? 1 : 0);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Initialise interrupts
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -884,15 +1291,15 @@ void RaftI2CCentral::i2cISR()
     AccessResultCode rsltCode = ACCESS_RESULT_PENDING;
     uint32_t interruptsToDisable = 0;
 
+    // Check for NACK - the transaction completes with a STOP which may be reported in the same interrupt
+    if (intStatus & I2C_ACK_ERR_INT_ST)
+        _accessNackDetected = true;
+
     // Check which interrupt has occurred
     if (intStatus & I2C_TIME_OUT_INT_ST)
     {
         rsltCode = ACCESS_RESULT_HW_TIME_OUT;
     }
-    else if (intStatus & I2C_ACK_ERR_INT_ST)
-    {
-        _accessNackDetected = true;
-    }
     else if (intStatus & I2C_ARBITRATION_LOST_INT_ST)
     {
         rsltCode = ACCESS_RESULT_ARB_LOST;
@@ -916,10 +1323,16 @@ void RaftI2CCentral::i2cISR()
 
         // Set flag indicating successful completion
         if (_accessResultCode == ACCESS_RESULT_PENDING)
+        {
+            _accessDoneUs = micros();
             _accessResultCode = rsltCode;
+        }
         return;
     }
 
+    // Check for the END command being reached - the command queue needs to be refilled
+    bool queueMoreCommands = intStatus & I2C_END_DETECT_INT_ST;
+
     // Check for Tx FIFO needing to be refilled
     if (intStatus & I2C_TXFIFO_EMPTY_INT_ST)
     {
@@ -941,6 +1354,16 @@ void RaftI2CCentral::i2cISR()
     // Remove enables on interrupts no longer wanted
     _interruptEnFlags &= ~interruptsToDisable;
 
+    // Refill the command queue and continue the transaction
+    if (queueMoreCommands)
+    {
+        _cmdsQueued = queueI2CCommands(false);
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C3)
+        I2C_DEVICE.ctr.conf_upgate = 1;
+#endif
+        I2C_DEVICE.ctr.trans_start = 1;
+    }
+
     // Restore interrupt enables
     I2C_DEVICE.int_ena.val = _interruptEnFlags;
 }
@@ -1085,6 +1508,14 @@ void RaftI2CCentral::deinit()
             gpio_reset_pin((gpio_num_t)_pinSCL);
     }
     _isInitialised = false;
+
+    // Queued transactions are abandoned
+    for (uint32_t i = 0; i < TRANSACTION_QUEUE_DEPTH; i++)
+    {
+        _transQueue[i].completeCB = nullptr;
+        _transQueue[i].pAccessTrans = nullptr;
+    }
+    _transQueueCount = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
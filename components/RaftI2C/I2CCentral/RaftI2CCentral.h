@@ -39,8 +39,30 @@ public:
     virtual AccessResultCode access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
                     uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead) override final;
 
+    // Non-blocking access
+    virtual bool submit(const Transaction& transaction, TransCompleteCB completeCB) override final;
+    virtual uint32_t poll() override final;
+    virtual uint32_t waitAny(uint32_t timeoutUs) override final;
+    virtual uint32_t getNumQueued() const override final
+    {
+        return _transQueueCount;
+    }
+
     // Check if bus operating ok
     virtual bool isOperatingOk() const override final;
+
+    // Set bus frequency for subsequent accesses
+    virtual bool setBusFrequency(uint32_t busFreq) override final;
+
+    // Get the software timeout that would be used for an access (adapts to transaction times observed
+    // for the address once enough have completed)
+    uint32_t getAccessTimeoutUs(uint32_t address, uint32_t numToWrite, uint32_t numToRead) const;
+
+    // Enable/disable adaptive timeouts (conservative timeouts are used for every access when disabled)
+    void setAdaptiveTimeouts(bool enable)
+    {
+        _adaptiveTimeoutsEnabled = enable;
+    }
      
 private:
     // Settings
@@ -53,6 +75,58 @@ private:
     // Init flag
     bool _isInitialised = false;
 
+    // Timing register values for a bus frequency - cached so that switching frequency between accesses
+    // only requires the registers to be written
+    struct TimingRegVals
+    {
+        uint32_t busFreq = 0;
+        uint32_t clkDivNum = 0;
+        uint32_t sclLowPeriod = 0;
+        uint32_t sclHighPeriod = 0;
+        uint32_t sdaHold = 0;
+        uint32_t sdaSample = 0;
+        uint32_t sclRstartSetup = 0;
+        uint32_t sclStopSetup = 0;
+        uint32_t sclStartHold = 0;
+        uint32_t sclStopHold = 0;
+        uint32_t timeout = 0;
+    };
+    static const uint32_t TIMING_CACHE_SIZE = 4;
+    TimingRegVals _timingCache[TIMING_CACHE_SIZE];
+    uint32_t _timingCacheCount = 0;
+    uint32_t _timingCacheNextIdx = 0;
+
+    // Observed transaction timing for each address - the overhead is the time an access takes beyond the
+    // time to clock its bits (ISR latency, clock stretching, etc) per byte in 1/16ths of a us. The peak
+    // decays towards the average so that a single outlier doesn't set the timeout for ever. The central
+    // doesn't know about bus extender slots so devices at the same address on different slots share timing
+    struct AddrTiming
+    {
+        uint16_t avgOverheadPerByte16 = 0;
+        uint16_t peakOverheadPerByte16 = 0;
+        uint8_t numSamples = 0;
+        uint8_t timeoutsInRow = 0;
+    };
+    static const uint32_t ADDR_TIMING_NUM_ADDRS = 128;
+    AddrTiming _addrTiming[ADDR_TIMING_NUM_ADDRS];
+    bool _adaptiveTimeoutsEnabled = true;
+
+    // Conservative timeout (used until enough transactions have been seen for an address) allows for
+    // clock stretching on every byte
+    static const uint32_t CLOCK_STRETCH_MAX_PER_BYTE_US = 250;
+    static const uint32_t START_RESTART_END_OVERHEAD_US = 500;
+
+    // Adaptive timeout is the bit time plus the peak observed overhead multiplied up (with a minimum)
+    static const uint32_t ADAPTIVE_TIMEOUT_MIN_SAMPLES = 8;
+    static const uint32_t ADAPTIVE_TIMEOUT_PEAK_MULTIPLIER = 2;
+    static const uint32_t ADAPTIVE_TIMEOUT_MIN_OVERHEAD_US = 250;
+    static const uint32_t ADAPTIVE_TIMEOUT_AVG_SHIFT = 3;
+    static const uint32_t ADAPTIVE_TIMEOUT_PEAK_DECAY_SHIFT = 6;
+
+    // After this many adaptive timeouts in a row the next access uses the conservative timeout in case the
+    // device has slowed down (if it succeeds the observed time raises the peak)
+    static const uint32_t ADAPTIVE_TIMEOUT_PROBE_AFTER = 8;
+
     // Address bytes to add to FIFO when required
     uint8_t _startAddrPlusRW = 0;
     bool _startAddrPlusRWRequired = false;
@@ -69,9 +143,37 @@ private:
     volatile const uint8_t* _writeBufStartPtr = nullptr;
     volatile uint32_t _writeBufLen = 0;
 
-    // Access result code
+    // Commands still to be queued - when a transaction needs more commands than the queue holds the
+    // queue ends with an END command and is refilled from the ISR when the END is reached
+    uint32_t _cmdWriteBytesLeft = 0;
+    uint32_t _cmdRestartCmdsLeft = 0;
+    uint32_t _cmdReadBytesLeft = 0;
+    bool _cmdStopRequired = false;
+    volatile uint32_t _cmdsQueued = 0;
+
+    // Access result code and the time the ISR saw completion
     volatile bool _accessNackDetected = false;
     volatile AccessResultCode _accessResultCode = ACCESS_RESULT_PENDING;
+    volatile uint64_t _accessDoneUs = 0;
+
+    // Submitted transactions - the head of the queue is on the bus (once started) and the next is
+    // started as soon as it completes
+    struct QueuedTrans
+    {
+        Transaction trans;
+        TransCompleteCB completeCB;
+        Transaction* pAccessTrans = nullptr;
+        bool isStarted = false;
+    };
+    QueuedTrans _transQueue[TRANSACTION_QUEUE_DEPTH];
+    uint32_t _transQueueHead = 0;
+    uint32_t _transQueueCount = 0;
+
+    // Transaction on the bus
+    uint64_t _transStartUs = 0;
+    uint32_t _transMaxExpectedUs = 0;
+    uint32_t _transTotalBytes = 0;
+    uint32_t _transMinTotalUs = 0;
 
     // Interrupt handle, clear and enable flags
     intr_handle_t _i2cISRHandle = nullptr;
@@ -172,10 +274,10 @@ private:
                     I2C_TRANS_COMPLETE_INT_ENA |
                     I2C_ARBITRATION_LOST_INT_ENA | 
                     I2C_TXFIFO_EMPTY_INT_ENA | 
-                    I2C_RXFIFO_FULL_INT_ENA 
+                    I2C_RXFIFO_FULL_INT_ENA |
+                    I2C_END_DETECT_INT_ENA
 #ifdef DEBUG_RAFT_I2C_CENTRAL_ISR_ALL_SOURCES
-                    | I2C_TRANS_START_INT_ENA 
-                    | I2C_END_DETECT_INT_ENA |
+                    | I2C_TRANS_START_INT_ENA |
                     I2C_MASTER_TRAN_COMP_INT_ENA | 
                     I2C_RXFIFO_OVF_INT_ENA
 #endif
@@ -225,9 +327,13 @@ private:
     bool ensureI2CReady();
     void prepareI2CAccess();
     void reinitI2CModule();
-    bool setBusFrequency(uint32_t busFreq);
+    void applyBusFrequency(uint32_t busFreq);
+    const TimingRegVals& getTimingRegVals(uint32_t busFreq);
+    void calcTimingRegVals(uint32_t busFreq, TimingRegVals& regVals);
     uint32_t getApbFrequency();
-    void setI2CCommand(uint32_t cmdIdx, uint8_t op_code, uint8_t byte_num, bool ack_val, bool ack_exp, bool ack_en);
+    void IRAM_ATTR setI2CCommand(uint32_t cmdIdx, uint8_t op_code, uint8_t byte_num, bool ack_val, bool ack_exp, bool ack_en);
+    uint32_t IRAM_ATTR queueI2CCommands(bool isFirst);
+    uint32_t IRAM_ATTR numI2CCommandsLeft() const;
     bool initInterrupts();
     void initBusFiltering();
     bool checkI2CLinesOk(String& busLinesErrorMsg);
@@ -236,6 +342,13 @@ private:
     uint32_t IRAM_ATTR fillTxFifo();
     uint32_t IRAM_ATTR emptyRxFifo();
     void setDefaultTimeout();
+    void startQueuedTransaction();
+    AccessResultCode startTransaction(const Transaction& trans);
+    bool checkTransactionDone(Transaction& trans);
+    bool queueTransaction(const Transaction& transaction, TransCompleteCB completeCB, Transaction* pAccessTrans);
+    uint32_t calcAccessTimeoutUs(uint32_t address, uint32_t totalBytes, uint32_t minTotalUs) const;
+    void updateAddrTiming(uint32_t address, AccessResultCode rslt, uint32_t totalBytes,
+                uint32_t minTotalUs, uint32_t elapsedUs);
 
     // Debugging
     static String debugMainStatusStr(const char* prefix, uint32_t statusFlags);
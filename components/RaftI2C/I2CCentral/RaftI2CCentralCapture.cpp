@@ -0,0 +1,160 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftI2CCentralCapture
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "RaftI2CCentralCapture.h"
+#include "BusI2CClock.h"
+#include "Logger.h"
+
+// #define DEBUG_I2C_CAPTURE_FULL
+
+#ifdef DEBUG_I2C_CAPTURE_FULL
+static const char* MODULE_PREFIX = "I2CCapture";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftI2CCentralCapture::RaftI2CCentralCapture(RaftI2CCentralIF* pI2CCentral, bool ownsCentral, uint32_t maxCaptureBytes) :
+    _pI2CCentral(pI2CCentral),
+    _ownsCentral(ownsCentral),
+    _maxCaptureBytes(maxCaptureBytes)
+{
+    _captureMutex = xSemaphoreCreateMutex();
+    _captureBuf.reserve(maxCaptureBytes);
+}
+
+RaftI2CCentralCapture::~RaftI2CCentralCapture()
+{
+    if (_ownsCentral)
+        delete _pI2CCentral;
+    if (_captureMutex)
+        vSemaphoreDelete(_captureMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pass-through to the captured central
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftI2CCentralCapture::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+            uint32_t busFilteringLevel)
+{
+    if (!_pI2CCentral)
+        return false;
+    return _pI2CCentral->init(i2cPort, pinSDA, pinSCL, busFrequency, busFilteringLevel);
+}
+
+void RaftI2CCentralCapture::deinit()
+{
+    if (_pI2CCentral)
+        _pI2CCentral->deinit();
+}
+
+bool RaftI2CCentralCapture::isBusy()
+{
+    return _pI2CCentral ? _pI2CCentral->isBusy() : false;
+}
+
+bool RaftI2CCentralCapture::isOperatingOk() const
+{
+    return _pI2CCentral ? _pI2CCentral->isOperatingOk() : false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Set bus frequency for subsequent accesses
+bool RaftI2CCentralCapture::setBusFrequency(uint32_t busFreq)
+{
+    return _pI2CCentral ? _pI2CCentral->setBusFrequency(busFreq) : false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Access the bus and record the access
+RaftI2CCentralIF::AccessResultCode RaftI2CCentralCapture::access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead)
+{
+    numRead = 0;
+    if (!_pI2CCentral)
+        return ACCESS_RESULT_NOT_INIT;
+
+    // Access
+    uint32_t timeUs = (uint32_t)BusI2CClock::nowUs();
+    AccessResultCode rslt = _pI2CCentral->access(address, pWriteBuf, numToWrite, pReadBuf, numToRead, numRead);
+    _i2cStats = _pI2CCentral->getStats();
+    if (!_captureEnabled)
+        return rslt;
+    uint32_t durationUs = (uint32_t)BusI2CClock::nowUs() - timeUs;
+
+    // Record
+    uint16_t writeLen = numToWrite > 0xffff ? 0xffff : numToWrite;
+    uint16_t readLen = numToRead > 0xffff ? 0xffff : numToRead;
+    uint16_t readDataLen = numRead > readLen ? readLen : numRead;
+    uint32_t recLen = CAPTURE_REC_HEADER_BYTES + writeLen + readDataLen;
+    if (xSemaphoreTake(_captureMutex, portMAX_DELAY) != pdTRUE)
+        return rslt;
+    if (CAPTURE_HEADER_BYTES + _captureBuf.size() + recLen > _maxCaptureBytes)
+    {
+#ifdef DEBUG_I2C_CAPTURE_FULL
+        if (_numDropped == 0)
+            LOG_I(MODULE_PREFIX, "access capture full after %d records", _numRecs);
+#endif
+        _numDropped++;
+        xSemaphoreGive(_captureMutex);
+        return rslt;
+    }
+    uint32_t pos = _captureBuf.size();
+    _captureBuf.resize(pos + recLen);
+    uint8_t* pRec = _captureBuf.data() + pos;
+    uint16_t durationUs16 = durationUs > 0xffff ? 0xffff : durationUs;
+    memcpy(pRec, &timeUs, sizeof(timeUs));
+    memcpy(pRec + 4, &durationUs16, sizeof(durationUs16));
+    pRec[6] = address;
+    pRec[7] = rslt;
+    memcpy(pRec + 8, &writeLen, sizeof(writeLen));
+    memcpy(pRec + 10, &readLen, sizeof(readLen));
+    memcpy(pRec + 12, &readDataLen, sizeof(readDataLen));
+    if (writeLen > 0)
+        memcpy(pRec + CAPTURE_REC_HEADER_BYTES, pWriteBuf, writeLen);
+    if (readDataLen > 0)
+        memcpy(pRec + CAPTURE_REC_HEADER_BYTES + writeLen, pReadBuf, readDataLen);
+    _numRecs++;
+    xSemaphoreGive(_captureMutex);
+    return rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get the capture
+/// @param captureData (out) header followed by access records
+/// @param clearAfter true to clear the capture after reading
+/// @return number of access records returned
+uint32_t RaftI2CCentralCapture::getCapture(std::vector<uint8_t>& captureData, bool clearAfter)
+{
+    if (xSemaphoreTake(_captureMutex, portMAX_DELAY) != pdTRUE)
+        return 0;
+    captureData.resize(CAPTURE_HEADER_BYTES + _captureBuf.size());
+    uint8_t* pData = captureData.data();
+    uint32_t magic = CAPTURE_MAGIC;
+    memcpy(pData, &magic, sizeof(magic));
+    pData[4] = CAPTURE_VERSION;
+    pData[5] = 0;
+    pData[6] = 0;
+    pData[7] = 0;
+    memcpy(pData + 8, &_numRecs, sizeof(_numRecs));
+    memcpy(pData + 12, &_numDropped, sizeof(_numDropped));
+    if (_captureBuf.size() > 0)
+        memcpy(pData + CAPTURE_HEADER_BYTES, _captureBuf.data(), _captureBuf.size());
+    uint32_t numRecs = _numRecs;
+    if (clearAfter)
+    {
+        _captureBuf.clear();
+        _numRecs = 0;
+        _numDropped = 0;
+    }
+    xSemaphoreGive(_captureMutex);
+    return numRecs;
+}
@@ -0,0 +1,88 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftI2CCentralCapture
+// Records every access made through another I2C central so that a bus session can be replayed
+//
+// Wrap the real central and pass the capture to BusI2C in place of it - e.g.
+//     RaftI2CCentralCapture* pCapture = new RaftI2CCentralCapture(new RaftI2CCentral(), true);
+//     BusI2C* pBus = new BusI2C(statusCB, opStatusCB, pCapture);
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include "RaftI2CCentralIF.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+class RaftI2CCentralCapture : public RaftI2CCentralIF
+{
+public:
+    /// @brief Constructor
+    /// @param pI2CCentral central to capture accesses from
+    /// @param ownsCentral true if the central should be deleted with this object
+    /// @param maxCaptureBytes maximum size of the capture (accesses are dropped once full)
+    RaftI2CCentralCapture(RaftI2CCentralIF* pI2CCentral, bool ownsCentral,
+                uint32_t maxCaptureBytes = DEFAULT_MAX_CAPTURE_BYTES);
+    virtual ~RaftI2CCentralCapture();
+
+    // Init/de-init
+    virtual bool init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+                uint32_t busFilteringLevel = DEFAULT_BUS_FILTER_LEVEL) override final;
+    virtual void deinit() override final;
+
+    // Busy
+    virtual bool isBusy() override final;
+
+    // Access the bus
+    virtual AccessResultCode access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                    uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead) override final;
+
+    // Check if bus operating ok
+    virtual bool isOperatingOk() const override final;
+
+    // Set bus frequency for subsequent accesses
+    virtual bool setBusFrequency(uint32_t busFreq) override final;
+
+    /// @brief Enable or disable capturing
+    /// @param enable true to capture accesses
+    void enableCapture(bool enable)
+    {
+        _captureEnabled = enable;
+    }
+
+    /// @brief Get the capture
+    /// @param captureData (out) header followed by access records
+    /// @param clearAfter true to clear the capture after reading
+    /// @return number of access records returned
+    /// @note Header is: magic (u32), version (u8), flags (u8), reserved (u16), num records (u32),
+    ///       num dropped (u32). Each record is: start time us (u32), duration us (u16), address (u8),
+    ///       result code (u8), write len (u16), read len requested (u16), num read (u16), write data, read data.
+    ///       All values are little-endian
+    uint32_t getCapture(std::vector<uint8_t>& captureData, bool clearAfter);
+
+    // Capture format
+    static const uint32_t CAPTURE_MAGIC = 0x43324952; // "RI2C" little-endian
+    static const uint32_t CAPTURE_VERSION = 1;
+    static const uint32_t CAPTURE_HEADER_BYTES = 16;
+    static const uint32_t CAPTURE_REC_HEADER_BYTES = 14;
+
+    // Default max capture size
+    static const uint32_t DEFAULT_MAX_CAPTURE_BYTES = 65536;
+
+private:
+    // Central being captured
+    RaftI2CCentralIF* _pI2CCentral = nullptr;
+    bool _ownsCentral = false;
+
+    // Capture
+    bool _captureEnabled = true;
+    std::vector<uint8_t> _captureBuf;
+    uint32_t _maxCaptureBytes = DEFAULT_MAX_CAPTURE_BYTES;
+    uint32_t _numRecs = 0;
+    uint32_t _numDropped = 0;
+    SemaphoreHandle_t _captureMutex = nullptr;
+};
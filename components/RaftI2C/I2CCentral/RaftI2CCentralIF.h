@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <functional>
 #include "RaftArduino.h"
 #include "esp_attr.h"
 
@@ -54,9 +55,79 @@ public:
     virtual AccessResultCode access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
                     uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead) = 0;
 
+    // Transaction for non-blocking access (buffers must remain valid until the transaction completes)
+    struct Transaction
+    {
+        uint32_t address = 0;
+        const uint8_t* pWriteBuf = nullptr;
+        uint32_t numToWrite = 0;
+        uint8_t* pReadBuf = nullptr;
+        uint32_t numToRead = 0;
+        uint32_t numRead = 0;
+        AccessResultCode rslt = ACCESS_RESULT_PENDING;
+    };
+    typedef std::function<void(const Transaction& transaction)> TransCompleteCB;
+
+    // Number of transactions that can be submitted before one completes (so the next transaction
+    // is staged while the current one runs)
+    static const uint32_t TRANSACTION_QUEUE_DEPTH = 2;
+
+    // Submit a transaction - it starts when the bus is free and completeCB is called from poll() or waitAny()
+    // once it has completed. Returns false if the queue is full
+    // The default performs the access immediately (for centrals which don't support non-blocking access)
+    virtual bool submit(const Transaction& transaction, TransCompleteCB completeCB)
+    {
+        if (_doneTransCount >= TRANSACTION_QUEUE_DEPTH)
+            return false;
+        DoneTrans& doneTrans = _doneTrans[(_doneTransHead + _doneTransCount) % TRANSACTION_QUEUE_DEPTH];
+        doneTrans.trans = transaction;
+        doneTrans.trans.numRead = 0;
+        doneTrans.trans.rslt = access(transaction.address, transaction.pWriteBuf, transaction.numToWrite,
+                    transaction.pReadBuf, transaction.numToRead, doneTrans.trans.numRead);
+        doneTrans.completeCB = std::move(completeCB);
+        _doneTransCount++;
+        return true;
+    }
+
+    // Complete finished transactions (calling their callbacks in submission order) and start the next
+    // Returns the number completed
+    virtual uint32_t poll()
+    {
+        uint32_t numCompleted = 0;
+        while (_doneTransCount > 0)
+        {
+            DoneTrans doneTrans = _doneTrans[_doneTransHead];
+            _doneTransHead = (_doneTransHead + 1) % TRANSACTION_QUEUE_DEPTH;
+            _doneTransCount--;
+            if (doneTrans.completeCB)
+                doneTrans.completeCB(doneTrans.trans);
+            numCompleted++;
+        }
+        return numCompleted;
+    }
+
+    // Wait until at least one transaction has completed (or the timeout) - returns the number completed
+    virtual uint32_t waitAny(uint32_t timeoutUs)
+    {
+        return poll();
+    }
+
+    // Number of transactions submitted which have not been completed by poll() or waitAny()
+    virtual uint32_t getNumQueued() const
+    {
+        return _doneTransCount;
+    }
+
     // Check if bus operating ok
     virtual bool isOperatingOk() const = 0;
 
+    // Set bus frequency for subsequent accesses (used to run each bus slot at the speed its devices support)
+    // Returns false if not supported or an access is in progress
+    virtual bool setBusFrequency(uint32_t busFreq)
+    {
+        return false;
+    }
+
     // Debugging
     class I2CStats
     {
@@ -77,6 +148,7 @@ public:
             arbitrationLostCount = 0;
             txFifoEmptyCount = 0;
             incompleteTransaction = 0;
+            timeoutBusTimeUs = 0;
         }
         void IRAM_ATTR update(bool transStart,
             bool ackErr,
@@ -110,13 +182,17 @@ public:
         {
             incompleteTransaction++;
         }
+        void recordTimeoutBusTime(uint32_t us)
+        {
+            timeoutBusTimeUs += us;
+        }
         String debugStr()
         {
-            char outStr[200];
-            snprintf(outStr, sizeof(outStr), "ISRs %lu Starts %lu NAKs %lu EngTimO %lu TransComps %lu ArbLost %lu MastTransComp %lu SwTimO %lu TxFIFOmt %lu incomplete %lu", 
+            char outStr[300];
+            snprintf(outStr, sizeof(outStr), "ISRs %lu Starts %lu NAKs %lu EngTimO %lu TransComps %lu ArbLost %lu MastTransComp %lu SwTimO %lu TxFIFOmt %lu incomplete %lu TimOBusMs %lu", 
                             (unsigned long)isrCount, (unsigned long)startCount, (unsigned long)nackCount, (unsigned long)engineTimeOutCount, (unsigned long)transCompleteCount,
                             (unsigned long)arbitrationLostCount,  (unsigned long)masterTransCompleteCount, (unsigned long)softwareTimeOutCount, 
-                            (unsigned long)txFifoEmptyCount, (unsigned long)incompleteTransaction);
+                            (unsigned long)txFifoEmptyCount, (unsigned long)incompleteTransaction, (unsigned long)(timeoutBusTimeUs / 1000));
             return outStr;
         }
         uint32_t isrCount;
@@ -129,6 +205,8 @@ public:
         uint32_t masterTransCompleteCount;
         uint32_t txFifoEmptyCount;
         uint32_t incompleteTransaction;
+        // Bus time spent waiting for accesses which timed out
+        uint64_t timeoutBusTimeUs;
     };
 
     // Get stats
@@ -166,4 +244,15 @@ protected:
     // I2C stats
     I2CStats _i2cStats;
 
+private:
+    // Transactions performed by the default submit() waiting for poll()
+    struct DoneTrans
+    {
+        Transaction trans;
+        TransCompleteCB completeCB;
+    };
+    DoneTrans _doneTrans[TRANSACTION_QUEUE_DEPTH];
+    uint32_t _doneTransHead = 0;
+    uint32_t _doneTransCount = 0;
+
 };
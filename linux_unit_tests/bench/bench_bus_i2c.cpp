@@ -0,0 +1,806 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus performance benchmark (host)
+//
+// Drives the BusI2C stack against the simulated I2C central using a virtual clock so that bus-time
+// results are deterministic. Results are written as JSON for comparison between commits.
+//
+// The mixed-speed scenarios have slow devices on some slots and fast devices on the rest and compare running
+// the whole bus at the slow speed with running only the slots that have slow devices slowly
+// (mixedSpeedBusTimeGainPct).
+//
+// Publishing poll responses from 50 devices every 100ms is measured as JSON and in the binary format
+// (publish - bytes per second, CPU and heap allocations per publish). The cost of forming each publish is also
+// measured for 10, 50 and 200 devices and for 200 devices with only 10 changing (publishScale).
+//
+// Decoding poll records into values using the generated decoders is measured in records per second for each
+// device type (decode).
+//
+// Usage: raft_i2c_linux_bench [--quick] [-o <file.json>]
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "RaftJson.h"
+#include "BusI2C.h"
+#include "BusI2CClock.h"
+#include "SimI2CCentral.h"
+#include "esp_log.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap allocation counting
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<uint64_t> benchAllocCount(0);
+
+void* operator new(size_t size)
+{
+    benchAllocCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scenario settings
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Device used for polling (identified from DeviceTypeRecords, polled every 200ms)
+static const uint32_t BENCH_POLLED_DEV_ADDR = 0x60;
+static const uint32_t BENCH_POLLED_DEV_POLL_REG = 0x08;
+static const uint32_t BENCH_POLLED_DEV_POLL_INTERVAL_US = 200000;
+static const std::vector<uint8_t> BENCH_POLLED_DEV_ID = {0x86, 0x01};
+
+// Addresses for generic (unidentified) devices - not used by any device type record
+static const uint32_t BENCH_GENERIC_ADDR_FIRST = 0x40;
+static const uint32_t BENCH_GENERIC_ADDR_COUNT = 16;
+
+// Slot limit (slotPlus1 is a 6 bit field so slot 64 is not addressable)
+static const uint32_t BENCH_SLOTS_PLUS1_MAX = 63;
+
+// Timing
+static const uint64_t BENCH_DISCOVERY_LIMIT_US = 60ULL * 1000000;
+static const uint64_t BENCH_HOTPLUG_LIMIT_US = 60ULL * 1000000;
+static const uint64_t BENCH_STEP_US = BusI2C::I2C_BUS_LOOP_YIELD_MS * 1000;
+static const uint64_t BENCH_CMD_INTERVAL_US = 50000;
+
+// Default bus frequency
+static const uint32_t BENCH_DEFAULT_BUS_FREQ = 400000;
+
+// Number of polled devices when publishing poll responses
+static const uint32_t BENCH_PUBLISH_NUM_DEVICES = 50;
+
+struct BenchScenario
+{
+    const char* name;
+    uint32_t numSlots;
+    uint32_t numDevices;
+    // Bus frequency (0 for default)
+    uint32_t busFreq;
+    // Number of slots (the highest numbered) with slow devices, the maximum frequency of those devices
+    // and the frequency configured for their slots (0 to run them at busFreq)
+    uint32_t numSlowSlots;
+    uint32_t slowDevMaxFreq;
+    uint32_t slowSlotFreq;
+};
+
+struct BenchResult
+{
+    bool allOnline = false;
+    uint32_t expectedOnline = 0;
+    uint32_t onlineCount = 0;
+    uint32_t numPolledDevices = 0;
+    double fullSweepScanMs = 0;
+    double hotplugToFirstPollMs = -1;
+    double demandedPollHz = 0;
+    double achievedPollHz = 0;
+    double pollLatePct = 0;
+    double cmdLatencyP50Ms = 0;
+    double cmdLatencyP99Ms = 0;
+    double cmdLatencyMaxMs = 0;
+    uint32_t cmdCount = 0;
+    uint32_t cmdFailCount = 0;
+    double busUtilisationPct = 0;
+    double busUsPerTransaction = 0;
+    uint32_t busFreqChanges = 0;
+    uint32_t speedViolations = 0;
+    double cpuUsPerTransaction = 0;
+    double allocsPerSecond = 0;
+    double allocsPerTransaction = 0;
+    double wallMs = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t benchCpuTimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t benchWallTimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static double benchPercentile(std::vector<double>& vals, double pct)
+{
+    if (vals.size() == 0)
+        return 0;
+    std::sort(vals.begin(), vals.end());
+    uint32_t idx = (uint32_t)((pct / 100.0) * (vals.size() - 1) + 0.5);
+    return vals[idx];
+}
+
+// Per polled device record
+struct BenchPolledDev
+{
+    SimRegDevice* pDevice = nullptr;
+    uint32_t slotPlus1 = 0;
+    uint64_t firstPollUs = 0;
+    uint64_t lastPollUs = 0;
+    uint32_t pollCount = 0;
+    uint32_t lateCount = 0;
+    uint32_t intervalCount = 0;
+};
+
+// Status of bus elements
+static std::vector<uint32_t> benchOnlineAddrs;
+static BusElemStatusCB benchBusElemStatusCB = [](BusBase& bus, const std::vector<BusElemAddrAndStatus>& statusChanges) {
+    for (const auto& stat : statusChanges)
+    {
+        if (stat.isChangeToOnline && (std::find(benchOnlineAddrs.begin(), benchOnlineAddrs.end(), stat.address) == benchOnlineAddrs.end()))
+            benchOnlineAddrs.push_back(stat.address);
+    }
+};
+static BusOperationStatusCB benchBusOperationStatusCB = [](BusBase& bus, BusOperationStatus busOperationStatus) {
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Run a scenario
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static BenchResult benchRunScenario(const BenchScenario& scenario, uint64_t windowUs)
+{
+    BenchResult result;
+    uint64_t wallStartUs = benchWallTimeUs();
+    benchOnlineAddrs.clear();
+
+    // Virtual clock
+    BusI2CVirtualClock virtualClock(1000000);
+    BusI2CClock::setClock(&virtualClock);
+
+    // Bus model
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    uint32_t numExtenders = (scenario.numSlots + 7) / 8;
+    for (uint32_t i = 0; i < numExtenders; i++)
+        pSim->addDevice(new SimPCA9548A(I2C_BUS_EXTENDER_BASE + i));
+    uint32_t usableSlots = std::min(scenario.numSlots, BENCH_SLOTS_PLUS1_MAX);
+
+    // Polled devices - one per slot (or one on the main bus if no slots)
+    std::vector<BenchPolledDev> polledDevs;
+    uint32_t numPolled = std::max(1U, std::min(scenario.numDevices, usableSlots));
+    polledDevs.resize(numPolled);
+    for (uint32_t i = 0; i < numPolled; i++)
+    {
+        BenchPolledDev& polledDev = polledDevs[i];
+        polledDev.slotPlus1 = usableSlots == 0 ? 0 : i + 1;
+        polledDev.pDevice = pSim->addDevice(new SimRegDevice(BENCH_POLLED_DEV_ADDR), polledDev.slotPlus1);
+        polledDev.pDevice->setRegs(0x0c, BENCH_POLLED_DEV_ID);
+        polledDev.pDevice->setReadHook([&polledDev, &virtualClock](uint32_t regAddr, uint8_t& value) {
+            if (regAddr != BENCH_POLLED_DEV_POLL_REG)
+                return;
+            uint64_t nowUs = virtualClock.getMicros();
+            if (polledDev.pollCount == 0)
+                polledDev.firstPollUs = nowUs;
+            else
+            {
+                polledDev.intervalCount++;
+                if (nowUs - polledDev.lastPollUs > BENCH_POLLED_DEV_POLL_INTERVAL_US * 3 / 2)
+                    polledDev.lateCount++;
+            }
+            polledDev.lastPollUs = nowUs;
+            polledDev.pollCount++;
+        });
+    }
+    result.numPolledDevices = numPolled;
+
+    // Device speeds
+    uint32_t busFreq = scenario.busFreq != 0 ? scenario.busFreq : BENCH_DEFAULT_BUS_FREQ;
+    uint32_t firstSlowSlotPlus1 = usableSlots + 1 - std::min(scenario.numSlowSlots, usableSlots);
+    String slotFreqsJson;
+    for (uint32_t slotPlus1 = firstSlowSlotPlus1; slotPlus1 <= usableSlots; slotPlus1++)
+    {
+        if (scenario.slowSlotFreq != 0)
+            slotFreqsJson += String(slotFreqsJson.length() == 0 ? "" : ",") + "{\"slotPlus1\":" + String(slotPlus1) +
+                        ",\"freq\":" + String(scenario.slowSlotFreq) + "}";
+    }
+    for (auto& polledDev : polledDevs)
+    {
+        if ((polledDev.slotPlus1 != 0) && (polledDev.slotPlus1 >= firstSlowSlotPlus1))
+            polledDev.pDevice->setMaxFreq(scenario.slowDevMaxFreq);
+    }
+
+    // Generic devices spread over slots
+    uint32_t numGeneric = scenario.numDevices > numPolled ? scenario.numDevices - numPolled : 0;
+    for (uint32_t i = 0; i < numGeneric; i++)
+    {
+        uint32_t slotPlus1 = usableSlots == 0 ? 0 : (i % usableSlots) + 1;
+        uint32_t addrIdx = usableSlots == 0 ? i : i / usableSlots;
+        pSim->addDevice(new SimRegDevice(BENCH_GENERIC_ADDR_FIRST + (addrIdx % BENCH_GENERIC_ADDR_COUNT)), slotPlus1);
+    }
+
+    // The last polled device is hot-plugged after discovery
+    BenchPolledDev& hotplugDev = polledDevs.back();
+    hotplugDev.pDevice->setPresent(false);
+    uint32_t expectedOnline = numExtenders + numPolled - 1 + numGeneric;
+
+    // Bus
+    BusI2C* pBus = new BusI2C(benchBusElemStatusCB, benchBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":" + String(busFreq) +
+                ",\"workerTask\":false,\"slotFreqs\":[" + slotFreqsJson + "]}";
+    pBus->setup(config);
+    auto stepFn = [&]() {
+        pBus->workerService();
+        pBus->service();
+        virtualClock.advanceUs(BENCH_STEP_US);
+    };
+
+    // Discovery
+    uint64_t startUs = virtualClock.getMicros();
+    while (virtualClock.getMicros() - startUs < BENCH_DISCOVERY_LIMIT_US)
+    {
+        stepFn();
+        if (benchOnlineAddrs.size() >= expectedOnline)
+        {
+            result.allOnline = true;
+            break;
+        }
+    }
+    result.fullSweepScanMs = (virtualClock.getMicros() - startUs) / 1000.0;
+    result.expectedOnline = expectedOnline;
+    result.onlineCount = benchOnlineAddrs.size();
+
+    // Hot-plug
+    uint64_t hotplugUs = virtualClock.getMicros();
+    hotplugDev.pDevice->setPresent(true);
+    while (virtualClock.getMicros() - hotplugUs < BENCH_HOTPLUG_LIMIT_US)
+    {
+        stepFn();
+        if (hotplugDev.pollCount > 0)
+        {
+            result.hotplugToFirstPollMs = (hotplugDev.firstPollUs - hotplugUs) / 1000.0;
+            break;
+        }
+    }
+
+    // Steady state window with command load
+    for (auto& polledDev : polledDevs)
+    {
+        polledDev.lateCount = 0;
+        polledDev.intervalCount = 0;
+    }
+    uint32_t pollCountStart = 0;
+    for (auto& polledDev : polledDevs)
+        pollCountStart += polledDev.pollCount;
+    std::vector<double> cmdLatenciesMs;
+    struct CmdState
+    {
+        BusI2CVirtualClock* pClock;
+        uint64_t sentUs;
+        std::vector<double>* pLatencies;
+        uint32_t failCount;
+    } cmdState = { &virtualClock, 0, &cmdLatenciesMs, 0 };
+    uint32_t cmdAddr = BusI2CAddrAndSlot(BENCH_POLLED_DEV_ADDR, polledDevs[0].slotPlus1).toCompositeAddrAndSlot();
+    uint64_t lastCmdUs = 0;
+    bool cmdInFlight = false;
+    uint64_t busTimeStartUs = pSim->getBusTimeUs();
+    uint32_t accessStart = pSim->getAccessCount();
+    uint32_t freqChangesStart = pBus->getBusFreqChangeCount();
+    uint64_t allocStart = benchAllocCount.load();
+    uint64_t cpuStartUs = benchCpuTimeUs();
+    uint64_t windowStartUs = virtualClock.getMicros();
+    while (virtualClock.getMicros() - windowStartUs < windowUs)
+    {
+        // Issue a command when the previous one has completed
+        uint64_t nowUs = virtualClock.getMicros();
+        if (!cmdInFlight && (nowUs - lastCmdUs >= BENCH_CMD_INTERVAL_US))
+        {
+            HWElemReq hwElemReq = {{0x0c}, 2, 1, "bench", 0};
+            BusRequestInfo busReqInfo("", cmdAddr);
+            busReqInfo.set(BUS_REQ_TYPE_STD, hwElemReq, 0,
+                    [&cmdInFlight](void* pCallbackData, BusRequestResult& reqResult)
+                        {
+                            CmdState* pState = (CmdState*)pCallbackData;
+                            pState->pLatencies->push_back((pState->pClock->getMicros() - pState->sentUs) / 1000.0);
+                            if (!reqResult.isResultOk())
+                                pState->failCount++;
+                            cmdInFlight = false;
+                        },
+                    &cmdState);
+            cmdState.sentUs = nowUs;
+            lastCmdUs = nowUs;
+            if (pBus->addRequest(busReqInfo))
+                cmdInFlight = true;
+            else
+                cmdState.failCount++;
+        }
+        stepFn();
+    }
+    uint64_t cpuUs = benchCpuTimeUs() - cpuStartUs;
+    uint64_t allocs = benchAllocCount.load() - allocStart;
+    uint32_t accesses = pSim->getAccessCount() - accessStart;
+    double windowSecs = windowUs / 1000000.0;
+
+    // Polling results
+    uint32_t pollCount = 0;
+    uint32_t lateCount = 0;
+    uint32_t intervalCount = 0;
+    for (auto& polledDev : polledDevs)
+    {
+        pollCount += polledDev.pollCount;
+        lateCount += polledDev.lateCount;
+        intervalCount += polledDev.intervalCount;
+    }
+    result.demandedPollHz = numPolled * 1000000.0 / BENCH_POLLED_DEV_POLL_INTERVAL_US;
+    result.achievedPollHz = (pollCount - pollCountStart) / windowSecs;
+    result.pollLatePct = intervalCount > 0 ? 100.0 * lateCount / intervalCount : 0;
+
+    // Command latency
+    result.cmdCount = cmdLatenciesMs.size();
+    result.cmdFailCount = cmdState.failCount;
+    result.cmdLatencyMaxMs = cmdLatenciesMs.size() > 0 ? *std::max_element(cmdLatenciesMs.begin(), cmdLatenciesMs.end()) : 0;
+    result.cmdLatencyP50Ms = benchPercentile(cmdLatenciesMs, 50);
+    result.cmdLatencyP99Ms = benchPercentile(cmdLatenciesMs, 99);
+
+    // Resources
+    result.busUtilisationPct = 100.0 * (pSim->getBusTimeUs() - busTimeStartUs) / windowUs;
+    result.busUsPerTransaction = accesses > 0 ? (double)(pSim->getBusTimeUs() - busTimeStartUs) / accesses : 0;
+    result.busFreqChanges = pBus->getBusFreqChangeCount() - freqChangesStart;
+    result.speedViolations = pSim->getSpeedViolationCount();
+    result.cpuUsPerTransaction = accesses > 0 ? (double)cpuUs / accesses : 0;
+    result.allocsPerSecond = allocs / windowSecs;
+    result.allocsPerTransaction = accesses > 0 ? (double)allocs / accesses : 0;
+
+    // Clean up
+    delete pBus;
+    delete pSim;
+    BusI2CClock::setClock(nullptr);
+    result.wallMs = (benchWallTimeUs() - wallStartUs) / 1000.0;
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Publishing poll responses as JSON and binary
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchPublishResult
+{
+    uint32_t numDevices = 0;
+    double jsonBytesPerSec = 0;
+    double jsonCpuUsPerPublish = 0;
+    double jsonAllocsPerPublish = 0;
+    double binBytesPerSec = 0;
+    double binCpuUsPerPublish = 0;
+    double binAllocsPerPublish = 0;
+};
+
+static BenchPublishResult benchPollPublish(uint32_t numDevices, uint64_t windowUs)
+{
+    static const uint64_t PUBLISH_INTERVAL_US = 100000;
+    BenchPublishResult result;
+    result.numDevices = numDevices;
+    benchOnlineAddrs.clear();
+
+    // Polled devices one per slot
+    BusI2CVirtualClock virtualClock(1000000);
+    BusI2CClock::setClock(&virtualClock);
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    uint32_t numExtenders = (numDevices + 7) / 8;
+    for (uint32_t i = 0; i < numExtenders; i++)
+        pSim->addDevice(new SimPCA9548A(I2C_BUS_EXTENDER_BASE + i));
+    for (uint32_t i = 0; i < numDevices; i++)
+        pSim->addDevice(new SimRegDevice(BENCH_POLLED_DEV_ADDR), i + 1)->setRegs(0x0c, BENCH_POLLED_DEV_ID);
+    BusI2C* pBus = new BusI2C(benchBusElemStatusCB, benchBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":" + String(BENCH_DEFAULT_BUS_FREQ) +
+                ",\"workerTask\":false}";
+    pBus->setup(config);
+    auto stepFn = [&]() {
+        pBus->workerService();
+        pBus->service();
+        virtualClock.advanceUs(BENCH_STEP_US);
+    };
+
+    // Discovery
+    uint64_t startUs = virtualClock.getMicros();
+    while ((benchOnlineAddrs.size() < numExtenders + numDevices) && (virtualClock.getMicros() - startUs < BENCH_DISCOVERY_LIMIT_US))
+        stepFn();
+    for (uint32_t i = 0; i < 20; i++)
+        stepFn();
+    pBus->getBusPollResponsesJson();
+
+    // Publish in each format for a window
+    std::vector<uint8_t> binBuf(8192);
+    for (uint32_t useBinary = 0; useBinary < 2; useBinary++)
+    {
+        uint64_t totalBytes = 0;
+        uint64_t publishCpuUs = 0;
+        uint64_t publishAllocs = 0;
+        uint32_t numPublishes = 0;
+        uint64_t windowStartUs = virtualClock.getMicros();
+        uint64_t lastPublishUs = windowStartUs;
+        while (virtualClock.getMicros() - windowStartUs < windowUs)
+        {
+            stepFn();
+            if (virtualClock.getMicros() - lastPublishUs < PUBLISH_INTERVAL_US)
+                continue;
+            lastPublishUs = virtualClock.getMicros();
+            uint64_t allocStart = benchAllocCount.load();
+            uint64_t cpuStartUs = benchCpuTimeUs();
+            if (useBinary)
+                totalBytes += pBus->getBusPollResponsesBinary(0, binBuf.data(), binBuf.size());
+            else
+                totalBytes += pBus->getBusPollResponsesJson().length();
+            publishCpuUs += benchCpuTimeUs() - cpuStartUs;
+            publishAllocs += benchAllocCount.load() - allocStart;
+            numPublishes++;
+        }
+        double windowSecs = windowUs / 1000000.0;
+        double bytesPerSec = totalBytes / windowSecs;
+        double cpuUsPerPublish = numPublishes > 0 ? (double)publishCpuUs / numPublishes : 0;
+        double allocsPerPublish = numPublishes > 0 ? (double)publishAllocs / numPublishes : 0;
+        (useBinary ? result.binBytesPerSec : result.jsonBytesPerSec) = bytesPerSec;
+        (useBinary ? result.binCpuUsPerPublish : result.jsonCpuUsPerPublish) = cpuUsPerPublish;
+        (useBinary ? result.binAllocsPerPublish : result.jsonAllocsPerPublish) = allocsPerPublish;
+    }
+
+    // Clean up
+    delete pBus;
+    delete pSim;
+    BusI2CClock::setClock(nullptr);
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Publishing cost against number of devices
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Numbers of devices for publishing cost
+static const uint32_t BENCH_PUBLISH_SCALE_DEVICES[] = { 10, 50, 200 };
+static const uint32_t BENCH_PUBLISH_SCALE_NUM_SIZES = sizeof(BENCH_PUBLISH_SCALE_DEVICES) / sizeof(BENCH_PUBLISH_SCALE_DEVICES[0]);
+
+// Number of devices with new data for the largest number of devices when most are idle
+static const uint32_t BENCH_PUBLISH_SCALE_ACTIVE_DEVICES = 10;
+
+struct BenchPublishScaleResult
+{
+    uint32_t numDevices = 0;
+    uint32_t numActive = 0;
+    double jsonBytesPerPublish = 0;
+    double jsonCpuUsPerPublish = 0;
+    double jsonAllocsPerPublish = 0;
+    double binCpuUsPerPublish = 0;
+    double binAllocsPerPublish = 0;
+    double snapshotCpuUsPerPublish = 0;
+};
+
+// The bus status manager is fed poll results directly (one result per active device between publishes) so only
+// the cost of forming the published data is measured. Each publish only includes devices changed since the last
+static BenchPublishScaleResult benchPublishScale(uint32_t numDevices, uint32_t numActive, uint32_t numPublishes)
+{
+    BenchPublishScaleResult result;
+    result.numDevices = numDevices;
+    result.numActive = numActive;
+    DeviceTypeRecords deviceTypeRecords;
+    std::vector<uint16_t> devTypeIdxs = deviceTypeRecords.getDeviceTypeIdxsForAddr(BusI2CAddrAndSlot(BENCH_POLLED_DEV_ADDR, 0));
+    if (devTypeIdxs.size() == 0)
+        return result;
+
+    // Status manager and device identification (the bus isn't used)
+    BusI2CReqSyncFn noBusFn = [](const BusI2CRequestRec* pReqRec, std::vector<uint8_t>* pReadData) {
+        return RaftI2CCentralIF::ACCESS_RESULT_NOT_INIT;
+    };
+    BusI2C bus(benchBusElemStatusCB, benchBusOperationStatusCB, nullptr);
+    BusStatusMgr* pStatusMgr = new BusStatusMgr(bus);
+    BusPowerController* pPowerController = new BusPowerController(noBusFn);
+    BusStuckHandler* pStuckHandler = new BusStuckHandler(noBusFn);
+    BusExtenderMgr* pExtenderMgr = new BusExtenderMgr(*pPowerController, *pStuckHandler, *pStatusMgr, noBusFn);
+    DeviceIdentMgr* pDeviceIdentMgr = new DeviceIdentMgr(*pExtenderMgr, noBusFn);
+    RaftJson config = "{\"maxElems\":" + String(numDevices) + "}";
+    pStatusMgr->setup(config);
+
+    // Devices online and identified as the polled device type
+    std::vector<BusI2CAddrAndSlot> addrs;
+    for (uint32_t i = 0; i < numDevices; i++)
+    {
+        BusI2CAddrAndSlot addrAndSlot(BENCH_GENERIC_ADDR_FIRST + i % BENCH_GENERIC_ADDR_COUNT, 1 + i / BENCH_GENERIC_ADDR_COUNT);
+        bool isOnline = false;
+        for (uint32_t j = 0; j < BusStatusMgr::I2C_ADDR_RESP_COUNT_OK_MAX; j++)
+            pStatusMgr->updateBusElemState(addrAndSlot, true, isOnline);
+        DeviceStatus deviceStatus;
+        deviceStatus.deviceTypeIndex = devTypeIdxs[0];
+        deviceTypeRecords.getPollInfo(addrAndSlot, deviceTypeRecords.getDeviceInfo(devTypeIdxs[0]), deviceStatus.deviceIdentPolling);
+        pStatusMgr->setBusElemDeviceStatus(addrAndSlot, deviceStatus);
+        addrs.push_back(addrAndSlot);
+    }
+
+    // Publish in each format then take snapshots only (the time the bus element status lock is held for JSON)
+    std::vector<uint8_t> pollResult(DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + 6);
+    std::vector<uint8_t> binBuf(16384);
+    BusI2CPollSnapshot snapshot;
+    DevicePollingInfo pollInfo;
+    for (uint32_t mode = 0; mode < 3; mode++)
+    {
+        uint64_t totalBytes = 0;
+        uint64_t publishCpuUs = 0;
+        uint64_t publishAllocs = 0;
+        uint32_t generation = pStatusMgr->getStatusGeneration();
+        for (uint32_t i = 0; i < numPublishes; i++)
+        {
+            for (uint32_t j = 0; j < pollResult.size(); j++)
+                pollResult[j] = i * 7 + j;
+            for (uint32_t j = 0; j < numActive; j++)
+                pStatusMgr->pollResultStore(i * 100000, pollInfo, addrs[j], pollResult);
+            uint64_t allocStart = benchAllocCount.load();
+            uint64_t cpuStartUs = benchCpuTimeUs();
+            if (mode == 0)
+                totalBytes += pStatusMgr->getBusPollResponsesJson(*pDeviceIdentMgr, generation, &generation).length();
+            else if (mode == 1)
+                totalBytes += pStatusMgr->getBusPollResponsesBinary(0, binBuf.data(), binBuf.size(), generation, &generation);
+            else
+                pStatusMgr->getBusPollSnapshot(snapshot, generation, &generation);
+            publishCpuUs += benchCpuTimeUs() - cpuStartUs;
+            publishAllocs += benchAllocCount.load() - allocStart;
+        }
+        if (mode == 0)
+        {
+            result.jsonBytesPerPublish = (double)totalBytes / numPublishes;
+            result.jsonCpuUsPerPublish = (double)publishCpuUs / numPublishes;
+            result.jsonAllocsPerPublish = (double)publishAllocs / numPublishes;
+        }
+        else if (mode == 1)
+        {
+            result.binCpuUsPerPublish = (double)publishCpuUs / numPublishes;
+            result.binAllocsPerPublish = (double)publishAllocs / numPublishes;
+        }
+        else
+        {
+            result.snapshotCpuUsPerPublish = (double)publishCpuUs / numPublishes;
+        }
+    }
+
+    // Clean up
+    delete pDeviceIdentMgr;
+    delete pExtenderMgr;
+    delete pStuckHandler;
+    delete pPowerController;
+    delete pStatusMgr;
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cost of recording a transaction trace record
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double benchTraceRecordNs()
+{
+    static const uint32_t NUM_RECORDS = 10000000;
+    BusI2CTraceRecorder traceRecorder;
+    traceRecorder.setup(4096);
+    uint64_t startUs = benchWallTimeUs();
+    for (uint32_t i = 0; i < NUM_RECORDS; i++)
+        traceRecorder.record(i * 100, i * 100 + 50, BusI2CAddrAndSlot(0x40 + (i & 0x0f), i & 0x07),
+                    BUS_REQ_TYPE_POLL, 1, 6, RaftI2CCentralIF::ACCESS_RESULT_OK);
+    uint64_t elapsedUs = benchWallTimeUs() - startUs;
+    if (traceRecorder.getTotalRecorded() != NUM_RECORDS)
+        return 0;
+    return elapsedUs * 1000.0 / NUM_RECORDS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Poll record decode throughput
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const uint32_t BENCH_DECODE_RECS_PER_CALL = 64;
+static const uint32_t BENCH_DECODE_MAX_STRUCT_SIZE = 64;
+
+static double benchDecodeRecordsPerSec(const BusI2CDevTypeRecord& devTypeRec, uint32_t numRecords)
+{
+    // Poll records as stored by the aggregator (timestamp and poll result) with varying contents
+    uint32_t recordSize = DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + devTypeRec.pollResultLenFn();
+    std::vector<uint8_t> pollRecords(recordSize * BENCH_DECODE_RECS_PER_CALL);
+    for (uint32_t i = 0; i < pollRecords.size(); i++)
+        pollRecords[i] = i * 37 + 11;
+    std::vector<uint64_t> decoded(BENCH_DECODE_RECS_PER_CALL * BENCH_DECODE_MAX_STRUCT_SIZE / sizeof(uint64_t));
+
+    // Decode
+    uint32_t numDecoded = 0;
+    uint64_t checksum = 0;
+    uint64_t startUs = benchWallTimeUs();
+    while (numDecoded < numRecords)
+    {
+        numDecoded += devTypeRec.pollResultDecodeFn(pollRecords.data(), pollRecords.size(), decoded.data(),
+                    BENCH_DECODE_RECS_PER_CALL);
+        checksum += decoded[numDecoded % decoded.size()];
+    }
+    uint64_t elapsedUs = benchWallTimeUs() - startUs;
+    static volatile uint64_t benchDecodeChecksum = 0;
+    benchDecodeChecksum = benchDecodeChecksum + checksum;
+    return elapsedUs > 0 ? numDecoded * 1e6 / elapsedUs : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    const char* pOutFile = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+            pOutFile = argv[++i];
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // Scenarios
+    static const BenchScenario fullScenarios[] = {
+        { "main_1dev", 0, 1 },
+        { "slots8_8dev", 8, 8 },
+        { "slots8_32dev", 8, 32 },
+        { "slots32_64dev", 32, 64 },
+        { "slots64_64dev", 64, 64 },
+        { "slots64_200dev", 64, 200 },
+        { "mixed8_all100k", 8, 8, 100000, 2, 100000, 0 },
+        { "mixed8_fast400k", 8, 8, 400000, 2, 100000, 100000 },
+        { "mixed64_all100k", 64, 64, 100000, 16, 100000, 0 },
+        { "mixed64_fast1m", 64, 64, 1000000, 16, 100000, 100000 },
+    };
+    static const BenchScenario quickScenarios[] = {
+        { "main_1dev", 0, 1 },
+        { "slots8_8dev", 8, 8 },
+        { "mixed8_all100k", 8, 8, 100000, 2, 100000, 0 },
+        { "mixed8_fast400k", 8, 8, 400000, 2, 100000, 100000 },
+    };
+    const BenchScenario* pScenarios = quick ? quickScenarios : fullScenarios;
+    uint32_t numScenarios = quick ? sizeof(quickScenarios) / sizeof(quickScenarios[0]) :
+                    sizeof(fullScenarios) / sizeof(fullScenarios[0]);
+    uint64_t windowUs = (quick ? 5ULL : 30ULL) * 1000000;
+
+    // Run and form JSON
+    std::string json = "{\"benchmark\":\"bus_i2c\",\"windowMs\":" + std::to_string(windowUs / 1000) + ",\"scenarios\":[";
+    double maxSustainablePollHz = 0;
+    double mixedSlowBusUs = 0;
+    double mixedFastBusUs = 0;
+    for (uint32_t i = 0; i < numScenarios; i++)
+    {
+        const BenchScenario& scenario = pScenarios[i];
+        fprintf(stderr, "Running scenario %s ...\n", scenario.name);
+        BenchResult r = benchRunScenario(scenario, windowUs);
+        if ((r.pollLatePct < 5.0) && (r.achievedPollHz > maxSustainablePollHz))
+            maxSustainablePollHz = r.achievedPollHz;
+        if ((scenario.numSlowSlots > 0) && (strstr(scenario.name, "mixed8_") == scenario.name))
+            (scenario.slowSlotFreq != 0 ? mixedFastBusUs : mixedSlowBusUs) = r.busUsPerTransaction;
+        char buf[1000];
+        snprintf(buf, sizeof(buf),
+                "%s{\"name\":\"%s\",\"slots\":%u,\"devices\":%u,\"polledDevices\":%u,\"allOnline\":%s,\"expectedOnline\":%u,\"onlineCount\":%u,"
+                "\"fullSweepScanMs\":%.1f,\"hotplugToFirstPollMs\":%.1f,"
+                "\"demandedPollHz\":%.1f,\"achievedPollHz\":%.1f,\"pollLatePct\":%.2f,"
+                "\"cmdCount\":%u,\"cmdFailCount\":%u,\"cmdLatencyP50Ms\":%.2f,\"cmdLatencyP99Ms\":%.2f,\"cmdLatencyMaxMs\":%.2f,"
+                "\"busFreq\":%u,\"slowSlots\":%u,\"slowSlotFreq\":%u,\"busUtilisationPct\":%.1f,\"busUsPerTransaction\":%.1f,"
+                "\"busFreqChanges\":%u,\"speedViolations\":%u,\"cpuUsPerTransaction\":%.3f,\"allocsPerSecond\":%.1f,\"allocsPerTransaction\":%.3f,"
+                "\"wallMs\":%.0f}",
+                i == 0 ? "" : ",", scenario.name, scenario.numSlots, scenario.numDevices, r.numPolledDevices,
+                r.allOnline ? "true" : "false", r.expectedOnline, r.onlineCount,
+                r.fullSweepScanMs, r.hotplugToFirstPollMs,
+                r.demandedPollHz, r.achievedPollHz, r.pollLatePct,
+                r.cmdCount, r.cmdFailCount, r.cmdLatencyP50Ms, r.cmdLatencyP99Ms, r.cmdLatencyMaxMs,
+                scenario.busFreq != 0 ? scenario.busFreq : BENCH_DEFAULT_BUS_FREQ, scenario.numSlowSlots,
+                scenario.slowSlotFreq, r.busUtilisationPct, r.busUsPerTransaction,
+                r.busFreqChanges, r.speedViolations, r.cpuUsPerTransaction, r.allocsPerSecond, r.allocsPerTransaction,
+                r.wallMs);
+        json += buf;
+    }
+    fprintf(stderr, "Running poll response publishing ...\n");
+    BenchPublishResult publish = benchPollPublish(BENCH_PUBLISH_NUM_DEVICES, windowUs);
+    std::string publishScaleJson = "\"publishScale\":{";
+    for (uint32_t i = 0; i <= BENCH_PUBLISH_SCALE_NUM_SIZES; i++)
+    {
+        // The last run has most devices idle
+        bool isMostlyIdle = i == BENCH_PUBLISH_SCALE_NUM_SIZES;
+        uint32_t numDevices = BENCH_PUBLISH_SCALE_DEVICES[isMostlyIdle ? i - 1 : i];
+        BenchPublishScaleResult r = benchPublishScale(numDevices, isMostlyIdle ? BENCH_PUBLISH_SCALE_ACTIVE_DEVICES : numDevices,
+                    quick ? 200 : 2000);
+        std::string prefix = "dev" + std::to_string(r.numDevices) +
+                    (isMostlyIdle ? "_active" + std::to_string(r.numActive) : std::string());
+        char buf[500];
+        snprintf(buf, sizeof(buf), "%s\"%s_jsonBytesPerPublish\":%.0f,\"%s_jsonCpuUsPerPublish\":%.2f,\"%s_jsonAllocsPerPublish\":%.1f,"
+                    "\"%s_binCpuUsPerPublish\":%.2f,\"%s_binAllocsPerPublish\":%.1f,\"%s_snapshotCpuUsPerPublish\":%.2f",
+                    i == 0 ? "" : ",", prefix.c_str(), r.jsonBytesPerPublish, prefix.c_str(), r.jsonCpuUsPerPublish,
+                    prefix.c_str(), r.jsonAllocsPerPublish, prefix.c_str(), r.binCpuUsPerPublish, prefix.c_str(), r.binAllocsPerPublish,
+                    prefix.c_str(), r.snapshotCpuUsPerPublish);
+        publishScaleJson += buf;
+    }
+    publishScaleJson += "}";
+    fprintf(stderr, "Running poll record decode ...\n");
+    std::string decodeJson = ",\"decode\":{";
+    DeviceTypeRecords deviceTypeRecords;
+    for (uint16_t devTypeIdx = 0; deviceTypeRecords.getDeviceInfo(devTypeIdx); devTypeIdx++)
+    {
+        const BusI2CDevTypeRecord* pDevTypeRec = deviceTypeRecords.getDeviceInfo(devTypeIdx);
+        if (!pDevTypeRec->pollResultDecodeFn || !pDevTypeRec->pollResultLenFn)
+            continue;
+        char buf[200];
+        snprintf(buf, sizeof(buf), "%s\"%sRecordsPerSec\":%.0f", decodeJson.back() == '{' ? "" : ",",
+                    pDevTypeRec->deviceType, benchDecodeRecordsPerSec(*pDevTypeRec, quick ? 2000000 : 20000000));
+        decodeJson += buf;
+    }
+    decodeJson += "}";
+    char buf[600];
+    snprintf(buf, sizeof(buf), "],\"maxSustainablePollHz\":%.1f,\"mixedSpeedBusTimeGainPct\":%.1f,\"traceRecordNs\":%.2f,"
+                "\"publish\":{\"devices\":%u,\"jsonBytesPerSec\":%.0f,\"jsonCpuUsPerPublish\":%.1f,\"jsonAllocsPerPublish\":%.1f,"
+                "\"binBytesPerSec\":%.0f,\"binCpuUsPerPublish\":%.1f,\"binAllocsPerPublish\":%.1f},",
+                maxSustainablePollHz, mixedSlowBusUs > 0 ? 100.0 * (1 - mixedFastBusUs / mixedSlowBusUs) : 0,
+                benchTraceRecordNs(), publish.numDevices, publish.jsonBytesPerSec, publish.jsonCpuUsPerPublish,
+                publish.jsonAllocsPerPublish, publish.binBytesPerSec, publish.binCpuUsPerPublish, publish.binAllocsPerPublish);
+    json += buf + publishScaleJson + decodeJson + "}";
+
+    // Output
+    if (pOutFile)
+    {
+        FILE* pFile = fopen(pOutFile, "w");
+        if (!pFile)
+        {
+            fprintf(stderr, "Failed to open %s\n", pOutFile);
+            return 1;
+        }
+        fprintf(pFile, "%s\n", json.c_str());
+        fclose(pFile);
+    }
+    else
+    {
+        printf("%s\n", json.c_str());
+    }
+    return 0;
+}
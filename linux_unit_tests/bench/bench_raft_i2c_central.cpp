@@ -0,0 +1,258 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftI2CCentral driver benchmark (host)
+//
+// Runs the ESP32-S3 I2C central driver unchanged against the register-level peripheral model (SimI2CPeripheral)
+// and reports ISR calls per byte and bus idle gaps (time the bus is stalled mid-transaction waiting for the
+// driver) for a range of transfer sizes, bus speeds and ISR latencies. Bus-time results are deterministic.
+// Also reports the bus time lost to each access to a device which has stopped responding (holding SCL low)
+// with conservative and adaptive timeouts - these are real (wall-clock) times as the driver waits in software
+//
+// Usage: raft_i2c_linux_central_bench [--quick] [-o <file.json>]
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <string>
+#include "RaftI2CCentral.h"
+#include "SimI2CPeripheral.h"
+#include "esp_intr_alloc.h"
+#include "esp_log.h"
+
+// Bus settings
+static const uint32_t BENCH_PIN_SDA = 21;
+static const uint32_t BENCH_PIN_SCL = 22;
+
+// Device with 16 bit register addresses (EEPROM-like)
+static const uint32_t BENCH_DEV_ADDR = 0x50;
+static const uint32_t BENCH_DEV_NUM_REGS = 8192;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scenarios and results
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchScenario
+{
+    const char* name;
+    uint32_t busFreq;
+    uint32_t isrLatencyNs;
+    uint32_t isrDurationNs;
+    // Poll if both zero, register write if writeLen > 0, register read otherwise
+    uint32_t writeLen;
+    uint32_t readLen;
+};
+
+struct BenchResult
+{
+    bool allOk = true;
+    uint32_t numTransactions = 0;
+    uint32_t bytesPerTransaction = 0;
+    double isrPerTransaction = 0;
+    double isrPerByte = 0;
+    double endCmdsPerTransaction = 0;
+    double fifoStallsPerTransaction = 0;
+    double busTimeUs = 0;
+    double idleGapUs = 0;
+    double idleGapsPerTransaction = 0;
+    double maxIdleGapUs = 0;
+    double busEfficiencyPct = 0;
+    double throughputKBps = 0;
+    double cpuUsPerTransaction = 0;
+};
+
+static double benchNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Run a scenario
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static BenchResult benchRunScenario(const BenchScenario& scenario, uint32_t numTransactions)
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(BENCH_DEV_ADDR, BENCH_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    BenchResult r;
+    if (!central.init(0, BENCH_PIN_SDA, BENCH_PIN_SCL, scenario.busFreq))
+    {
+        r.allOk = false;
+        return r;
+    }
+    simPeriph.setIsrTiming(scenario.isrLatencyNs, scenario.isrDurationNs);
+
+    // Transaction buffers
+    std::vector<uint8_t> writeBuf = { 0, 0 };
+    for (uint32_t i = 0; i < scenario.writeLen; i++)
+        writeBuf.push_back((uint8_t)(i * 7));
+    std::vector<uint8_t> readBuf(scenario.readLen);
+    bool isPoll = (scenario.writeLen == 0) && (scenario.readLen == 0);
+
+    // Run
+    simPeriph.clearStats();
+    double startUs = benchNowUs();
+    for (uint32_t i = 0; i < numTransactions; i++)
+    {
+        uint32_t numRead = 0;
+        RaftI2CCentralIF::AccessResultCode rslt = isPoll ?
+                    central.access(BENCH_DEV_ADDR, nullptr, 0, nullptr, 0, numRead) :
+                    central.access(BENCH_DEV_ADDR, writeBuf.data(), writeBuf.size(), readBuf.data(), readBuf.size(), numRead);
+        if ((rslt != RaftI2CCentralIF::ACCESS_RESULT_OK) || (numRead != readBuf.size()))
+            r.allOk = false;
+    }
+    double cpuUs = benchNowUs() - startUs;
+
+    // Results per transaction
+    const SimI2CPeripheral::Stats& stats = simPeriph.getStats();
+    uint32_t busBytes = stats.bytesWritten + stats.bytesRead;
+    r.numTransactions = numTransactions;
+    r.bytesPerTransaction = busBytes / numTransactions;
+    r.isrPerTransaction = (double)stats.isrCalls / numTransactions;
+    r.isrPerByte = busBytes > 0 ? (double)stats.isrCalls / busBytes : 0;
+    r.endCmdsPerTransaction = (double)stats.endCmds / numTransactions;
+    r.fifoStallsPerTransaction = (double)(stats.txFifoStalls + stats.rxFifoStalls) / numTransactions;
+    r.busTimeUs = stats.busTimeNs / 1000.0 / numTransactions;
+    r.idleGapUs = stats.idleGapNs / 1000.0 / numTransactions;
+    r.idleGapsPerTransaction = (double)stats.idleGapCount / numTransactions;
+    r.maxIdleGapUs = stats.maxIdleGapNs / 1000.0;
+    uint64_t totalNs = stats.busTimeNs + stats.idleGapNs;
+    r.busEfficiencyPct = totalNs > 0 ? stats.busTimeNs * 100.0 / totalNs : 0;
+    r.throughputKBps = totalNs > 0 ? busBytes * 1e6 / totalNs : 0;
+    r.cpuUsPerTransaction = cpuUs / numTransactions;
+    return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bus time lost per access to a stuck device after a run of successful accesses
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double benchStuckDeviceTimeoutUs(bool adaptiveTimeouts, uint32_t numTimeouts)
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(BENCH_DEV_ADDR, BENCH_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    if (!central.init(0, BENCH_PIN_SDA, BENCH_PIN_SCL, 400000))
+        return 0;
+    central.setAdaptiveTimeouts(adaptiveTimeouts);
+
+    // Register read of 6 bytes (typical sensor poll)
+    uint8_t writeBuf[2] = { 0, 0 };
+    uint8_t readBuf[6];
+    uint32_t numRead = 0;
+    for (uint32_t i = 0; i < 16; i++)
+        central.access(BENCH_DEV_ADDR, writeBuf, sizeof(writeBuf), readBuf, sizeof(readBuf), numRead);
+
+    // Device stops responding
+    simDev.setHoldsBus(true);
+    for (uint32_t i = 0; i < numTimeouts; i++)
+        central.access(BENCH_DEV_ADDR, writeBuf, sizeof(writeBuf), readBuf, sizeof(readBuf), numRead);
+    return (double)central.getStats().timeoutBusTimeUs / numTimeouts;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    const char* pOutFile = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+            pOutFile = argv[++i];
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    // Scenarios
+    static const BenchScenario fullScenarios[] = {
+        { "poll_400k", 400000, 2000, 3000, 0, 0 },
+        { "read16_400k", 400000, 2000, 3000, 0, 16 },
+        { "read32_400k", 400000, 2000, 3000, 0, 32 },
+        { "read255_400k", 400000, 2000, 3000, 0, 255 },
+        { "write255_400k", 400000, 2000, 3000, 255, 0 },
+        { "write1k_400k", 400000, 2000, 3000, 1024, 0 },
+        { "read4k_400k", 400000, 2000, 3000, 0, 4096 },
+        { "write4k_100k", 100000, 2000, 3000, 4096, 0 },
+        { "write4k_1m", 1000000, 2000, 3000, 4096, 0 },
+        { "read4k_1m", 1000000, 2000, 3000, 0, 4096 },
+        { "write4k_1m_lat20us", 1000000, 20000, 5000, 4096, 0 },
+        { "read4k_1m_lat20us", 1000000, 20000, 5000, 0, 4096 },
+        { "write4k_400k_lat100us", 400000, 100000, 5000, 4096, 0 },
+        { "read4k_400k_lat100us", 400000, 100000, 5000, 0, 4096 },
+    };
+    static const BenchScenario quickScenarios[] = {
+        { "poll_400k", 400000, 2000, 3000, 0, 0 },
+        { "read32_400k", 400000, 2000, 3000, 0, 32 },
+        { "write1k_400k", 400000, 2000, 3000, 1024, 0 },
+        { "read4k_1m_lat20us", 1000000, 20000, 5000, 0, 4096 },
+    };
+    const BenchScenario* pScenarios = quick ? quickScenarios : fullScenarios;
+    uint32_t numScenarios = quick ? sizeof(quickScenarios) / sizeof(quickScenarios[0]) :
+                    sizeof(fullScenarios) / sizeof(fullScenarios[0]);
+    uint32_t numTransactions = quick ? 5 : 50;
+
+    // Run and form JSON
+    std::string json = "{\"benchmark\":\"rafti2c_central\",\"transactions\":" + std::to_string(numTransactions) + ",\"scenarios\":[";
+    for (uint32_t i = 0; i < numScenarios; i++)
+    {
+        const BenchScenario& scenario = pScenarios[i];
+        fprintf(stderr, "Running scenario %s ...\n", scenario.name);
+        BenchResult r = benchRunScenario(scenario, numTransactions);
+        char buf[1000];
+        snprintf(buf, sizeof(buf),
+                "%s{\"name\":\"%s\",\"busFreq\":%u,\"isrLatencyUs\":%.1f,\"isrDurationUs\":%.1f,\"allOk\":%s,"
+                "\"bytesPerTransaction\":%u,\"isrPerTransaction\":%.2f,\"isrPerByte\":%.4f,\"endCmdsPerTransaction\":%.2f,"
+                "\"fifoStallsPerTransaction\":%.2f,\"busTimeUs\":%.1f,\"idleGapUs\":%.1f,\"idleGapsPerTransaction\":%.2f,"
+                "\"maxIdleGapUs\":%.1f,\"busEfficiencyPct\":%.2f,\"throughputKBps\":%.2f,\"cpuUsPerTransaction\":%.2f}",
+                i == 0 ? "" : ",", scenario.name, scenario.busFreq, scenario.isrLatencyNs / 1000.0,
+                scenario.isrDurationNs / 1000.0, r.allOk ? "true" : "false",
+                r.bytesPerTransaction, r.isrPerTransaction, r.isrPerByte, r.endCmdsPerTransaction,
+                r.fifoStallsPerTransaction, r.busTimeUs, r.idleGapUs, r.idleGapsPerTransaction,
+                r.maxIdleGapUs, r.busEfficiencyPct, r.throughputKBps, r.cpuUsPerTransaction);
+        json += buf;
+    }
+    json += "]";
+
+    // Stuck device
+    uint32_t numTimeouts = quick ? 9 : 90;
+    fprintf(stderr, "Running stuck device timeouts ...\n");
+    double fixedTimeoutUs = benchStuckDeviceTimeoutUs(false, numTimeouts);
+    double adaptiveTimeoutUs = benchStuckDeviceTimeoutUs(true, numTimeouts);
+    char buf[200];
+    snprintf(buf, sizeof(buf), ",\"stuckDevice\":{\"timeouts\":%u,\"fixedTimeoutUs\":%.1f,\"adaptiveTimeoutUs\":%.1f},"
+                "\"timeoutCostReductionPct\":%.1f}",
+                numTimeouts, fixedTimeoutUs, adaptiveTimeoutUs,
+                fixedTimeoutUs > 0 ? (fixedTimeoutUs - adaptiveTimeoutUs) * 100.0 / fixedTimeoutUs : 0);
+    json += buf;
+
+    // Output
+    if (pOutFile)
+    {
+        FILE* pFile = fopen(pOutFile, "w");
+        if (!pFile)
+        {
+            fprintf(stderr, "Failed to open %s\n", pOutFile);
+            return 1;
+        }
+        fprintf(pFile, "%s\n", json.c_str());
+        fclose(pFile);
+    }
+    else
+    {
+        printf("%s\n", json.c_str());
+    }
+    return 0;
+}
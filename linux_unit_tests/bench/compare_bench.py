@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+# Compare two benchmark JSON files produced by raft_i2c_linux_bench or raft_i2c_linux_central_bench
+# Usage: compare_bench.py <baseline.json> <new.json>
+
+import json
+import sys
+
+def main():
+    if len(sys.argv) != 3:
+        print("Usage: compare_bench.py <baseline.json> <new.json>")
+        return 1
+    with open(sys.argv[1]) as f:
+        base = json.load(f)
+    with open(sys.argv[2]) as f:
+        new = json.load(f)
+    for key in ("maxSustainablePollHz", "mixedSpeedBusTimeGainPct", "traceRecordNs", "timeoutCostReductionPct"):
+        if key in base and key in new:
+            baseVal = base[key]
+            pct = ((new[key] - baseVal) * 100.0 / baseVal) if baseVal else 0.0
+            print(f"{key:28} {baseVal:>12.3f} -> {new[key]:>12.3f} ({pct:+.1f}%)")
+    for name, obj in new.items():
+        if not isinstance(obj, dict) or not isinstance(base.get(name), dict):
+            continue
+        print(name)
+        for key, val in obj.items():
+            if not isinstance(val, (int, float)) or isinstance(val, bool) or key not in base[name]:
+                continue
+            baseVal = base[name][key]
+            pct = ((val - baseVal) * 100.0 / baseVal) if baseVal else 0.0
+            print(f"    {key:24} {baseVal:>12.3f} -> {val:>12.3f} ({pct:+.1f}%)")
+    baseScenarios = {s["name"]: s for s in base.get("scenarios", [])}
+    for scenario in new.get("scenarios", []):
+        baseScenario = baseScenarios.get(scenario["name"])
+        if baseScenario is None:
+            print(f"{scenario['name']}: no baseline")
+            continue
+        print(scenario["name"])
+        for key, val in scenario.items():
+            if not isinstance(val, (int, float)) or isinstance(val, bool) or key not in baseScenario:
+                continue
+            baseVal = baseScenario[key]
+            pct = ((val - baseVal) * 100.0 / baseVal) if baseVal else 0.0
+            print(f"    {key:24} {baseVal:>12.3f} -> {val:>12.3f} ({pct:+.1f}%)")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,1219 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests of I2C Bus against the simulated I2C central
+// Exercises BusI2C end-to-end (worker task, scanning, bus extenders, power control, ident and polling)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "RaftJson.h"
+#include "BusI2C.h"
+#include "SimI2CCentral.h"
+#include "DevicePollRecords_generated.h"
+
+static const char* MODULE_PREFIX = "test_bus_i2c_sim";
+
+// Pins used by the simulated bus
+static const char* SIM_BUS_CONFIG_BASE = "\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"busScanPeriodMs\":0,\"loopYieldMs\":1";
+
+// VCNL4040 ident register (0x0c) contents
+static const std::vector<uint8_t> SIM_VCNL4040_ID = {0x86, 0x01};
+
+// Status changes reported by the bus
+static std::vector<BusElemAddrAndStatus> simStatusChanges;
+static BusOperationStatus simBusStatus = BUS_OPERATION_UNKNOWN;
+
+static BusElemStatusCB simBusElemStatusCB = [](BusBase& bus, const std::vector<BusElemAddrAndStatus>& statusChanges) {
+    simStatusChanges.insert(simStatusChanges.end(), statusChanges.begin(), statusChanges.end());
+};
+static BusOperationStatusCB simBusOperationStatusCB = [](BusBase& bus, BusOperationStatus busOperationStatus) {
+    simBusStatus = busOperationStatus;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static SimRegDevice* sim_add_vcnl4040(SimI2CCentral& simCentral, uint32_t slotPlus1)
+{
+    SimRegDevice* pDev = simCentral.addDevice(new SimRegDevice(0x60, 256, 1), slotPlus1);
+    // Registers are 16 bits wide (LSB first) but a flat byte model is sufficient for ident and polling
+    pDev->setRegs(0x0c, SIM_VCNL4040_ID);
+    return pDev;
+}
+
+static bool sim_service_until(BusI2C& busI2C, uint32_t timeoutMs, std::function<bool()> condFn)
+{
+    uint32_t startMs = millis();
+    while (!Raft::isTimeout(millis(), startMs, timeoutMs))
+    {
+        busI2C.service();
+        if (condFn())
+            return true;
+        vTaskDelay(1);
+    }
+    return condFn();
+}
+
+static bool sim_status_change_seen(uint32_t compositeAddr, bool toOnline)
+{
+    for (const auto& stat : simStatusChanges)
+    {
+        if ((stat.address == compositeAddr) && (toOnline ? stat.isChangeToOnline : stat.isChangeToOffline))
+            return true;
+    }
+    return false;
+}
+
+static void sim_reset_status()
+{
+    simStatusChanges.clear();
+    simBusStatus = BUS_OPERATION_UNKNOWN;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("test_sim_main_bus_scan_ident_poll", "[rafti2c_sim_tests]")
+{
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->addDevice(new SimRegDevice(0x55));
+    SimRegDevice* pVcnl = sim_add_vcnl4040(*pSim, 0);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = String("{") + SIM_BUS_CONFIG_BASE + ",\"lockupDetect\":\"0x55\"}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Both devices should come online
+    bool ok = sim_service_until(busI2C, 5000, [&]() {
+        return sim_status_change_seen(0x55, true) && sim_status_change_seen(0x60, true);
+    });
+    TEST_ASSERT_MESSAGE(ok, "devices not reported online");
+    TEST_ASSERT_MESSAGE(simBusStatus == BUS_OPERATION_OK, "bus status not ok");
+
+    // Device type identified
+    ok = sim_service_until(busI2C, 5000, [&]() {
+        return busI2C.getDevTypeInfoJsonByAddr(0x60, false).indexOf("VCNL4040") >= 0;
+    });
+    TEST_ASSERT_MESSAGE(ok, "VCNL4040 not identified");
+
+    // Init values written
+    TEST_ASSERT_MESSAGE(pVcnl->getRegWriteCount() > 0, "init values not written");
+
+    // Poll responses arrive
+    ok = sim_service_until(busI2C, 5000, [&]() {
+        std::vector<uint32_t> addrs;
+        return busI2C.getBusElemAddresses(addrs, true) && (addrs.size() > 0);
+    });
+    TEST_ASSERT_MESSAGE(ok, "no poll responses");
+    String pollJson = busI2C.getBusPollResponsesJson();
+    TEST_ASSERT_MESSAGE(pollJson.indexOf("60") >= 0, "poll JSON doesn't contain device");
+
+    // Hot-unplug
+    simStatusChanges.clear();
+    pVcnl->setPresent(false);
+    ok = sim_service_until(busI2C, 5000, [&]() { return sim_status_change_seen(0x60, false); });
+    TEST_ASSERT_MESSAGE(ok, "device not reported offline after unplug");
+
+    busI2C.close();
+    LOG_I(MODULE_PREFIX, "main bus test sim stats %s busTimeUs %llu", pSim->getStats().debugStr().c_str(),
+                (unsigned long long)pSim->getBusTimeUs());
+    delete pSim;
+}
+
+TEST_CASE("test_sim_bus_extender_slots", "[rafti2c_sim_tests]")
+{
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->addDevice(new SimPCA9548A(0x73));
+    pSim->addDevice(new SimRegDevice(0x55), 26);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = String("{") + SIM_BUS_CONFIG_BASE + "}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Extender and device on slot 26 should come online
+    uint32_t devCompositeAddr = BusI2CAddrAndSlot(0x55, 26).toCompositeAddrAndSlot();
+    bool ok = sim_service_until(busI2C, 5000, [&]() {
+        return sim_status_change_seen(0x73, true) && sim_status_change_seen(devCompositeAddr, true);
+    });
+    TEST_ASSERT_MESSAGE(ok, "extender or slot device not reported online");
+
+    // The device must not be reported on the main bus or any other slot
+    for (const auto& stat : simStatusChanges)
+    {
+        BusI2CAddrAndSlot addrAndSlot = BusI2CAddrAndSlot::fromCompositeAddrAndSlot(stat.address);
+        if (addrAndSlot.addr == 0x55)
+            TEST_ASSERT_MESSAGE(addrAndSlot.slotPlus1 == 26, "device reported on wrong slot");
+    }
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_slot_power_control", "[rafti2c_sim_tests]")
+{
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->addDevice(new SimPCA9548A(0x70));
+    SimPCA9535* pPwr = pSim->addDevice(new SimPCA9535(0x1d, 1, 8));
+    pSim->addDevice(new SimRegDevice(0x55), 3);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = String("{") + SIM_BUS_CONFIG_BASE +
+                ",\"pwr\":{\"ctrl\":[{\"dev\":\"PCA9535\",\"addr\":\"0x1d\",\"minSlotPlus1\":1,\"numSlots\":8}]}}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Slot starts unpowered (PCA9535 power-on default is all inputs)
+    TEST_ASSERT_MESSAGE(!pSim->isSlotPowered(3), "slot powered before controller init");
+
+    // Power controller sequences the slot on and the device is then found
+    uint32_t devCompositeAddr = BusI2CAddrAndSlot(0x55, 3).toCompositeAddrAndSlot();
+    bool ok = sim_service_until(busI2C, 5000, [&]() { return sim_status_change_seen(devCompositeAddr, true); });
+    TEST_ASSERT_MESSAGE(ok, "slot device not reported online");
+    TEST_ASSERT_MESSAGE(pPwr->isSlotPowered(3), "slot not powered");
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_ack_faults", "[rafti2c_sim_tests]")
+{
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    SimRegDevice* pFlaky = pSim->addDevice(new SimRegDevice(0x48));
+    pSim->setAddrFault(0x49, RaftI2CCentralIF::ACCESS_RESULT_HW_TIME_OUT);
+    pSim->addDevice(new SimRegDevice(0x49));
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = String("{") + SIM_BUS_CONFIG_BASE + "}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Device that never ACKs stays offline while the good device comes online
+    pFlaky->setAckMode(SimI2CDevice::ACK_NEVER);
+    bool ok = sim_service_until(busI2C, 1000, [&]() { return sim_status_change_seen(0x48, true); });
+    TEST_ASSERT_MESSAGE(!ok, "non-ACKing device reported online");
+    TEST_ASSERT_MESSAGE(!sim_status_change_seen(0x49, true), "timing-out device reported online");
+
+    // Once it starts ACKing it is found
+    pFlaky->setAckMode(SimI2CDevice::ACK_ALWAYS);
+    ok = sim_service_until(busI2C, 5000, [&]() { return sim_status_change_seen(0x48, true); });
+    TEST_ASSERT_MESSAGE(ok, "device not found once ACKing");
+    TEST_ASSERT_MESSAGE(pSim->getStats().nackCount > 0, "NACKs not recorded in stats");
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_virtual_clock_long_run", "[rafti2c_sim_tests]")
+{
+    // Run the bus from a virtual clock so that a long scenario completes in a fraction of the wall time
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    pSim->addDevice(new SimPCA9548A(0x70));
+    pSim->addDevice(new SimPCA9535(0x1d, 1, 8));
+    SimRegDevice* pVcnl = sim_add_vcnl4040(*pSim, 5);
+    uint32_t pollReadCount = 0;
+    pVcnl->setReadHook([&pollReadCount](uint32_t regAddr, uint8_t& value) {
+        if (regAddr == 0x08)
+            pollReadCount++;
+    });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = String("{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false") +
+                ",\"pwr\":{\"ctrl\":[{\"dev\":\"PCA9535\",\"addr\":\"0x1d\",\"minSlotPlus1\":1,\"numSlots\":8}]}}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Step the bus for 2 minutes of virtual time
+    static const uint64_t RUN_TIME_US = 2ULL * 60 * 1000000;
+    static const uint32_t STEP_US = 5000;
+    uint64_t wallStartUs = micros();
+    uint64_t endUs = virtualClock.getMicros() + RUN_TIME_US;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(STEP_US);
+    }
+    uint64_t wallElapsedUs = micros() - wallStartUs;
+
+    // Device came online through the power controller and extender
+    uint32_t devCompositeAddr = BusI2CAddrAndSlot(0x60, 5).toCompositeAddrAndSlot();
+    TEST_ASSERT_MESSAGE(sim_status_change_seen(devCompositeAddr, true), "slot device not reported online");
+
+    // Polled at close to its configured 200ms interval throughout
+    uint32_t expectedPolls = RUN_TIME_US / 200000;
+    LOG_I(MODULE_PREFIX, "virtual clock run wallMs %d polls %d expected %d bus accesses %d",
+                (int)(wallElapsedUs / 1000), pollReadCount, expectedPolls, pSim->getAccessCount());
+    TEST_ASSERT_MESSAGE(pollReadCount >= expectedPolls * 9 / 10, "too few polls in virtual time");
+    TEST_ASSERT_MESSAGE(pollReadCount <= expectedPolls * 11 / 10, "too many polls in virtual time");
+    TEST_ASSERT_MESSAGE(wallElapsedUs < RUN_TIME_US / 10, "virtual clock run not faster than real time");
+
+    delete pSim;
+}
+
+TEST_CASE("test_sim_trace_recorder", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false,\"traceRecs\":4000}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Run for long enough to scan, identify and poll (and to wrap the trace buffer)
+    uint64_t endUs = virtualClock.getMicros() + 5000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Header
+    std::vector<uint8_t> traceData;
+    uint32_t numRecs = busI2C.getTrace(traceData, true);
+    TEST_ASSERT_MESSAGE(numRecs >= 4000, "too few trace records");
+    TEST_ASSERT_EQUAL_UINT32(BusI2CTraceRecorder::TRACE_HEADER_BYTES + numRecs * sizeof(BusI2CTraceRec), traceData.size());
+    uint32_t magic = 0, totalRecorded = 0;
+    memcpy(&magic, traceData.data(), sizeof(magic));
+    memcpy(&totalRecorded, traceData.data() + 12, sizeof(totalRecorded));
+    TEST_ASSERT_EQUAL_UINT32(BusI2CTraceRecorder::TRACE_MAGIC, magic);
+    TEST_ASSERT_EQUAL_UINT8(sizeof(BusI2CTraceRec), traceData[5]);
+    TEST_ASSERT_MESSAGE(totalRecorded > numRecs, "trace buffer didn't wrap");
+
+    // Records are in time order and include successful polls of the device
+    const BusI2CTraceRec* pRecs = (const BusI2CTraceRec*)(traceData.data() + BusI2CTraceRecorder::TRACE_HEADER_BYTES);
+    uint32_t numPolls = 0;
+    for (uint32_t i = 0; i < numRecs; i++)
+    {
+        if (i > 0)
+            TEST_ASSERT_MESSAGE(pRecs[i].startUs >= pRecs[i-1].startUs, "trace records out of order");
+        if ((pRecs[i].addrAndSlot == 0x60) && ((pRecs[i].reqType & ~BusI2CTraceRecorder::TRACE_FLAG_ASYNC) == BUS_REQ_TYPE_POLL) &&
+                    (pRecs[i].resultCode == RaftI2CCentralIF::ACCESS_RESULT_OK) && (pRecs[i].readLen > 0) &&
+                    (pRecs[i].durationUs > 0))
+            numPolls++;
+    }
+    TEST_ASSERT_MESSAGE(numPolls > 0, "no poll records in trace");
+
+    // Cleared records are not returned again
+    TEST_ASSERT_EQUAL_UINT32(0, busI2C.getTrace(traceData, false));
+
+    delete pSim;
+
+    // A single trace record still enables tracing (the ring has at least 2 records)
+    BusI2CTraceRecorder traceRecorder;
+    traceRecorder.setup(1);
+    TEST_ASSERT_TRUE(traceRecorder.isEnabled());
+    traceRecorder.record(0, 10, BusI2CAddrAndSlot(0x60, 0), BUS_REQ_TYPE_POLL, 1, 2, RaftI2CCentralIF::ACCESS_RESULT_OK);
+    TEST_ASSERT_EQUAL_UINT32(1, traceRecorder.getTotalRecorded());
+    traceRecorder.setup(0);
+    TEST_ASSERT_FALSE(traceRecorder.isEnabled());
+}
+
+TEST_CASE("test_sim_slot_bus_speeds", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Fast device on slot 1 and a device limited to 100kHz on slot 2 - the main bus runs at 400kHz
+    // and slot 2 is configured to run at 100kHz
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    pSim->addDevice(new SimPCA9548A(0x70));
+    sim_add_vcnl4040(*pSim, 1)->setMaxFreq(400000);
+    pSim->addDevice(new SimRegDevice(0x55), 2)->setMaxFreq(100000);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false,"
+                "\"slotFreqs\":[{\"slotPlus1\":2,\"freq\":100000}]}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Run to scan, identify and poll
+    uint64_t endUs = virtualClock.getMicros() + 5000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+    TEST_ASSERT_MESSAGE(sim_status_change_seen(BusI2CAddrAndSlot(0x60, 1).toCompositeAddrAndSlot(), true), "fast device not online");
+    TEST_ASSERT_MESSAGE(sim_status_change_seen(BusI2CAddrAndSlot(0x55, 2).toCompositeAddrAndSlot(), true), "slow device not online");
+    TEST_ASSERT_MESSAGE(busI2C.getDevTypeInfoJsonByAddr(BusI2CAddrAndSlot(0x60, 1).toCompositeAddrAndSlot(), false).indexOf("VCNL4040") >= 0,
+                "fast device not identified");
+
+    // The slow device never saw a transaction faster than it supports but most of the bus ran fast
+    LOG_I(MODULE_PREFIX, "slot bus speeds accesses 400k %d 100k %d freqChanges %d violations %d",
+                pSim->getAccessCountAtFreq(400000), pSim->getAccessCountAtFreq(100000),
+                busI2C.getBusFreqChangeCount(), pSim->getSpeedViolationCount());
+    TEST_ASSERT_EQUAL_UINT32(0, pSim->getSpeedViolationCount());
+    TEST_ASSERT_MESSAGE(pSim->getAccessCountAtFreq(100000) > 0, "no accesses at slow slot speed");
+    TEST_ASSERT_MESSAGE(pSim->getAccessCountAtFreq(400000) > pSim->getAccessCountAtFreq(100000), "fast slot not run fast");
+    TEST_ASSERT_EQUAL_UINT32(busI2C.getBusFreqChangeCount(), pSim->getFreqChangeCount());
+
+    delete pSim;
+}
+
+TEST_CASE("test_sim_slot_bus_speeds_refused", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // As test_sim_slot_bus_speeds but the central refuses frequency changes
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false,"
+                "\"slotFreqs\":[{\"slotPlus1\":2,\"freq\":100000}]}";
+    for (bool refuseAtSetup : {true, false})
+    {
+        sim_reset_status();
+        SimI2CCentral* pSim = new SimI2CCentral();
+        pSim->setVirtualClock(&virtualClock);
+        pSim->addDevice(new SimPCA9548A(0x70));
+        sim_add_vcnl4040(*pSim, 1)->setMaxFreq(400000);
+        pSim->addDevice(new SimRegDevice(0x55), 2)->setMaxFreq(100000);
+        BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+        pSim->setFreqChangeRefused(refuseAtSetup);
+        TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+        pSim->setFreqChangeRefused(true);
+
+        // Run to scan, identify and poll
+        uint64_t endUs = virtualClock.getMicros() + 5000000;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+        LOG_I(MODULE_PREFIX, "slot bus speeds refused refuseAtSetup %d accesses 400k %d 100k %d failCount %d violations %d",
+                    refuseAtSetup, pSim->getAccessCountAtFreq(400000), pSim->getAccessCountAtFreq(100000),
+                    busI2C.getBusFreqChangeFailCount(), pSim->getSpeedViolationCount());
+        TEST_ASSERT_EQUAL_UINT32(0, pSim->getFreqChangeCount());
+        TEST_ASSERT_EQUAL_UINT32(0, pSim->getAccessCountAtFreq(100000));
+        TEST_ASSERT_EQUAL_UINT32(0, busI2C.getBusFreqChangeCount());
+        if (refuseAtSetup)
+        {
+            // slotFreqs is ignored so every access runs at i2cFreq and nothing is retried
+            TEST_ASSERT_EQUAL_UINT32(0, busI2C.getBusFreqChangeFailCount());
+            TEST_ASSERT_MESSAGE(sim_status_change_seen(BusI2CAddrAndSlot(0x55, 2).toCompositeAddrAndSlot(), true),
+                        "slow device not online");
+        }
+        else
+        {
+            // Accesses needing a change fail rather than being sent at the wrong speed
+            TEST_ASSERT_MESSAGE(busI2C.getBusFreqChangeFailCount() > 0, "frequency change failures not counted");
+            TEST_ASSERT_EQUAL_UINT32(0, pSim->getSpeedViolationCount());
+        }
+        delete pSim;
+    }
+}
+
+TEST_CASE("test_sim_dev_type_max_freq", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Slot 1 configured for 1MHz but the VCNL4040 device type record limits it to 400kHz once identified
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    pSim->addDevice(new SimPCA9548A(0x70));
+    sim_add_vcnl4040(*pSim, 1)->setMaxFreq(400000);
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":100000,\"workerTask\":false,"
+                "\"slotFreqs\":[{\"slotPlus1\":1,\"freq\":1000000}]}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    auto runForUs = [&](uint64_t runUs) {
+        uint64_t endUs = virtualClock.getMicros() + runUs;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+    };
+
+    // Identify
+    runForUs(3000000);
+    TEST_ASSERT_MESSAGE(busI2C.getDevTypeInfoJsonByAddr(BusI2CAddrAndSlot(0x60, 1).toCompositeAddrAndSlot(), false).indexOf("VCNL4040") >= 0,
+                "device not identified");
+
+    // Once identified the slot runs at the device's maximum
+    uint32_t violationsAfterIdent = pSim->getSpeedViolationCount();
+    uint32_t accessesAt400kAfterIdent = pSim->getAccessCountAtFreq(400000);
+    runForUs(2000000);
+    TEST_ASSERT_EQUAL_UINT32(violationsAfterIdent, pSim->getSpeedViolationCount());
+    TEST_ASSERT_MESSAGE(pSim->getAccessCountAtFreq(400000) > accessesAt400kAfterIdent, "slot not run at device maximum");
+
+    // Unplugged so the limit is removed
+    sim_reset_status();
+    pSim->clearDevices();
+    pSim->addDevice(new SimPCA9548A(0x70));
+    runForUs(3000000);
+    TEST_ASSERT_MESSAGE(sim_status_change_seen(BusI2CAddrAndSlot(0x60, 1).toCompositeAddrAndSlot(), false), "device not offline");
+    uint32_t accessesAt1MAfterUnplug = pSim->getAccessCountAtFreq(1000000);
+    runForUs(2000000);
+    TEST_ASSERT_MESSAGE(pSim->getAccessCountAtFreq(1000000) > accessesAt1MAfterUnplug, "limit not removed when device offline");
+
+    delete pSim;
+}
+
+TEST_CASE("test_sim_pipelined_polling", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+
+    // VCNL4040 poll reads 2 bytes from each of registers 0x08, 0x09 and 0x0a
+    static const std::vector<uint8_t> pollRegs = { 0x11, 0x22, 0x33, 0x44 };
+    static const std::vector<uint8_t> expectedPollData = { 0x11, 0x22, 0x22, 0x33, 0x33, 0x44 };
+
+    // Poll devices on the given slots (0 for main bus) and check the results are the same with and without
+    // pipelining - returns true if a poll was left in flight between loops
+    auto runPolling = [&](const std::vector<uint32_t>& slotPlus1s, bool pipelined) {
+        BusI2CVirtualClock virtualClock(1000000);
+        ClockGuard clockGuard(&virtualClock);
+        sim_reset_status();
+        SimI2CCentral* pSim = new SimI2CCentral();
+        pSim->setVirtualClock(&virtualClock);
+        pSim->addDevice(new SimPCA9548A(0x70));
+        for (uint32_t slotPlus1 : slotPlus1s)
+            sim_add_vcnl4040(*pSim, slotPlus1)->setRegs(0x08, pollRegs);
+        BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+        RaftJson config = String("{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false,\"pipelined\":") +
+                    (pipelined ? "true" : "false") + "}";
+        TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+        uint64_t endUs = virtualClock.getMicros() + 5000000;
+        bool isInFlightSeen = false;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            isInFlightSeen = isInFlightSeen || (pSim->getNumQueued() > 0);
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+        for (uint32_t slotPlus1 : slotPlus1s)
+        {
+            bool isOnline = false;
+            uint16_t deviceTypeIndex = 0;
+            std::vector<uint8_t> pollData;
+            uint32_t responseSize = 0;
+            uint32_t numResponses = busI2C.getBusElemPollResponses(BusI2CAddrAndSlot(0x60, slotPlus1).toCompositeAddrAndSlot(),
+                        isOnline, deviceTypeIndex, pollData, responseSize, 1);
+            LOG_I(MODULE_PREFIX, "pipelined %d slotPlus1 %d online %d responses %d size %d",
+                        pipelined, slotPlus1, isOnline, numResponses, responseSize);
+            TEST_ASSERT_MESSAGE(isOnline, "device not online");
+            TEST_ASSERT_EQUAL_UINT32(1, numResponses);
+            TEST_ASSERT_EQUAL_UINT32(DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + expectedPollData.size(), responseSize);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedPollData.data(), pollData.data() + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE,
+                        expectedPollData.size());
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, pSim->getNumQueued());
+        busI2C.close();
+        delete pSim;
+        return isInFlightSeen;
+    };
+
+    // Only main bus devices are pipelined (stay in flight between loops) - devices on bus extender slots are
+    // polled synchronously as setting the slot is a synchronous access
+    TEST_ASSERT_FALSE(runPolling({0}, false));
+    TEST_ASSERT_TRUE(runPolling({0}, true));
+    TEST_ASSERT_FALSE(runPolling({1, 2}, false));
+    TEST_ASSERT_FALSE(runPolling({1, 2}, true));
+}
+
+TEST_CASE("test_sim_poll_responses_binary", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // VCNL4040 on the main bus polled every 200ms
+    static const std::vector<uint8_t> expectedPollData = { 0x11, 0x22, 0x22, 0x33, 0x33, 0x44 };
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    auto runForUs = [&](uint64_t runUs) {
+        uint64_t endUs = virtualClock.getMicros() + runUs;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+    };
+    runForUs(3000000);
+
+    // Buffer with room for one record only - the rest stay for the next call
+    static const uint32_t HEADERS_SIZE = BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE + BusStatusMgr::POLL_RESP_BIN_DEVICE_HEADER_SIZE;
+    uint8_t buf[500];
+    uint32_t len = busI2C.getBusPollResponsesBinary(3, buf, HEADERS_SIZE + 1 + expectedPollData.size());
+    TEST_ASSERT_EQUAL_UINT32(HEADERS_SIZE + 1 + expectedPollData.size(), len);
+    TEST_ASSERT_EQUAL_UINT8(BusStatusMgr::POLL_RESP_BIN_VERSION, buf[0]);
+    TEST_ASSERT_EQUAL_UINT8(3, buf[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, buf[8]);
+
+    // Remaining records
+    len = busI2C.getBusPollResponsesBinary(3, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(len > HEADERS_SIZE);
+    const uint8_t* pDev = buf + BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE;
+    TEST_ASSERT_EQUAL_UINT32(0x60, ((uint32_t)pDev[0] << 8) | pDev[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, pDev[2] & 0x01);
+    TEST_ASSERT_EQUAL_UINT8(expectedPollData.size(), pDev[5]);
+    uint32_t numRecords = pDev[6];
+    TEST_ASSERT_TRUE(numRecords >= 5);
+    const uint8_t* pRec = pDev + BusStatusMgr::POLL_RESP_BIN_DEVICE_HEADER_SIZE;
+    for (uint32_t i = 0; i < numRecords; i++)
+    {
+        // Records are 200ms apart (first delta is 0)
+        uint32_t delta = *pRec++;
+        TEST_ASSERT_TRUE(delta != PollDataAggregator::DELTA_ESCAPE);
+        if (i == 0)
+            TEST_ASSERT_EQUAL_UINT32(0, delta);
+        else
+            TEST_ASSERT_TRUE((delta >= 190) && (delta <= 210));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedPollData.data(), pRec, expectedPollData.size());
+        pRec += expectedPollData.size();
+    }
+    TEST_ASSERT_EQUAL_UINT32(len, pRec - buf);
+
+    // Nothing new until the next poll
+    len = busI2C.getBusPollResponsesBinary(3, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT32(HEADERS_SIZE, len);
+    TEST_ASSERT_EQUAL_UINT8(0, buf[8]);
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_poll_responses_json", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // VCNL4040 on the main bus polled every 200ms
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    uint64_t endUs = virtualClock.getMicros() + 3000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Records are a 2 byte timestamp and the poll data
+    static const String jsonPrefix = "{\"0x60@0\":{\"x\":\"";
+    static const String jsonSuffix = "\",\"_o\":1,\"_t\":\"VCNL4040\"}}";
+    String pollJson = busI2C.getBusPollResponsesJson();
+    TEST_ASSERT_TRUE(pollJson.startsWith(jsonPrefix));
+    TEST_ASSERT_TRUE(pollJson.endsWith(jsonSuffix));
+    String hex = pollJson.substring(jsonPrefix.length(), pollJson.length() - jsonSuffix.length());
+    static const uint32_t RECORD_HEX_LEN = 2 * (DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + 6);
+    TEST_ASSERT_EQUAL_UINT32(0, hex.length() % RECORD_HEX_LEN);
+    TEST_ASSERT_TRUE(hex.length() / RECORD_HEX_LEN >= 5);
+    for (uint32_t pos = 0; pos < hex.length(); pos += RECORD_HEX_LEN)
+        TEST_ASSERT_EQUAL_STRING("112222333344", hex.substring(pos + 4, pos + RECORD_HEX_LEN).c_str());
+
+    // Records are only returned once
+    TEST_ASSERT_EQUAL_STRING((jsonPrefix + jsonSuffix).c_str(), busI2C.getBusPollResponsesJson().c_str());
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_status_generations", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Polled VCNL4040 and an unidentified device (not polled) on the main bus
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0);
+    SimRegDevice* pOther = pSim->addDevice(new SimRegDevice(0x55));
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    auto runForUs = [&](uint64_t runUs) {
+        uint64_t endUs = virtualClock.getMicros() + runUs;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+    };
+    runForUs(3000000);
+
+    // Both have changed since the start
+    std::vector<uint32_t> addrs;
+    uint32_t generation = busI2C.getBusElemsChangedSince(0, addrs);
+    TEST_ASSERT_EQUAL_UINT32(2, addrs.size());
+    TEST_ASSERT_EQUAL_UINT32(generation, busI2C.getStatusGeneration());
+
+    // Only the polled device changes after that
+    runForUs(1000000);
+    addrs.clear();
+    uint32_t nextGeneration = busI2C.getBusElemsChangedSince(generation, addrs);
+    TEST_ASSERT_TRUE(nextGeneration > generation);
+    TEST_ASSERT_EQUAL_UINT32(1, addrs.size());
+    TEST_ASSERT_EQUAL_UINT32(0x60, addrs[0]);
+
+    // Incremental JSON has the polled device then nothing until it changes again
+    String pollJson = busI2C.getBusPollResponsesJson(generation, generation);
+    TEST_ASSERT_TRUE(pollJson.startsWith("{\"0x60@0\":{\"x\":\""));
+    TEST_ASSERT_EQUAL_STRING("{}", busI2C.getBusPollResponsesJson(generation, generation).c_str());
+
+    // Unplugged device is changed
+    pOther->setPresent(false);
+    runForUs(3000000);
+    TEST_ASSERT_MESSAGE(sim_status_change_seen(0x55, false), "device not reported offline after unplug");
+    addrs.clear();
+    busI2C.getBusElemsChangedSince(generation, addrs);
+    TEST_ASSERT_TRUE(std::find(addrs.begin(), addrs.end(), 0x55) != addrs.end());
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_poll_snapshot", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Polled VCNL4040s on two slots
+    static const std::vector<uint8_t> expectedPollData = { 0x11, 0x22, 0x22, 0x33, 0x33, 0x44 };
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    pSim->addDevice(new SimPCA9548A(0x70));
+    sim_add_vcnl4040(*pSim, 1)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    sim_add_vcnl4040(*pSim, 2)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    uint64_t endUs = virtualClock.getMicros() + 3000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Snapshot has an entry for each element (including the extender) with the results packed in the data
+    BusI2CPollSnapshot snapshot;
+    uint32_t generation = 0;
+    TEST_ASSERT_TRUE(busI2C.getBusPollSnapshot(snapshot, 0, &generation));
+    TEST_ASSERT_EQUAL_UINT32(3, snapshot.entries().size());
+    uint32_t numPolled = 0;
+    uint32_t dataLen = 0;
+    for (const BusI2CPollSnapshot::Entry& entry : snapshot.entries())
+    {
+        TEST_ASSERT_EQUAL_UINT32(dataLen, entry.dataOffset);
+        dataLen += entry.numResults * entry.resultSize;
+        if (entry.addrAndSlot.addr != 0x60)
+            continue;
+        numPolled++;
+        TEST_ASSERT_TRUE(entry.isOnline);
+        TEST_ASSERT_TRUE(entry.numResults >= 5);
+        TEST_ASSERT_EQUAL_UINT32(DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + expectedPollData.size(), entry.resultSize);
+        for (uint32_t i = 0; i < entry.numResults; i++)
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedPollData.data(), 
+                        snapshot.getData(entry) + i * entry.resultSize + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE,
+                        expectedPollData.size());
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, numPolled);
+    TEST_ASSERT_EQUAL_UINT32(dataLen, snapshot.getDataLen());
+
+    // Results are moved so a second snapshot of changes has nothing
+    TEST_ASSERT_TRUE(busI2C.getBusPollSnapshot(snapshot, generation, &generation));
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.entries().size());
+
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_poll_decode", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Polled VCNL4040 (prox 0x2211, als 0x3322, white 0x4433 - all little endian)
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    uint64_t endUs = virtualClock.getMicros() + 2000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Decode the snapshot records into the generated struct
+    BusI2CPollSnapshot snapshot;
+    TEST_ASSERT_TRUE(busI2C.getBusPollSnapshot(snapshot));
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.entries().size());
+    const BusI2CPollSnapshot::Entry& entry = snapshot.entries()[0];
+    TEST_ASSERT_TRUE(entry.numResults >= 2);
+    poll_VCNL4040 vcnlRecs[2];
+    TEST_ASSERT_EQUAL_UINT32(2, busI2C.decodePollResponses(entry.deviceTypeIndex, snapshot.getData(entry),
+                entry.numResults * entry.resultSize, vcnlRecs, 2));
+    for (const poll_VCNL4040& rec : vcnlRecs)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0x2211, rec.prox);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 0x3322 / 10.0, rec.als);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 0x4433 / 10.0, rec.white);
+    }
+    uint16_t pollIntervalMs = vcnlRecs[1].timeMs - vcnlRecs[0].timeMs;
+    TEST_ASSERT_TRUE((pollIntervalMs >= 200) && (pollIntervalMs < 250));
+    busI2C.close();
+    delete pSim;
+
+    // Nibble aligned 20 bit values (humidity 0x80000 = 50%, temperature 0x66666 = 30C)
+    DeviceTypeRecords deviceTypeRecords;
+    const uint8_t aht20Rec[] = { 0x12, 0x34, 0x1c, 0x80, 0x00, 0x06, 0x66, 0x66 };
+    poll_AHT20 aht20;
+    TEST_ASSERT_EQUAL_UINT32(1, deviceTypeRecords.getDeviceInfo("AHT20")->pollResultDecodeFn(aht20Rec, sizeof(aht20Rec), &aht20, 1));
+    TEST_ASSERT_EQUAL_UINT16(0x1234, aht20.timeMs);
+    TEST_ASSERT_EQUAL_UINT32(0x1c, aht20.status);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 50.0, aht20.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 30.0, aht20.temperature);
+
+    // Sign bit at position 13 (0x1ff0 = -1C, 0x0190 = 25C) and limit on the number of records
+    const uint8_t mcp9808Recs[] = { 0, 0, 0x1f, 0xf0, 0, 1, 0x01, 0x90, 0, 2, 0x00, 0x00 };
+    poll_MCP9808 mcp9808[2];
+    TEST_ASSERT_EQUAL_UINT32(2, deviceTypeRecords.getDeviceInfo("MCP9808")->pollResultDecodeFn(mcp9808Recs, sizeof(mcp9808Recs), mcp9808, 2));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0, mcp9808[0].temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 25.0, mcp9808[1].temperature);
+
+    // 24 bit little endian value and signed value with offset (pressure 1016hPa, temperature 32.5C)
+    const uint8_t lps25Rec[] = { 0, 0, 0x00, 0x80, 0x3f, 0x40, 0xed };
+    poll_LPS25 lps25;
+    TEST_ASSERT_EQUAL_UINT32(1, deviceTypeRecords.getDeviceInfo("LPS25")->pollResultDecodeFn(lps25Rec, sizeof(lps25Rec), &lps25, 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1016.0, lps25.pressure);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 32.5, lps25.temperature);
+
+    // Absolute positions with masks and shifts (a partial record isn't decoded)
+    const uint8_t cap1203Recs[] = { 0, 0, 0x12, 0x05, 0, 0 };
+    poll_CAP1203 cap1203[2];
+    TEST_ASSERT_EQUAL_UINT32(1, deviceTypeRecords.getDeviceInfo("CAP1203")->pollResultDecodeFn(cap1203Recs, sizeof(cap1203Recs), cap1203, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, cap1203[0].A);
+    TEST_ASSERT_EQUAL_UINT32(0, cap1203[0].B);
+    TEST_ASSERT_EQUAL_UINT32(1, cap1203[0].C);
+    TEST_ASSERT_EQUAL_UINT32(0x1205, cap1203[0].status);
+
+    // Device types without attributes have no decoder
+    TEST_ASSERT_NULL(deviceTypeRecords.getDeviceInfo("QwiicLEDStick")->pollResultDecodeFn);
+}
+
+TEST_CASE("test_sim_poll_subscriptions", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // Polled VCNL4040 with results pushed from service() (no dispatch task)
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    sim_add_vcnl4040(*pSim, 0)->setRegs(0x08, { 0x11, 0x22, 0x33, 0x44 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false,\"subsTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+
+    // Device subscription delivering at most once a second with up to 10 results
+    uint32_t numCallbacks = 0;
+    uint32_t numResults = 0;
+    uint32_t maxBatch = 0;
+    uint64_t lastCallbackUs = 0;
+    uint64_t minCallbackIntervalUs = UINT64_MAX;
+    bool dataOk = true;
+    PollDataDispatcher::SubscriptionOptions deviceOptions;
+    deviceOptions.scope = PollDataDispatcher::SCOPE_DEVICE;
+    deviceOptions.address = BusI2CAddrAndSlot(0x60, 0).toCompositeAddrAndSlot();
+    deviceOptions.maxRateHz = 1;
+    deviceOptions.batchSize = 10;
+    uint32_t deviceSubId = busI2C.subscribePollData(deviceOptions,
+        [&](uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults, uint32_t resultSize, uint32_t num) {
+            uint64_t nowUs = virtualClock.getMicros();
+            if ((numCallbacks > 0) && (nowUs - lastCallbackUs < minCallbackIntervalUs))
+                minCallbackIntervalUs = nowUs - lastCallbackUs;
+            lastCallbackUs = nowUs;
+            numCallbacks++;
+            numResults += num;
+            maxBatch = num > maxBatch ? num : maxBatch;
+            for (uint32_t i = 0; i < num; i++)
+                dataOk = dataOk && (pResults[i * resultSize + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE] == 0x11);
+            return true;
+        });
+    TEST_ASSERT_NOT_EQUAL(0, deviceSubId);
+
+    // Subscription for all devices which never accepts results (its small queue fills and then drops)
+    PollDataDispatcher::SubscriptionOptions busyOptions;
+    busyOptions.queueBytes = 64;
+    uint32_t busySubId = busI2C.subscribePollData(busyOptions,
+        [](uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults, uint32_t resultSize, uint32_t num) {
+            return false;
+        });
+
+    // Subscription for another device type
+    PollDataDispatcher::SubscriptionOptions otherTypeOptions;
+    otherTypeOptions.scope = PollDataDispatcher::SCOPE_DEVICE_TYPE;
+    otherTypeOptions.deviceTypeIndex = 0xfffe;
+    uint32_t numOtherTypeCallbacks = 0;
+    uint32_t otherTypeSubId = busI2C.subscribePollData(otherTypeOptions,
+        [&](uint32_t address, uint16_t deviceTypeIndex, const uint8_t* pResults, uint32_t resultSize, uint32_t num) {
+            numOtherTypeCallbacks++;
+            return true;
+        });
+
+    // Run for 4s (polled at 5Hz)
+    uint64_t endUs = virtualClock.getMicros() + 4000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Rate limited batches of the device's results
+    PollDataDispatcher::SubscriptionStats stats;
+    TEST_ASSERT_TRUE(busI2C.getPollSubscriptionStats(deviceSubId, stats));
+    LOG_I(MODULE_PREFIX, "subscriptions callbacks %d results %d maxBatch %d queued %d", 
+                numCallbacks, numResults, maxBatch, stats.numQueued);
+    TEST_ASSERT_TRUE(numCallbacks >= 2);
+    TEST_ASSERT_TRUE(numResults >= 10);
+    TEST_ASSERT_TRUE(maxBatch <= 10);
+    TEST_ASSERT_TRUE(minCallbackIntervalUs >= 1000000);
+    TEST_ASSERT_TRUE(dataOk);
+    TEST_ASSERT_EQUAL_UINT32(numResults, stats.numDelivered);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numDropped);
+
+    // Backpressure only affects the busy subscriber
+    TEST_ASSERT_TRUE(busI2C.getPollSubscriptionStats(busySubId, stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numDelivered);
+    TEST_ASSERT_TRUE(stats.numDeferred > 0);
+    TEST_ASSERT_TRUE(stats.numDropped > 0);
+    TEST_ASSERT_TRUE(stats.numQueued * (PollDataDispatcher::QUEUE_ENTRY_HEADER_SIZE + 8) <= busyOptions.queueBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, numOtherTypeCallbacks);
+
+    // Unsubscribe
+    TEST_ASSERT_TRUE(busI2C.unsubscribePollData(deviceSubId));
+    TEST_ASSERT_FALSE(busI2C.unsubscribePollData(deviceSubId));
+    TEST_ASSERT_FALSE(busI2C.getPollSubscriptionStats(deviceSubId, stats));
+    TEST_ASSERT_TRUE(busI2C.unsubscribePollData(busySubId));
+    TEST_ASSERT_TRUE(busI2C.unsubscribePollData(otherTypeSubId));
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_sim_poll_us_timestamps", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // MSA301 (us delta timestamps) polled every 100ms for 2s
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    SimRegDevice* pMsa301 = pSim->addDevice(new SimRegDevice(0x26, 256, 1), 0);
+    pMsa301->setRegs(0x01, { 0x13 });
+    pMsa301->setRegs(0x02, { 0x40, 0x1f, 0xc0, 0xe0, 0x00, 0x00 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    uint64_t endUs = virtualClock.getMicros() + 2000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+
+    // Result times are worked back from the time of the last result
+    BusI2CPollSnapshot snapshot;
+    TEST_ASSERT_TRUE(busI2C.getBusPollSnapshot(snapshot));
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.entries().size());
+    const BusI2CPollSnapshot::Entry& entry = snapshot.entries()[0];
+    TEST_ASSERT_EQUAL_INT(PollTimestamp::FORMAT_US_DELTA16, entry.timestampFormat);
+    TEST_ASSERT_TRUE(entry.numResults >= 5);
+    TEST_ASSERT_TRUE(entry.lastTimeUs <= virtualClock.getMicros());
+    TEST_ASSERT_TRUE(virtualClock.getMicros() - entry.lastTimeUs < 110000);
+    std::vector<uint64_t> timesUs(entry.numResults);
+    PollTimestamp::getTimesUs(entry.timestampFormat, snapshot.getData(entry), entry.resultSize, entry.numResults,
+                entry.lastTimeUs, timesUs.data());
+    for (uint32_t i = 1; i < entry.numResults; i++)
+        TEST_ASSERT_TRUE((timesUs[i] - timesUs[i - 1] >= 100000) && (timesUs[i] - timesUs[i - 1] < 110000));
+
+    // Decoded records hold the delta (x 0x1f40 = 1g, y -0x1f40 = -1g)
+    poll_MSA301 msaRecs[2];
+    TEST_ASSERT_EQUAL_UINT32(2, busI2C.decodePollResponses(entry.deviceTypeIndex, snapshot.getData(entry),
+                entry.numResults * entry.resultSize, msaRecs, 2));
+    TEST_ASSERT_EQUAL_UINT32(timesUs[1] - timesUs[0], msaRecs[1].timeDeltaUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, msaRecs[0].x);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0, msaRecs[0].y);
+
+    // JSON has the time of the last result
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+    String pollJson = busI2C.getBusPollResponsesJson();
+    TEST_ASSERT_TRUE(pollJson.indexOf("\"_t\":\"MSA301\",\"_b\":") > 0);
+    TEST_ASSERT_TRUE(pollJson.endsWith("}}"));
+
+    // Binary blocks have a 4 byte time of the last record and records as stored
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+    uint8_t buf[256];
+    uint32_t len = busI2C.getBusPollResponsesBinary(0, buf, sizeof(buf));
+    const uint8_t* pDev = buf + BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE;
+    TEST_ASSERT_EQUAL_UINT8(BusStatusMgr::POLL_RESP_BIN_FLAG_ONLINE | BusStatusMgr::POLL_RESP_BIN_FLAG_US_DELTA, pDev[2]);
+    TEST_ASSERT_EQUAL_UINT8(6, pDev[5]);
+    uint32_t numRecs = pDev[6];
+    TEST_ASSERT_TRUE(numRecs >= 1);
+    TEST_ASSERT_EQUAL_UINT32(BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE + BusStatusMgr::POLL_RESP_BIN_DEVICE_HEADER_SIZE_US + 
+                numRecs * 8, len);
+    uint32_t lastTimeUs = Raft::getBEUint32(pDev, 7);
+    TEST_ASSERT_TRUE(virtualClock.getMicros() - lastTimeUs < 110000);
+    TEST_ASSERT_EQUAL_UINT8(0x40, pDev[BusStatusMgr::POLL_RESP_BIN_DEVICE_HEADER_SIZE_US + 2]);
+    busI2C.close();
+    delete pSim;
+}
+
+TEST_CASE("test_device_type_name_lookup", "[rafti2c_sim_tests]")
+{
+    // Every device type is found by name at its index
+    DeviceTypeRecords deviceTypeRecords;
+    uint32_t numTypes = 0;
+    for (uint16_t idx = 0; deviceTypeRecords.getDeviceInfo(idx); idx++, numTypes++)
+    {
+        const BusI2CDevTypeRecord* pRec = deviceTypeRecords.getDeviceInfo(idx);
+        uint16_t foundIdx = UINT16_MAX;
+        TEST_ASSERT_TRUE(deviceTypeRecords.getDeviceTypeIdx(pRec->deviceType, foundIdx));
+        TEST_ASSERT_EQUAL_UINT16(idx, foundIdx);
+        TEST_ASSERT_TRUE(pRec == deviceTypeRecords.getDeviceInfo(String(pRec->deviceType)));
+    }
+    TEST_ASSERT_TRUE(numTypes >= 10);
+
+    // Names which aren't device types (including near misses) aren't found
+    uint16_t foundIdx = 0;
+    TEST_ASSERT_FALSE(deviceTypeRecords.getDeviceTypeIdx("", foundIdx));
+    TEST_ASSERT_FALSE(deviceTypeRecords.getDeviceTypeIdx(nullptr, foundIdx));
+    TEST_ASSERT_NULL(deviceTypeRecords.getDeviceInfo("VCNL404"));
+    TEST_ASSERT_NULL(deviceTypeRecords.getDeviceInfo("VCNL40400"));
+    TEST_ASSERT_NULL(deviceTypeRecords.getDeviceInfo("vcnl4040"));
+    TEST_ASSERT_EQUAL_STRING("{}", deviceTypeRecords.getDevTypeInfoJsonByTypeName("NotAType", false).c_str());
+    TEST_ASSERT_TRUE(deviceTypeRecords.getDevTypeInfoJsonByTypeName("MSA301", false).startsWith("{\"name\":\"MSA301\""));
+}
+
+TEST_CASE("test_sim_detect_tree_shared_addr", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+
+    // ADXL313 and MCP9808 can both be at 0x1d - ADXL313 is checked first (one probe) and then MCP9808 (whose
+    // first check fails for a device which isn't either)
+    struct SharedAddrCase
+    {
+        const char* deviceType;
+        std::vector<std::pair<uint32_t, std::vector<uint8_t>>> regs;
+        uint32_t numProbes;
+    };
+    std::vector<SharedAddrCase> cases = {
+        { "ADXL313", { { 0x00, { 0xad, 0x1d } } }, 1 },
+        { nullptr, { { 0x00, { 0x12, 0x34 } } }, 2 },
+    };
+    for (const auto& testCase : cases)
+    {
+        BusI2CVirtualClock virtualClock(1000000);
+        ClockGuard clockGuard(&virtualClock);
+        sim_reset_status();
+        SimI2CCentral* pSim = new SimI2CCentral();
+        pSim->setVirtualClock(&virtualClock);
+        SimRegDevice* pDev = pSim->addDevice(new SimRegDevice(0x1d, 256, 1), 0);
+        for (const auto& reg : testCase.regs)
+            pDev->setRegs(reg.first, reg.second);
+        BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+        RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+        TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+        uint64_t endUs = virtualClock.getMicros() + 2000000;
+        while (virtualClock.getMicros() < endUs)
+        {
+            busI2C.workerService();
+            busI2C.service();
+            virtualClock.advanceUs(1000);
+        }
+
+        // Identified as the expected type (if any) with each probe made once
+        String devTypeInfo = busI2C.getDevTypeInfoJsonByAddr(0x1d, false);
+        if (testCase.deviceType)
+            TEST_ASSERT_MESSAGE(devTypeInfo.indexOf(testCase.deviceType) >= 0, testCase.deviceType);
+        else
+            TEST_ASSERT_TRUE((devTypeInfo.indexOf("ADXL313") < 0) && (devTypeInfo.indexOf("MCP9808") < 0));
+        TEST_ASSERT_EQUAL_UINT32(testCase.numProbes, busI2C.getNumDetectProbes());
+        busI2C.close();
+        delete pSim;
+    }
+
+    // Every address with device types has a tree and each node is a check or a leaf
+    DeviceTypeRecords deviceTypeRecords;
+    uint16_t rootIdx = deviceTypeRecords.getDetectTreeRoot(BusI2CAddrAndSlot(0x1d, 0));
+    TEST_ASSERT_NOT_NULL(deviceTypeRecords.getDetectNode(rootIdx));
+    TEST_ASSERT_EQUAL_UINT16(DEV_DETECT_NONE, deviceTypeRecords.getDetectTreeRoot(BusI2CAddrAndSlot(0x01, 0)));
+    for (uint16_t nodeIdx = 0; nodeIdx < deviceTypeRecords.getNumDetectNodes(); nodeIdx++)
+    {
+        const BusI2CDevDetectNode* pNode = deviceTypeRecords.getDetectNode(nodeIdx);
+        const uint8_t* pWriteData = nullptr;
+        if (pNode->probeIdx == DEV_DETECT_NONE)
+            TEST_ASSERT_TRUE((pNode->devTypeIdx == DEV_DETECT_NONE) || deviceTypeRecords.getDeviceInfo(pNode->devTypeIdx));
+        else
+            TEST_ASSERT_NOT_NULL(deviceTypeRecords.getDetectProbe(pNode->probeIdx, pWriteData));
+    }
+}
+
+TEST_CASE("test_sim_init_burst_writes", "[rafti2c_sim_tests]")
+{
+    struct ClockGuard
+    {
+        ClockGuard(BusI2CClock* pClock) { BusI2CClock::setClock(pClock); }
+        ~ClockGuard() { BusI2CClock::setClock(nullptr); }
+    };
+    BusI2CVirtualClock virtualClock(1000000);
+    ClockGuard clockGuard(&virtualClock);
+
+    // VL6180 init values in DeviceTypeRecords.json (one write each) - runs of consecutive registers are merged
+    static const char* VL6180_INIT_VALUES = "0x020701&0x020801&0x009600&0x0097fd&0x00e301&0x00e403&0x00e502&0x00e601"
+                "&0x00e703&0x00f502&0x00d905&0x00dbce&0x00dc03&0x00ddf8&0x009f00&0x00a33c&0x00b700&0x00bb3c&0x00b209"
+                "&0x00ca09&0x019801&0x01b017&0x01ad00&0x00ff05&0x010005&0x019905&0x01a61b&0x01ac3e&0x01a71f&0x003000"
+                "&0x001110&0x010a30&0x003f42&0x0031ff&0x004000&0x004163&0x002e01&0x001b09&0x003e31&0x001424&0x003801";
+    DeviceTypeRecords deviceTypeRecords;
+    const BusI2CDevTypeRecord* pDevTypeRec = deviceTypeRecords.getDeviceInfo("VL6180");
+    TEST_ASSERT_NOT_NULL(pDevTypeRec);
+    std::vector<BusI2CRequestRec> initReqs;
+    deviceTypeRecords.getInitBusRequests(BusI2CAddrAndSlot(0x29, 0), pDevTypeRec, initReqs);
+    TEST_ASSERT_TRUE(initReqs.size() < 41);
+
+    // Registers written by the bursts are the same as by the single writes
+    sim_reset_status();
+    SimI2CCentral* pSim = new SimI2CCentral();
+    pSim->setVirtualClock(&virtualClock);
+    SimRegDevice* pVl6180 = pSim->addDevice(new SimRegDevice(0x29, 0x210, 2), 0);
+    pVl6180->setRegs(0x0000, { 0xb4 });
+    BusI2C busI2C(simBusElemStatusCB, simBusOperationStatusCB, pSim);
+    RaftJson config = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,\"workerTask\":false}";
+    TEST_ASSERT_MESSAGE(busI2C.setup(config), "setup failed");
+    uint64_t endUs = virtualClock.getMicros() + 2000000;
+    while (virtualClock.getMicros() < endUs)
+    {
+        busI2C.workerService();
+        busI2C.service();
+        virtualClock.advanceUs(1000);
+    }
+    TEST_ASSERT_MESSAGE(busI2C.getDevTypeInfoJsonByAddr(0x29, false).indexOf("VL6180") >= 0, "VL6180 not identified");
+    std::vector<RaftJson::NameValuePair> initPairs;
+    RaftJson::extractNameValues(VL6180_INIT_VALUES, "=", "&", ";", initPairs);
+    TEST_ASSERT_EQUAL_UINT32(41, initPairs.size());
+    for (const auto& initPair : initPairs)
+    {
+        uint8_t writeData[3] = {};
+        Raft::getBytesFromHexStr(initPair.name.c_str() + 2, writeData, sizeof(writeData));
+        TEST_ASSERT_MESSAGE(writeData[2] == pVl6180->getReg((writeData[0] << 8) | writeData[1]), initPair.name.c_str());
+    }
+    busI2C.close();
+    delete pSim;
+}
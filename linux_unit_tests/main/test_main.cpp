@@ -0,0 +1,46 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unit Testing for I2C - host (linux) runner
+//
+// Usage: raft_i2c_linux_tests [tag|-tag]
+//   e.g. raft_i2c_linux_tests [rafti2c_sim_tests]
+//   a leading - excludes tests with the tag
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "esp_log.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char** argv)
+{
+    // Reduce logging noise unless verbose requested
+    const char* pVerbose = getenv("RAFT_I2C_TEST_VERBOSE");
+    esp_log_level_set("*", (pVerbose && pVerbose[0] == '1') ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    // Run registered tests
+    UNITY_BEGIN();
+    if (argc > 1)
+    {
+        bool invert = argv[1][0] == '-';
+        unity_run_tests_by_tag(invert ? argv[1] + 1 : argv[1], invert);
+    }
+    else
+    {
+        unity_run_all_tests();
+    }
+    return UNITY_END();
+}
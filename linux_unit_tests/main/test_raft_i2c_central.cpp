@@ -0,0 +1,349 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests of RaftI2CCentral against the register-level I2C peripheral model
+// The driver is built unchanged (as for ESP32-S3) with the soc/ register shims and SimI2CPeripheral
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "RaftI2CCentral.h"
+#include "SimI2CPeripheral.h"
+#include "esp_intr_alloc.h"
+
+static const char* MODULE_PREFIX = "test_raft_i2c_central";
+
+// Bus settings
+static const uint32_t TEST_PIN_SDA = 21;
+static const uint32_t TEST_PIN_SCL = 22;
+static const uint32_t TEST_BUS_FREQ = 400000;
+
+// Device with 16 bit register addresses (EEPROM-like)
+static const uint32_t TEST_DEV_ADDR = 0x50;
+static const uint32_t TEST_DEV_NUM_REGS = 8192;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::vector<uint8_t> central_test_pattern(uint32_t len, uint32_t seed)
+{
+    std::vector<uint8_t> data(len);
+    for (uint32_t i = 0; i < len; i++)
+        data[i] = (uint8_t)((i * 7 + seed * 13 + (i >> 8)) & 0xff);
+    return data;
+}
+
+static RaftI2CCentralIF::AccessResultCode central_write_regs(RaftI2CCentral& central, uint32_t regAddr,
+            const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> writeBuf = { (uint8_t)(regAddr >> 8), (uint8_t)(regAddr & 0xff) };
+    writeBuf.insert(writeBuf.end(), data.begin(), data.end());
+    uint32_t numRead = 0;
+    return central.access(TEST_DEV_ADDR, writeBuf.data(), writeBuf.size(), nullptr, 0, numRead);
+}
+
+static RaftI2CCentralIF::AccessResultCode central_read_regs(RaftI2CCentral& central, uint32_t regAddr,
+            std::vector<uint8_t>& data, uint32_t len)
+{
+    uint8_t writeBuf[2] = { (uint8_t)(regAddr >> 8), (uint8_t)(regAddr & 0xff) };
+    data.resize(len);
+    uint32_t numRead = 0;
+    RaftI2CCentralIF::AccessResultCode rslt = central.access(TEST_DEV_ADDR, writeBuf, sizeof(writeBuf), data.data(), len, numRead);
+    data.resize(numRead);
+    return rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("test_central_poll_and_short_access", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+
+    // Poll present and absent addresses
+    uint32_t numRead = 0;
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central.access(TEST_DEV_ADDR, nullptr, 0, nullptr, 0, numRead));
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_ACK_ERROR, central.access(TEST_DEV_ADDR + 1, nullptr, 0, nullptr, 0, numRead));
+
+    // Short write then read back
+    std::vector<uint8_t> data = central_test_pattern(8, 1);
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0x100, data));
+    std::vector<uint8_t> readData;
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0x100, readData, data.size()));
+    TEST_ASSERT_EQUAL(data.size(), readData.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data.data(), readData.data(), data.size());
+
+    // Read-only access continues from the register pointer
+    uint8_t readOnlyBuf[4] = {0};
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central.access(TEST_DEV_ADDR, nullptr, 0, readOnlyBuf, sizeof(readOnlyBuf), numRead));
+    TEST_ASSERT_EQUAL(sizeof(readOnlyBuf), numRead);
+    TEST_ASSERT_EQUAL(simDev.getReg(0x108), readOnlyBuf[0]);
+
+    // Short accesses fit in the command queue
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().endCmds);
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().fifoErrors);
+}
+
+TEST_CASE("test_central_long_transfers_single_transaction", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+
+    // Write and read back lengths which need several refills of the command queue (8 on ESP32-S3)
+    // including lengths either side of the 255 byte per command boundaries
+    static const uint32_t testLens[] = { 252, 253, 254, 255, 256, 257, 509, 510, 511, 1530, 1785, 1786, 4000 };
+    uint32_t seed = 0;
+    for (uint32_t len : testLens)
+    {
+        std::vector<uint8_t> data = central_test_pattern(len, seed++);
+        simPeriph.clearStats();
+        TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0x10, data));
+        const SimI2CPeripheral::Stats& writeStats = simPeriph.getStats();
+        TEST_ASSERT_EQUAL(1, writeStats.starts);
+        TEST_ASSERT_EQUAL(1, writeStats.stops);
+        TEST_ASSERT_EQUAL(len + 3, writeStats.bytesWritten);
+        for (uint32_t i = 0; i < len; i++)
+            TEST_ASSERT_EQUAL(data[i], simDev.getReg(0x10 + i));
+
+        simPeriph.clearStats();
+        std::vector<uint8_t> readData;
+        TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0x10, readData, len));
+        const SimI2CPeripheral::Stats& readStats = simPeriph.getStats();
+        TEST_ASSERT_EQUAL(1, readStats.starts);
+        TEST_ASSERT_EQUAL(1, readStats.restarts);
+        TEST_ASSERT_EQUAL(1, readStats.stops);
+        TEST_ASSERT_EQUAL(len, readStats.bytesRead);
+        TEST_ASSERT_EQUAL(0, readStats.fifoErrors);
+        TEST_ASSERT_EQUAL(len, readData.size());
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(data.data(), readData.data(), len);
+        if (len > 1000)
+            TEST_ASSERT_TRUE(readStats.endCmds > 0);
+        LOG_I(MODULE_PREFIX, "len %d writeEnds %d readEnds %d readISRs %d", len, writeStats.endCmds, readStats.endCmds, readStats.isrCalls);
+    }
+
+    // Long read-only access
+    std::vector<uint8_t> readOnlyData(3000);
+    uint32_t numRead = 0;
+    uint8_t regAddr[2] = { 0, 0x10 };
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central.access(TEST_DEV_ADDR, regAddr, sizeof(regAddr), nullptr, 0, numRead));
+    simPeriph.clearStats();
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central.access(TEST_DEV_ADDR, nullptr, 0, readOnlyData.data(), readOnlyData.size(), numRead));
+    TEST_ASSERT_EQUAL(readOnlyData.size(), numRead);
+    TEST_ASSERT_EQUAL(1, simPeriph.getStats().starts);
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().restarts);
+    for (uint32_t i = 0; i < readOnlyData.size(); i++)
+        TEST_ASSERT_EQUAL(simDev.getReg(0x10 + i), readOnlyData[i]);
+}
+
+TEST_CASE("test_central_long_transfer_nack", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+
+    // A long access to an absent device stops after the address NACK
+    simDev.setPresent(false);
+    std::vector<uint8_t> data = central_test_pattern(2000, 5);
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_ACK_ERROR, central_write_regs(central, 0, data));
+    TEST_ASSERT_EQUAL(1, simPeriph.getStats().nacks);
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().endCmds);
+
+    // And the bus is usable afterwards
+    simDev.setPresent(true);
+    std::vector<uint8_t> readData;
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0, readData, 600));
+    TEST_ASSERT_EQUAL(600, readData.size());
+}
+
+TEST_CASE("test_central_bus_timing", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+
+    // Bit time from the clock registers set by the driver
+    TEST_ASSERT_EQUAL(1000000000 / TEST_BUS_FREQ, simPeriph.getBitTimeNs());
+
+    // Poll is start, address byte and stop
+    uint32_t numRead = 0;
+    simPeriph.clearStats();
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central.access(TEST_DEV_ADDR, nullptr, 0, nullptr, 0, numRead));
+    TEST_ASSERT_EQUAL(11 * simPeriph.getBitTimeNs(), simPeriph.getStats().busTimeNs);
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().idleGapCount);
+
+    // Long write with an ISR which keeps up - the bus never waits
+    std::vector<uint8_t> data = central_test_pattern(4000, 3);
+    simPeriph.setIsrTiming(0, 0);
+    simPeriph.clearStats();
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0, data));
+    TEST_ASSERT_EQUAL(0, simPeriph.getStats().idleGapNs);
+    TEST_ASSERT_EQUAL((4003 * 9 + 2) * (uint64_t)simPeriph.getBitTimeNs(), simPeriph.getStats().busTimeNs);
+
+    // ISR latency longer than the time to send the bytes left in the FIFO leaves gaps on the bus
+    simPeriph.setIsrTiming(200000, 5000);
+    simPeriph.clearStats();
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0, data));
+    const SimI2CPeripheral::Stats& stats = simPeriph.getStats();
+    TEST_ASSERT_TRUE(stats.idleGapCount > 0);
+    TEST_ASSERT_TRUE(stats.idleGapNs > 0);
+    TEST_ASSERT_TRUE(stats.maxIdleGapNs <= 205000);
+    for (uint32_t i = 0; i < data.size(); i++)
+        TEST_ASSERT_EQUAL(data[i], simDev.getReg(i));
+    LOG_I(MODULE_PREFIX, "4000B write isrCalls %d idleGaps %d idleGapUs %d busTimeUs %d", stats.isrCalls,
+                stats.idleGapCount, (int)(stats.idleGapNs / 1000), (int)(stats.busTimeNs / 1000));
+}
+
+TEST_CASE("test_central_set_bus_frequency", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, 100000));
+    uint32_t bitTimeNs100k = simPeriph.getBitTimeNs();
+    TEST_ASSERT_EQUAL(10000, bitTimeNs100k);
+
+    // Switch between frequencies (more than the timing cache holds) and check each access runs at the new speed
+    static const uint32_t freqs[] = { 400000, 100000, 1000000, 200000, 50000, 400000 };
+    std::vector<uint8_t> data = central_test_pattern(8, 5);
+    for (uint32_t busFreq : freqs)
+    {
+        TEST_ASSERT_TRUE(central.setBusFrequency(busFreq));
+        TEST_ASSERT_EQUAL(1000000000 / busFreq, simPeriph.getBitTimeNs());
+        simPeriph.clearStats();
+        TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0x10, data));
+        TEST_ASSERT_EQUAL((11 * 9 + 2) * (uint64_t)simPeriph.getBitTimeNs(), simPeriph.getStats().busTimeNs);
+        for (uint32_t i = 0; i < data.size(); i++)
+            TEST_ASSERT_EQUAL(data[i], simDev.getReg(0x10 + i));
+    }
+
+    // Invalid frequency is rejected
+    TEST_ASSERT_FALSE(central.setBusFrequency(0));
+    TEST_ASSERT_EQUAL(1000000000 / 400000, simPeriph.getBitTimeNs());
+}
+
+TEST_CASE("test_central_adaptive_timeouts", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+
+    // Reading 6 bytes is 10 bytes on the bus (250us at 400kHz) - conservative timeout allows 250us per byte
+    // of clock stretching plus 500us
+    static const uint32_t BIT_TIME_US = 250;
+    static const uint32_t CONSERVATIVE_US = BIT_TIME_US + 500 + 10 * 250;
+    TEST_ASSERT_EQUAL(CONSERVATIVE_US, central.getAccessTimeoutUs(TEST_DEV_ADDR, 2, 6));
+
+    // Timeout tightens once enough transactions have been seen (other addresses are unaffected)
+    std::vector<uint8_t> readData;
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0, readData, 6));
+    uint32_t adaptiveUs = central.getAccessTimeoutUs(TEST_DEV_ADDR, 2, 6);
+    TEST_ASSERT_TRUE(adaptiveUs >= BIT_TIME_US + 250);
+    TEST_ASSERT_TRUE(adaptiveUs < CONSERVATIVE_US);
+    TEST_ASSERT_EQUAL(CONSERVATIVE_US, central.getAccessTimeoutUs(TEST_DEV_ADDR + 1, 2, 6));
+
+    // Device holding the bus times out after the adaptive timeout and the bus time lost is counted
+    simDev.setHoldsBus(true);
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_SW_TIME_OUT, central_read_regs(central, 0, readData, 6));
+    RaftI2CCentralIF::I2CStats stats = central.getStats();
+    TEST_ASSERT_EQUAL(1, stats.softwareTimeOutCount);
+    TEST_ASSERT_TRUE(stats.timeoutBusTimeUs >= adaptiveUs);
+
+    // After 8 timeouts in a row one access probes with the conservative timeout then the tight timeout is used again
+    for (uint32_t i = 1; i < 8; i++)
+        TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_SW_TIME_OUT, central_read_regs(central, 0, readData, 6));
+    TEST_ASSERT_EQUAL(CONSERVATIVE_US, central.getAccessTimeoutUs(TEST_DEV_ADDR, 2, 6));
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_SW_TIME_OUT, central_read_regs(central, 0, readData, 6));
+    TEST_ASSERT_TRUE(central.getStats().timeoutBusTimeUs >= 8 * (uint64_t)adaptiveUs + CONSERVATIVE_US);
+    TEST_ASSERT_EQUAL(adaptiveUs, central.getAccessTimeoutUs(TEST_DEV_ADDR, 2, 6));
+
+    // Device released - the engine is reset and accesses succeed
+    simDev.setHoldsBus(false);
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0, readData, 6));
+    TEST_ASSERT_EQUAL(6, readData.size());
+
+    // Disabled
+    central.setAdaptiveTimeouts(false);
+    TEST_ASSERT_EQUAL(CONSERVATIVE_US, central.getAccessTimeoutUs(TEST_DEV_ADDR, 2, 6));
+}
+
+TEST_CASE("test_central_submit_poll_wait", "[rafti2c_central_tests]")
+{
+    SimI2CPeripheral simPeriph(I2C0, ETS_I2C_EXT0_INTR_SOURCE);
+    SimRegDevice simDev(TEST_DEV_ADDR, TEST_DEV_NUM_REGS, 2);
+    simPeriph.addDevice(&simDev);
+    RaftI2CCentral central;
+    TEST_ASSERT_TRUE(central.init(0, TEST_PIN_SDA, TEST_PIN_SCL, TEST_BUS_FREQ));
+    std::vector<uint8_t> data = central_test_pattern(16, 7);
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_write_regs(central, 0x200, data));
+
+    // Two register reads are queued (the second is staged while the first runs) and a third is refused
+    uint8_t regAddrs[2][2] = { { 0x02, 0x00 }, { 0x02, 0x08 } };
+    uint8_t readBufs[2][8] = {};
+    std::vector<uint32_t> completedAddrIdxs;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        RaftI2CCentralIF::Transaction trans;
+        trans.address = TEST_DEV_ADDR;
+        trans.pWriteBuf = regAddrs[i];
+        trans.numToWrite = 2;
+        trans.pReadBuf = readBufs[i];
+        trans.numToRead = 8;
+        TEST_ASSERT_TRUE(central.submit(trans, [&completedAddrIdxs, i](const RaftI2CCentralIF::Transaction& doneTrans) {
+            TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, doneTrans.rslt);
+            TEST_ASSERT_EQUAL(8, doneTrans.numRead);
+            completedAddrIdxs.push_back(i);
+        }));
+    }
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::TRANSACTION_QUEUE_DEPTH, central.getNumQueued());
+    RaftI2CCentralIF::Transaction extraTrans;
+    extraTrans.address = TEST_DEV_ADDR;
+    TEST_ASSERT_FALSE(central.submit(extraTrans, nullptr));
+
+    // Completions are delivered in submission order
+    while (central.getNumQueued() > 0)
+        central.waitAny(UINT32_MAX);
+    TEST_ASSERT_EQUAL(2, completedAddrIdxs.size());
+    TEST_ASSERT_EQUAL(0, completedAddrIdxs[0]);
+    TEST_ASSERT_EQUAL(1, completedAddrIdxs[1]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data.data(), readBufs[0], 8);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data.data() + 8, readBufs[1], 8);
+    TEST_ASSERT_EQUAL(0, central.poll());
+
+    // Synchronous access waits behind a submitted transaction
+    bool isDone = false;
+    RaftI2CCentralIF::Transaction writeTrans;
+    std::vector<uint8_t> writeBuf = { 0x03, 0x00, 0xa5 };
+    writeTrans.address = TEST_DEV_ADDR;
+    writeTrans.pWriteBuf = writeBuf.data();
+    writeTrans.numToWrite = writeBuf.size();
+    TEST_ASSERT_TRUE(central.submit(writeTrans, [&isDone](const RaftI2CCentralIF::Transaction& doneTrans) {
+        isDone = doneTrans.rslt == RaftI2CCentralIF::ACCESS_RESULT_OK;
+    }));
+    std::vector<uint8_t> readData;
+    TEST_ASSERT_EQUAL(RaftI2CCentralIF::ACCESS_RESULT_OK, central_read_regs(central, 0x300, readData, 1));
+    TEST_ASSERT_TRUE(isDone);
+    TEST_ASSERT_EQUAL(0xa5, readData[0]);
+    TEST_ASSERT_EQUAL(0, central.getNumQueued());
+}
@@ -0,0 +1,311 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C Bus capture replay (host)
+//
+// Replays a bus session captured with RaftI2CCentralCapture (e.g. from a field rig) against the current
+// BusI2C stack using a simulated central which responds as the captured bus did. The replayed session is
+// captured in the same way and transaction counts, discovery (scan) times and poll timing are compared with
+// the original. Differences beyond the tolerance are reported as regressions (and the exit code is 1).
+//
+// Usage: raft_i2c_linux_replay <capture.bin> [--config <busConfig.json>] [--tolerance <pct>] [-o <report.json>]
+//        raft_i2c_linux_replay --generate <capture.bin>
+//
+// --generate makes a capture from a simulated rig (bus extender, slot power controller, devices on slots
+// and the main bus and a hot-plug) which can then be replayed
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "RaftJson.h"
+#include "BusI2C.h"
+#include "BusI2CClock.h"
+#include "RaftI2CCentralCapture.h"
+#include "SimI2CCentral.h"
+#include "SimReplayCentral.h"
+#include "I2CCapture.h"
+#include "esp_log.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Settings
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Bus config used when none is given (matches the generated rig)
+static const char* REPLAY_DEFAULT_BUS_CONFIG = "{\"sdaPin\":\"21\",\"sclPin\":\"22\",\"i2cFreq\":400000,"
+            "\"pwr\":{\"ctrl\":[{\"dev\":\"PCA9535\",\"addr\":\"0x1d\",\"minSlotPlus1\":1,\"numSlots\":8}]}}";
+
+// Generated rig
+static const uint64_t REPLAY_GENERATE_DURATION_US = 30ULL * 1000000;
+static const uint64_t REPLAY_GENERATE_HOTPLUG_US = 10ULL * 1000000;
+static const std::vector<uint8_t> REPLAY_VCNL4040_ID = {0x86, 0x01};
+
+// Step and max capture size
+static const uint64_t REPLAY_STEP_US = BusI2C::I2C_BUS_LOOP_YIELD_MS * 1000;
+static const uint32_t REPLAY_MAX_CAPTURE_BYTES = 16 * 1024 * 1024;
+
+// Default tolerances
+static const double REPLAY_DEFAULT_TOLERANCE_PCT = 10;
+static const double REPLAY_TIME_SLACK_MS = 50;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static BusElemStatusCB replayBusElemStatusCB = [](BusBase& bus, const std::vector<BusElemAddrAndStatus>& statusChanges) {
+};
+static BusOperationStatusCB replayBusOperationStatusCB = [](BusBase& bus, BusOperationStatus busOperationStatus) {
+};
+
+static bool replayReadFile(const char* pFileName, std::string& contents)
+{
+    FILE* pFile = fopen(pFileName, "r");
+    if (!pFile)
+        return false;
+    char buf[1024];
+    size_t numRead = 0;
+    while ((numRead = fread(buf, 1, sizeof(buf), pFile)) > 0)
+        contents.append(buf, numRead);
+    fclose(pFile);
+    return true;
+}
+
+/// @brief Run a bus against a central until a time
+static void replayRunBus(RaftI2CCentralIF* pCentral, const char* pBusConfig, BusI2CVirtualClock& virtualClock,
+            uint64_t untilUs, std::function<void(uint64_t)> stepFn)
+{
+    // The bus is stepped here rather than by its worker task
+    String busConfig = pBusConfig;
+    busConfig.trim();
+    int closeIdx = busConfig.lastIndexOf('}');
+    bool hasMembers = busConfig.substring(0, closeIdx).indexOf(':') >= 0;
+    busConfig = busConfig.substring(0, closeIdx) + (hasMembers ? "," : "") + "\"workerTask\":false}";
+
+    BusI2C* pBus = new BusI2C(replayBusElemStatusCB, replayBusOperationStatusCB, pCentral);
+    pBus->setup(RaftJson(busConfig));
+    while (virtualClock.getMicros() < untilUs)
+    {
+        if (stepFn)
+            stepFn(virtualClock.getMicros());
+        pBus->workerService();
+        pBus->service();
+        virtualClock.advanceUs(REPLAY_STEP_US);
+    }
+    delete pBus;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Generate a capture from a simulated rig
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int replayGenerate(const char* pCaptureFile)
+{
+    BusI2CVirtualClock virtualClock(1000000);
+    BusI2CClock::setClock(&virtualClock);
+
+    // Rig
+    SimI2CCentral sim;
+    sim.setVirtualClock(&virtualClock);
+    sim.addDevice(new SimPCA9548A(I2C_BUS_EXTENDER_BASE));
+    sim.addDevice(new SimPCA9535(0x1d, 1, 8));
+    sim.addDevice(new SimRegDevice(0x55));
+    sim.addDevice(new SimRegDevice(0x60), 2)->setRegs(0x0c, REPLAY_VCNL4040_ID);
+    SimRegDevice* pHotplugDev = sim.addDevice(new SimRegDevice(0x60), 5);
+    pHotplugDev->setRegs(0x0c, REPLAY_VCNL4040_ID);
+    pHotplugDev->setPresent(false);
+
+    // Capture
+    RaftI2CCentralCapture capture(&sim, false, REPLAY_MAX_CAPTURE_BYTES);
+    uint64_t startUs = virtualClock.getMicros();
+    replayRunBus(&capture, REPLAY_DEFAULT_BUS_CONFIG, virtualClock, startUs + REPLAY_GENERATE_DURATION_US,
+            [&](uint64_t timeNowUs) {
+                if (timeNowUs - startUs >= REPLAY_GENERATE_HOTPLUG_US)
+                    pHotplugDev->setPresent(true);
+            });
+    BusI2CClock::setClock(nullptr);
+
+    std::vector<uint8_t> captureData;
+    uint32_t numRecs = capture.getCapture(captureData, false);
+    if (!I2CCapture::save(pCaptureFile, captureData))
+    {
+        fprintf(stderr, "Failed to write %s\n", pCaptureFile);
+        return 1;
+    }
+    fprintf(stderr, "Generated capture %s with %u accesses\n", pCaptureFile, numRecs);
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compare summaries
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void replayAddRegression(std::string& json, uint32_t& numRegressions, const char* pElem, const char* pMetric,
+            double captureVal, double replayVal)
+{
+    numRegressions++;
+    char buf[200];
+    snprintf(buf, sizeof(buf), "%s{\"elem\":\"%s\",\"metric\":\"%s\",\"capture\":%.2f,\"replay\":%.2f}",
+                json.empty() ? "" : ",", pElem, pMetric, captureVal, replayVal);
+    json += buf;
+}
+
+static std::string replayCompare(const I2CCaptureSummary& orig, const I2CCaptureSummary& replay, double tolerancePct,
+            uint32_t& numRegressions)
+{
+    std::string json;
+    double tol = tolerancePct / 100;
+    numRegressions = 0;
+    auto isLater = [tol](double origMs, double replayMs) {
+        return replayMs > origMs * (1 + tol) + REPLAY_TIME_SLACK_MS;
+    };
+
+    // Bus totals
+    if ((replay.numAccesses > orig.numAccesses * (1 + tol)) || (replay.numAccesses < orig.numAccesses * (1 - tol)))
+        replayAddRegression(json, numRegressions, "bus", "accesses", orig.numAccesses, replay.numAccesses);
+    if (isLater(orig.discoveryMs, replay.discoveryMs))
+        replayAddRegression(json, numRegressions, "bus", "discoveryMs", orig.discoveryMs, replay.discoveryMs);
+
+    // Elements seen in the original
+    for (const auto& elemIt : orig.elems)
+    {
+        const I2CCaptureSummary::ElemSummary& origElem = elemIt.second;
+        if ((origElem.numAcked == 0) || I2CCaptureSlotTracker::isExtenderAddr(origElem.addr))
+            continue;
+        char elemName[20];
+        snprintf(elemName, sizeof(elemName), "0x%02x@%u", origElem.addr, origElem.slotPlus1);
+        auto replayIt = replay.elems.find(elemIt.first);
+        if ((replayIt == replay.elems.end()) || (replayIt->second.numAcked == 0))
+        {
+            replayAddRegression(json, numRegressions, elemName, "missing", origElem.numAcked, 0);
+            continue;
+        }
+        const I2CCaptureSummary::ElemSummary& replayElem = replayIt->second;
+        if (isLater(origElem.firstAckMs, replayElem.firstAckMs))
+            replayAddRegression(json, numRegressions, elemName, "firstAckMs", origElem.firstAckMs, replayElem.firstAckMs);
+        if (origElem.numPolls == 0)
+            continue;
+        if (replayElem.numPolls < origElem.numPolls * (1 - tol))
+            replayAddRegression(json, numRegressions, elemName, "polls", origElem.numPolls, replayElem.numPolls);
+        if (replayElem.pollIntervalMeanMs > origElem.pollIntervalMeanMs * (1 + tol))
+            replayAddRegression(json, numRegressions, elemName, "pollMeanMs", origElem.pollIntervalMeanMs, replayElem.pollIntervalMeanMs);
+    }
+    return json;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Replay a capture
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int replayCapture(const char* pCaptureFile, const char* pBusConfig, double tolerancePct, const char* pOutFile)
+{
+    // Original
+    I2CCapture origCapture;
+    if (!origCapture.load(pCaptureFile))
+    {
+        fprintf(stderr, "Failed to load capture %s\n", pCaptureFile);
+        return 1;
+    }
+    I2CCaptureSummary origSummary;
+    origSummary.analyse(origCapture);
+
+    // Replay starting at the time of the original
+    BusI2CVirtualClock virtualClock(origCapture.getStartUs());
+    BusI2CClock::setClock(&virtualClock);
+    SimReplayCentral replayCentral(origCapture);
+    replayCentral.setVirtualClock(&virtualClock);
+    RaftI2CCentralCapture replayCapture(&replayCentral, false, REPLAY_MAX_CAPTURE_BYTES);
+    replayRunBus(&replayCapture, pBusConfig, virtualClock, origCapture.getEndUs(), nullptr);
+    BusI2CClock::setClock(nullptr);
+
+    // Replayed
+    std::vector<uint8_t> replayData;
+    replayCapture.getCapture(replayData, false);
+    I2CCapture replayedCapture;
+    replayedCapture.parse(replayData);
+    I2CCaptureSummary replaySummary;
+    replaySummary.analyse(replayedCapture);
+
+    // Compare
+    uint32_t numRegressions = 0;
+    std::string regressionsJson = replayCompare(origSummary, replaySummary, tolerancePct, numRegressions);
+    char buf[200];
+    snprintf(buf, sizeof(buf), "{\"tolerancePct\":%.1f,\"overheadUs\":%u,\"unmatched\":%u,\"dropped\":%u,",
+                tolerancePct, replayCentral.getOverheadUs(), replayCentral.getUnmatchedCount(), origCapture.getNumDropped());
+    std::string json = buf;
+    json += "\"capture\":" + origSummary.toJson() + ",\"replay\":" + replaySummary.toJson() +
+                ",\"regressions\":[" + regressionsJson + "]}";
+
+    // Output
+    if (pOutFile)
+    {
+        FILE* pFile = fopen(pOutFile, "w");
+        if (!pFile)
+        {
+            fprintf(stderr, "Failed to open %s\n", pOutFile);
+            return 1;
+        }
+        fprintf(pFile, "%s\n", json.c_str());
+        fclose(pFile);
+    }
+    else
+    {
+        printf("%s\n", json.c_str());
+    }
+    fprintf(stderr, "Replayed %u accesses (original %u) regressions %u\n", replaySummary.numAccesses,
+                origSummary.numAccesses, numRegressions);
+    return numRegressions == 0 ? 0 : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    const char* pCaptureFile = nullptr;
+    const char* pGenerateFile = nullptr;
+    const char* pConfigFile = nullptr;
+    const char* pOutFile = nullptr;
+    double tolerancePct = REPLAY_DEFAULT_TOLERANCE_PCT;
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--generate") == 0) && (i + 1 < argc))
+            pGenerateFile = argv[++i];
+        else if ((strcmp(argv[i], "--config") == 0) && (i + 1 < argc))
+            pConfigFile = argv[++i];
+        else if ((strcmp(argv[i], "--tolerance") == 0) && (i + 1 < argc))
+            tolerancePct = atof(argv[++i]);
+        else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+            pOutFile = argv[++i];
+        else
+            pCaptureFile = argv[i];
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    if (pGenerateFile)
+        return replayGenerate(pGenerateFile);
+    if (!pCaptureFile)
+    {
+        fprintf(stderr, "Usage: %s <capture.bin> [--config <busConfig.json>] [--tolerance <pct>] [-o <report.json>]\n"
+                    "       %s --generate <capture.bin>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    // Bus config
+    std::string busConfig = REPLAY_DEFAULT_BUS_CONFIG;
+    if (pConfigFile)
+    {
+        busConfig.clear();
+        if (!replayReadFile(pConfigFile, busConfig))
+        {
+            fprintf(stderr, "Failed to read config %s\n", pConfigFile);
+            return 1;
+        }
+    }
+    return replayCapture(pCaptureFile, busConfig.c_str(), tolerancePct, pOutFile);
+}
@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ESP-IDF shims for host (linux) builds - timer, logging and GPIO
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Timer
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const std::chrono::steady_clock::time_point s_hostStartTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_hostStartTime).count();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Logging
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static esp_log_level_t s_hostLogLevel = ESP_LOG_INFO;
+static std::mutex s_hostLogMutex;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+    // Per-tag levels are not supported on host
+    s_hostLogLevel = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+    if (level > s_hostLogLevel)
+        return;
+    std::lock_guard<std::mutex> lock(s_hostLogMutex);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPIO
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int s_hostGpioOutputLevels[GPIO_NUM_MAX] = {};
+static int s_hostGpioInputLevels[GPIO_NUM_MAX] = {};
+static bool s_hostGpioInputLevelSet[GPIO_NUM_MAX] = {};
+
+static bool isValidGpio(gpio_num_t gpioNum)
+{
+    return (gpioNum >= 0) && (gpioNum < GPIO_NUM_MAX);
+}
+
+esp_err_t gpio_config(const gpio_config_t* pGPIOConfig)
+{
+    return pGPIOConfig ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpioNum)
+{
+    if (!isValidGpio(gpioNum))
+        return ESP_ERR_INVALID_ARG;
+    s_hostGpioOutputLevels[gpioNum] = 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpioNum, gpio_mode_t mode)
+{
+    return isValidGpio(gpioNum) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpioNum, uint32_t level)
+{
+    if (!isValidGpio(gpioNum))
+        return ESP_ERR_INVALID_ARG;
+    s_hostGpioOutputLevels[gpioNum] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpioNum)
+{
+    if (!isValidGpio(gpioNum))
+        return 0;
+    // Inputs are pulled-up unless a simulation is driving them
+    return s_hostGpioInputLevelSet[gpioNum] ? s_hostGpioInputLevels[gpioNum] : 1;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpioNum, gpio_pull_mode_t pull)
+{
+    return isValidGpio(gpioNum) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_pullup_en(gpio_num_t gpioNum)
+{
+    return isValidGpio(gpioNum) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void hostGpioSetInputLevel(gpio_num_t gpioNum, int level)
+{
+    if (!isValidGpio(gpioNum))
+        return;
+    s_hostGpioInputLevels[gpioNum] = level ? 1 : 0;
+    s_hostGpioInputLevelSet[gpioNum] = true;
+}
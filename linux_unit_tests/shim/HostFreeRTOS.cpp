@@ -0,0 +1,255 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// FreeRTOS shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Host task record
+struct HostTask
+{
+    std::string name;
+    std::mutex notifyMutex;
+    std::condition_variable notifyCV;
+    uint32_t notifyCount = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Host semaphore record
+struct HostSemaphore
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count = 0;
+    UBaseType_t maxCount = 1;
+};
+
+// Task records are never freed as handles may be notified after the task function returns
+static std::mutex s_hostTasksMutex;
+static std::vector<std::unique_ptr<HostTask>> s_hostTasks;
+static thread_local HostTask* s_pCurrentHostTask = nullptr;
+
+// Yield hook
+static HostYieldHookFn s_hostYieldHookFn = nullptr;
+static void* s_hostYieldHookArg = nullptr;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get current task record (creating one for threads not started by xTaskCreate)
+static HostTask* getCurrentHostTask()
+{
+    if (!s_pCurrentHostTask)
+    {
+        std::lock_guard<std::mutex> lock(s_hostTasksMutex);
+        s_hostTasks.push_back(std::unique_ptr<HostTask>(new HostTask()));
+        s_pCurrentHostTask = s_hostTasks.back().get();
+        s_pCurrentHostTask->name = "main";
+    }
+    return s_pCurrentHostTask;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Convert ticks to a chrono duration
+static std::chrono::milliseconds ticksToDuration(TickType_t ticks)
+{
+    return std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tasks
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+            void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask, BaseType_t xCoreID)
+{
+    // Create task record
+    HostTask* pTask = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s_hostTasksMutex);
+        s_hostTasks.push_back(std::unique_ptr<HostTask>(new HostTask()));
+        pTask = s_hostTasks.back().get();
+        pTask->name = pcName ? pcName : "";
+    }
+
+    // Handle is set before the thread starts so the task can compare against it
+    if (pvCreatedTask)
+        *pvCreatedTask = pTask;
+
+    // Start thread (core affinity and priority are not modelled)
+    std::thread([pTask, pvTaskCode, pvParameters]() {
+        s_pCurrentHostTask = pTask;
+        pvTaskCode(pvParameters);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+            void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    // Deleting the current task is handled by the task function returning
+    // Deleting another task is not supported on host
+}
+
+void hostSetYieldHook(HostYieldHookFn hookFn, void* pArg)
+{
+    s_hostYieldHookArg = pArg;
+    s_hostYieldHookFn = hookFn;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    if (s_hostYieldHookFn)
+        s_hostYieldHookFn(s_hostYieldHookArg);
+    if (xTicksToDelay == 0)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(ticksToDuration(xTicksToDelay));
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+void taskYIELD()
+{
+    if (s_hostYieldHookFn)
+        s_hostYieldHookFn(s_hostYieldHookArg);
+    std::this_thread::yield();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return getCurrentHostTask();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Notifications
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    if (!xTaskToNotify)
+        return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(xTaskToNotify->notifyMutex);
+        xTaskToNotify->notifyCount++;
+    }
+    xTaskToNotify->notifyCV.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    HostTask* pTask = getCurrentHostTask();
+    std::unique_lock<std::mutex> lock(pTask->notifyMutex);
+    if ((pTask->notifyCount == 0) && (xTicksToWait != 0))
+    {
+        if (xTicksToWait == portMAX_DELAY)
+            pTask->notifyCV.wait(lock, [pTask]{ return pTask->notifyCount != 0; });
+        else
+            pTask->notifyCV.wait_for(lock, ticksToDuration(xTicksToWait), [pTask]{ return pTask->notifyCount != 0; });
+    }
+    uint32_t count = pTask->notifyCount;
+    if (count != 0)
+        pTask->notifyCount = xClearCountOnExit ? 0 : count - 1;
+    return count;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Semaphores
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    HostSemaphore* pSem = new HostSemaphore();
+    pSem->maxCount = uxMaxCount;
+    pSem->count = uxInitialCount;
+    return pSem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    delete xSemaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait)
+{
+    if (!xSemaphore)
+        return pdFALSE;
+    std::unique_lock<std::mutex> lock(xSemaphore->mutex);
+    if (xSemaphore->count == 0)
+    {
+        if (xTicksToWait == 0)
+            return pdFALSE;
+        if (xTicksToWait == portMAX_DELAY)
+            xSemaphore->cv.wait(lock, [xSemaphore]{ return xSemaphore->count != 0; });
+        else if (!xSemaphore->cv.wait_for(lock, ticksToDuration(xTicksToWait), [xSemaphore]{ return xSemaphore->count != 0; }))
+            return pdFALSE;
+    }
+    xSemaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    if (!xSemaphore)
+        return pdFALSE;
+    {
+        std::lock_guard<std::mutex> lock(xSemaphore->mutex);
+        if (xSemaphore->count >= xSemaphore->maxCount)
+            return pdFALSE;
+        xSemaphore->count++;
+    }
+    xSemaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreTake(xSemaphore, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreGive(xSemaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+    if (!xSemaphore)
+        return 0;
+    std::lock_guard<std::mutex> lock(xSemaphore->mutex);
+    return xSemaphore->count;
+}
@@ -0,0 +1,76 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Peripheral register shim for host (linux) builds
+//
+// Registers in the soc/ shim headers are unions of HostRegField members which all share the register's 32 bits
+// so target code using bitfield syntax (e.g. I2C0.ctr.trans_start = 1) compiles unchanged. Each access calls a
+// hook which forwards accesses within an attached register block to a peripheral model - accesses to copies of
+// registers in local variables are not forwarded
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Peripheral model which handles accesses to a register block
+class HostRegHandler
+{
+public:
+    virtual ~HostRegHandler()
+    {
+    }
+
+    /// @brief Called before a register is read
+    /// @param regOffset byte offset of the register in the block
+    virtual void onRegRead(uint32_t regOffset) = 0;
+
+    /// @brief Called after a register (or a field of a register) is written
+    /// @param regOffset byte offset of the register in the block
+    /// @param fieldMask bits of the register written
+    virtual void onRegWrite(uint32_t regOffset, uint32_t fieldMask) = 0;
+};
+
+/// @brief Attach a model to a register block
+void hostRegAttach(void* pBlock, size_t blockSize, HostRegHandler* pHandler);
+
+/// @brief Detach the model from a register block
+void hostRegDetach(void* pBlock);
+
+// Hooks called on register access
+void hostRegRead(const void* pReg);
+void hostRegWrite(void* pReg, uint32_t fieldMask);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Register field (occupies the full register so fields can be members of the same union)
+template<uint32_t LSB, uint32_t WIDTH>
+struct HostRegField
+{
+    static const uint32_t FIELD_MASK = (uint32_t)(((1ULL << WIDTH) - 1) << LSB);
+
+    // Register value
+    uint32_t _regVal;
+
+    operator uint32_t() const
+    {
+        hostRegRead(this);
+        return (_regVal & FIELD_MASK) >> LSB;
+    }
+    HostRegField& operator=(uint32_t fieldVal)
+    {
+        _regVal = (_regVal & ~FIELD_MASK) | ((fieldVal << LSB) & FIELD_MASK);
+        hostRegWrite(this, FIELD_MASK);
+        return *this;
+    }
+    HostRegField& operator=(const HostRegField& other)
+    {
+        return *this = (uint32_t)other;
+    }
+};
+
+/// @brief Whole register value
+typedef HostRegField<0, 32> HostRegVal;
@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Peripheral register and interrupt shims for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include "HostReg.h"
+#include "esp_intr_alloc.h"
+#include "soc/i2c_struct.h"
+
+// I2C peripheral register blocks
+i2c_dev_t I2C0;
+i2c_dev_t I2C1;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Register blocks
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct HostRegBlock
+{
+    uint8_t* pBlock;
+    size_t blockSize;
+    HostRegHandler* pHandler;
+};
+static std::vector<HostRegBlock> s_hostRegBlocks;
+
+void hostRegAttach(void* pBlock, size_t blockSize, HostRegHandler* pHandler)
+{
+    hostRegDetach(pBlock);
+    s_hostRegBlocks.push_back({(uint8_t*)pBlock, blockSize, pHandler});
+}
+
+void hostRegDetach(void* pBlock)
+{
+    for (auto it = s_hostRegBlocks.begin(); it != s_hostRegBlocks.end(); ++it)
+    {
+        if (it->pBlock == pBlock)
+        {
+            s_hostRegBlocks.erase(it);
+            return;
+        }
+    }
+}
+
+static HostRegBlock* findRegBlock(const void* pReg)
+{
+    const uint8_t* pAddr = (const uint8_t*)pReg;
+    for (HostRegBlock& block : s_hostRegBlocks)
+    {
+        if ((pAddr >= block.pBlock) && (pAddr < block.pBlock + block.blockSize))
+            return &block;
+    }
+    return nullptr;
+}
+
+void hostRegRead(const void* pReg)
+{
+    HostRegBlock* pBlock = findRegBlock(pReg);
+    if (pBlock)
+        pBlock->pHandler->onRegRead((const uint8_t*)pReg - pBlock->pBlock);
+}
+
+void hostRegWrite(void* pReg, uint32_t fieldMask)
+{
+    HostRegBlock* pBlock = findRegBlock(pReg);
+    if (pBlock)
+        pBlock->pHandler->onRegWrite((uint8_t*)pReg - pBlock->pBlock, fieldMask);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interrupts
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct HostIntr
+{
+    int source;
+    intr_handler_t handler;
+    void* arg;
+};
+static std::vector<HostIntr*> s_hostIntrs;
+
+esp_err_t hostIntrAlloc(int source, int flags, uint32_t intrStatusMask, intr_handler_t handler, void* arg,
+            intr_handle_t* pRetHandle)
+{
+    HostIntr* pIntr = new HostIntr({source, handler, arg});
+    s_hostIntrs.push_back(pIntr);
+    if (pRetHandle)
+        *pRetHandle = pIntr;
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_free(intr_handle_t handle)
+{
+    for (auto it = s_hostIntrs.begin(); it != s_hostIntrs.end(); ++it)
+    {
+        if (*it == handle)
+        {
+            s_hostIntrs.erase(it);
+            delete handle;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+uint32_t hostIntrRaise(int source)
+{
+    uint32_t numCalled = 0;
+    for (HostIntr* pIntr : s_hostIntrs)
+    {
+        if (pIntr->source == source)
+        {
+            pIntr->handler(pIntr->arg);
+            numCalled++;
+        }
+    }
+    return numCalled;
+}
@@ -0,0 +1,36 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// String function shim for host (linux) builds
+// newlib (ESP-IDF) provides the BSD strlcpy/strlcat functions which glibc only has from 2.38
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string.h>
+
+#if defined(__GLIBC__) && ((__GLIBC__ < 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ < 38)))
+
+static inline size_t strlcpy(char* pDest, const char* pSrc, size_t destSize)
+{
+    size_t srcLen = strlen(pSrc);
+    if (destSize > 0)
+    {
+        size_t copyLen = srcLen < destSize - 1 ? srcLen : destSize - 1;
+        memcpy(pDest, pSrc, copyLen);
+        pDest[copyLen] = 0;
+    }
+    return srcLen;
+}
+
+static inline size_t strlcat(char* pDest, const char* pSrc, size_t destSize)
+{
+    size_t destLen = strnlen(pDest, destSize);
+    if (destLen == destSize)
+        return destLen + strlen(pSrc);
+    return destLen + strlcpy(pDest + destLen, pSrc, destSize - destLen);
+}
+
+#endif
@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unity shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "unity.h"
+#include "unity_test_runner.h"
+
+// Test record
+struct UnityHostTest
+{
+    const char* name;
+    const char* desc;
+    UnityHostTestFn fn;
+    const char* file;
+    int line;
+};
+
+// Failure (thrown to end the test case)
+struct UnityHostFailure
+{
+    const char* file;
+    int line;
+    const char* msg;
+};
+
+// Registered tests (function-local static so registration order across files doesn't matter)
+static std::vector<UnityHostTest>& unityHostTests()
+{
+    static std::vector<UnityHostTest> tests;
+    return tests;
+}
+
+// Counts
+static uint32_t s_testsRun = 0;
+static uint32_t s_testsFailed = 0;
+
+// Hooks used by the test runner
+void setUp(void);
+void tearDown(void);
+
+UnityHostTestReg::UnityHostTestReg(const char* name, const char* desc, UnityHostTestFn fn, const char* file, int line)
+{
+    unityHostTests().push_back({name, desc, fn, file, line});
+}
+
+void unityHostFail(const char* file, int line, const char* msg)
+{
+    throw UnityHostFailure{file, line, msg};
+}
+
+void unityHostBegin()
+{
+    s_testsRun = 0;
+    s_testsFailed = 0;
+}
+
+int unityHostEnd()
+{
+    printf("\n-----------------------\n%u Tests %u Failures 0 Ignored\n%s\n", s_testsRun, s_testsFailed, s_testsFailed ? "FAIL" : "OK");
+    return s_testsFailed;
+}
+
+static void unityHostRunTest(const UnityHostTest& test)
+{
+    s_testsRun++;
+    setUp();
+    try
+    {
+        test.fn();
+        printf("%s:%d:%s:PASS\n", test.file, test.line, test.name);
+    }
+    catch (const UnityHostFailure& failure)
+    {
+        s_testsFailed++;
+        printf("%s:%d:%s:FAIL: %s\n", failure.file, failure.line, test.name, failure.msg ? failure.msg : "");
+    }
+    tearDown();
+}
+
+void unity_run_all_tests()
+{
+    for (const auto& test : unityHostTests())
+        unityHostRunTest(test);
+}
+
+void unity_run_tests_by_tag(const char* tag, bool invert)
+{
+    for (const auto& test : unityHostTests())
+    {
+        bool hasTag = strstr(test.desc, tag) != nullptr;
+        if (hasTag != invert)
+            unityHostRunTest(test);
+    }
+}
+
+void unity_run_test_by_name(const char* name)
+{
+    for (const auto& test : unityHostTests())
+    {
+        if (strcmp(test.name, name) == 0)
+            unityHostRunTest(test);
+    }
+}
+
+void unity_run_menu()
+{
+    for (const auto& test : unityHostTests())
+        printf("\"%s\" %s\n", test.name, test.desc);
+}
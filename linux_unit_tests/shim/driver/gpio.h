@@ -0,0 +1,46 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// GPIO driver shim for host (linux) builds
+// Output levels are stored and input levels default to high (pulled-up) unless set by a simulation
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// GPIO numbers
+typedef int gpio_num_t;
+#define GPIO_NUM_NC -1
+#define GPIO_NUM_MAX 64
+
+// Modes and config
+typedef enum { GPIO_MODE_DISABLE = 0, GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2, 
+            GPIO_MODE_OUTPUT_OD = 6, GPIO_MODE_INPUT_OUTPUT_OD = 7, GPIO_MODE_INPUT_OUTPUT = 3 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE = 0, GPIO_PULLUP_ENABLE = 1 } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE = 0, GPIO_PULLDOWN_ENABLE = 1 } gpio_pulldown_t;
+typedef enum { GPIO_INTR_DISABLE = 0 } gpio_int_type_t;
+typedef enum { GPIO_PULLUP_ONLY = 0, GPIO_PULLDOWN_ONLY = 1, GPIO_PULLUP_PULLDOWN = 2, GPIO_FLOATING = 3 } gpio_pull_mode_t;
+typedef struct
+{
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+// GPIO functions
+esp_err_t gpio_config(const gpio_config_t* pGPIOConfig);
+esp_err_t gpio_reset_pin(gpio_num_t gpioNum);
+esp_err_t gpio_set_direction(gpio_num_t gpioNum, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpioNum, uint32_t level);
+int gpio_get_level(gpio_num_t gpioNum);
+esp_err_t gpio_set_pull_mode(gpio_num_t gpioNum, gpio_pull_mode_t pull);
+esp_err_t gpio_pullup_en(gpio_num_t gpioNum);
+
+// Host only - set the level seen on an input (e.g. a simulated bus line held low)
+void hostGpioSetInputLevel(gpio_num_t gpioNum, int level);
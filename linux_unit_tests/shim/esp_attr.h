@@ -0,0 +1,14 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ESP attribute shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Interrupt allocation shim for host (linux) builds
+// Handlers are called by peripheral models using hostIntrRaise()
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_idf_version.h"
+
+// Handles and handlers
+struct HostIntr;
+typedef HostIntr* intr_handle_t;
+typedef void (*intr_handler_t)(void* arg);
+
+// Flags
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define ESP_INTR_FLAG_LEVEL2 (1 << 2)
+#define ESP_INTR_FLAG_LEVEL3 (1 << 3)
+#define ESP_INTR_FLAG_SHARED (1 << 8)
+#define ESP_INTR_FLAG_IRAM (1 << 10)
+#define ESP_INTR_FLAG_LOWMED (ESP_INTR_FLAG_LEVEL1 | ESP_INTR_FLAG_LEVEL2 | ESP_INTR_FLAG_LEVEL3)
+
+// Sources
+#define ETS_I2C_EXT0_INTR_SOURCE 42
+#define ETS_I2C_EXT1_INTR_SOURCE 43
+
+// Allocation - the interrupt status register is not used on host (and target code casts its address to 32 bits
+// so the argument is dropped here rather than compiled)
+esp_err_t hostIntrAlloc(int source, int flags, uint32_t intrStatusMask, intr_handler_t handler, void* arg,
+            intr_handle_t* pRetHandle);
+#define esp_intr_alloc_intrstatus(source, flags, intrStatusReg, intrStatusMask, handler, arg, pRetHandle) \
+            hostIntrAlloc(source, flags, intrStatusMask, handler, arg, pRetHandle)
+esp_err_t esp_intr_free(intr_handle_t handle);
+
+// Host only - call the handlers allocated for a source
+// Returns the number of handlers called
+uint32_t hostIntrRaise(int source);
@@ -0,0 +1,15 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Clock shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// XTAL frequency (Hz)
+static inline int esp_clk_xtal_freq()
+{
+    return 40000000;
+}
@@ -0,0 +1,18 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Peripheral control shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+typedef enum {
+    PERIPH_I2C0_MODULE,
+    PERIPH_I2C1_MODULE,
+} periph_module_t;
+
+static inline void periph_module_enable(periph_module_t periph)
+{
+}
@@ -0,0 +1,19 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// GPIO matrix shim for host (linux) builds - signal routing is not modelled
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+static inline void esp_rom_gpio_connect_out_signal(uint32_t gpioNum, uint32_t signalIdx, bool outInv, bool oenInv)
+{
+}
+
+static inline void esp_rom_gpio_connect_in_signal(uint32_t gpioNum, uint32_t signalIdx, bool inv)
+{
+}
@@ -0,0 +1,16 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Task watchdog shim for host (linux) builds - there is no watchdog on host
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "esp_err.h"
+
+static inline esp_err_t esp_task_wdt_reset()
+{
+    return ESP_OK;
+}
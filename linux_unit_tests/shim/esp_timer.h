@@ -0,0 +1,14 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ESP timer shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+// Time in microseconds since start
+int64_t esp_timer_get_time();
@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// FreeRTOS shim for host (linux) builds
+// Only the subset of FreeRTOS used by RaftI2C is provided
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+
+// Types
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+// Constants
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((uint64_t)(xTimeInMs) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY 0x7fffffff
+
+// Critical sections (spinlocks on ESP32) map to a recursive mutex
+typedef struct
+{
+    std::recursive_mutex mutex;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(pMux) (pMux)->mutex.lock()
+#define portEXIT_CRITICAL(pMux) (pMux)->mutex.unlock()
+#define portENTER_CRITICAL_ISR(pMux) (pMux)->mutex.lock()
+#define portEXIT_CRITICAL_ISR(pMux) (pMux)->mutex.unlock()
+#define taskENTER_CRITICAL(pMux) portENTER_CRITICAL(pMux)
+#define taskEXIT_CRITICAL(pMux) portEXIT_CRITICAL(pMux)
+typedef portMUX_TYPE spinlock_t;
+#define spinlock_initialize(pLock)
@@ -0,0 +1,40 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// FreeRTOS task shim for host (linux) builds
+// Tasks are std::threads and task notifications are counting notifications on a condition variable
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Task handle
+struct HostTask;
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Task creation and deletion
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+            void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask, BaseType_t xCoreID);
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+            void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+// Delays and ticks
+void vTaskDelay(TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount();
+void taskYIELD();
+
+// Current task
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+// Notifications
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+// Host only - hook called when a task delays or yields (e.g. to run a peripheral model while a driver busy-waits)
+typedef void (*HostYieldHookFn)(void* pArg);
+void hostSetYieldHook(HostYieldHookFn hookFn, void* pArg);
@@ -0,0 +1,15 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// GPIO HAL shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+static inline void gpio_hal_iomux_func_sel(uint32_t pinMuxReg, uint32_t func)
+{
+}
@@ -0,0 +1,28 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C HAL types shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    I2C_DATA_MODE_MSB_FIRST = 0,
+    I2C_DATA_MODE_LSB_FIRST = 1,
+} i2c_trans_mode_t;
+
+typedef struct {
+    uint16_t clkm_div;
+    uint16_t scl_low;
+    uint16_t scl_high;
+    uint16_t scl_wait_high;
+    uint16_t sda_hold;
+    uint16_t sda_sample;
+    uint16_t setup;
+    uint16_t hold;
+    uint16_t tout;
+} i2c_hal_clk_config_t;
@@ -0,0 +1,14 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// sdkconfig for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LOG_MAXIMUM_LEVEL 5
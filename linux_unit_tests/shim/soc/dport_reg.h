@@ -0,0 +1,9 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// DPORT register shim for host (linux) builds - nothing is needed for ESP32-S3 register layouts
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
@@ -0,0 +1,25 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C peripheral signal shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "soc/i2c_struct.h"
+#include "soc/i2c_reg.h"
+
+typedef struct {
+    uint8_t sda_out_sig;
+    uint8_t sda_in_sig;
+    uint8_t scl_out_sig;
+    uint8_t scl_in_sig;
+    uint8_t irq;
+} i2c_signal_conn_t;
+
+static const i2c_signal_conn_t i2c_periph_signal[2] = {
+    { 90, 90, 89, 89, 42 },
+    { 92, 92, 91, 91, 43 },
+};
@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C peripheral register bit definitions shim for host (linux) builds (ESP32-S3 names and positions)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifndef BIT
+#define BIT(nr) (1UL << (nr))
+#endif
+
+// Interrupt raw/clear/enable/status bits
+#define I2C_RXFIFO_WM_INT_ENA BIT(0)
+#define I2C_TXFIFO_WM_INT_ENA BIT(1)
+#define I2C_RXFIFO_OVF_INT_ENA BIT(2)
+#define I2C_END_DETECT_INT_ENA BIT(3)
+#define I2C_BYTE_TRANS_DONE_INT_ENA BIT(4)
+#define I2C_ARBITRATION_LOST_INT_ENA BIT(5)
+#define I2C_MST_TXFIFO_UDF_INT_ENA BIT(6)
+#define I2C_TRANS_COMPLETE_INT_ENA BIT(7)
+#define I2C_TIME_OUT_INT_ENA BIT(8)
+#define I2C_TRANS_START_INT_ENA BIT(9)
+#define I2C_NACK_INT_ENA BIT(10)
+#define I2C_TXFIFO_OVF_INT_ENA BIT(11)
+#define I2C_RXFIFO_UDF_INT_ENA BIT(12)
+#define I2C_SCL_ST_TO_INT_ENA BIT(13)
+#define I2C_SCL_MAIN_ST_TO_INT_ENA BIT(14)
+#define I2C_DET_START_INT_ENA BIT(15)
+
+#define I2C_RXFIFO_WM_INT_ST BIT(0)
+#define I2C_TXFIFO_WM_INT_ST BIT(1)
+#define I2C_RXFIFO_OVF_INT_ST BIT(2)
+#define I2C_END_DETECT_INT_ST BIT(3)
+#define I2C_BYTE_TRANS_DONE_INT_ST BIT(4)
+#define I2C_ARBITRATION_LOST_INT_ST BIT(5)
+#define I2C_MST_TXFIFO_UDF_INT_ST BIT(6)
+#define I2C_TRANS_COMPLETE_INT_ST BIT(7)
+#define I2C_TIME_OUT_INT_ST BIT(8)
+#define I2C_TRANS_START_INT_ST BIT(9)
+#define I2C_NACK_INT_ST BIT(10)
+#define I2C_TXFIFO_OVF_INT_ST BIT(11)
+#define I2C_RXFIFO_UDF_INT_ST BIT(12)
+#define I2C_SCL_ST_TO_INT_ST BIT(13)
+#define I2C_SCL_MAIN_ST_TO_INT_ST BIT(14)
+#define I2C_DET_START_INT_ST BIT(15)
+
+// Status register fields
+#define I2C_RXFIFO_CNT_S 8
+#define I2C_RXFIFO_CNT_V 0x3f
+#define I2C_TXFIFO_CNT_S 18
+#define I2C_TXFIFO_CNT_V 0x3f
+#define I2C_SCL_MAIN_STATE_LAST_S 24
+#define I2C_SCL_MAIN_STATE_LAST_V 0x7
+#define I2C_SCL_STATE_LAST_S 28
+#define I2C_SCL_STATE_LAST_V 0x7
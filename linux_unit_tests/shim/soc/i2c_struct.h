@@ -0,0 +1,188 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2C peripheral register shim for host (linux) builds
+// Register and field names follow the ESP32-S3 (build I2C central code with CONFIG_IDF_TARGET_ESP32S3)
+// Accesses are forwarded to a model attached with hostRegAttach() (see SimI2CPeripheral)
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "HostReg.h"
+
+typedef union {
+    HostRegField<0, 9> scl_low_period;
+    HostRegVal val;
+} i2c_scl_low_period_reg_t;
+
+typedef union {
+    HostRegField<0, 1> sda_force_out;
+    HostRegField<1, 1> scl_force_out;
+    HostRegField<2, 1> sample_scl_level;
+    HostRegField<3, 1> rx_full_ack_level;
+    HostRegField<4, 1> ms_mode;
+    HostRegField<5, 1> trans_start;
+    HostRegField<6, 1> tx_lsb_first;
+    HostRegField<7, 1> rx_lsb_first;
+    HostRegField<8, 1> clk_en;
+    HostRegField<9, 1> arbitration_en;
+    HostRegField<10, 1> fsm_rst;
+    HostRegField<11, 1> conf_upgate;
+    HostRegVal val;
+} i2c_ctr_reg_t;
+
+typedef union {
+    HostRegField<0, 1> resp_rec;
+    HostRegField<1, 1> slave_rw;
+    HostRegField<3, 1> arb_lost;
+    HostRegField<4, 1> bus_busy;
+    HostRegField<5, 1> slave_addressed;
+    HostRegField<8, 6> rxfifo_cnt;
+    HostRegField<14, 2> stretch_cause;
+    HostRegField<18, 6> txfifo_cnt;
+    HostRegField<24, 3> scl_main_state_last;
+    HostRegField<28, 3> scl_state_last;
+    HostRegVal val;
+} i2c_sr_reg_t;
+
+typedef union {
+    HostRegField<0, 5> time_out_value;
+    HostRegField<5, 1> time_out_en;
+    HostRegVal val;
+} i2c_to_reg_t;
+
+typedef union {
+    HostRegField<0, 5> rxfifo_raddr;
+    HostRegField<5, 5> rxfifo_waddr;
+    HostRegField<10, 5> txfifo_raddr;
+    HostRegField<15, 5> txfifo_waddr;
+    HostRegVal val;
+} i2c_fifo_st_reg_t;
+
+typedef union {
+    HostRegField<0, 5> rxfifo_wm_thrhd;
+    HostRegField<5, 5> txfifo_wm_thrhd;
+    HostRegField<10, 1> nonfifo_en;
+    HostRegField<11, 1> fifo_addr_cfg_en;
+    HostRegField<12, 1> rx_fifo_rst;
+    HostRegField<13, 1> tx_fifo_rst;
+    HostRegField<14, 1> fifo_prt_en;
+    HostRegVal val;
+} i2c_fifo_conf_reg_t;
+
+typedef union {
+    HostRegField<0, 8> fifo_rdata;
+    HostRegVal val;
+} i2c_data_reg_t;
+
+typedef union {
+    HostRegVal val;
+} i2c_int_reg_t;
+
+typedef union {
+    HostRegField<0, 9> sda_hold_time;
+    HostRegVal val;
+} i2c_sda_hold_reg_t;
+
+typedef union {
+    HostRegField<0, 9> sda_sample_time;
+    HostRegVal val;
+} i2c_sda_sample_reg_t;
+
+typedef union {
+    HostRegField<0, 9> scl_high_period;
+    HostRegField<9, 7> scl_wait_high_period;
+    HostRegVal val;
+} i2c_scl_high_period_reg_t;
+
+typedef union {
+    HostRegField<0, 9> scl_start_hold_time;
+    HostRegVal val;
+} i2c_scl_start_hold_reg_t;
+
+typedef union {
+    HostRegField<0, 9> scl_rstart_setup_time;
+    HostRegVal val;
+} i2c_scl_rstart_setup_reg_t;
+
+typedef union {
+    HostRegField<0, 9> scl_stop_hold_time;
+    HostRegVal val;
+} i2c_scl_stop_hold_reg_t;
+
+typedef union {
+    HostRegField<0, 9> scl_stop_setup_time;
+    HostRegVal val;
+} i2c_scl_stop_setup_reg_t;
+
+typedef union {
+    HostRegField<0, 4> scl_filter_thres;
+    HostRegField<4, 4> sda_filter_thres;
+    HostRegField<8, 1> scl_filter_en;
+    HostRegField<9, 1> sda_filter_en;
+    HostRegVal val;
+} i2c_filter_cfg_reg_t;
+
+typedef union {
+    HostRegField<0, 8> sclk_div_num;
+    HostRegField<8, 6> sclk_div_a;
+    HostRegField<14, 6> sclk_div_b;
+    HostRegField<20, 1> sclk_sel;
+    HostRegField<21, 1> sclk_active;
+    HostRegVal val;
+} i2c_clk_conf_reg_t;
+
+// Command registers are plain storage (the model reads them when each command is executed)
+typedef union {
+    struct {
+        uint32_t byte_num:     8,
+                 ack_en:       1,
+                 ack_exp:      1,
+                 ack_value:    1,
+                 op_code:      3,
+                 reserved14:  17,
+                 command_done: 1;
+    };
+    uint32_t val;
+} i2c_comd_reg_t;
+
+typedef struct i2c_dev_t {
+    i2c_scl_low_period_reg_t scl_low_period;
+    i2c_ctr_reg_t ctr;
+    i2c_sr_reg_t sr;
+    i2c_to_reg_t to;
+    HostRegVal slave_addr;
+    i2c_fifo_st_reg_t fifo_st;
+    i2c_fifo_conf_reg_t fifo_conf;
+    i2c_data_reg_t data;
+    i2c_int_reg_t int_raw;
+    i2c_int_reg_t int_clr;
+    i2c_int_reg_t int_ena;
+    i2c_int_reg_t int_status;
+    i2c_sda_hold_reg_t sda_hold;
+    i2c_sda_sample_reg_t sda_sample;
+    i2c_scl_high_period_reg_t scl_high_period;
+    uint32_t reserved_3c;
+    i2c_scl_start_hold_reg_t scl_start_hold;
+    i2c_scl_rstart_setup_reg_t scl_rstart_setup;
+    i2c_scl_stop_hold_reg_t scl_stop_hold;
+    i2c_scl_stop_setup_reg_t scl_stop_setup;
+    i2c_filter_cfg_reg_t filter_cfg;
+    i2c_clk_conf_reg_t clk_conf;
+    i2c_comd_reg_t comd[8];
+    HostRegVal scl_st_time_out;
+    HostRegVal scl_main_st_time_out;
+    HostRegVal scl_sp_conf;
+    HostRegVal scl_stretch_conf;
+    uint32_t reserved_a8[22];
+    HostRegVal date;
+    uint32_t reserved_fc;
+    HostRegVal txfifo_start_addr;
+    uint32_t reserved_104[31];
+    HostRegVal rxfifo_start_addr;
+} i2c_dev_t;
+
+extern i2c_dev_t I2C0;
+extern i2c_dev_t I2C1;
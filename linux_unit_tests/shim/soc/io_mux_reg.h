@@ -0,0 +1,16 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// IO MUX shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+#define PIN_FUNC_GPIO 1
+
+// Pin mux registers are not modelled
+static const uint32_t GPIO_PIN_MUX_REG[64] = {0};
@@ -0,0 +1,24 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RTC clock shim for host (linux) builds
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t source_freq_mhz;
+    uint32_t div;
+    uint32_t freq_mhz;
+} rtc_cpu_freq_config_t;
+
+static inline void rtc_clk_cpu_freq_get_config(rtc_cpu_freq_config_t* pConfig)
+{
+    pConfig->source_freq_mhz = 480;
+    pConfig->div = 2;
+    pConfig->freq_mhz = 240;
+}
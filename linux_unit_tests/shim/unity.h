@@ -0,0 +1,45 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unity shim for host (linux) builds
+// Provides the subset of Unity assertions used by the RaftI2C tests - a failed assertion ends the test case
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Failure handler (does not return)
+[[noreturn]] void unityHostFail(const char* file, int line, const char* msg);
+
+#define UNITY_BEGIN() unityHostBegin()
+#define UNITY_END() unityHostEnd()
+void unityHostBegin();
+int unityHostEnd();
+
+#define TEST_ASSERT_MESSAGE(condition, message) do { if (!(condition)) unityHostFail(__FILE__, __LINE__, message); } while (0)
+#define TEST_ASSERT(condition) TEST_ASSERT_MESSAGE(condition, #condition)
+#define TEST_ASSERT_TRUE(condition) TEST_ASSERT_MESSAGE(condition, "Expected TRUE " #condition)
+#define TEST_ASSERT_FALSE(condition) TEST_ASSERT_MESSAGE(!(condition), "Expected FALSE " #condition)
+#define TEST_ASSERT_TRUE_MESSAGE(condition, message) TEST_ASSERT_MESSAGE(condition, message)
+#define TEST_ASSERT_FALSE_MESSAGE(condition, message) TEST_ASSERT_MESSAGE(!(condition), message)
+#define TEST_ASSERT_NULL(pointer) TEST_ASSERT_MESSAGE((pointer) == nullptr, "Expected NULL " #pointer)
+#define TEST_ASSERT_NOT_NULL(pointer) TEST_ASSERT_MESSAGE((pointer) != nullptr, "Expected not NULL " #pointer)
+#define TEST_ASSERT_EQUAL(expected, actual) TEST_ASSERT_MESSAGE((expected) == (actual), "Expected " #expected " == " #actual)
+#define TEST_ASSERT_EQUAL_MESSAGE(expected, actual, message) TEST_ASSERT_MESSAGE((expected) == (actual), message)
+#define TEST_ASSERT_EQUAL_INT(expected, actual) TEST_ASSERT_EQUAL(expected, actual)
+#define TEST_ASSERT_EQUAL_UINT32(expected, actual) TEST_ASSERT_EQUAL((uint32_t)(expected), (uint32_t)(actual))
+#define TEST_ASSERT_EQUAL_UINT8(expected, actual) TEST_ASSERT_EQUAL((uint8_t)(expected), (uint8_t)(actual))
+#define TEST_ASSERT_EQUAL_UINT16(expected, actual) TEST_ASSERT_EQUAL((uint16_t)(expected), (uint16_t)(actual))
+#define TEST_ASSERT_NOT_EQUAL(expected, actual) TEST_ASSERT_MESSAGE((expected) != (actual), "Expected " #expected " != " #actual)
+#define TEST_ASSERT_GREATER_THAN(threshold, actual) TEST_ASSERT_MESSAGE((actual) > (threshold), "Expected " #actual " > " #threshold)
+#define TEST_ASSERT_LESS_THAN(threshold, actual) TEST_ASSERT_MESSAGE((actual) < (threshold), "Expected " #actual " < " #threshold)
+#define TEST_ASSERT_FLOAT_WITHIN(delta, expected, actual) TEST_ASSERT_MESSAGE(fabs((double)(actual) - (double)(expected)) <= (delta), "Expected " #actual " within " #delta " of " #expected)
+#define TEST_ASSERT_EQUAL_STRING(expected, actual) TEST_ASSERT_MESSAGE(strcmp((expected), (actual)) == 0, "Expected string " #expected)
+#define TEST_ASSERT_EQUAL_MEMORY(expected, actual, len) TEST_ASSERT_MESSAGE(memcmp((expected), (actual), (len)) == 0, "Expected memory " #expected)
+#define TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, numElements) TEST_ASSERT_EQUAL_MEMORY(expected, actual, numElements)
+#define TEST_FAIL_MESSAGE(message) unityHostFail(__FILE__, __LINE__, message)
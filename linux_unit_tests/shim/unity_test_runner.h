@@ -0,0 +1,38 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Unity test runner shim for host (linux) builds
+// Mirrors the ESP-IDF TEST_CASE registration so test files build unchanged on host and target
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string.h>
+#include "unity.h"
+
+// Test function
+typedef void (*UnityHostTestFn)(void);
+
+// Test registration
+class UnityHostTestReg
+{
+public:
+    UnityHostTestReg(const char* name, const char* desc, UnityHostTestFn fn, const char* file, int line);
+};
+
+#define UNITY_HOST_CONCAT2(a, b) a##b
+#define UNITY_HOST_CONCAT(a, b) UNITY_HOST_CONCAT2(a, b)
+#define UNITY_HOST_UID(prefix) UNITY_HOST_CONCAT(prefix, __LINE__)
+
+#define TEST_CASE(name_, desc_) \
+    static void UNITY_HOST_UID(unity_host_test_fn_)(void); \
+    static UnityHostTestReg UNITY_HOST_UID(unity_host_test_reg_)(name_, desc_, UNITY_HOST_UID(unity_host_test_fn_), __FILE__, __LINE__); \
+    static void UNITY_HOST_UID(unity_host_test_fn_)(void)
+
+// Run tests
+void unity_run_all_tests();
+void unity_run_tests_by_tag(const char* tag, bool invert);
+void unity_run_test_by_name(const char* name);
+void unity_run_menu();
@@ -0,0 +1,257 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2CCapture
+// Parsing and analysis of bus captures made with RaftI2CCentralCapture
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "I2CCapture.h"
+#include "RaftI2CCentralCapture.h"
+#include "BusI2CConsts.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Slot tracker
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool I2CCaptureSlotTracker::isExtenderAddr(uint32_t addr)
+{
+    return (addr >= I2C_BUS_EXTENDER_BASE) && (addr < I2C_BUS_EXTENDER_BASE + I2C_BUS_EXTENDERS_MAX);
+}
+
+uint32_t I2CCaptureSlotTracker::getSlotPlus1(uint32_t addr) const
+{
+    if (isExtenderAddr(addr))
+        return 0;
+    uint32_t slotPlus1 = 0;
+    for (uint32_t extIdx = 0; extIdx < I2C_BUS_EXTENDERS_MAX; extIdx++)
+    {
+        uint8_t mask = _extenderMasks[extIdx];
+        if (mask == 0)
+            continue;
+        // More than one channel enabled is treated as the main bus
+        if ((slotPlus1 != 0) || (mask & (mask - 1)))
+            return 0;
+        uint32_t chanIdx = 0;
+        while (!(mask & (1 << chanIdx)))
+            chanIdx++;
+        slotPlus1 = extIdx * 8 + chanIdx + 1;
+    }
+    return slotPlus1;
+}
+
+void I2CCaptureSlotTracker::update(uint32_t addr, const uint8_t* pWriteData, uint32_t writeLen,
+            RaftI2CCentralIF::AccessResultCode result)
+{
+    if (!isExtenderAddr(addr))
+        return;
+    uint32_t extIdx = addr - I2C_BUS_EXTENDER_BASE;
+    if ((result == RaftI2CCentralIF::ACCESS_RESULT_OK) && (writeLen > 0))
+        _extenderMasks[extIdx] = pWriteData[0];
+    else if (result != RaftI2CCentralIF::ACCESS_RESULT_OK)
+        _extenderMasks[extIdx] = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Capture
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool I2CCapture::parse(const std::vector<uint8_t>& captureData)
+{
+    _recs.clear();
+    _numDropped = 0;
+    if (captureData.size() < RaftI2CCentralCapture::CAPTURE_HEADER_BYTES)
+        return false;
+    uint32_t magic = 0, numRecs = 0;
+    memcpy(&magic, captureData.data(), sizeof(magic));
+    if ((magic != RaftI2CCentralCapture::CAPTURE_MAGIC) || (captureData[4] != RaftI2CCentralCapture::CAPTURE_VERSION))
+        return false;
+    memcpy(&numRecs, captureData.data() + 8, sizeof(numRecs));
+    memcpy(&_numDropped, captureData.data() + 12, sizeof(_numDropped));
+
+    // Records
+    I2CCaptureSlotTracker slotTracker;
+    uint32_t pos = RaftI2CCentralCapture::CAPTURE_HEADER_BYTES;
+    uint64_t timeBaseUs = 0;
+    uint32_t lastTimeUs = 0;
+    _recs.reserve(numRecs);
+    for (uint32_t recIdx = 0; recIdx < numRecs; recIdx++)
+    {
+        if (pos + RaftI2CCentralCapture::CAPTURE_REC_HEADER_BYTES > captureData.size())
+            return false;
+        const uint8_t* pRec = captureData.data() + pos;
+        uint32_t timeUs = 0;
+        uint16_t durationUs = 0, writeLen = 0, readLen = 0, readDataLen = 0;
+        memcpy(&timeUs, pRec, sizeof(timeUs));
+        memcpy(&durationUs, pRec + 4, sizeof(durationUs));
+        memcpy(&writeLen, pRec + 8, sizeof(writeLen));
+        memcpy(&readLen, pRec + 10, sizeof(readLen));
+        memcpy(&readDataLen, pRec + 12, sizeof(readDataLen));
+        pos += RaftI2CCentralCapture::CAPTURE_REC_HEADER_BYTES;
+        if (pos + writeLen + readDataLen > captureData.size())
+            return false;
+
+        // Times are the low 32 bits of the bus clock so unwrap them
+        if ((recIdx > 0) && (timeUs < lastTimeUs))
+            timeBaseUs += 1ULL << 32;
+        lastTimeUs = timeUs;
+
+        I2CCaptureRec rec;
+        rec.timeUs = timeBaseUs + timeUs;
+        rec.durationUs = durationUs;
+        rec.addr = pRec[6];
+        rec.result = (RaftI2CCentralIF::AccessResultCode)pRec[7];
+        rec.readReqLen = readLen;
+        rec.writeData.assign(captureData.data() + pos, captureData.data() + pos + writeLen);
+        rec.readData.assign(captureData.data() + pos + writeLen, captureData.data() + pos + writeLen + readDataLen);
+        rec.slotPlus1 = slotTracker.getSlotPlus1(rec.addr);
+        slotTracker.update(rec.addr, rec.writeData.data(), writeLen, rec.result);
+        pos += writeLen + readDataLen;
+        _recs.push_back(rec);
+    }
+    return true;
+}
+
+bool I2CCapture::load(const char* pFileName)
+{
+    FILE* pFile = fopen(pFileName, "rb");
+    if (!pFile)
+        return false;
+    std::vector<uint8_t> fileData;
+    uint8_t buf[4096];
+    size_t numRead = 0;
+    while ((numRead = fread(buf, 1, sizeof(buf), pFile)) > 0)
+        fileData.insert(fileData.end(), buf, buf + numRead);
+    fclose(pFile);
+
+    // Accept hex text as well as binary
+    uint32_t magic = 0;
+    if (fileData.size() >= sizeof(magic))
+        memcpy(&magic, fileData.data(), sizeof(magic));
+    if (magic != RaftI2CCentralCapture::CAPTURE_MAGIC)
+    {
+        std::vector<uint8_t> binData;
+        int nibbleHi = -1;
+        for (uint8_t ch : fileData)
+        {
+            int nibble = (ch >= '0' && ch <= '9') ? ch - '0' : (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 :
+                        (ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : -1;
+            if (nibble < 0)
+                continue;
+            if (nibbleHi < 0)
+            {
+                nibbleHi = nibble;
+                continue;
+            }
+            binData.push_back((nibbleHi << 4) | nibble);
+            nibbleHi = -1;
+        }
+        fileData.swap(binData);
+    }
+    return parse(fileData);
+}
+
+bool I2CCapture::save(const char* pFileName, const std::vector<uint8_t>& captureData)
+{
+    FILE* pFile = fopen(pFileName, "wb");
+    if (!pFile)
+        return false;
+    bool ok = fwrite(captureData.data(), 1, captureData.size(), pFile) == captureData.size();
+    fclose(pFile);
+    return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Summary
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void I2CCaptureSummary::analyse(const I2CCapture& capture)
+{
+    const std::vector<I2CCaptureRec>& recs = capture.getRecs();
+    uint64_t startUs = capture.getStartUs();
+    durationMs = (capture.getEndUs() - startUs) / 1000.0;
+    numAccesses = recs.size();
+    numAcked = 0;
+    numReads = 0;
+    busTimeMs = 0;
+    discoveryMs = 0;
+    elems.clear();
+
+    // Read times for each element grouped by the data written before the read
+    std::map<uint32_t, std::map<std::vector<uint8_t>, std::vector<uint64_t>>> readTimes;
+    for (const I2CCaptureRec& rec : recs)
+    {
+        uint32_t key = (rec.slotPlus1 << 8) | rec.addr;
+        ElemSummary& elem = elems[key];
+        elem.addr = rec.addr;
+        elem.slotPlus1 = rec.slotPlus1;
+        elem.numAccesses++;
+        busTimeMs += rec.durationUs / 1000.0;
+        if (rec.result != RaftI2CCentralIF::ACCESS_RESULT_OK)
+            continue;
+        numAcked++;
+        elem.numAcked++;
+        if (elem.firstAckMs < 0)
+            elem.firstAckMs = (rec.timeUs - startUs) / 1000.0;
+        if (rec.readData.size() > 0)
+        {
+            numReads++;
+            readTimes[key][rec.writeData].push_back(rec.timeUs);
+        }
+    }
+
+    // Discovery and poll timing
+    for (auto& elemIt : elems)
+    {
+        ElemSummary& elem = elemIt.second;
+        if (!I2CCaptureSlotTracker::isExtenderAddr(elem.addr) && (elem.firstAckMs > discoveryMs))
+            discoveryMs = elem.firstAckMs;
+        auto readIt = readTimes.find(elemIt.first);
+        if (readIt == readTimes.end())
+            continue;
+        const std::vector<uint64_t>* pPollTimes = nullptr;
+        for (const auto& group : readIt->second)
+        {
+            if (!pPollTimes || (group.second.size() > pPollTimes->size()))
+                pPollTimes = &group.second;
+        }
+        if (!pPollTimes || (pPollTimes->size() < 3))
+            continue;
+        elem.numPolls = pPollTimes->size();
+        for (uint32_t i = 1; i < pPollTimes->size(); i++)
+        {
+            double intervalMs = ((*pPollTimes)[i] - (*pPollTimes)[i-1]) / 1000.0;
+            elem.pollIntervalMeanMs += intervalMs;
+            if (intervalMs > elem.pollIntervalMaxMs)
+                elem.pollIntervalMaxMs = intervalMs;
+        }
+        elem.pollIntervalMeanMs /= pPollTimes->size() - 1;
+    }
+}
+
+std::string I2CCaptureSummary::toJson() const
+{
+    char buf[300];
+    snprintf(buf, sizeof(buf), "{\"durationMs\":%.1f,\"accesses\":%u,\"acked\":%u,\"reads\":%u,\"busTimeMs\":%.1f,"
+                "\"discoveryMs\":%.1f,\"elems\":[",
+                durationMs, numAccesses, numAcked, numReads, busTimeMs, discoveryMs);
+    std::string json = buf;
+    bool isFirst = true;
+    for (const auto& elemIt : elems)
+    {
+        const ElemSummary& elem = elemIt.second;
+        if (elem.numAcked == 0)
+            continue;
+        snprintf(buf, sizeof(buf), "%s{\"addr\":\"0x%02x@%u\",\"accesses\":%u,\"acked\":%u,\"firstAckMs\":%.1f,"
+                    "\"polls\":%u,\"pollMeanMs\":%.2f,\"pollMaxMs\":%.2f}",
+                    isFirst ? "" : ",", elem.addr, elem.slotPlus1, elem.numAccesses, elem.numAcked, elem.firstAckMs,
+                    elem.numPolls, elem.pollIntervalMeanMs, elem.pollIntervalMaxMs);
+        json += buf;
+        isFirst = false;
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,128 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// I2CCapture
+// Parsing and analysis of bus captures made with RaftI2CCentralCapture
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <string>
+#include "RaftI2CCentralIF.h"
+#include "BusI2CConsts.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Captured access
+struct I2CCaptureRec
+{
+    uint64_t timeUs = 0;
+    uint32_t durationUs = 0;
+    uint32_t addr = 0;
+    uint32_t slotPlus1 = 0;
+    RaftI2CCentralIF::AccessResultCode result = RaftI2CCentralIF::ACCESS_RESULT_OK;
+    uint32_t readReqLen = 0;
+    std::vector<uint8_t> writeData;
+    std::vector<uint8_t> readData;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Tracks which slot is enabled from writes to bus extenders
+/// @note Bus extenders are on the main bus so their own accesses are always attributed to slot 0
+class I2CCaptureSlotTracker
+{
+public:
+    /// @brief Get the slot (+1) which accesses currently reach (0 if none or more than one slot enabled)
+    /// @param addr address being accessed
+    uint32_t getSlotPlus1(uint32_t addr) const;
+
+    /// @brief Update with an access
+    void update(uint32_t addr, const uint8_t* pWriteData, uint32_t writeLen, RaftI2CCentralIF::AccessResultCode result);
+
+    /// @brief Check if an address is a bus extender
+    static bool isExtenderAddr(uint32_t addr);
+
+private:
+    uint8_t _extenderMasks[I2C_BUS_EXTENDERS_MAX] = {0};
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Bus capture
+class I2CCapture
+{
+public:
+    /// @brief Parse capture data (from RaftI2CCentralCapture::getCapture())
+    /// @return true if valid
+    bool parse(const std::vector<uint8_t>& captureData);
+
+    /// @brief Load a capture file (binary or hex)
+    bool load(const char* pFileName);
+
+    /// @brief Save capture data to a file
+    static bool save(const char* pFileName, const std::vector<uint8_t>& captureData);
+
+    const std::vector<I2CCaptureRec>& getRecs() const
+    {
+        return _recs;
+    }
+    uint32_t getNumDropped() const
+    {
+        return _numDropped;
+    }
+    uint64_t getStartUs() const
+    {
+        return _recs.size() > 0 ? _recs.front().timeUs : 0;
+    }
+    uint64_t getEndUs() const
+    {
+        return _recs.size() > 0 ? _recs.back().timeUs + _recs.back().durationUs : 0;
+    }
+
+private:
+    std::vector<I2CCaptureRec> _recs;
+    uint32_t _numDropped = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Summary of bus behaviour in a capture - used to compare a replay with the original
+class I2CCaptureSummary
+{
+public:
+    /// @brief Bus element (address and slot) summary
+    struct ElemSummary
+    {
+        uint32_t addr = 0;
+        uint32_t slotPlus1 = 0;
+        uint32_t numAccesses = 0;
+        uint32_t numAcked = 0;
+        // Time of first ACK (relative to the capture start) - or -1 if never acked
+        double firstAckMs = -1;
+        // Most frequent repeated read (the poll) and its interval
+        uint32_t numPolls = 0;
+        double pollIntervalMeanMs = 0;
+        double pollIntervalMaxMs = 0;
+    };
+
+    /// @brief Analyse a capture
+    void analyse(const I2CCapture& capture);
+
+    /// @brief Get summary as JSON
+    std::string toJson() const;
+
+    // Totals
+    double durationMs = 0;
+    uint32_t numAccesses = 0;
+    uint32_t numAcked = 0;
+    uint32_t numReads = 0;
+    double busTimeMs = 0;
+
+    // Time until the last element (excluding bus extenders) first acked
+    double discoveryMs = 0;
+
+    // Elements keyed by (slotPlus1 << 8) | addr
+    std::map<uint32_t, ElemSummary> elems;
+};
@@ -0,0 +1,364 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CCentral
+// Simulated I2C central for host-native testing
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <chrono>
+#include "SimI2CCentral.h"
+#include "BusI2CConsts.h"
+#include "Logger.h"
+#include "driver/gpio.h"
+
+// #define DEBUG_SIM_I2C_ACCESS
+
+#ifdef DEBUG_SIM_I2C_ACCESS
+static const char* MODULE_PREFIX = "SimI2CCentral";
+#endif
+
+// Slots are numbered from 1 - extender N channel C is slot N*8+C+1
+static const uint32_t SIM_SLOTS_PER_EXTENDER = 8;
+static const uint32_t SIM_SLOTS_PLUS1_MAX = I2C_BUS_EXTENDERS_MAX * SIM_SLOTS_PER_EXTENDER + 1;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SimI2CCentral::SimI2CCentral()
+{
+    for (uint32_t i = 0; i < I2C_ADDR_COUNT; i++)
+        _addrFaults[i] = ACCESS_RESULT_OK;
+    _slotPowerPrev.resize(SIM_SLOTS_PLUS1_MAX, true);
+}
+
+SimI2CCentral::~SimI2CCentral()
+{
+    clearDevices();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Init / deinit
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+            uint32_t busFilteringLevel)
+{
+    _pinSDA = pinSDA;
+    _pinSCL = pinSCL;
+    _busFrequency = busFrequency > 0 ? busFrequency : 100000;
+    _isInitialised = true;
+    setBusStuck(_isBusStuck);
+    return true;
+}
+
+void SimI2CCentral::deinit()
+{
+    _submitted.clear();
+    _isInitialised = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Operating ok
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::isOperatingOk() const
+{
+    return _isInitialised && !_isBusStuck;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bus frequency
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::setBusFrequency(uint32_t busFreq)
+{
+    if ((busFreq == 0) || _isFreqChangeRefused)
+        return false;
+    if (busFreq != _busFrequency)
+        _freqChangeCount++;
+    _busFrequency = busFreq;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Topology and fault control
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimI2CCentral::clearDevices()
+{
+    std::lock_guard<std::recursive_mutex> lock(_topologyMutex);
+    for (auto& devRec : _devices)
+        delete devRec.pDevice;
+    _devices.clear();
+}
+
+void SimI2CCentral::setAddrFault(uint32_t address, AccessResultCode resultCode)
+{
+    if (address < I2C_ADDR_COUNT)
+        _addrFaults[address] = resultCode;
+}
+
+void SimI2CCentral::setBusStuck(bool isStuck)
+{
+    _isBusStuck = isStuck;
+    if (_pinSDA >= 0)
+        hostGpioSetInputLevel((gpio_num_t)_pinSDA, isStuck ? 0 : 1);
+    if (_pinSCL >= 0)
+        hostGpioSetInputLevel((gpio_num_t)_pinSCL, isStuck ? 0 : 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Access the bus
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftI2CCentralIF::AccessResultCode SimI2CCentral::access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead)
+{
+    // Submitted transactions complete first
+    while (!_submitted.empty())
+        waitAny(UINT32_MAX);
+
+    // Access
+    uint32_t transUs = 0;
+    AccessResultCode rslt = doAccess(address, pWriteBuf, numToWrite, pReadBuf, numToRead, numRead, transUs);
+    if (_applyAsRealDelay && (transUs > 0))
+        std::this_thread::sleep_for(std::chrono::microseconds(transUs));
+    return rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Non-blocking access
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::submit(const Transaction& transaction, TransCompleteCB completeCB)
+{
+    if (_submitted.size() >= TRANSACTION_QUEUE_DEPTH)
+        return false;
+
+    // Perform the access now and work out when the bus would finish it
+    SubmittedTrans submitted = { transaction, completeCB, 0 };
+    uint32_t transUs = 0;
+    submitted.trans.rslt = doAccess(transaction.address, transaction.pWriteBuf, transaction.numToWrite,
+                transaction.pReadBuf, transaction.numToRead, submitted.trans.numRead, transUs);
+    if (_applyAsRealDelay)
+    {
+        uint64_t nowUs = micros();
+        _busFreeUs = (_busFreeUs > nowUs ? _busFreeUs : nowUs) + transUs;
+        submitted.completeUs = _busFreeUs;
+    }
+    _submitted.push_back(submitted);
+    return true;
+}
+
+uint32_t SimI2CCentral::poll()
+{
+    uint32_t numCompleted = 0;
+    while (!_submitted.empty())
+    {
+        if (_applyAsRealDelay && (_submitted.front().completeUs > micros()))
+            break;
+        SubmittedTrans submitted = _submitted.front();
+        _submitted.pop_front();
+        if (submitted.completeCB)
+            submitted.completeCB(submitted.trans);
+        numCompleted++;
+    }
+    return numCompleted;
+}
+
+uint32_t SimI2CCentral::waitAny(uint32_t timeoutUs)
+{
+    if (_submitted.empty())
+        return 0;
+    if (_applyAsRealDelay)
+    {
+        uint64_t nowUs = micros();
+        uint64_t waitUs = _submitted.front().completeUs > nowUs ? _submitted.front().completeUs - nowUs : 0;
+        if (waitUs > timeoutUs)
+            waitUs = timeoutUs;
+        if (waitUs > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+    }
+    return poll();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Perform a simulated access (transUs is set to the simulated bus time)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftI2CCentralIF::AccessResultCode SimI2CCentral::doAccess(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead, uint32_t& transUs)
+{
+    numRead = 0;
+    if (!_isInitialised)
+        return ACCESS_RESULT_NOT_INIT;
+    if (address >= I2C_ADDR_COUNT)
+        return ACCESS_RESULT_INVALID;
+
+    // Stats
+    _accessCount++;
+    _accessCountByAddr[address]++;
+    _accessCountByFreq[_busFrequency]++;
+
+    // Simulated bus time - start, address byte(s), data bytes, stop
+    uint32_t numBits = 2 + (1 + numToWrite) * 9 + (numToRead > 0 ? (1 + numToRead) * 9 : 0);
+    transUs = (uint32_t)(((uint64_t)numBits * 1000000) / _busFrequency) + _overheadUs;
+    _busTimeUs += transUs;
+    if (_pVirtualClock)
+        _pVirtualClock->advanceUs(transUs);
+
+    // Bus stuck
+    if (_isBusStuck)
+    {
+        _i2cStats.update(true, false, true, false, false, false, false);
+        return ACCESS_RESULT_HW_TIME_OUT;
+    }
+
+    // Injected faults
+    if (_addrFaults[address] != ACCESS_RESULT_OK)
+    {
+        _i2cStats.update(true, _addrFaults[address] == ACCESS_RESULT_ACK_ERROR,
+                    _addrFaults[address] == ACCESS_RESULT_HW_TIME_OUT, false,
+                    _addrFaults[address] == ACCESS_RESULT_ARB_LOST, false, false);
+        return _addrFaults[address];
+    }
+
+    // Find devices responding at this address - the bus is wired-OR for ACK and wired-AND for data
+    std::lock_guard<std::recursive_mutex> lock(_topologyMutex);
+    if (isSpeedViolation())
+        _speedViolationCount++;
+    std::vector<SimI2CDevice*> responders;
+    findResponders(address, responders);
+    bool isAcked = false;
+    for (SimI2CDevice* pDevice : responders)
+    {
+        if (pDevice->checkAck())
+        {
+            isAcked = true;
+            if (numToWrite > 0)
+                pDevice->write(pWriteBuf, numToWrite);
+        }
+    }
+    if (!isAcked)
+    {
+#ifdef DEBUG_SIM_I2C_ACCESS
+        LOG_I(MODULE_PREFIX, "access addr 0x%02x NACK", (unsigned)address);
+#endif
+        _i2cStats.update(true, true, false, false, false, true, false);
+        return ACCESS_RESULT_ACK_ERROR;
+    }
+
+    // Read
+    if (numToRead > 0)
+    {
+        std::vector<uint8_t> devData(numToRead);
+        for (uint32_t i = 0; i < numToRead; i++)
+            pReadBuf[i] = 0xff;
+        for (SimI2CDevice* pDevice : responders)
+        {
+            if (!pDevice->isPresent())
+                continue;
+            pDevice->read(devData.data(), numToRead);
+            for (uint32_t i = 0; i < numToRead; i++)
+                pReadBuf[i] &= devData[i];
+        }
+        numRead = numToRead;
+    }
+
+    // Writes may have changed mux channels or slot power
+    if (numToWrite > 0)
+        updateSlotPower();
+
+#ifdef DEBUG_SIM_I2C_ACCESS
+    LOG_I(MODULE_PREFIX, "access addr 0x%02x write %d read %d OK", (unsigned)address, (int)numToWrite, (int)numToRead);
+#endif
+    _i2cStats.update(true, false, false, true, false, true, false);
+    return ACCESS_RESULT_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Slot power
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::isSlotPowered(uint32_t slotPlus1) const
+{
+    if (slotPlus1 == 0)
+        return true;
+    std::lock_guard<std::recursive_mutex> lock(_topologyMutex);
+    for (const auto& devRec : _devices)
+    {
+        if (devRec.slotPlus1 != 0)
+            continue;
+        SimPCA9535* pPwrCtrl = dynamic_cast<SimPCA9535*>(devRec.pDevice);
+        if (pPwrCtrl && pPwrCtrl->isPresent() && pPwrCtrl->controlsSlot(slotPlus1))
+            return pPwrCtrl->isSlotPowered(slotPlus1);
+    }
+    return true;
+}
+
+void SimI2CCentral::updateSlotPower()
+{
+    for (uint32_t slotPlus1 = 1; slotPlus1 < SIM_SLOTS_PLUS1_MAX; slotPlus1++)
+    {
+        bool isPowered = isSlotPowered(slotPlus1);
+        if (isPowered && !_slotPowerPrev[slotPlus1])
+        {
+            for (auto& devRec : _devices)
+            {
+                if (devRec.slotPlus1 == slotPlus1)
+                    devRec.pDevice->powerOn();
+            }
+        }
+        _slotPowerPrev[slotPlus1] = isPowered;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Find devices currently connected to the main bus at an address
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CCentral::isSlotVisible(uint32_t slotPlus1) const
+{
+    if (slotPlus1 == 0)
+        return true;
+    uint32_t extIdx = (slotPlus1 - 1) / SIM_SLOTS_PER_EXTENDER;
+    uint32_t chanIdx = (slotPlus1 - 1) % SIM_SLOTS_PER_EXTENDER;
+    for (const auto& devRec : _devices)
+    {
+        if ((devRec.slotPlus1 != 0) || (devRec.pDevice->getAddress() != I2C_BUS_EXTENDER_BASE + extIdx))
+            continue;
+        SimPCA9548A* pMux = dynamic_cast<SimPCA9548A*>(devRec.pDevice);
+        if (pMux && pMux->isPresent() && (pMux->getChannelMask() & (1 << chanIdx)))
+            return isSlotPowered(slotPlus1);
+    }
+    return false;
+}
+
+bool SimI2CCentral::isSpeedViolation() const
+{
+    // Every device connected to the bus sees the access whatever its address
+    for (const auto& devRec : _devices)
+    {
+        uint32_t maxFreq = devRec.pDevice->getMaxFreq();
+        if ((maxFreq == 0) || (maxFreq >= _busFrequency) || !devRec.pDevice->isPresent())
+            continue;
+        if (isSlotVisible(devRec.slotPlus1))
+            return true;
+    }
+    return false;
+}
+
+void SimI2CCentral::findResponders(uint32_t address, std::vector<SimI2CDevice*>& responders) const
+{
+    for (const auto& devRec : _devices)
+    {
+        if (devRec.pDevice->getAddress() != address)
+            continue;
+        if (isSlotVisible(devRec.slotPlus1))
+            responders.push_back(devRec.pDevice);
+    }
+}
@@ -0,0 +1,210 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CCentral
+// Simulated I2C central for host-native testing
+//
+// Models a main bus with optional PCA9548A bus extenders (slots) and PCA9535 slot power controllers
+// so that BusI2C and its subsystems can be exercised without hardware
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include "RaftI2CCentralIF.h"
+#include "SimI2CDevice.h"
+#include "BusI2CClock.h"
+
+class SimI2CCentral : public RaftI2CCentralIF
+{
+public:
+    SimI2CCentral();
+    virtual ~SimI2CCentral();
+
+    // Init/de-init
+    virtual bool init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+                uint32_t busFilteringLevel = DEFAULT_BUS_FILTER_LEVEL) override final;
+    virtual void deinit() override final;
+
+    // Busy
+    virtual bool isBusy() override final
+    {
+        return false;
+    }
+
+    // Access the bus
+    virtual AccessResultCode access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                    uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead) override final;
+
+    // Non-blocking access - with real delay applied transactions complete after their simulated bus time
+    // (one after another) so the caller can do other work meanwhile
+    virtual bool submit(const Transaction& transaction, TransCompleteCB completeCB) override final;
+    virtual uint32_t poll() override final;
+    virtual uint32_t waitAny(uint32_t timeoutUs) override final;
+    virtual uint32_t getNumQueued() const override final
+    {
+        return _submitted.size();
+    }
+
+    // Check if bus operating ok
+    virtual bool isOperatingOk() const override final;
+
+    // Set bus frequency for subsequent accesses
+    virtual bool setBusFrequency(uint32_t busFreq) override final;
+
+    /// @brief Get current bus frequency
+    uint32_t getBusFrequency() const
+    {
+        return _busFrequency;
+    }
+
+    /// @brief Add a device (ownership is taken)
+    /// @param pDevice device
+    /// @param slotPlus1 slot number + 1 (0 for main bus)
+    /// @return the device pointer for convenience
+    template<typename T>
+    T* addDevice(T* pDevice, uint32_t slotPlus1 = 0)
+    {
+        std::lock_guard<std::recursive_mutex> lock(_topologyMutex);
+        _devices.push_back({pDevice, slotPlus1});
+        return pDevice;
+    }
+
+    /// @brief Remove all devices
+    void clearDevices();
+
+    /// @brief Force a result code for all accesses to an address (ACCESS_RESULT_OK clears the fault)
+    /// @param address I2C address
+    /// @param resultCode result to return
+    void setAddrFault(uint32_t address, AccessResultCode resultCode);
+
+    /// @brief Simulate SDA/SCL being held low
+    /// @param isStuck true to hold the bus
+    void setBusStuck(bool isStuck);
+
+    /// @brief Simulate a central that can't change bus frequency (setBusFrequency() returns false)
+    /// @param isRefused true to refuse changes
+    void setFreqChangeRefused(bool isRefused)
+    {
+        _isFreqChangeRefused = isRefused;
+    }
+
+    /// @brief Simulated latency settings
+    /// @param overheadUs fixed overhead per transaction
+    /// @param applyAsRealDelay true to actually sleep for the simulated time
+    void setLatency(uint32_t overheadUs, bool applyAsRealDelay)
+    {
+        _overheadUs = overheadUs;
+        _applyAsRealDelay = applyAsRealDelay;
+    }
+
+    /// @brief Advance a virtual clock by the simulated time of each transaction
+    /// @param pClock virtual clock (nullptr to disable)
+    void setVirtualClock(BusI2CVirtualClock* pClock)
+    {
+        _pVirtualClock = pClock;
+    }
+
+    /// @brief Get total simulated bus time in us
+    uint64_t getBusTimeUs() const
+    {
+        return _busTimeUs;
+    }
+
+    /// @brief Get count of accesses
+    uint32_t getAccessCount() const
+    {
+        return _accessCount;
+    }
+
+    /// @brief Get count of accesses to an address
+    uint32_t getAccessCount(uint32_t address) const
+    {
+        return address < I2C_ADDR_COUNT ? _accessCountByAddr[address] : 0;
+    }
+
+    /// @brief Get count of accesses made at a bus frequency
+    uint32_t getAccessCountAtFreq(uint32_t busFreq) const
+    {
+        auto it = _accessCountByFreq.find(busFreq);
+        return it != _accessCountByFreq.end() ? it->second : 0;
+    }
+
+    /// @brief Get count of bus frequency changes
+    uint32_t getFreqChangeCount() const
+    {
+        return _freqChangeCount;
+    }
+
+    /// @brief Get count of accesses made while a device with a lower maximum frequency was visible on the bus
+    uint32_t getSpeedViolationCount() const
+    {
+        return _speedViolationCount;
+    }
+
+    /// @brief Check if a slot is currently powered (slots without a power controller are always powered)
+    bool isSlotPowered(uint32_t slotPlus1) const;
+
+private:
+    // Device record
+    struct DeviceRec
+    {
+        SimI2CDevice* pDevice;
+        uint32_t slotPlus1;
+    };
+
+    // Topology
+    std::vector<DeviceRec> _devices;
+    mutable std::recursive_mutex _topologyMutex;
+
+    // Settings
+    bool _isInitialised = false;
+    int16_t _pinSDA = -1;
+    int16_t _pinSCL = -1;
+    uint32_t _busFrequency = 100000;
+
+    // Faults
+    static const uint32_t I2C_ADDR_COUNT = 128;
+    AccessResultCode _addrFaults[I2C_ADDR_COUNT];
+    bool _isBusStuck = false;
+    bool _isFreqChangeRefused = false;
+
+    // Latency
+    uint32_t _overheadUs = 0;
+    bool _applyAsRealDelay = false;
+    BusI2CVirtualClock* _pVirtualClock = nullptr;
+    uint64_t _busTimeUs = 0;
+
+    // Submitted transactions (the simulated access is performed on submission)
+    struct SubmittedTrans
+    {
+        Transaction trans;
+        TransCompleteCB completeCB;
+        uint64_t completeUs;
+    };
+    std::deque<SubmittedTrans> _submitted;
+    uint64_t _busFreeUs = 0;
+
+    // Stats
+    uint32_t _accessCount = 0;
+    uint32_t _accessCountByAddr[I2C_ADDR_COUNT] = {0};
+    std::map<uint32_t, uint32_t> _accessCountByFreq;
+    uint32_t _freqChangeCount = 0;
+    uint32_t _speedViolationCount = 0;
+
+    // Slot power tracking (to power-cycle devices)
+    std::vector<bool> _slotPowerPrev;
+
+    // Helpers
+    AccessResultCode doAccess(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                    uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead, uint32_t& transUs);
+    bool isSlotVisible(uint32_t slotPlus1) const;
+    bool isSpeedViolation() const;
+    void updateSlotPower();
+    void findResponders(uint32_t address, std::vector<SimI2CDevice*>& responders) const;
+};
@@ -0,0 +1,154 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CDevice
+// Simulated I2C devices for host-native testing
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SimI2CDevice.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check ACK
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CDevice::checkAck()
+{
+    if (!_isPresent)
+        return false;
+    switch (_ackMode)
+    {
+        case ACK_ALWAYS:
+            return true;
+        case ACK_NEVER:
+            return false;
+        case ACK_EVERY_NTH:
+            _ackCount++;
+            return (_ackParam == 0) || (_ackCount % _ackParam == 0);
+        case ACK_PROBABILITY:
+            // Deterministic LCG so that test runs are repeatable
+            _randSeed = _randSeed * 1103515245 + 12345;
+            return ((_randSeed >> 16) % 100) < _ackParam;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Register device
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SimRegDevice::SimRegDevice(uint32_t address, uint32_t numRegs, uint32_t regAddrBytes)
+    : SimI2CDevice(address), _regAddrBytes(regAddrBytes == 2 ? 2 : 1)
+{
+    _regs.resize(numRegs, 0);
+    _powerOnRegs.resize(numRegs, 0);
+}
+
+void SimRegDevice::setRegs(uint32_t regAddr, const std::vector<uint8_t>& bytes)
+{
+    for (uint32_t i = 0; i < bytes.size(); i++)
+    {
+        if (regAddr + i >= _regs.size())
+            break;
+        _regs[regAddr + i] = bytes[i];
+        _powerOnRegs[regAddr + i] = bytes[i];
+    }
+}
+
+bool SimRegDevice::write(const uint8_t* pData, uint32_t len)
+{
+    if (len < _regAddrBytes)
+        return true;
+    _regPtr = _regAddrBytes == 2 ? ((pData[0] << 8) | pData[1]) : pData[0];
+    for (uint32_t i = _regAddrBytes; i < len; i++)
+    {
+        if (_regPtr < _regs.size())
+            _regs[_regPtr] = pData[i];
+        _regPtr++;
+        _regWriteCount++;
+    }
+    return true;
+}
+
+void SimRegDevice::read(uint8_t* pData, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint8_t val = _regPtr < _regs.size() ? _regs[_regPtr] : 0xff;
+        if (_readHookFn)
+            _readHookFn(_regPtr, val);
+        pData[i] = val;
+        _regPtr++;
+    }
+}
+
+void SimRegDevice::powerOn()
+{
+    _regs = _powerOnRegs;
+    _regPtr = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCA9535
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimPCA9535::isSlotPowered(uint32_t slotPlus1) const
+{
+    if (!controlsSlot(slotPlus1))
+        return true;
+    uint32_t bitIdx = (slotPlus1 - _minSlotPlus1) * 2;
+    uint16_t outputs = getReg16(2);
+    uint16_t config = getReg16(6);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        uint16_t mask = 1 << (bitIdx + i);
+        if (((outputs & mask) == 0) && ((config & mask) == 0))
+            return true;
+    }
+    return false;
+}
+
+bool SimPCA9535::write(const uint8_t* pData, uint32_t len)
+{
+    if (len == 0)
+        return true;
+    _regPtr = pData[0] & 0x07;
+    for (uint32_t i = 1; i < len; i++)
+    {
+        // Inputs are read-only
+        if (_regPtr >= 2)
+            _regs[_regPtr] = pData[i];
+        // Pointer toggles within the register pair
+        _regPtr ^= 1;
+    }
+    return true;
+}
+
+void SimPCA9535::read(uint8_t* pData, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        // Inputs reflect outputs where configured as output, otherwise pulled high
+        if (_regPtr < 2)
+        {
+            uint8_t cfg = _regs[6 + _regPtr];
+            pData[i] = (_regs[2 + _regPtr] & ~cfg) | cfg;
+        }
+        else
+        {
+            pData[i] = _regs[_regPtr];
+        }
+        _regPtr ^= 1;
+    }
+}
+
+void SimPCA9535::powerOn()
+{
+    // Power-on defaults per datasheet - outputs high, all pins inputs
+    _regs[0] = _regs[1] = 0xff;
+    _regs[2] = _regs[3] = 0xff;
+    _regs[4] = _regs[5] = 0x00;
+    _regs[6] = _regs[7] = 0xff;
+    _regPtr = 0;
+}
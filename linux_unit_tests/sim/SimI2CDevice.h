@@ -0,0 +1,250 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CDevice
+// Simulated I2C devices for host-native testing
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <functional>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Base class for simulated I2C devices
+class SimI2CDevice
+{
+public:
+    SimI2CDevice(uint32_t address)
+        : _address(address)
+    {
+    }
+    virtual ~SimI2CDevice()
+    {
+    }
+
+    /// @brief Get the device address
+    uint32_t getAddress() const
+    {
+        return _address;
+    }
+
+    /// @brief Set whether the device is physically present (used to simulate hot-plug)
+    /// @param isPresent true if present
+    void setPresent(bool isPresent)
+    {
+        _isPresent = isPresent;
+    }
+    bool isPresent() const
+    {
+        return _isPresent;
+    }
+
+    /// @brief Set the maximum bus frequency the device supports (accesses while it is visible at a higher
+    ///        frequency are counted as speed violations by SimI2CCentral)
+    /// @param maxFreq frequency in Hz (0 for no limit)
+    void setMaxFreq(uint32_t maxFreq)
+    {
+        _maxFreq = maxFreq;
+    }
+    uint32_t getMaxFreq() const
+    {
+        return _maxFreq;
+    }
+
+    /// @brief Set whether the device holds SCL low (stretches the clock indefinitely) once it is addressed
+    ///        - only modelled by SimI2CPeripheral where the transaction stalls until the driver resets the engine
+    /// @param holdsBus true to hold the bus
+    void setHoldsBus(bool holdsBus)
+    {
+        _holdsBus = holdsBus;
+    }
+    bool holdsBus() const
+    {
+        return _holdsBus;
+    }
+
+    /// @brief ACK behaviour
+    enum AckMode
+    {
+        ACK_ALWAYS,
+        ACK_NEVER,
+        ACK_EVERY_NTH,
+        ACK_PROBABILITY
+    };
+
+    /// @brief Set ACK behaviour
+    /// @param ackMode mode
+    /// @param param N for ACK_EVERY_NTH, percent (0..100) for ACK_PROBABILITY
+    void setAckMode(AckMode ackMode, uint32_t param = 0)
+    {
+        _ackMode = ackMode;
+        _ackParam = param;
+        _ackCount = 0;
+    }
+
+    /// @brief Check if the device ACKs the current transaction (advances ACK state)
+    bool checkAck();
+
+    /// @brief Handle bytes written to the device (after the address byte)
+    /// @param pData data
+    /// @param len length
+    /// @return true if all bytes were ACKed
+    virtual bool write(const uint8_t* pData, uint32_t len)
+    {
+        return true;
+    }
+
+    /// @brief Handle bytes read from the device
+    /// @param pData buffer to fill
+    /// @param len number of bytes to read
+    virtual void read(uint8_t* pData, uint32_t len)
+    {
+        for (uint32_t i = 0; i < len; i++)
+            pData[i] = 0xff;
+    }
+
+    /// @brief Called when the device's power is restored
+    virtual void powerOn()
+    {
+    }
+
+private:
+    uint32_t _address = 0;
+    bool _isPresent = true;
+    uint32_t _maxFreq = 0;
+    bool _holdsBus = false;
+    AckMode _ackMode = ACK_ALWAYS;
+    uint32_t _ackParam = 0;
+    uint32_t _ackCount = 0;
+    uint32_t _randSeed = 0x12345678;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Register-based device (register pointer written first, auto-increment on read and write)
+class SimRegDevice : public SimI2CDevice
+{
+public:
+    /// @brief Constructor
+    /// @param address I2C address
+    /// @param numRegs number of byte registers
+    /// @param regAddrBytes number of register address bytes (1 or 2)
+    SimRegDevice(uint32_t address, uint32_t numRegs = 256, uint32_t regAddrBytes = 1);
+
+    /// @brief Set register contents (also become the power-on values)
+    /// @param regAddr first register
+    /// @param bytes values
+    void setRegs(uint32_t regAddr, const std::vector<uint8_t>& bytes);
+
+    /// @brief Get register value
+    uint8_t getReg(uint32_t regAddr) const
+    {
+        return regAddr < _regs.size() ? _regs[regAddr] : 0xff;
+    }
+
+    /// @brief Hook to generate dynamic register data on read (regAddr, value in/out)
+    typedef std::function<void(uint32_t regAddr, uint8_t& value)> ReadHookFn;
+    void setReadHook(ReadHookFn readHookFn)
+    {
+        _readHookFn = readHookFn;
+    }
+
+    /// @brief Number of register writes received (excluding register pointer bytes)
+    uint32_t getRegWriteCount() const
+    {
+        return _regWriteCount;
+    }
+
+    virtual bool write(const uint8_t* pData, uint32_t len) override;
+    virtual void read(uint8_t* pData, uint32_t len) override;
+    virtual void powerOn() override;
+
+private:
+    std::vector<uint8_t> _regs;
+    std::vector<uint8_t> _powerOnRegs;
+    uint32_t _regAddrBytes = 1;
+    uint32_t _regPtr = 0;
+    uint32_t _regWriteCount = 0;
+    ReadHookFn _readHookFn = nullptr;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief PCA9548A 8-channel I2C multiplexer
+class SimPCA9548A : public SimI2CDevice
+{
+public:
+    SimPCA9548A(uint32_t address)
+        : SimI2CDevice(address)
+    {
+    }
+
+    /// @brief Get the channel enable mask
+    uint8_t getChannelMask() const
+    {
+        return _chanMask;
+    }
+
+    virtual bool write(const uint8_t* pData, uint32_t len) override
+    {
+        if (len > 0)
+            _chanMask = pData[len-1];
+        return true;
+    }
+    virtual void read(uint8_t* pData, uint32_t len) override
+    {
+        for (uint32_t i = 0; i < len; i++)
+            pData[i] = _chanMask;
+    }
+    virtual void powerOn() override
+    {
+        _chanMask = 0;
+    }
+
+private:
+    uint8_t _chanMask = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief PCA9535 16-bit IO expander used as a slot power controller
+/// Each slot uses two consecutive bits (3V3 and 5V) - a rail is on when the pin is an output driven low
+class SimPCA9535 : public SimI2CDevice
+{
+public:
+    /// @brief Constructor
+    /// @param address I2C address
+    /// @param minSlotPlus1 first slotPlus1 controlled
+    /// @param numSlots number of slots controlled
+    SimPCA9535(uint32_t address, uint32_t minSlotPlus1, uint32_t numSlots)
+        : SimI2CDevice(address), _minSlotPlus1(minSlotPlus1), _numSlots(numSlots)
+    {
+        powerOn();
+    }
+
+    /// @brief Check if this controller handles the slot
+    bool controlsSlot(uint32_t slotPlus1) const
+    {
+        return (slotPlus1 >= _minSlotPlus1) && (slotPlus1 < _minSlotPlus1 + _numSlots);
+    }
+
+    /// @brief Check if a slot has power on either rail
+    bool isSlotPowered(uint32_t slotPlus1) const;
+
+    /// @brief Get 16-bit register pair value (0=input, 2=output, 4=polarity, 6=config)
+    uint16_t getReg16(uint32_t regPairBase) const
+    {
+        return _regs[regPairBase & 0x06] | (_regs[(regPairBase & 0x06) + 1] << 8);
+    }
+
+    virtual bool write(const uint8_t* pData, uint32_t len) override;
+    virtual void read(uint8_t* pData, uint32_t len) override;
+    virtual void powerOn() override;
+
+private:
+    uint32_t _minSlotPlus1 = 0;
+    uint32_t _numSlots = 0;
+    uint8_t _regs[8] = {0};
+    uint32_t _regPtr = 0;
+};
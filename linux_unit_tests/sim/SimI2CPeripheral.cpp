@@ -0,0 +1,458 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CPeripheral
+// Register-level model of the ESP32-S3 I2C master peripheral for testing RaftI2CCentral on the host
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <algorithm>
+#include "SimI2CPeripheral.h"
+#include "soc/i2c_reg.h"
+#include "esp_intr_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Register offsets
+static const uint32_t REG_OFFSET_CTR = offsetof(i2c_dev_t, ctr);
+static const uint32_t REG_OFFSET_FIFO_CONF = offsetof(i2c_dev_t, fifo_conf);
+static const uint32_t REG_OFFSET_DATA = offsetof(i2c_dev_t, data);
+static const uint32_t REG_OFFSET_INT_CLR = offsetof(i2c_dev_t, int_clr);
+static const uint32_t REG_OFFSET_INT_ENA = offsetof(i2c_dev_t, int_ena);
+
+// Register bits
+static const uint32_t CTR_TRANS_START = 1 << 5;
+static const uint32_t CTR_FSM_RST = 1 << 10;
+static const uint32_t FIFO_CONF_RX_FIFO_RST = 1 << 12;
+static const uint32_t FIFO_CONF_TX_FIFO_RST = 1 << 13;
+
+// Limit on interrupts serviced without the bus making progress
+static const uint32_t MAX_ISR_CALLS_WITHOUT_PROGRESS = 2;
+
+// Source clock (XTAL) and bit time used before the clock registers are set
+static const uint32_t SCLK_XTAL_FREQ_HZ = 40000000;
+static const uint32_t DEFAULT_BIT_TIME_NS = 10000;
+
+// Bus bits for start/restart/stop conditions and for a byte (including ACK)
+static const uint32_t BUS_BITS_PER_COND = 1;
+static const uint32_t BUS_BITS_PER_BYTE = 9;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SimI2CPeripheral::SimI2CPeripheral(i2c_dev_t& dev, int intrSource) :
+    _dev(dev), _intrSource(intrSource)
+{
+    memset((void*)&_dev, 0, sizeof(_dev));
+    hostRegAttach(&_dev, sizeof(_dev), this);
+    hostSetYieldHook(serviceStatic, this);
+}
+
+SimI2CPeripheral::~SimI2CPeripheral()
+{
+    hostSetYieldHook(nullptr, nullptr);
+    hostRegDetach(&_dev);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Devices
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimI2CPeripheral::addDevice(SimI2CDevice* pDevice)
+{
+    _devices.push_back(pDevice);
+}
+
+SimI2CDevice* SimI2CPeripheral::findDevice(uint32_t addr)
+{
+    for (SimI2CDevice* pDevice : _devices)
+    {
+        if ((pDevice->getAddress() == addr) && pDevice->isPresent())
+            return pDevice;
+    }
+    return nullptr;
+}
+
+void SimI2CPeripheral::flushDeviceWrites()
+{
+    if (_pCurDevice && (_devWriteData.size() > 0))
+        _pCurDevice->write(_devWriteData.data(), _devWriteData.size());
+    _devWriteData.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Service - run the bus and call the ISR when an enabled interrupt is pending
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimI2CPeripheral::serviceStatic(void* pArg)
+{
+    if (pArg)
+        ((SimI2CPeripheral*)pArg)->service();
+}
+
+void SimI2CPeripheral::service()
+{
+    uint32_t isrCallsWithoutProgress = 0;
+    while (isrCallsWithoutProgress <= MAX_ISR_CALLS_WITHOUT_PROGRESS)
+    {
+        // A pending interrupt is handled after the latency (and not before the previous ISR completes)
+        if (!_isrPending && (_dev.int_status.val._regVal != 0))
+        {
+            _isrPending = true;
+            _isrDueNs = std::max(_nowNs + _isrLatencyNs, _cpuFreeNs);
+        }
+
+        // The bus runs until the ISR is due
+        if (!_isrPending || (_nowNs < _isrDueNs))
+        {
+            if (step())
+            {
+                isrCallsWithoutProgress = 0;
+                continue;
+            }
+            if (!_isrPending)
+                break;
+            _nowNs = _isrDueNs;
+        }
+
+        // Call the ISR - a stalled bus resumes when it completes
+        _isrPending = false;
+        _stats.isrCalls++;
+        hostIntrRaise(_intrSource);
+        _cpuFreeNs = _nowNs + _isrDurationNs;
+        if (_stalled)
+            _nowNs = _cpuFreeNs;
+        isrCallsWithoutProgress++;
+    }
+}
+
+uint32_t SimI2CPeripheral::getBitTimeNs() const
+{
+    // SCL period in source clock cycles (the low period register holds the period - 1)
+    uint32_t sclkCycles = _dev.scl_low_period.scl_low_period + 1 + _dev.scl_high_period.scl_high_period +
+                _dev.scl_high_period.scl_wait_high_period;
+    if (sclkCycles <= 1)
+        return DEFAULT_BIT_TIME_NS;
+    uint64_t sclkDiv = _dev.clk_conf.sclk_div_num + 1;
+    return (uint32_t)(((uint64_t)sclkCycles * sclkDiv * 1000000000ULL) / SCLK_XTAL_FREQ_HZ);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Execute one bus event (start, byte, stop, etc) - returns false if idle or stalled
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimI2CPeripheral::step()
+{
+    // After a NACK the master generates a STOP
+    if (_engineState == ENGINE_NACK_STOP)
+    {
+        flushDeviceWrites();
+        _pCurDevice = nullptr;
+        busEvent(BUS_BITS_PER_COND);
+        _stats.stops++;
+        _engineState = ENGINE_IDLE;
+        _dev.sr.bus_busy = 0;
+        raiseInt(I2C_TRANS_COMPLETE_INT_ST);
+        return true;
+    }
+    if (_engineState != ENGINE_RUNNING)
+        return false;
+
+    // A device holding SCL low stalls the bus until the engine is reset
+    if (_pCurDevice && _pCurDevice->holdsBus())
+    {
+        stall();
+        return false;
+    }
+
+    // Running off the end of the command queue is treated as a timeout
+    if (_cmdIdx >= CMD_QUEUE_SIZE)
+    {
+        resetEngine();
+        raiseInt(I2C_TIME_OUT_INT_ST);
+        return true;
+    }
+
+    i2c_comd_reg_t cmd = _dev.comd[_cmdIdx];
+    switch (cmd.op_code)
+    {
+        case CMD_RSTART:
+        {
+            flushDeviceWrites();
+            busEvent(BUS_BITS_PER_COND);
+            if (_dev.sr.bus_busy)
+                _stats.restarts++;
+            else
+                _stats.starts++;
+            _dev.sr.bus_busy = 1;
+            _addrPending = true;
+            cmdDone();
+            return true;
+        }
+        case CMD_WRITE:
+        {
+            if (_cmdBytesDone >= cmd.byte_num)
+            {
+                cmdDone();
+                return true;
+            }
+            if (_txFifo.empty())
+            {
+                if (!_stalled)
+                    _stats.txFifoStalls++;
+                stall();
+                return false;
+            }
+            busEvent(BUS_BITS_PER_BYTE);
+            uint8_t byteVal = _txFifo.front();
+            _txFifo.pop_front();
+            updateFifoLevels();
+
+            // Address byte selects the device, data bytes are passed to the device at the next (re)start or stop
+            bool isAcked = false;
+            if (_addrPending)
+            {
+                _addrPending = false;
+                _pCurDevice = findDevice(byteVal >> 1);
+                isAcked = _pCurDevice && _pCurDevice->checkAck();
+                if (!isAcked)
+                    _pCurDevice = nullptr;
+            }
+            else if (_pCurDevice)
+            {
+                _devWriteData.push_back(byteVal);
+                isAcked = true;
+            }
+            _stats.bytesWritten++;
+            _cmdBytesDone++;
+            if (!isAcked && cmd.ack_en && (cmd.ack_exp == 0))
+            {
+                _stats.nacks++;
+                _engineState = ENGINE_NACK_STOP;
+                raiseInt(I2C_NACK_INT_ST);
+                return true;
+            }
+            if (_cmdBytesDone >= cmd.byte_num)
+                cmdDone();
+            return true;
+        }
+        case CMD_READ:
+        {
+            if (_cmdBytesDone >= cmd.byte_num)
+            {
+                cmdDone();
+                return true;
+            }
+            if (_rxFifo.size() >= FIFO_SIZE)
+            {
+                if (!_stalled)
+                    _stats.rxFifoStalls++;
+                stall();
+                return false;
+            }
+            busEvent(BUS_BITS_PER_BYTE);
+            uint8_t byteVal = 0xff;
+            if (_pCurDevice)
+                _pCurDevice->read(&byteVal, 1);
+            _rxFifo.push_back(byteVal);
+            updateFifoLevels();
+            _stats.bytesRead++;
+            _cmdBytesDone++;
+            if (_cmdBytesDone >= cmd.byte_num)
+                cmdDone();
+            return true;
+        }
+        case CMD_STOP:
+        {
+            flushDeviceWrites();
+            _pCurDevice = nullptr;
+            busEvent(BUS_BITS_PER_COND);
+            _stats.stops++;
+            cmdDone();
+            _engineState = ENGINE_IDLE;
+            _dev.sr.bus_busy = 0;
+            raiseInt(I2C_TRANS_COMPLETE_INT_ST);
+            return true;
+        }
+        case CMD_END:
+        {
+            // SCL is held low until the command queue is refilled and trans_start is set
+            _stats.endCmds++;
+            cmdDone();
+            _engineState = ENGINE_PAUSED_AT_END;
+            stall();
+            raiseInt(I2C_END_DETECT_INT_ST);
+            return true;
+        }
+        default:
+        {
+            resetEngine();
+            raiseInt(I2C_TIME_OUT_INT_ST);
+            return true;
+        }
+    }
+}
+
+void SimI2CPeripheral::busEvent(uint32_t numBits)
+{
+    // Bus resuming after a stall
+    if (_stalled)
+    {
+        uint64_t gapNs = _nowNs - _stallStartNs;
+        if (gapNs > 0)
+        {
+            _stats.idleGapNs += gapNs;
+            _stats.idleGapCount++;
+            _stats.maxIdleGapNs = std::max(_stats.maxIdleGapNs, gapNs);
+        }
+        _stalled = false;
+    }
+    uint64_t eventNs = (uint64_t)numBits * getBitTimeNs();
+    _nowNs += eventNs;
+    _stats.busTimeNs += eventNs;
+}
+
+void SimI2CPeripheral::stall()
+{
+    if (_stalled)
+        return;
+    _stalled = true;
+    _stallStartNs = _nowNs;
+}
+
+void SimI2CPeripheral::cmdDone()
+{
+    _dev.comd[_cmdIdx].command_done = 1;
+    _cmdIdx++;
+    _cmdBytesDone = 0;
+    _stats.cmdsExecuted++;
+}
+
+void SimI2CPeripheral::startEngine()
+{
+    if (_engineState == ENGINE_IDLE)
+        raiseInt(I2C_TRANS_START_INT_ST);
+    else if (_engineState != ENGINE_PAUSED_AT_END)
+        return;
+    _engineState = ENGINE_RUNNING;
+    _cmdIdx = 0;
+    _cmdBytesDone = 0;
+}
+
+void SimI2CPeripheral::resetEngine()
+{
+    _engineState = ENGINE_IDLE;
+    _cmdIdx = 0;
+    _cmdBytesDone = 0;
+    _stalled = false;
+    _addrPending = false;
+    _pCurDevice = nullptr;
+    _devWriteData.clear();
+    _dev.sr.bus_busy = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interrupts and FIFO levels
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimI2CPeripheral::raiseInt(uint32_t intBits)
+{
+    _dev.int_raw.val._regVal |= intBits;
+    updateIntStatus();
+}
+
+void SimI2CPeripheral::updateIntStatus()
+{
+    _dev.int_status.val._regVal = _dev.int_raw.val._regVal & _dev.int_ena.val._regVal;
+}
+
+void SimI2CPeripheral::updateFifoLevels()
+{
+    _dev.sr.txfifo_cnt = _txFifo.size();
+    _dev.sr.rxfifo_cnt = _rxFifo.size();
+
+    // Watermark interrupts are raised while the level condition holds
+    uint32_t intBits = 0;
+    if (_txFifo.size() < _dev.fifo_conf.txfifo_wm_thrhd)
+        intBits |= I2C_TXFIFO_WM_INT_ST;
+    if (_rxFifo.size() > _dev.fifo_conf.rxfifo_wm_thrhd)
+        intBits |= I2C_RXFIFO_WM_INT_ST;
+    raiseInt(intBits);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Register access
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimI2CPeripheral::onRegRead(uint32_t regOffset)
+{
+    // Reading the data register pops the RX FIFO
+    if (regOffset == REG_OFFSET_DATA)
+    {
+        uint32_t byteVal = 0;
+        if (_rxFifo.empty())
+        {
+            _stats.fifoErrors++;
+            raiseInt(I2C_RXFIFO_UDF_INT_ST);
+        }
+        else
+        {
+            byteVal = _rxFifo.front();
+            _rxFifo.pop_front();
+        }
+        _dev.data.val._regVal = byteVal;
+        updateFifoLevels();
+    }
+}
+
+void SimI2CPeripheral::onRegWrite(uint32_t regOffset, uint32_t fieldMask)
+{
+    if (regOffset == REG_OFFSET_CTR)
+    {
+        uint32_t ctrVal = _dev.ctr.val._regVal;
+        if (ctrVal & CTR_FSM_RST)
+            resetEngine();
+        if ((fieldMask & CTR_TRANS_START) && (ctrVal & CTR_TRANS_START))
+        {
+            // trans_start is self-clearing
+            _dev.ctr.val._regVal = ctrVal & ~CTR_TRANS_START;
+            startEngine();
+        }
+    }
+    else if (regOffset == REG_OFFSET_FIFO_CONF)
+    {
+        uint32_t fifoConfVal = _dev.fifo_conf.val._regVal;
+        if (fifoConfVal & FIFO_CONF_TX_FIFO_RST)
+            _txFifo.clear();
+        if (fifoConfVal & FIFO_CONF_RX_FIFO_RST)
+            _rxFifo.clear();
+        updateFifoLevels();
+    }
+    else if (regOffset == REG_OFFSET_DATA)
+    {
+        // Writing the data register pushes to the TX FIFO
+        if (_txFifo.size() < FIFO_SIZE)
+        {
+            _txFifo.push_back(_dev.data.val._regVal & 0xff);
+        }
+        else
+        {
+            _stats.fifoErrors++;
+            raiseInt(I2C_TXFIFO_OVF_INT_ST);
+        }
+        updateFifoLevels();
+    }
+    else if (regOffset == REG_OFFSET_INT_CLR)
+    {
+        _dev.int_raw.val._regVal &= ~_dev.int_clr.val._regVal;
+        _dev.int_clr.val._regVal = 0;
+        updateFifoLevels();
+    }
+    else if (regOffset == REG_OFFSET_INT_ENA)
+    {
+        updateIntStatus();
+    }
+}
@@ -0,0 +1,167 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimI2CPeripheral
+// Register-level model of the ESP32-S3 I2C master peripheral for testing RaftI2CCentral on the host
+//
+// The model is attached to a register block (I2C0 or I2C1) from the soc/i2c_struct.h shim and executes the
+// command registers (RSTART, WRITE, READ, STOP, END) against simulated devices - bytes to write are taken from
+// the TX FIFO and bytes read are put in the RX FIFO, the bus stalls when a FIFO is empty (or full) and interrupt
+// raw/status bits are raised as the hardware would. The model runs when the driver yields (vTaskDelay) and
+// calls the allocated interrupt handler whenever an enabled interrupt is pending
+//
+// Time is modelled in bus bit-times derived from the clock registers the driver sets (bytes take 9 bits, start,
+// restart and stop 1 bit each). An interrupt is handled after the ISR latency and the bus carries on meanwhile -
+// if the bus stalls (FIFO empty/full or END command) it resumes when the ISR completes and the time stalled is
+// counted as an idle gap. Time waiting on task-level code between transactions is not modelled
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include "HostReg.h"
+#include "soc/i2c_struct.h"
+#include "SimI2CDevice.h"
+
+class SimI2CPeripheral : public HostRegHandler
+{
+public:
+    /// @brief Constructor
+    /// @param dev register block to model (e.g. I2C0)
+    /// @param intrSource interrupt source (e.g. ETS_I2C_EXT0_INTR_SOURCE)
+    SimI2CPeripheral(i2c_dev_t& dev, int intrSource);
+    virtual ~SimI2CPeripheral();
+
+    /// @brief Add a device to the bus (not owned)
+    void addDevice(SimI2CDevice* pDevice);
+
+    /// @brief Run the model until the bus is idle or stalled waiting for the driver
+    void service();
+
+    /// @brief Set interrupt timing
+    /// @param latencyNs time from an interrupt being raised to the ISR running
+    /// @param durationNs time the ISR takes (a stalled bus resumes when it completes)
+    void setIsrTiming(uint32_t latencyNs, uint32_t durationNs)
+    {
+        _isrLatencyNs = latencyNs;
+        _isrDurationNs = durationNs;
+    }
+
+    /// @brief Get the bus bit time from the clock registers
+    uint32_t getBitTimeNs() const;
+
+    /// @brief Get simulated time (ns)
+    uint64_t getTimeNs() const
+    {
+        return _nowNs;
+    }
+
+    /// @brief Statistics
+    struct Stats
+    {
+        uint32_t starts = 0;
+        uint32_t restarts = 0;
+        uint32_t stops = 0;
+        uint32_t endCmds = 0;
+        uint32_t cmdsExecuted = 0;
+        uint32_t bytesWritten = 0;
+        uint32_t bytesRead = 0;
+        uint32_t nacks = 0;
+        uint32_t isrCalls = 0;
+        uint32_t txFifoStalls = 0;
+        uint32_t rxFifoStalls = 0;
+        uint32_t fifoErrors = 0;
+        // Time spent clocking the bus and time the bus was stalled mid-transaction waiting for the driver
+        uint64_t busTimeNs = 0;
+        uint64_t idleGapNs = 0;
+        uint32_t idleGapCount = 0;
+        uint64_t maxIdleGapNs = 0;
+    };
+    const Stats& getStats() const
+    {
+        return _stats;
+    }
+    void clearStats()
+    {
+        _stats = Stats();
+    }
+
+    // HostRegHandler
+    virtual void onRegRead(uint32_t regOffset) override;
+    virtual void onRegWrite(uint32_t regOffset, uint32_t fieldMask) override;
+
+    // Command queue and FIFO sizes
+    static const uint32_t CMD_QUEUE_SIZE = 8;
+    static const uint32_t FIFO_SIZE = 32;
+
+    // Command op codes
+    static const uint32_t CMD_RSTART = 6;
+    static const uint32_t CMD_WRITE = 1;
+    static const uint32_t CMD_READ = 3;
+    static const uint32_t CMD_STOP = 2;
+    static const uint32_t CMD_END = 4;
+
+    // Default interrupt timing
+    static const uint32_t DEFAULT_ISR_LATENCY_NS = 2000;
+    static const uint32_t DEFAULT_ISR_DURATION_NS = 3000;
+
+private:
+    // Registers and interrupt
+    i2c_dev_t& _dev;
+    int _intrSource = 0;
+
+    // Devices
+    std::vector<SimI2CDevice*> _devices;
+
+    // FIFOs
+    std::deque<uint8_t> _txFifo;
+    std::deque<uint8_t> _rxFifo;
+
+    // Engine state
+    enum EngineState
+    {
+        ENGINE_IDLE,
+        ENGINE_RUNNING,
+        ENGINE_NACK_STOP,
+        ENGINE_PAUSED_AT_END
+    };
+    EngineState _engineState = ENGINE_IDLE;
+    uint32_t _cmdIdx = 0;
+    uint32_t _cmdBytesDone = 0;
+
+    // Timing
+    uint64_t _nowNs = 0;
+    uint32_t _isrLatencyNs = DEFAULT_ISR_LATENCY_NS;
+    uint32_t _isrDurationNs = DEFAULT_ISR_DURATION_NS;
+    bool _isrPending = false;
+    uint64_t _isrDueNs = 0;
+    uint64_t _cpuFreeNs = 0;
+    bool _stalled = false;
+    uint64_t _stallStartNs = 0;
+
+    // Current transaction
+    bool _addrPending = false;
+    SimI2CDevice* _pCurDevice = nullptr;
+    std::vector<uint8_t> _devWriteData;
+
+    // Stats
+    Stats _stats;
+
+    // Helpers
+    static void serviceStatic(void* pArg);
+    bool step();
+    void busEvent(uint32_t numBits);
+    void stall();
+    void startEngine();
+    void resetEngine();
+    void cmdDone();
+    void flushDeviceWrites();
+    SimI2CDevice* findDevice(uint32_t addr);
+    void raiseInt(uint32_t intBits);
+    void updateFifoLevels();
+    void updateIntStatus();
+};
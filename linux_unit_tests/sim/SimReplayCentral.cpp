@@ -0,0 +1,173 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimReplayCentral
+// Simulated I2C central which responds as a captured bus session did
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <algorithm>
+#include "SimReplayCentral.h"
+#include "Logger.h"
+#include "driver/gpio.h"
+
+// #define DEBUG_SIM_REPLAY_UNMATCHED
+
+#ifdef DEBUG_SIM_REPLAY_UNMATCHED
+static const char* MODULE_PREFIX = "SimReplay";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SimReplayCentral::SimReplayCentral(const I2CCapture& capture) :
+    _capture(capture)
+{
+    // Index the capture by element
+    const std::vector<I2CCaptureRec>& recs = _capture.getRecs();
+    for (uint32_t recIdx = 0; recIdx < recs.size(); recIdx++)
+        _recIdxsByElem[(recs[recIdx].slotPlus1 << 8) | recs[recIdx].addr].push_back(recIdx);
+}
+
+SimReplayCentral::~SimReplayCentral()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Init / deinit
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimReplayCentral::init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+            uint32_t busFilteringLevel)
+{
+    _busFrequency = busFrequency > 0 ? busFrequency : 100000;
+
+    // Bus lines idle high
+    hostGpioSetInputLevel((gpio_num_t)pinSDA, 1);
+    hostGpioSetInputLevel((gpio_num_t)pinSCL, 1);
+
+    // Estimate the per-transaction overhead of the captured bus (median of time beyond the bit time)
+    std::vector<int32_t> overheads;
+    for (const I2CCaptureRec& rec : _capture.getRecs())
+    {
+        if (rec.durationUs > 0)
+            overheads.push_back((int32_t)rec.durationUs - (int32_t)bitTimeUs(rec.writeData.size(), rec.readReqLen));
+    }
+    _overheadUs = 0;
+    if (overheads.size() > 0)
+    {
+        std::nth_element(overheads.begin(), overheads.begin() + overheads.size() / 2, overheads.end());
+        int32_t medianUs = overheads[overheads.size() / 2];
+        _overheadUs = medianUs > 0 ? medianUs : 0;
+    }
+    _isInitialised = true;
+    return true;
+}
+
+void SimReplayCentral::deinit()
+{
+    _isInitialised = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Access the bus
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftI2CCentralIF::AccessResultCode SimReplayCentral::access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead)
+{
+    numRead = 0;
+    if (!_isInitialised)
+        return ACCESS_RESULT_NOT_INIT;
+
+    // Time of the access and its duration
+    uint64_t timeUs = BusI2CClock::nowUs();
+    if (_pVirtualClock)
+        _pVirtualClock->advanceUs(bitTimeUs(numToWrite, numToRead) + _overheadUs);
+
+    // Find the captured access - devices on the main bus respond whichever slot is enabled
+    uint32_t slotPlus1 = _slotTracker.getSlotPlus1(address);
+    const I2CCaptureRec* pRec = findRec(address, slotPlus1, timeUs, nullptr, 0, 0);
+    if (!pRec && (slotPlus1 != 0))
+    {
+        slotPlus1 = 0;
+        pRec = findRec(address, slotPlus1, timeUs, nullptr, 0, 0);
+    }
+    AccessResultCode rslt = pRec ? pRec->result : ACCESS_RESULT_ACK_ERROR;
+    if (!pRec)
+        _unmatchedCount++;
+
+    // Read data from a captured access which wrote the same data (e.g. register address)
+    if ((rslt == ACCESS_RESULT_OK) && (numToRead > 0))
+    {
+        const I2CCaptureRec* pReadRec = findRec(address, slotPlus1, timeUs, pWriteBuf, numToWrite, numToRead);
+        if (!pReadRec)
+            pReadRec = findRec(address, slotPlus1, timeUs, nullptr, 0, numToRead);
+        memset(pReadBuf, 0, numToRead);
+        if (pReadRec)
+            memcpy(pReadBuf, pReadRec->readData.data(), numToRead);
+        else
+            _unmatchedCount++;
+        numRead = numToRead;
+#ifdef DEBUG_SIM_REPLAY_UNMATCHED
+        if (!pReadRec)
+            LOG_I(MODULE_PREFIX, "access addr 0x%02x@%d no read data len %d", address, slotPlus1, numToRead);
+#endif
+    }
+
+    // Track slot changes made by the bus under test
+    _slotTracker.update(address, pWriteBuf, numToWrite, rslt);
+    _i2cStats.update(true, rslt == ACCESS_RESULT_ACK_ERROR, rslt == ACCESS_RESULT_HW_TIME_OUT,
+                rslt == ACCESS_RESULT_OK, rslt == ACCESS_RESULT_ARB_LOST, true, false);
+    return rslt;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t SimReplayCentral::bitTimeUs(uint32_t numToWrite, uint32_t numToRead) const
+{
+    // Start, address byte(s), data bytes, stop
+    uint32_t numBits = 2 + (1 + numToWrite) * 9 + (numToRead > 0 ? (1 + numToRead) * 9 : 0);
+    return (uint32_t)(((uint64_t)numBits * 1000000) / _busFrequency);
+}
+
+/// @brief Find the most recent captured access at or before a time (or the earliest after it if there is none)
+/// @param pWriteBuf if not nullptr only accesses which wrote the same data are considered
+/// @param numToRead if not 0 only successful accesses which read at least this much are considered
+const I2CCaptureRec* SimReplayCentral::findRec(uint32_t address, uint32_t slotPlus1, uint64_t timeUs,
+            const uint8_t* pWriteBuf, uint32_t numToWrite, uint32_t numToRead) const
+{
+    auto elemIt = _recIdxsByElem.find((slotPlus1 << 8) | address);
+    if (elemIt == _recIdxsByElem.end())
+        return nullptr;
+    const std::vector<I2CCaptureRec>& recs = _capture.getRecs();
+    const std::vector<uint32_t>& recIdxs = elemIt->second;
+    auto isMatch = [&](const I2CCaptureRec& rec) {
+        if (pWriteBuf && ((rec.writeData.size() != numToWrite) || (memcmp(rec.writeData.data(), pWriteBuf, numToWrite) != 0)))
+            return false;
+        return (numToRead == 0) || ((rec.result == ACCESS_RESULT_OK) && (rec.readData.size() >= numToRead));
+    };
+
+    // First access after the time
+    auto afterIt = std::upper_bound(recIdxs.begin(), recIdxs.end(), timeUs,
+                [&recs](uint64_t t, uint32_t recIdx) { return t < recs[recIdx].timeUs; });
+
+    // Search back then forward
+    for (auto it = afterIt; it != recIdxs.begin(); )
+    {
+        --it;
+        if (isMatch(recs[*it]))
+            return &recs[*it];
+    }
+    for (auto it = afterIt; it != recIdxs.end(); ++it)
+    {
+        if (isMatch(recs[*it]))
+            return &recs[*it];
+    }
+    return nullptr;
+}
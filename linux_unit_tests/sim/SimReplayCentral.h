@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SimReplayCentral
+// Simulated I2C central which responds as a captured bus session did
+//
+// Each access is answered from the capture (see RaftI2CCentralCapture) using the most recent captured access
+// to the same address on the same slot at or before the current bus time - so devices ACK (and hot-plug)
+// when they did in the original session and return the data they returned then
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include "RaftI2CCentralIF.h"
+#include "BusI2CClock.h"
+#include "I2CCapture.h"
+
+class SimReplayCentral : public RaftI2CCentralIF
+{
+public:
+    /// @brief Constructor
+    /// @param capture capture to replay (must remain valid while in use)
+    SimReplayCentral(const I2CCapture& capture);
+    virtual ~SimReplayCentral();
+
+    // Init/de-init
+    virtual bool init(uint8_t i2cPort, uint16_t pinSDA, uint16_t pinSCL, uint32_t busFrequency,
+                uint32_t busFilteringLevel = DEFAULT_BUS_FILTER_LEVEL) override final;
+    virtual void deinit() override final;
+
+    // Busy
+    virtual bool isBusy() override final
+    {
+        return false;
+    }
+
+    // Access the bus
+    virtual AccessResultCode access(uint32_t address, const uint8_t* pWriteBuf, uint32_t numToWrite,
+                    uint8_t* pReadBuf, uint32_t numToRead, uint32_t& numRead) override final;
+
+    // Check if bus operating ok
+    virtual bool isOperatingOk() const override final
+    {
+        return _isInitialised;
+    }
+
+    // Set bus frequency for subsequent accesses
+    virtual bool setBusFrequency(uint32_t busFreq) override final
+    {
+        if (busFreq == 0)
+            return false;
+        _busFrequency = busFreq;
+        return true;
+    }
+
+    /// @brief Advance a virtual clock by the time of each transaction
+    /// @param pClock virtual clock (nullptr to disable)
+    void setVirtualClock(BusI2CVirtualClock* pClock)
+    {
+        _pVirtualClock = pClock;
+    }
+
+    /// @brief Get per-transaction overhead (beyond bit time) estimated from the capture
+    uint32_t getOverheadUs() const
+    {
+        return _overheadUs;
+    }
+
+    /// @brief Get count of accesses which had no captured equivalent
+    uint32_t getUnmatchedCount() const
+    {
+        return _unmatchedCount;
+    }
+
+private:
+    // Capture
+    const I2CCapture& _capture;
+    std::map<uint32_t, std::vector<uint32_t>> _recIdxsByElem;
+
+    // Settings
+    bool _isInitialised = false;
+    uint32_t _busFrequency = 100000;
+    uint32_t _overheadUs = 0;
+    BusI2CVirtualClock* _pVirtualClock = nullptr;
+
+    // Slot currently enabled by the bus under test
+    I2CCaptureSlotTracker _slotTracker;
+
+    // Stats
+    uint32_t _unmatchedCount = 0;
+
+    // Helpers
+    uint32_t bitTimeUs(uint32_t numToWrite, uint32_t numToRead) const;
+    const I2CCaptureRec* findRec(uint32_t address, uint32_t slotPlus1, uint64_t timeUs,
+                const uint8_t* pWriteBuf, uint32_t numToWrite, uint32_t numToRead) const;
+};
@@ -0,0 +1,93 @@
+import json
+import struct
+import sys
+import argparse
+
+# ConvertI2CTraceToChrome.py
+# Rob Dobson 2024
+# This script converts a binary I2C transaction trace (from BusI2C::getTrace()) into Chrome trace JSON
+# which can be viewed in chrome://tracing or https://ui.perfetto.dev
+# The trace file can be the raw binary or the same data as a hex string
+# Each slot is shown as a separate thread (slot 0 is the main bus) and each transaction is a complete event
+# Transactions rejected before reaching the bus (e.g. barred) are shown as instant events
+
+TRACE_MAGIC = 0x54324952
+TRACE_HEADER_FORMAT = "<IBBHII"
+TRACE_REC_FORMAT = "<IIHHHBB"
+TRACE_FLAG_ASYNC = 0x80
+
+REQ_TYPE_NAMES = ["std", "poll", "fwUpdate", "slowScan", "fastScan", "sendIfPaused"]
+RESULT_NAMES = ["pending", "ok", "hwTimeOut", "ackError", "arbLost", "swTimeOut", "invalid",
+                "notReady", "incomplete", "barred", "notInit", "busStuck", "slotPowerUnstable"]
+
+def read_trace(trace_path):
+    with open(trace_path, 'rb') as trace_file:
+        trace_data = trace_file.read()
+    # Accept hex text as well as binary
+    if not trace_data.startswith(struct.pack("<I", TRACE_MAGIC)):
+        trace_data = bytes.fromhex(trace_data.decode("ascii").strip())
+    magic, version, rec_size, _, num_recs, total_recorded = struct.unpack_from(TRACE_HEADER_FORMAT, trace_data, 0)
+    if magic != TRACE_MAGIC or version != 1:
+        raise ValueError("Not an I2C trace file (magic 0x%08x version %d)" % (magic, version))
+    header_size = struct.calcsize(TRACE_HEADER_FORMAT)
+    recs = []
+    for rec_idx in range(num_recs):
+        recs.append(struct.unpack_from(TRACE_REC_FORMAT, trace_data, header_size + rec_idx * rec_size))
+    return recs, total_recorded
+
+def convert_trace(recs, bus_name):
+    events = []
+    slots_seen = set()
+    time_base_us = 0
+    last_start_us = None
+    for start_us, duration_us, addr_and_slot, write_len, read_len, req_type, result_code in recs:
+        # Timestamps are the low 32 bits of a us clock so unwrap them
+        if last_start_us is not None and start_us < last_start_us:
+            time_base_us += 1 << 32
+        last_start_us = start_us
+        addr = addr_and_slot & 0x3ff
+        slot_plus1 = (addr_and_slot >> 10) & 0x3f
+        slots_seen.add(slot_plus1)
+        base_req_type = req_type & ~TRACE_FLAG_ASYNC
+        req_name = REQ_TYPE_NAMES[base_req_type] if base_req_type < len(REQ_TYPE_NAMES) else str(base_req_type)
+        result_name = RESULT_NAMES[result_code] if result_code < len(RESULT_NAMES) else str(result_code)
+        event = {
+            "name": "0x%02x@%d %s" % (addr, slot_plus1, req_name),
+            "cat": req_name,
+            "ts": time_base_us + start_us,
+            "pid": 1,
+            "tid": slot_plus1,
+            "args": {
+                "addr": "0x%02x" % addr,
+                "slotPlus1": slot_plus1,
+                "async": bool(req_type & TRACE_FLAG_ASYNC),
+                "writeLen": write_len,
+                "readLen": read_len,
+                "result": result_name
+            }
+        }
+        if duration_us == 0 and result_code != 1:
+            event["ph"] = "i"
+            event["s"] = "t"
+        else:
+            event["ph"] = "X"
+            event["dur"] = duration_us
+        events.append(event)
+
+    # Name the process and threads
+    events.append({"name": "process_name", "ph": "M", "pid": 1, "args": {"name": bus_name}})
+    for slot_plus1 in sorted(slots_seen):
+        thread_name = "main bus" if slot_plus1 == 0 else "slot %d" % slot_plus1
+        events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": slot_plus1, "args": {"name": thread_name}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+if __name__ == "__main__":
+    argparse = argparse.ArgumentParser()
+    argparse.add_argument("trace_path", help="Path to the binary (or hex) trace file")
+    argparse.add_argument("json_path", help="Path to the Chrome trace JSON file to generate")
+    argparse.add_argument("--busname", help="Name of the bus shown in the trace viewer", default="I2C")
+    args = argparse.parse_args()
+    recs, total_recorded = read_trace(args.trace_path)
+    with open(args.json_path, 'w') as json_file:
+        json.dump(convert_trace(recs, args.busname), json_file)
+    print("Converted %d records (%d recorded in total)" % (len(recs), total_recorded))
@@ -1,3 +1,5 @@
+import re
+
 def get_polling_config_result_len_bytes(polling_config_record):
     
     # Parse the polling config record
@@ -23,11 +25,258 @@ def get_polling_config_result_len_bytes(polling_config_record):
             raise ValueError("Invalid polling config record value: " + pc_read_def)
     return pc_len
 
+def decode_generator_len_fn_name(dev_type_record):
+    return "pollResultLen_" + c_identifier(dev_type_record["deviceType"])
+
 def decode_generator_len_fn(dev_type_record):
     # Parse the device type record polling config record
     # Accessing nested dictionary safely with default empty objects
     polling_config_record = dev_type_record.get("pollingConfigJson", "").get("c", "")
     rslt_len = get_polling_config_result_len_bytes(polling_config_record)
-    # Return a C++ anonymous function that returns the result length
-    return "[]() -> uint32_t { return " + str(rslt_len) + "; }"
+    # Return a named C++ function that returns the result length (a named function rather than a lambda so the
+    # device type records can be constant initialised)
+    return f"static uint32_t {decode_generator_len_fn_name(dev_type_record)}() {{ return {rslt_len}; }}"
+
+
+# Size of the timestamp at the start of each poll record (DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE)
+POLL_RESULT_TIMESTAMP_SIZE = 2
+
+# Bits for each python struct type character (as used in the devInfoJson attribute "t" values)
+STRUCT_TYPE_BITS = {
+    "c": 8, "b": 8, "B": 8, "?": 8,
+    "h": 16, "H": 16,
+    "i": 32, "I": 32, "l": 32, "L": 32,
+    "q": 64, "Q": 64,
+    "f": 32, "d": 64,
+}
+STRUCT_TYPE_SIGNED = "bhilq"
+STRUCT_TYPE_FLOAT = "fd"
+
+def c_identifier(name):
+    # Make a string usable as a C identifier
+    ident = re.sub(r'\W', '_', name)
+    if len(ident) == 0 or ident[0].isdigit():
+        ident = "_" + ident
+    return ident
+
+def c_float(value):
+    # Format a float literal
+    return repr(float(value)) + "f"
+
+def parse_attr_type(attr_type):
+    # Attr type can be of the form AA or AA:NN or AA:NN:MM (and @X can prefix any of these) - see DeviceManager.ts
+    #   AA is the python struct type (e.g. >h)
+    #   NN is the number of bits to read (multiple of 4)
+    #   MM is the position of the sign bit for signed values
+    #   @X means read from byte X of the record (after the timestamp) and don't advance the read position
+    abs_byte = None
+    at_match = re.match(r'^@(\d+)(.*)$', attr_type)
+    if at_match:
+        abs_byte = int(at_match.group(1))
+        attr_type = at_match.group(2)
+    type_split = attr_type.split(":")
+    struct_type = type_split[0]
+    type_char = struct_type.lstrip("<>!=@")
+    if len(type_char) != 1 or type_char not in STRUCT_TYPE_BITS:
+        raise ValueError("Unsupported attribute type: " + attr_type)
+    struct_bits = STRUCT_TYPE_BITS[type_char]
+    is_little_endian = struct_type.startswith("<")
+    if struct_bits > 8 and not struct_type.startswith(("<", ">", "!")):
+        raise ValueError("Attribute type needs byte order (< or >): " + attr_type)
+    read_bits = int(type_split[1]) if len(type_split) > 1 else struct_bits
+    sign_bit_pos = int(type_split[2]) if len(type_split) > 2 else 0
+    if read_bits % 4 != 0 or read_bits > struct_bits:
+        raise ValueError("Invalid number of bits in attribute type: " + attr_type)
+    return abs_byte, type_char, struct_bits, is_little_endian, read_bits, sign_bit_pos
+
+def gen_raw_value_expr(start_nibble, read_nibbles, struct_bits, is_little_endian, raw_type):
+    # The value is read in nibbles and padded to the size of the struct type (on the right for little endian
+    # and on the left otherwise) before being unpacked - the same way as DeviceManager.ts does it with hex strings
+    pad_nibbles = struct_bits // 4 - read_nibbles
+    nibble_srcs = list(range(start_nibble, start_nibble + read_nibbles))
+    nibble_srcs = nibble_srcs + [None] * pad_nibbles if is_little_endian else [None] * pad_nibbles + nibble_srcs
+    num_bytes = struct_bits // 8
+    terms = []
+    for byte_idx in range(num_bytes):
+        hi_src = nibble_srcs[byte_idx * 2]
+        lo_src = nibble_srcs[byte_idx * 2 + 1]
+        if hi_src is None and lo_src is None:
+            continue
+        if hi_src is not None and hi_src % 2 == 0 and lo_src == hi_src + 1:
+            byte_expr = f"p[{hi_src // 2}]"
+        else:
+            parts = []
+            if hi_src is not None:
+                parts.append(f"((p[{hi_src // 2}] >> 4) << 4)" if hi_src % 2 == 0 else f"((p[{hi_src // 2}] & 0x0f) << 4)")
+            if lo_src is not None:
+                parts.append(f"(p[{lo_src // 2}] >> 4)" if lo_src % 2 == 0 else f"(p[{lo_src // 2}] & 0x0f)")
+            byte_expr = "(" + " | ".join(parts) + ")"
+        shift = byte_idx * 8 if is_little_endian else (num_bytes - 1 - byte_idx) * 8
+        terms.append(f"(({raw_type}){byte_expr} << {shift})" if shift > 0 else f"({raw_type}){byte_expr}")
+    return " | ".join(terms) if len(terms) > 0 else f"({raw_type})0"
+
+def gen_attr_decode(attr, cur_nibble, data_len):
+    # Returns (field C type, value expression, nibbles to advance)
+    abs_byte, type_char, struct_bits, is_little_endian, read_bits, sign_bit_pos = parse_attr_type(attr["t"])
+    start_nibble = abs_byte * 2 if abs_byte is not None else cur_nibble
+    read_nibbles = read_bits // 4
+    if start_nibble + read_nibbles > data_len * 2:
+        raise ValueError(f"Attribute {attr['n']} is outside the poll result")
+    raw_type = "uint64_t" if struct_bits > 32 else "uint32_t"
+    signed_type = "int64_t" if struct_bits > 32 else "int32_t"
+    raw_expr = "(" + gen_raw_value_expr(start_nibble, read_nibbles, struct_bits, is_little_endian, raw_type) + ")"
+
+    # Unpack as signed, unsigned or float
+    if type_char in STRUCT_TYPE_FLOAT:
+        if "m" in attr or attr.get("s", 0):
+            raise ValueError(f"Mask and shift aren't supported on float attribute {attr['n']}")
+        value_expr = f"pollDecodeFloat({raw_expr})" if struct_bits == 32 else f"pollDecodeDouble({raw_expr})"
+        field_type = "float" if struct_bits == 32 else "double"
+    elif type_char in STRUCT_TYPE_SIGNED and sign_bit_pos > 0:
+        sign_bit_mask = 1 << (sign_bit_pos - 1)
+        value_expr = f"(({signed_type})({raw_expr} & 0x{sign_bit_mask - 1:x}) - ({signed_type})({raw_expr} & 0x{sign_bit_mask:x}))"
+        field_type = signed_type
+    elif type_char in STRUCT_TYPE_SIGNED:
+        value_expr = f"({signed_type})(int{struct_bits}_t){raw_expr}"
+        field_type = signed_type
+    else:
+        value_expr = raw_expr
+        field_type = raw_type
+
+    # Mask and shift
+    if "m" in attr:
+        mask = int(attr["m"], 16) if isinstance(attr["m"], str) else int(attr["m"])
+        value_expr = f"({value_expr} & 0x{mask:x})"
+    shift = int(attr.get("s", 0))
+    if shift > 0:
+        value_expr = f"({value_expr} >> {shift})"
+    elif shift < 0:
+        value_expr = f"({value_expr} << {-shift})"
+
+    # Divisor (multiply by the reciprocal to avoid a division per value) and value to add
+    divisor = attr.get("d", 0)
+    add_value = attr.get("a", None)
+    if divisor or add_value is not None:
+        if field_type not in ("float", "double"):
+            value_expr = f"(float){value_expr}"
+            field_type = "float"
+        if divisor:
+            value_expr = f"{value_expr} * {c_float(1.0 / divisor)}"
+        if add_value is not None:
+            value_expr = f"{value_expr} - {c_float(-add_value)}" if add_value < 0 else f"{value_expr} + {c_float(add_value)}"
+
+    return field_type, value_expr, 0 if abs_byte is not None else read_nibbles
+
+def decode_generator_has_decode_fn(dev_type_record):
+    # Decode functions are generated for device types with polling and attributes
+    polling_config_record = dev_type_record.get("pollingConfigJson", {}).get("c", "")
+    attrs = dev_type_record.get("devInfoJson", {}).get("attr", {}).get("x", [])
+    return len(polling_config_record) > 0 and any("t" in attr for attr in attrs)
+
+def decode_generator_struct_name(dev_type_record):
+    return "poll_" + c_identifier(dev_type_record["deviceType"])
+
+def decode_generator_decode_fn_name(dev_type_record):
+    return "pollDecode_" + c_identifier(dev_type_record["deviceType"])
+
+def decode_generator_struct_and_fn(dev_type_record):
+    # Generate a struct holding one decoded poll record and a function which decodes poll records (as stored
+    # in the poll data aggregator) into an array of these structs - returns (struct code, function code)
+    data_len = get_polling_config_result_len_bytes(dev_type_record["pollingConfigJson"]["c"])
+    record_len = POLL_RESULT_TIMESTAMP_SIZE + data_len
+    struct_name = decode_generator_struct_name(dev_type_record)
+    fn_name = decode_generator_decode_fn_name(dev_type_record)
+
+    # Fields
+    fields = []
+    field_names = set(["timeMs", "timeDeltaUs"])
+    cur_nibble = 0
+    for attr in dev_type_record["devInfoJson"]["attr"]["x"]:
+        if "t" not in attr:
+            continue
+        field_type, value_expr, advance_nibbles = gen_attr_decode(attr, cur_nibble, data_len)
+        cur_nibble += advance_nibbles
+        field_name = c_identifier(attr["n"])
+        while field_name in field_names:
+            field_name += "_"
+        field_names.add(field_name)
+        fields.append((field_type, field_name, value_expr))
+
+    # Struct (the timestamp is the time in ms or, for us delta timestamps, the time since the previous record -
+    # UINT32_MAX if the time is re-based after a gap too long to code)
+    is_us_delta = dev_type_record["pollingConfigJson"].get("t", "") == "us"
+    struct_code = f"struct {struct_name}\n{{\n"
+    struct_code += "    uint32_t timeDeltaUs;\n" if is_us_delta else "    uint16_t timeMs;\n"
+    for field_type, field_name, _ in fields:
+        struct_code += f"    {field_type} {field_name};\n"
+    struct_code += "};\n"
+
+    # Decode function
+    fn_code = f"static uint32_t {fn_name}(const uint8_t* pPollResult, uint32_t pollResultLen, void* pStructOut, uint32_t maxRecs)\n{{\n"
+    fn_code += f"    {struct_name}* pOut = ({struct_name}*)pStructOut;\n"
+    fn_code += f"    uint32_t numRecs = pollResultLen / {record_len};\n"
+    fn_code += "    numRecs = numRecs < maxRecs ? numRecs : maxRecs;\n"
+    fn_code += f"    for (uint32_t i = 0; i < numRecs; i++, pPollResult += {record_len}, pOut++)\n    {{\n"
+    if is_us_delta:
+        # Coded as a 14 bit mantissa and 2 bit exponent (see PollTimestamp::decodeDeltaUs) with 0xffff re-based
+        fn_code += "        pOut->timeDeltaUs = (pPollResult[0] == 0xff) && (pPollResult[1] == 0xff) ? UINT32_MAX :\n"
+        fn_code += "                    (uint32_t)(((pPollResult[0] & 0x3f) << 8) | pPollResult[1]) << ((pPollResult[0] >> 6) * 5);\n"
+    else:
+        fn_code += "        pOut->timeMs = ((uint16_t)pPollResult[0] << 8) | pPollResult[1];\n"
+    fn_code += f"        const uint8_t* p = pPollResult + {POLL_RESULT_TIMESTAMP_SIZE};\n"
+    for _, field_name, value_expr in fields:
+        fn_code += f"        pOut->{field_name} = {value_expr};\n"
+    fn_code += "    }\n    return numRecs;\n}\n"
+    return struct_code, fn_code
+
+def decode_generator_poll_fields(dev_type_record):
+    # Locations of the value fields in the poll result for windowed downsampling (min, max and mean) - returns a
+    # list of (nibble offset, number of nibbles, value bits, is little endian, is signed). Bit fields (mask or
+    # shift, or shown as hex or boolean), floats, 64 bit values and fields overlapping earlier ones are left out
+    if not decode_generator_has_decode_fn(dev_type_record):
+        return []
+    data_len = get_polling_config_result_len_bytes(dev_type_record["pollingConfigJson"]["c"])
+    fields = []
+    used_nibbles = set()
+    cur_nibble = 0
+    for attr in dev_type_record["devInfoJson"]["attr"]["x"]:
+        if "t" not in attr:
+            continue
+        abs_byte, type_char, struct_bits, is_little_endian, read_bits, sign_bit_pos = parse_attr_type(attr["t"])
+        start_nibble = abs_byte * 2 if abs_byte is not None else cur_nibble
+        read_nibbles = read_bits // 4
+        if abs_byte is None:
+            cur_nibble += read_nibbles
+        if "m" in attr or attr.get("s", 0) or attr.get("f", "").endswith(("x", "X", "b")):
+            continue
+        if type_char in STRUCT_TYPE_FLOAT or struct_bits > 32:
+            continue
+        if is_little_endian and (start_nibble % 2 != 0 or read_nibbles % 2 != 0):
+            continue
+        field_nibbles = set(range(start_nibble, start_nibble + read_nibbles))
+        if start_nibble + read_nibbles > data_len * 2 or len(field_nibbles & used_nibbles) > 0:
+            continue
+        used_nibbles |= field_nibbles
+        is_signed = type_char in STRUCT_TYPE_SIGNED and (sign_bit_pos > 0 or read_bits == struct_bits)
+        value_bits = sign_bit_pos if type_char in STRUCT_TYPE_SIGNED and sign_bit_pos > 0 else read_bits
+        fields.append((start_nibble, read_nibbles, value_bits, is_little_endian, is_signed))
+    return fields
+
+def decode_generator_poll_fields_name(dev_type_record):
+    return "pollFields_" + c_identifier(dev_type_record["deviceType"])
 
+def decode_generator_poll_fields_array(dev_type_record):
+    # Generate the array of BusI2CPollField records for a device type (empty string if there are none)
+    fields = decode_generator_poll_fields(dev_type_record)
+    if len(fields) == 0:
+        return ""
+    code = f"static const BusI2CPollField {decode_generator_poll_fields_name(dev_type_record)}[] =\n{{\n"
+    for start_nibble, read_nibbles, value_bits, is_little_endian, is_signed in fields:
+        flags = []
+        if is_little_endian:
+            flags.append("BusI2CPollField::IS_LITTLE_ENDIAN")
+        if is_signed:
+            flags.append("BusI2CPollField::IS_SIGNED")
+        code += f"    {{ {start_nibble}, {read_nibbles}, {value_bits}, {' | '.join(flags) if len(flags) > 0 else '0'} }},\n"
+    code += "};\n"
+    return code
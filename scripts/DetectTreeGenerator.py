@@ -0,0 +1,242 @@
+import re
+
+# DetectTreeGenerator.py
+# Rob Dobson 2024
+# Generates a decision tree for each address which identifies the device at the address from the detection values
+# of the device types which can be at that address. Each distinct probe (bytes written and number of bytes read) is
+# made at most once when identifying a device - the bytes read are kept and each node of the tree checks them
+# against a masked value. Device types are tried in the order of the records so the first one that matches is
+# chosen (as when each device type was checked in turn)
+
+# Value for no node / no device type / no probe
+DETECT_NONE = 0xffff
+
+def detect_write_bytes(write_str):
+    # Same as DeviceTypeRecords::extractBufferDataFromHexStr()
+    if write_str.lower().startswith("0x"):
+        write_str = write_str[2:]
+    if len(write_str) % 2 != 0:
+        write_str = write_str + "0"
+    return tuple(bytes.fromhex(write_str))
+
+def detect_mask_and_check(read_str):
+    # Same as DeviceTypeRecords::extractMaskAndDataFromHexStr() with maskToZeros set
+    read_str = read_str.lower()
+    if read_str.startswith("r"):
+        len_bytes = int(read_str[1:])
+        mask = [0] * len_bytes
+        for i in range(min(len_bytes, len(read_str) - 1)):
+            mask[i] = 0xff
+        return tuple(mask), tuple([0] * len_bytes)
+    if read_str.startswith("0b"):
+        bits = read_str[2:]
+        len_bytes = (len(bits) + 7) // 8
+        mask = [0] * len_bytes
+        check = [0] * len_bytes
+        for i, bit in enumerate(bits):
+            bit_mask = 0x80 >> (i % 8)
+            if bit != "x":
+                mask[i // 8] |= bit_mask
+            if bit == "1":
+                check[i // 8] |= bit_mask
+        return tuple(mask), tuple(check)
+    if len(read_str) == 0:
+        return (), ()
+    return None
+
+def detect_checks(detection_values):
+    # Parse detection values (e.g. "0x06=0b0000000001010100&0x07=0b00000100XXXXXXXX") into a list of checks
+    # each of which is ((write bytes, read len), mask, check value)
+    checks = []
+    for pair in re.split("[&;]", detection_values):
+        if len(pair) == 0:
+            continue
+        name, _, value = pair.partition("=")
+        mask_and_check = detect_mask_and_check(value.strip())
+        if mask_and_check is None:
+            continue
+        mask, check = mask_and_check
+        checks.append(((detect_write_bytes(name.strip()), len(mask)), mask, check))
+    return checks
+
+def detect_check_implies(check_a, check_b):
+    # True if check_a passing means check_b passes (same probe and check_b only tests bits check_a tests)
+    if check_a[0] != check_b[0]:
+        return False
+    for mask_a, val_a, mask_b, val_b in zip(check_a[1], check_a[2], check_b[1], check_b[2]):
+        if (mask_b & ~mask_a) or ((val_a ^ val_b) & mask_b):
+            return False
+    return True
+
+def detect_checks_conflict(check_a, check_b):
+    # True if both checks can't pass (same probe and a bit they both test differs)
+    if check_a[0] != check_b[0]:
+        return False
+    for mask_a, val_a, mask_b, val_b in zip(check_a[1], check_a[2], check_b[1], check_b[2]):
+        if (val_a ^ val_b) & mask_a & mask_b:
+            return True
+    return False
+
+class DetectTreeBuilder:
+
+    def __init__(self):
+        self.probes = []
+        self.probe_index = {}
+        self.data = []
+        self.data_index = {}
+        self.nodes = []
+        self.node_index = {}
+        self.candidates_node_index = {}
+
+    def add_probe(self, probe):
+        if probe not in self.probe_index:
+            self.probe_index[probe] = len(self.probes)
+            self.probes.append((self.add_data(probe[0]), len(probe[0]), probe[1]))
+        return self.probe_index[probe]
+
+    def add_data(self, data):
+        # Byte pool shared by write data and mask/check values
+        data = tuple(data)
+        if data not in self.data_index:
+            self.data_index[data] = len(self.data)
+            self.data.extend(data)
+        return self.data_index[data]
+
+    def add_node(self, node):
+        if node not in self.node_index:
+            self.node_index[node] = len(self.nodes)
+            self.nodes.append(node)
+        return self.node_index[node]
+
+    def build(self, candidates):
+        # Candidates are (device type index, checks still to pass) in record order
+        key = tuple((dev_type_idx, tuple(checks)) for dev_type_idx, checks in candidates)
+        if key in self.candidates_node_index:
+            return self.candidates_node_index[key]
+        if len(candidates) == 0:
+            return self.add_node((DETECT_NONE, 0, DETECT_NONE, DETECT_NONE, DETECT_NONE))
+        first_idx, first_checks = candidates[0]
+        if len(first_checks) == 0:
+            return self.add_node((DETECT_NONE, 0, DETECT_NONE, DETECT_NONE, first_idx))
+
+        # Check the first check of the first candidate - if it passes any check of another candidate it implies
+        # is passed and candidates with a check it conflicts with can't match - if it fails candidates with a check
+        # which implies it can't match
+        check = first_checks[0]
+        pass_candidates = [(first_idx, [other for other in first_checks[1:] if not detect_check_implies(check, other)])]
+        fail_candidates = []
+        for dev_type_idx, checks in candidates[1:]:
+            if not any(detect_checks_conflict(check, other) for other in checks):
+                pass_candidates.append((dev_type_idx, [other for other in checks if not detect_check_implies(check, other)]))
+            if not any(detect_check_implies(other, check) for other in checks):
+                fail_candidates.append((dev_type_idx, checks))
+        pass_node = self.build(pass_candidates)
+        fail_node = self.build(fail_candidates)
+        data_offset = self.add_data(check[1] + check[2])
+        node_idx = self.add_node((self.add_probe(check[0]), data_offset, pass_node, fail_node, DETECT_NONE))
+        self.candidates_node_index[key] = node_idx
+        return node_idx
+
+    def count_probes(self, root, present_checks):
+        # Walk the tree for a device which passes the checks in present_checks (and fails any other) and return
+        # the number of distinct probes made
+        probes_made = set()
+        node_idx = root
+        while self.nodes[node_idx][0] != DETECT_NONE:
+            probe_idx, data_offset, pass_node, fail_node, _ = self.nodes[node_idx]
+            probe = self.probes[probe_idx]
+            probes_made.add(probe_idx)
+            read_len = probe[2]
+            check = (self.probe_key(probe), tuple(self.data[data_offset:data_offset + read_len]),
+                        tuple(self.data[data_offset + read_len:data_offset + 2 * read_len]))
+            node_idx = pass_node if detect_check_passes(check, present_checks) else fail_node
+        return len(probes_made)
+
+    def probe_key(self, probe):
+        return (tuple(self.data[probe[0]:probe[0] + probe[1]]), probe[2])
+
+def detect_check_passes(check, present_checks):
+    # A device passes a check if one of its own detection checks implies it (anything else is assumed to fail)
+    return any(detect_check_implies(present, check) for present in present_checks)
+
+def detect_transactions_per_type_check(candidates, present_checks):
+    # Identification transactions when each candidate was checked in turn (stopping at a candidate's first failed
+    # check but checking every candidate)
+    num_transactions = 0
+    for _, checks in candidates:
+        for check in checks:
+            num_transactions += 1
+            if not detect_check_passes(check, present_checks):
+                break
+    return num_transactions
+
+def detect_tree_generate(header_file, dev_types, addr_index_to_dev_array, min_addr, max_addr):
+    # Generate the decision trees and return lines of a report of identification transactions per device
+    dev_type_checks = [detect_checks(dev_type.get("detectionValues", "")) for dev_type in dev_types]
+    builder = DetectTreeBuilder()
+    roots = []
+    for addr in range(min_addr, max_addr + 1):
+        dev_type_idxs = addr_index_to_dev_array[addr]
+        if len(dev_type_idxs) == 0:
+            roots.append(DETECT_NONE)
+            continue
+        roots.append(builder.build([(idx, dev_type_checks[idx]) for idx in dev_type_idxs]))
+
+    # Byte pool
+    header_file.write('\nstatic constexpr uint8_t devDetectData[] =\n{\n    ')
+    header_file.write(','.join(f'0x{byte:02x}' for byte in builder.data) if builder.data else '0')
+    header_file.write('\n};\n')
+
+    # Probes
+    header_file.write('\nstatic constexpr BusI2CDevDetectProbe devDetectProbes[] =\n{\n')
+    for write_offset, write_len, read_len in builder.probes:
+        header_file.write(f'    {{{write_offset}, {write_len}, {read_len}}},\n')
+    if len(builder.probes) == 0:
+        header_file.write('    {0, 0, 0},\n')
+    header_file.write('};\n')
+    header_file.write(f'static const uint32_t DEV_DETECT_NUM_PROBES = {len(builder.probes)};\n')
+
+    # Nodes
+    header_file.write('\nstatic constexpr BusI2CDevDetectNode devDetectNodes[] =\n{\n')
+    for probe_idx, data_offset, pass_node, fail_node, dev_type_idx in builder.nodes:
+        header_file.write(f'    {{0x{probe_idx:04x}, {data_offset}, 0x{pass_node:04x}, 0x{fail_node:04x}, 0x{dev_type_idx:04x}}},\n')
+    if len(builder.nodes) == 0:
+        header_file.write(f'    {{0x{DETECT_NONE:04x}, 0, 0x{DETECT_NONE:04x}, 0x{DETECT_NONE:04x}, 0x{DETECT_NONE:04x}}},\n')
+    header_file.write('};\n')
+    header_file.write(f'static const uint32_t DEV_DETECT_NUM_NODES = {len(builder.nodes)};\n')
+
+    # Root node for each address
+    header_file.write('\nstatic constexpr uint16_t devDetectRootByAddr[] =\n{\n    ')
+    header_file.write(','.join(f'0x{root:04x}' for root in roots))
+    header_file.write('\n};\n')
+
+    # Report transactions to identify each device type at each of its addresses (and an unknown device)
+    lines = ["Identification transactions (checking each device type in turn -> decision tree)"]
+    total_before = 0
+    total_after = 0
+    for dev_type_idx, dev_type in enumerate(dev_types):
+        before = 0
+        after = 0
+        num_addrs = 0
+        for addr in range(min_addr, max_addr + 1):
+            dev_type_idxs = addr_index_to_dev_array[addr]
+            if dev_type_idx not in dev_type_idxs:
+                continue
+            candidates = [(idx, dev_type_checks[idx]) for idx in dev_type_idxs]
+            before += detect_transactions_per_type_check(candidates, dev_type_checks[dev_type_idx])
+            after += builder.count_probes(roots[addr - min_addr], dev_type_checks[dev_type_idx])
+            num_addrs += 1
+        lines.append(f"  {dev_type['deviceType']:<24} {before:>4} -> {after:>4} ({num_addrs} addresses)")
+        total_before += before
+        total_after += after
+    unknown_before = 0
+    unknown_after = 0
+    for addr in range(min_addr, max_addr + 1):
+        dev_type_idxs = addr_index_to_dev_array[addr]
+        if len(dev_type_idxs) == 0:
+            continue
+        unknown_before += detect_transactions_per_type_check([(idx, dev_type_checks[idx]) for idx in dev_type_idxs], [])
+        unknown_after += builder.count_probes(roots[addr - min_addr], [])
+    lines.append(f"  {'unknown device':<24} {unknown_before:>4} -> {unknown_after:>4} (all addresses)")
+    lines.append(f"  {'total':<24} {total_before + unknown_before:>4} -> {total_after + unknown_after:>4}")
+    return lines
@@ -0,0 +1,84 @@
+import re
+
+# InitBurstGenerator.py
+# Rob Dobson 2024
+# Coalesces device initialisation writes into burst writes. Runs of init values which each write one byte to
+# consecutive register addresses (with the same address width) are merged into a single write of the first
+# register address followed by all the bytes - the device auto-increments the register address after each byte.
+# Device types which don't auto-increment set "initBurst": false in their record. The register address width is
+# taken from the detection values and polling config (writes which are followed by a read) and init values aren't
+# merged if the width can't be found
+
+# Maximum bytes in a burst write (including the register address)
+INIT_BURST_MAX_WRITE_BYTES = 32
+
+def init_burst_split(values_str):
+    # Split write/read pairs (separated by & or ;)
+    return [pair for pair in re.split("[&;]", values_str) if len(pair) > 0]
+
+def init_burst_hex(write_str):
+    write_str = write_str.strip()
+    if write_str.lower().startswith("0x"):
+        write_str = write_str[2:]
+    return write_str
+
+def init_burst_reg_addr_bytes(dev_type):
+    # Register address width from writes which are followed by a read (None if there are none or they differ)
+    widths = set()
+    polling_config = dev_type.get("pollingConfigJson", {})
+    polling_str = polling_config.get("c", "") if isinstance(polling_config, dict) else ""
+    for pair in init_burst_split(dev_type.get("detectionValues", "")) + init_burst_split(polling_str):
+        write_str, _, read_str = pair.partition("=")
+        write_hex = init_burst_hex(write_str)
+        if (len(read_str.strip()) > 0) and (len(write_hex) > 0) and (len(write_hex) % 2 == 0):
+            widths.add(len(write_hex) // 2)
+    return widths.pop() if len(widths) == 1 else None
+
+def init_burst_coalesce(dev_type):
+    # Returns the init values with runs of single byte writes to consecutive registers merged (unchanged if the
+    # device type opts out or the register address width isn't known)
+    init_values = dev_type.get("initValues", "")
+    reg_addr_bytes = init_burst_reg_addr_bytes(dev_type)
+    if not dev_type.get("initBurst", True) or reg_addr_bytes is None:
+        return init_values
+
+    # Each entry is the write hex string and the register address (None if it can't be merged)
+    entries = []
+    for pair in init_burst_split(init_values):
+        write_str, sep, read_str = pair.partition("=")
+        write_hex = init_burst_hex(write_str)
+        reg_addr = None
+        if (len(read_str.strip()) == 0) and re.fullmatch("[0-9a-fA-F]*", write_hex) and \
+                    (len(write_hex) == (reg_addr_bytes + 1) * 2):
+            reg_addr = int(write_hex[:reg_addr_bytes * 2], 16)
+        entries.append([pair, reg_addr, write_hex, sep])
+
+    # Merge runs
+    merged = []
+    for pair, reg_addr, write_hex, sep in entries:
+        if merged and (reg_addr is not None) and (merged[-1][1] is not None):
+            prev = merged[-1]
+            num_bytes = len(prev[2]) // 2
+            if (reg_addr == prev[1] + num_bytes - reg_addr_bytes) and (num_bytes < INIT_BURST_MAX_WRITE_BYTES):
+                prev[2] += write_hex[reg_addr_bytes * 2:]
+                prev[0] = "0x" + prev[2] + prev[3]
+                continue
+        merged.append([pair, reg_addr, write_hex, sep])
+    if len(merged) == len(entries):
+        return init_values
+    return "&".join(entry[0] for entry in merged)
+
+def init_burst_report(dev_types):
+    # Lines reporting init writes for each device type before and after merging
+    lines = ["Init writes (one per init value -> burst writes)"]
+    total_before = 0
+    total_after = 0
+    for dev_type in dev_types:
+        before = len(init_burst_split(dev_type.get("initValues", "")))
+        after = len(init_burst_split(init_burst_coalesce(dev_type)))
+        if before > 0:
+            lines.append(f"  {dev_type['deviceType']:<24} {before:>4} -> {after:>4}")
+        total_before += before
+        total_after += after
+    lines.append(f"  {'total':<24} {total_before:>4} -> {total_after:>4}")
+    return lines
@@ -2,20 +2,116 @@ import json
 import sys
 import re
 import argparse
+import os
 
-from DecodeGenerator import decode_generator_len_fn
+from DecodeGenerator import decode_generator_len_fn, decode_generator_has_decode_fn, decode_generator_struct_and_fn, decode_generator_decode_fn_name
+from DecodeGenerator import decode_generator_len_fn_name
+from DecodeGenerator import decode_generator_poll_fields, decode_generator_poll_fields_name, decode_generator_poll_fields_array
+from DecodeGenerator import c_identifier as decode_generator_c_identifier
+from DetectTreeGenerator import detect_tree_generate
+from InitBurstGenerator import init_burst_coalesce, init_burst_report
 
 # ProcessDevTypeJsonToC.py
 # Rob Dobson 2024
 # This script processes a JSON I2C device types file and generates a C header file
 # with the device types and addresses. The header file contains the following:
 # - An array of BusI2CDevTypeRecord structures - these contain the device type, addresses, detection values, init values, polling config and device info
+#   (and the maximum bus frequency for device types which specify maxFreq)
 # - An array of device type counts for each address (0x00 to 0x7f) - this is the number of device types for each address
 # - An array of device type indexes for each address - each element is an array of indices into the BusI2CDevTypeRecord array
 # - An array of scanning priorities for each address
+# - Functions to decode poll results for each device type with attributes (unless decode generation is turned off)
+# - The location of each value in the poll results (used for windowed downsampling)
+# - A perfect hash of the device type names (so a type can be found by name with one string compare) and a
+#   constant for the index of each device type (indices are the order of the records in the JSON file so new
+#   device types should be added at the end - DEV_TYPE_RECORDS_SIGNATURE changes if any index changes)
+# - Init values with runs of single byte writes to consecutive registers merged into burst writes (unless the
+#   device type has "initBurst": false - see InitBurstGenerator.py) - the init writes before and after are printed
+#   and written to the header
+# - A decision tree for each address to identify the device type with each distinct probe made once (see
+#   DetectTreeGenerator.py) - the identification transactions before and after are printed and written to the header
+# All tables are constant so they are linked into flash (rodata) rather than copied into RAM - a report of the RAM
+# this saves for each device type is printed and written at the end of the header
 # The script takes two arguments:
 # - The path to the JSON file with the device types
 # - The path to the header file to generate
+# A second header (DevicePollRecords_generated.h in the same folder) is also generated with a struct for each device
+# type holding a decoded poll record - this can be included by code which uses the decode functions
+
+# Seeded FNV-1a hash of a device type name (must match devTypeNameHash() in the generated header)
+def dev_type_name_hash(name, seed):
+    hash_val = (0x811c9dc5 ^ seed) & 0xffffffff
+    for c in name.encode("utf-8"):
+        hash_val = ((hash_val ^ c) * 0x01000193) & 0xffffffff
+    return hash_val
+
+def dev_type_name_perfect_hash(names):
+    # Hash and displace - names are put into buckets by their unseeded hash then, largest bucket first, a seed
+    # is found for each bucket which maps all of its names to free slots - returns (bucket seeds, slot indices)
+    num_buckets = max(1, (len(names) + 1) // 2)
+    num_slots = max(1, len(names) + len(names) // 4)
+    buckets = [[] for _ in range(num_buckets)]
+    for name_idx, name in enumerate(names):
+        buckets[dev_type_name_hash(name, 0) % num_buckets].append(name_idx)
+    seeds = [0] * num_buckets
+    slots = [None] * num_slots
+    for bucket_idx in sorted(range(num_buckets), key=lambda b: -len(buckets[b])):
+        if len(buckets[bucket_idx]) == 0:
+            break
+        for seed in range(1, 0x10000):
+            bucket_slots = [dev_type_name_hash(names[i], seed) % num_slots for i in buckets[bucket_idx]]
+            if len(set(bucket_slots)) == len(bucket_slots) and all(slots[s] is None for s in bucket_slots):
+                break
+        else:
+            raise ValueError("No perfect hash seed found for device type names")
+        seeds[bucket_idx] = seed
+        for name_idx, slot in zip(buckets[bucket_idx], bucket_slots):
+            slots[slot] = name_idx
+    return seeds, slots
+
+def write_dev_type_name_hash(header_file, names):
+    # Write the perfect hash tables and a constant for the index of each device type
+    if len(set(names)) != len(names):
+        raise ValueError("Duplicate device type names")
+    seeds, slots = dev_type_name_perfect_hash(names)
+    header_file.write('\n// Device type name lookup (perfect hash)\n')
+    header_file.write('static inline uint32_t devTypeNameHash(const char* pName, uint32_t seed)\n{\n')
+    header_file.write('    uint32_t hashVal = 0x811c9dc5 ^ seed;\n')
+    header_file.write('    while (*pName)\n        hashVal = (hashVal ^ (uint8_t)*pName++) * 0x01000193;\n')
+    header_file.write('    return hashVal;\n}\n')
+    header_file.write(f'static const uint32_t DEV_TYPE_NAME_HASH_NUM_BUCKETS = {len(seeds)};\n')
+    header_file.write(f'static const uint32_t DEV_TYPE_NAME_HASH_NUM_SLOTS = {len(slots)};\n')
+    header_file.write('static const uint16_t devTypeNameHashSeeds[] =\n{\n    ')
+    header_file.write(','.join(str(seed) for seed in seeds))
+    header_file.write('\n};\n')
+    header_file.write('static const uint16_t devTypeNameHashSlots[] =\n{\n    ')
+    header_file.write(','.join(str(slot if slot is not None else 0xffff) for slot in slots))
+    header_file.write('\n};\n\n')
+
+    # Device type indices and a signature of the names in index order
+    for name_idx, name in enumerate(names):
+        header_file.write(f'static const uint16_t DEV_TYPE_IDX_{decode_generator_c_identifier(name)} = {name_idx};\n')
+    header_file.write(f'static const uint32_t DEV_TYPE_RECORDS_SIGNATURE = 0x{dev_type_name_hash(",".join(names), 0):08x};\n')
+
+# Size of a BusI2CDevTypeRecord with 32 bit pointers (checked by a static_assert in the generated header)
+DEV_TYPE_RECORD_SIZE_32BIT = 44
+POINTER_SIZE_32BIT = 4
+
+def flash_tables_report(dev_types, addr_index_to_dev_record, num_addr_slots):
+    # Lines reporting the RAM saved (on a 32 bit target) by each device type's table entries being in flash - the
+    # record and its entries in the by-address index (strings and functions were already in flash)
+    lines = ["RAM saved by device type tables in flash (32 bit target)"]
+    total_bytes = 0
+    for dev_record_index, dev_type in enumerate(dev_types):
+        num_addrs = sum(1 for idxs in addr_index_to_dev_record.values() if dev_record_index in idxs)
+        type_bytes = DEV_TYPE_RECORD_SIZE_32BIT + num_addrs * 2
+        lines.append(f"  {dev_type['deviceType']:<24} {type_bytes:>5} bytes (record, {num_addrs} address index entries)")
+        total_bytes += type_bytes
+    index_bytes = num_addr_slots * POINTER_SIZE_32BIT
+    lines.append(f"  {'index by address':<24} {index_bytes:>5} bytes")
+    total_bytes += index_bytes
+    lines.append(f"  {'total':<24} {total_bytes:>5} bytes")
+    return lines
 
 def process_dev_types(json_path, header_path, gen_decode):
     with open(json_path, 'r') as json_file:
@@ -110,12 +206,43 @@ def process_dev_types(json_path, header_path, gen_decode):
     # Debug
     print(addr_index_to_dev_record)
 
+    # Generate poll record structs and decode functions
+    poll_structs_code = []
+    decode_fns_code = []
+    poll_fields_code = []
+    if gen_decode:
+        for dev_type in dev_ident_json['devTypes'].values():
+            decode_fns_code.append(decode_generator_len_fn(dev_type))
+            if decode_generator_has_decode_fn(dev_type):
+                struct_code, fn_code = decode_generator_struct_and_fn(dev_type)
+                poll_structs_code.append(struct_code)
+                decode_fns_code.append(fn_code)
+            poll_fields_array = decode_generator_poll_fields_array(dev_type)
+            if len(poll_fields_array) > 0:
+                poll_fields_code.append(poll_fields_array)
+
+    # Generate poll records header file
+    poll_records_header_path = os.path.join(os.path.dirname(header_path), "DevicePollRecords_generated.h")
+    with open(poll_records_header_path, 'w') as poll_records_file:
+        poll_records_file.write('#pragma once\n\n#include <stdint.h>\n\n')
+        poll_records_file.write('\n'.join(poll_structs_code))
+
     # Generate header file
     with open(header_path, 'w') as header_file:
         header_file.write('#pragma once\n\n')
 
+        # Poll result decode functions
+        if gen_decode:
+            header_file.write('#include <string.h>\n#include "DevicePollRecords_generated.h"\n\n')
+            header_file.write('static inline float pollDecodeFloat(uint32_t raw) { float val; memcpy(&val, &raw, sizeof(val)); return val; }\n')
+            header_file.write('static inline double pollDecodeDouble(uint64_t raw) { double val; memcpy(&val, &raw, sizeof(val)); return val; }\n\n')
+            header_file.write('\n'.join(decode_fns_code))
+            header_file.write('\n')
+            header_file.write('\n'.join(poll_fields_code))
+            header_file.write('\n')
+
         # Generate the BusI2CDevTypeRecord array
-        header_file.write('static BusI2CDevTypeRecord baseDevTypeRecords[] =\n')
+        header_file.write('static constexpr BusI2CDevTypeRecord baseDevTypeRecords[] =\n')
         header_file.write('{\n')
 
         # Iterate records
@@ -128,18 +255,35 @@ def process_dev_types(json_path, header_path, gen_decode):
             header_file.write(f'        R"({dev_type["deviceType"]})",\n')
             header_file.write(f'        R"({dev_type["addresses"]})",\n')
             header_file.write(f'        R"({dev_type["detectionValues"]})",\n')
-            header_file.write(f'        R"({dev_type["initValues"]})",\n')
+            header_file.write(f'        R"({init_burst_coalesce(dev_type)})",\n')
             header_file.write(f'        R"({polling_config_json_str})",\n')
             header_file.write(f'        R"({dev_info_json_str})"')
 
             # Check if gen_decode is set
             if gen_decode:
-                header_file.write(f',\n        {decode_generator_len_fn(dev_type)}')
+                header_file.write(f',\n        {decode_generator_len_fn_name(dev_type)}')
+                decode_fn_name = decode_generator_decode_fn_name(dev_type) if decode_generator_has_decode_fn(dev_type) else "nullptr"
+                header_file.write(f',\n        {decode_fn_name}')
+
+            # Maximum bus frequency (if specified) follows the poll result functions
+            if gen_decode:
+                header_file.write(f',\n        {int(dev_type.get("maxFreq", 0))}')
+            elif "maxFreq" in dev_type:
+                header_file.write(f',\n        nullptr,\n        nullptr,\n        {int(dev_type["maxFreq"])}')
+
+            # Value fields in the poll result
+            if gen_decode and len(decode_generator_poll_fields(dev_type)) > 0:
+                num_poll_fields = len(decode_generator_poll_fields(dev_type))
+                header_file.write(f',\n        {decode_generator_poll_fields_name(dev_type)},\n        {num_poll_fields}')
 
             header_file.write('\n    },\n')
             dev_record_index += 1
 
-        header_file.write('};\n\n')
+        header_file.write('};\n')
+
+        # Device type name lookup
+        write_dev_type_name_hash(header_file, [dev_type["deviceType"] for dev_type in dev_ident_json['devTypes'].values()])
+        header_file.write('\n')
 
         # Write constants for the min and max values of array index
         header_file.write(f'static const uint32_t BASE_DEV_INDEX_BY_ARRAY_MIN_ADDR = 0;\n')
@@ -155,7 +299,7 @@ def process_dev_types(json_path, header_path, gen_decode):
         # For every non-zero length array, generate a C variable specific to that array
         for addr in range(min_addr_array_index, max_addr_array_index+1):
             if len(addr_index_to_dev_array[addr]) > 0:
-                header_file.write(f'static uint16_t baseDevTypeIndexByAddr_0x{addr:02x}[] = ')
+                header_file.write(f'static constexpr uint16_t baseDevTypeIndexByAddr_0x{addr:02x}[] = ')
                 header_file.write('{')
                 if len(addr_index_to_dev_array[addr]) > 0:
                     header_file.write(f'{addr_index_to_dev_array[addr][0]}')
@@ -164,7 +308,7 @@ def process_dev_types(json_path, header_path, gen_decode):
                 header_file.write('};\n')
 
         # Generate the BusI2CDevTypeRecord index by address
-        header_file.write(f'\nstatic uint16_t* baseDevTypeIndexByAddr[] =\n')
+        header_file.write(f'\nstatic constexpr const uint16_t* baseDevTypeIndexByAddr[] =\n')
         header_file.write('{\n')
 
         # Iterate address array
@@ -197,7 +341,7 @@ def process_dev_types(json_path, header_path, gen_decode):
             header_file.write('\n};\n')
 
         # Write a record for scan lists
-        header_file.write('\nstatic const uint8_t* scanPriorityLists[] =\n')
+        header_file.write('\nstatic constexpr const uint8_t* scanPriorityLists[] =\n')
         header_file.write('{\n')
         for i in range(NUM_PRIORITY_LEVELS):
             header_file.write(f'    scanPriority{i},\n')
@@ -213,6 +357,30 @@ def process_dev_types(json_path, header_path, gen_decode):
         # Write out the number of priority scan lists
         header_file.write(f'\nstatic const uint8_t numScanPriorityLists = {NUM_PRIORITY_LEVELS};\n')
 
+        # Report of init writes merged into bursts
+        header_file.write('\n')
+        for line in init_burst_report(list(dev_ident_json['devTypes'].values())):
+            header_file.write(f'// {line}\n')
+            print(line)
+
+        # Generate the device detection decision trees
+        report_lines = detect_tree_generate(header_file, list(dev_ident_json['devTypes'].values()),
+                    addr_index_to_dev_array, min_addr_array_index, max_addr_array_index)
+        header_file.write('\n')
+        for line in report_lines:
+            header_file.write(f'// {line}\n')
+            print(line)
+
+        # Report of the RAM saved by the tables being in flash
+        report_lines = flash_tables_report(dev_ident_json['devTypes'].values(), addr_index_to_dev_record,
+                    max_addr_array_index - min_addr_array_index + 1)
+        header_file.write('\n')
+        for line in report_lines:
+            header_file.write(f'// {line}\n')
+            print(line)
+        header_file.write(f'static_assert((sizeof(void*) != 4) || (sizeof(BusI2CDevTypeRecord) == {DEV_TYPE_RECORD_SIZE_32BIT}), '
+                          '"Update DEV_TYPE_RECORD_SIZE_32BIT in ProcessDevTypeJsonToC.py");\n')
+
 if __name__ == "__main__":
     argparse = argparse.ArgumentParser()
     argparse.add_argument("json_path", help="Path to the JSON file with the device types")
@@ -162,10 +162,11 @@ BusBase busBase(busElemStatusCB, busOperationStatusCB);
 // BusStatusMgr
 BusStatusMgr busStatusMgr(busBase);
 BusPowerController busPowerController(busReqSyncFn);
-BusStuckHandler busStuckHandler;
+BusStuckHandler busStuckHandler(busReqSyncFn);
 BusExtenderMgr busExtenderMgr(busPowerController, busStuckHandler, busStatusMgr, busReqSyncFn);
 DeviceIdentMgr deviceIdentMgr(busExtenderMgr, busReqSyncFn);
-BusScanner busScanner(busStatusMgr, busExtenderMgr, deviceIdentMgr, busReqSyncFn);
+BusSpeedMgr busSpeedMgr;
+BusScanner busScanner(busStatusMgr, busExtenderMgr, deviceIdentMgr, busSpeedMgr, busReqSyncFn);
 
 void helper_reset_status_changes_list()
 {
@@ -198,7 +199,7 @@ void helper_cleardown_i2c_tests()
 void helper_service_some(uint32_t serviceLoops, bool serviceScanner)
 {
     // Service the status for some time
-    for (int i = 0; i < serviceLoops; i++)
+    for (uint32_t i = 0; i < serviceLoops; i++)
     {
         busStatusMgr.service(true);
         if (serviceScanner)
@@ -212,7 +213,7 @@ void helper_service_some(uint32_t serviceLoops, bool serviceScanner)
 
 void helper_elem_states_handle(const std::vector<BusI2CAddrAndSlot>& addrs, bool elemResponding, uint32_t count)
 {
-    for (int i = 0; i < count; i++)
+    for (uint32_t i = 0; i < count; i++)
     {
         for (auto addr : addrs)
         {
@@ -242,7 +243,7 @@ bool helper_check_bus_extender_list(std::vector<uint32_t> busExtenderList)
             LOG_I(MODULE_PREFIX, "Actual bus extender %02x", addr);
         return false;
     }
-    for (int i = 0; i < busExtenders.size(); i++)
+    for (uint32_t i = 0; i < busExtenders.size(); i++)
     {
         if (busExtenders[i] != busExtenderList[i])
         {
@@ -257,7 +258,7 @@ bool helper_check_online_offline_elems(std::vector<BusI2CAddrAndSlot> onlineElem
 {
     // Create a list of all addresses
     std::vector<BusI2CAddrAndSlot> offlineAddrs;
-    for (int i = I2C_BUS_ADDRESS_MIN; i < I2C_BUS_ADDRESS_MAX; i++)
+    for (uint32_t i = I2C_BUS_ADDRESS_MIN; i < I2C_BUS_ADDRESS_MAX; i++)
         offlineAddrs.push_back(BusI2CAddrAndSlot(i,0));
 
     // Go through addresses that should be online
@@ -269,7 +270,7 @@ bool helper_check_online_offline_elems(std::vector<BusI2CAddrAndSlot> onlineElem
             return false;
         }
         // Remove from list
-        for (int i = 0; i < offlineAddrs.size(); i++)
+        for (uint32_t i = 0; i < offlineAddrs.size(); i++)
         {
             if (offlineAddrs[i].addr == addr.addr)
             {
@@ -448,3 +449,60 @@ TEST_CASE("test_rafti2c_bus_scanner_slotted", "[rafti2c_busi2c_tests]")
     // Check elems that should be online are online, etc
     TEST_ASSERT_MESSAGE(helper_check_online_offline_elems({testAddr1, testSlottedAddr1, testSlottedAddr3, extenderAddr1}), "online/offline elems not correct 3");
 }
+
+TEST_CASE("test_rafti2c_bus_status_window_summaries", "[rafti2c_busi2c_tests]")
+{
+    static const BusI2CAddrAndSlot testAddr = {0x60, 0};
+
+    // Setup test with a VCNL4040 downsampled over 1s windows
+    helper_setup_i2c_tests({});
+    helper_elem_states_handle({testAddr}, true, BusStatusMgr::I2C_ADDR_RESP_COUNT_OK_MAX);
+    DeviceTypeRecords deviceTypeRecords;
+    DeviceStatus deviceStatus;
+    TEST_ASSERT_TRUE(deviceTypeRecords.getDeviceTypeIdx("VCNL4040", deviceStatus.deviceTypeIndex));
+    const BusI2CDevTypeRecord* pDevTypeRec = deviceTypeRecords.getDeviceInfo(deviceStatus.deviceTypeIndex);
+    deviceTypeRecords.getPollInfo(testAddr, pDevTypeRec, deviceStatus.deviceIdentPolling);
+    deviceStatus.deviceIdentPolling.windowUs = 1000000;
+    deviceStatus.dataWindow.init(deviceStatus.deviceIdentPolling.windowUs, pDevTypeRec->pollResultFields,
+                pDevTypeRec->numPollResultFields, deviceStatus.deviceIdentPolling.pollResultSizeIncTimestamp);
+    busStatusMgr.setBusElemDeviceStatus(testAddr, deviceStatus);
+
+    // Results (ms timestamp then prox, als and white) - each window starting stores the previous one
+    for (uint32_t windowIdx = 0; windowIdx < 4; windowIdx++)
+    {
+        uint16_t timeMs = windowIdx * 1000;
+        busStatusMgr.pollResultStore(timeMs * 1000ULL, deviceStatus.deviceIdentPolling, testAddr,
+                    {uint8_t(timeMs >> 8), uint8_t(timeMs & 0xff), 1, 0, 2, 0, 3, 0});
+    }
+
+    // JSON marks the results as window summaries starting with a minimum
+    String pollJson = busStatusMgr.getBusPollResponsesJson(deviceIdentMgr);
+    TEST_ASSERT_TRUE(pollJson.indexOf("\"_t\":\"VCNL4040\",\"_w\":3,\"_wi\":0}") > 0);
+
+    // Binary flags hold the results per window and the position in its window of the first record - a window
+    // split between calls continues from the maximum
+    for (uint32_t windowIdx = 4; windowIdx < 6; windowIdx++)
+    {
+        uint16_t timeMs = windowIdx * 1000;
+        busStatusMgr.pollResultStore(timeMs * 1000ULL, deviceStatus.deviceIdentPolling, testAddr,
+                    {uint8_t(timeMs >> 8), uint8_t(timeMs & 0xff), 1, 0, 2, 0, 3, 0});
+    }
+    uint8_t buf[100];
+    static const uint32_t HEADERS_SIZE = BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE + BusStatusMgr::POLL_RESP_BIN_DEVICE_HEADER_SIZE;
+    static const uint32_t REC_SIZE = 1 + 6;
+    static const uint32_t REC_SIZE_ESCAPED = 1 + DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE + 6;
+    const uint8_t* pDev = buf + BusStatusMgr::POLL_RESP_BIN_FRAME_HEADER_SIZE;
+    uint32_t len = busStatusMgr.getBusPollResponsesBinary(0, buf, HEADERS_SIZE + 3 * REC_SIZE + REC_SIZE_ESCAPED);
+    TEST_ASSERT_EQUAL_UINT32(HEADERS_SIZE + 3 * REC_SIZE + REC_SIZE_ESCAPED, len);
+    TEST_ASSERT_EQUAL_UINT8(4, pDev[6]);
+    TEST_ASSERT_EQUAL_UINT8(BusStatusMgr::POLL_RESP_BIN_FLAG_ONLINE | (3 << BusStatusMgr::POLL_RESP_BIN_FLAG_WINDOW_SIZE_SHIFT), pDev[2]);
+    len = busStatusMgr.getBusPollResponsesBinary(0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT32(HEADERS_SIZE + 2 * REC_SIZE, len);
+    TEST_ASSERT_EQUAL_UINT8(2, pDev[6]);
+    TEST_ASSERT_EQUAL_UINT8(BusStatusMgr::POLL_RESP_BIN_FLAG_ONLINE | (3 << BusStatusMgr::POLL_RESP_BIN_FLAG_WINDOW_SIZE_SHIFT) | 
+                (1 << BusStatusMgr::POLL_RESP_BIN_FLAG_WINDOW_IDX_SHIFT), pDev[2]);
+
+    // Remove the element
+    helper_elem_states_handle({testAddr}, false, BusStatusMgr::I2C_ADDR_RESP_COUNT_FAIL_MAX);
+    helper_service_some(1000, false);
+}
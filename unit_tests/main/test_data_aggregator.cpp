@@ -14,6 +14,8 @@
 #include "unity_test_runner.h"
 
 #include "PollDataAggregator.h"
+#include "PollDataWindow.h"
+#include "DeviceTypeRecords.h"
 
 // static const char* MODULE_PREFIX = "test_i2c_data_agg";
 
@@ -152,3 +154,291 @@ TEST_CASE("Test PollDataAggregator Put and Get Multiple", "[PollDataAggregator]"
     TEST_ASSERT_TRUE(dataTest5to7 == dataOut);
     TEST_ASSERT_FALSE(aggregator.get(dataOut));
 }
+
+TEST_CASE("Test PollDataWindow Min Max Mean", "[PollDataAggregator]") 
+{
+    // VCNL4040 results (timestamp then prox, als and white little endian)
+    DeviceTypeRecords deviceTypeRecords;
+    const BusI2CDevTypeRecord* pDevTypeRec = deviceTypeRecords.getDeviceInfo("VCNL4040");
+    TEST_ASSERT_NOT_NULL(pDevTypeRec);
+    TEST_ASSERT_EQUAL_UINT32(3, pDevTypeRec->numPollResultFields);
+    PollDataAggregator aggregator;
+    aggregator.init(10, 8);
+    PollDataWindow window;
+    window.init(1000000, pDevTypeRec->pollResultFields, pDevTypeRec->numPollResultFields, 8);
+    TEST_ASSERT_FALSE(window.add(0, {0x12, 0x34, 100, 0, 10, 0, 5, 0}, aggregator));
+    TEST_ASSERT_FALSE(window.add(100000, {0x12, 0x98, 0x2c, 0x01, 20, 0, 5, 0}, aggregator));
+    TEST_ASSERT_FALSE(window.add(200000, {0x12, 0xfc, 200, 0, 60, 0, 5, 0}, aggregator));
+    TEST_ASSERT_EQUAL_UINT32(0, aggregator.count());
+
+    // The next window starting stores the minimum, maximum and mean with the first timestamp
+    TEST_ASSERT_TRUE(window.add(1000000, {0x16, 0x1c, 1, 0, 1, 0, 1, 0}, aggregator));
+    std::vector<uint8_t> dataOut;
+    uint32_t elemSize = 0;
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, aggregator.get(dataOut, elemSize, 0));
+    const std::vector<uint8_t> expected = {
+        0x12, 0x34, 100, 0, 10, 0, 5, 0,
+        0x12, 0x34, 0x2c, 0x01, 60, 0, 5, 0,
+        0x12, 0x34, 200, 0, 30, 0, 5, 0 };
+    TEST_ASSERT_TRUE(expected == dataOut);
+
+    // A window which ends without a later result (e.g. polling stopped) is stored by flushing
+    TEST_ASSERT_FALSE(window.isWindowEnded(1999999));
+    TEST_ASSERT_TRUE(window.isWindowEnded(2000000));
+    TEST_ASSERT_TRUE(window.flush(aggregator));
+    TEST_ASSERT_FALSE(window.isWindowEnded(3000000));
+    TEST_ASSERT_FALSE(window.flush(aggregator));
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, aggregator.get(dataOut, elemSize, 0));
+    const std::vector<uint8_t> expectedFlushed = {
+        0x16, 0x1c, 1, 0, 1, 0, 1, 0,
+        0x16, 0x1c, 1, 0, 1, 0, 1, 0,
+        0x16, 0x1c, 1, 0, 1, 0, 1, 0 };
+    TEST_ASSERT_TRUE(expectedFlushed == dataOut);
+
+    // MCP9808 13 bit signed value with flags in the top bits (flags are taken from the latest result)
+    pDevTypeRec = deviceTypeRecords.getDeviceInfo("MCP9808");
+    TEST_ASSERT_NOT_NULL(pDevTypeRec);
+    aggregator.init(10, 4);
+    window.init(1000000, pDevTypeRec->pollResultFields, pDevTypeRec->numPollResultFields, 4);
+    window.add(0, {0, 0, 0x9f, 0xf0}, aggregator);
+    window.add(100000, {0, 0, 0x01, 0x90}, aggregator);
+    window.add(200000, {0, 0, 0x40, 0x10}, aggregator);
+    TEST_ASSERT_TRUE(window.add(1000000, {0, 0, 0x00, 0x00}, aggregator));
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, aggregator.get(dataOut, elemSize, 0));
+    const std::vector<uint8_t> expectedSigned = { 0, 0, 0x5f, 0xf0, 0, 0, 0x41, 0x90, 0, 0, 0x40, 0x85 };
+    TEST_ASSERT_TRUE(expectedSigned == dataOut);
+
+    // Without value fields only the latest result in each window is stored
+    aggregator.init(10, 3);
+    window.init(1000000, nullptr, 0, 3);
+    window.add(0, {0, 1, 7}, aggregator);
+    window.add(500000, {0, 2, 8}, aggregator);
+    TEST_ASSERT_TRUE(window.add(1000000, {0, 3, 9}, aggregator));
+    TEST_ASSERT_EQUAL_UINT32(1, aggregator.get(dataOut, elemSize, 0));
+    const std::vector<uint8_t> expectedLatest = { 0, 1, 8 };
+    TEST_ASSERT_TRUE(expectedLatest == dataOut);
+    TEST_ASSERT_EQUAL_UINT32(1, window.getResultsPerWindow());
+    window.clear();
+    TEST_ASSERT_EQUAL_UINT32(0, window.getResultsPerWindow());
+}
+
+TEST_CASE("Test PollDataWindow Whole Summaries", "[PollDataAggregator]") 
+{
+    DeviceTypeRecords deviceTypeRecords;
+    const BusI2CDevTypeRecord* pDevTypeRec = deviceTypeRecords.getDeviceInfo("VCNL4040");
+    TEST_ASSERT_NOT_NULL(pDevTypeRec);
+    PollDataWindow window;
+    window.init(1000000, pDevTypeRec->pollResultFields, pDevTypeRec->numPollResultFields, 8);
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, window.getResultsPerWindow());
+
+    // Room for one summary and a bit - when the oldest is kept a summary which doesn't fit is dropped whole
+    PollDataAggregator aggregator;
+    aggregator.init(5, 8);
+    aggregator.setBlockOldest(true);
+    window.add(0, {0, 0, 1, 0, 1, 0, 1, 0}, aggregator);
+    TEST_ASSERT_TRUE(window.add(1000000, {0, 0, 2, 0, 2, 0, 2, 0}, aggregator));
+    TEST_ASSERT_FALSE(window.add(2000000, {0, 0, 3, 0, 3, 0, 3, 0}, aggregator));
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, aggregator.count());
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, aggregator.getNumPut());
+    PollDataAggregator::Stats stats;
+    aggregator.getStats(stats, 0, 2);
+    TEST_ASSERT_EQUAL_UINT32(PollDataWindow::RESULTS_PER_WINDOW, stats.numDropped);
+    TEST_ASSERT_EQUAL_UINT32(stats.numProduced, stats.numConsumed + stats.numOverwritten + stats.numDropped + stats.numUnread);
+
+    // Overwriting the oldest keeps every summary (the first unread result may then be part way through a window)
+    aggregator.setBlockOldest(false);
+    TEST_ASSERT_TRUE(window.add(3000000, {0, 0, 4, 0, 4, 0, 4, 0}, aggregator));
+    TEST_ASSERT_EQUAL_UINT32(5, aggregator.count());
+    TEST_ASSERT_EQUAL_UINT32(1, (aggregator.getNumPut() - aggregator.count()) % PollDataWindow::RESULTS_PER_WINDOW);
+}
+
+TEST_CASE("Test PollDataArena Alloc Free Compact", "[PollDataAggregator]")
+{
+    // Three rings of 2 results of 4 bytes
+    PollDataArena arena;
+    arena.setup(28);
+    PollDataAggregator aggregators[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_TRUE(aggregators[i].initInArena(arena, 2, 4));
+        TEST_ASSERT_TRUE(aggregators[i].put({(uint8_t)i, 1, 2, 3}));
+    }
+
+    // No room for another
+    PollDataAggregator noRoom;
+    TEST_ASSERT_FALSE(noRoom.initInArena(arena, 2, 4));
+    TEST_ASSERT_FALSE(noRoom.put({0, 0, 0, 0}));
+
+    // Freeing the middle ring leaves a hole
+    aggregators[1].release();
+    PollDataArena::Stats stats;
+    arena.getStats(stats);
+    TEST_ASSERT_EQUAL_UINT32(16, stats.usedBytes);
+    TEST_ASSERT_EQUAL_UINT32(24, stats.highWaterBytes);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numHoles);
+    TEST_ASSERT_EQUAL_UINT32(12, stats.freeBytes);
+    TEST_ASSERT_EQUAL_UINT32(8, stats.largestFreeBytes);
+    TEST_ASSERT_EQUAL_UINT32(34, stats.fragmentationPct);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numAllocFailures);
+
+    // Compaction moves the last ring down and keeps its contents
+    std::vector<PollDataArena::Region*> regions = { aggregators[0].getArenaRegion(), aggregators[2].getArenaRegion() };
+    TEST_ASSERT_TRUE(arena.compact(regions));
+    arena.getStats(stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numHoles);
+    TEST_ASSERT_EQUAL_UINT32(12, stats.largestFreeBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.fragmentationPct);
+    TEST_ASSERT_EQUAL_UINT32(8, aggregators[2].getArenaRegion()->offset);
+    std::vector<uint8_t> dataOut;
+    TEST_ASSERT_TRUE(aggregators[2].get(dataOut));
+    const std::vector<uint8_t> expected = {2, 1, 2, 3};
+    TEST_ASSERT_TRUE(expected == dataOut);
+
+    // Compaction is refused if a region is missing
+    regions = { aggregators[0].getArenaRegion() };
+    TEST_ASSERT_FALSE(arena.compact(regions));
+
+    // Freed space is reused
+    TEST_ASSERT_TRUE(noRoom.initInArena(arena, 3, 4));
+    arena.getStats(stats);
+    TEST_ASSERT_EQUAL_UINT32(28, stats.usedBytes);
+}
+
+TEST_CASE("Test PollDataAggregator Overflow Counters", "[PollDataAggregator]")
+{
+    // Ring of 2 results with a 2 byte ms timestamp
+    PollDataAggregator aggregator;
+    aggregator.init(2, 3);
+    TEST_ASSERT_TRUE(aggregator.put({0x00, 0x64, 1}));
+    TEST_ASSERT_TRUE(aggregator.put({0x00, 0xc8, 2}));
+    TEST_ASSERT_TRUE(aggregator.put({0x01, 0x2c, 3}));
+    PollDataAggregator::Stats stats;
+    aggregator.getStats(stats, 1000, 2);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.numProduced);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numConsumed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numOverwritten);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numDropped);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.numUnread);
+    TEST_ASSERT_EQUAL_UINT32(800, stats.oldestUnreadAgeMs);
+
+    // Age wraps with the timestamp
+    aggregator.getStats(stats, 0x10000 + 100, 2);
+    TEST_ASSERT_EQUAL_UINT32(65436, stats.oldestUnreadAgeMs);
+
+    // Consume one
+    std::vector<uint8_t> dataOut;
+    TEST_ASSERT_TRUE(aggregator.get(dataOut));
+    aggregator.getStats(stats, 1000, 2);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numConsumed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numUnread);
+    TEST_ASSERT_EQUAL_UINT32(700, stats.oldestUnreadAgeMs);
+
+    // Block oldest keeps unread results and drops new ones
+    aggregator.setBlockOldest(true);
+    TEST_ASSERT_TRUE(aggregator.put({0x01, 0x90, 4}));
+    TEST_ASSERT_FALSE(aggregator.put({0x01, 0xf4, 5}));
+    aggregator.getStats(stats, 1000, 2);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.numProduced);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numOverwritten);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.numDropped);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.numUnread);
+    uint32_t elemSize = 0;
+    TEST_ASSERT_EQUAL_UINT32(2, aggregator.get(dataOut, elemSize, 0));
+    const std::vector<uint8_t> expected = {0x01, 0x2c, 3, 0x01, 0x90, 4};
+    TEST_ASSERT_TRUE(expected == dataOut);
+
+    // Produced is the sum of the other counters
+    aggregator.getStats(stats, 1000, 2);
+    TEST_ASSERT_EQUAL_UINT32(stats.numProduced, stats.numConsumed + stats.numOverwritten + stats.numDropped + stats.numUnread);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.oldestUnreadAgeMs);
+}
+
+TEST_CASE("Test PollDataAggregator US Delta Timestamps", "[PollDataAggregator]")
+{
+    // Codes are exact to 16ms then 32us, 1024us and 32768us units (longer gaps are re-based)
+    uint32_t codedDeltaUs = 0;
+    TEST_ASSERT_EQUAL_UINT16(10000, PollTimestamp::encodeDeltaUs(10000, codedDeltaUs));
+    TEST_ASSERT_EQUAL_UINT32(10000, codedDeltaUs);
+    uint16_t code = PollTimestamp::encodeDeltaUs(100001, codedDeltaUs);
+    TEST_ASSERT_EQUAL_UINT32(100000, codedDeltaUs);
+    TEST_ASSERT_EQUAL_UINT32(100000, PollTimestamp::decodeDeltaUs(code));
+    code = PollTimestamp::encodeDeltaUs(PollTimestamp::MAX_DELTA_US, codedDeltaUs);
+    TEST_ASSERT_TRUE(code != PollTimestamp::CODE_REBASED);
+    TEST_ASSERT_TRUE(PollTimestamp::MAX_DELTA_US - codedDeltaUs < 32768);
+    TEST_ASSERT_EQUAL_UINT32(codedDeltaUs, PollTimestamp::decodeDeltaUs(code));
+    TEST_ASSERT_EQUAL_UINT16(PollTimestamp::CODE_REBASED, PollTimestamp::encodeDeltaUs(PollTimestamp::MAX_DELTA_US + 1, codedDeltaUs));
+    TEST_ASSERT_EQUAL_UINT16(PollTimestamp::CODE_REBASED, PollTimestamp::encodeDeltaUs(1000000000ULL, codedDeltaUs));
+    TEST_ASSERT_EQUAL_UINT32(0, codedDeltaUs);
+
+    // Ring of 4 results with a 2 byte timestamp
+    PollDataAggregator aggregator;
+    aggregator.init(4, 3);
+    aggregator.setTimestampFormat(PollTimestamp::FORMAT_US_DELTA16);
+    const uint64_t t0 = 5000000;
+    const uint64_t times[] = {t0, t0 + 10000, t0 + 110001, t0 + 130001, t0 + 100130001};
+    for (uint32_t i = 0; i < sizeof(times) / sizeof(times[0]); i++)
+        TEST_ASSERT_TRUE(aggregator.put({0, 0, (uint8_t)i}, times[i]));
+
+    // Rounding of one delta doesn't carry into the next
+    uint8_t results[12] = {};
+    uint64_t lastTimeUs = 0;
+    TEST_ASSERT_EQUAL_UINT32(1, aggregator.getNewest(results, sizeof(results), 1, &lastTimeUs));
+    TEST_ASSERT_TRUE(times[4] - lastTimeUs < 32768);
+    TEST_ASSERT_EQUAL_UINT32(4, aggregator.getNewest(results, sizeof(results), 4));
+    TEST_ASSERT_EQUAL_UINT8(1, results[2]);
+    TEST_ASSERT_EQUAL_UINT32(10000, PollTimestamp::decodeDeltaUs((results[0] << 8) | results[1]));
+    TEST_ASSERT_EQUAL_UINT32(100000, PollTimestamp::decodeDeltaUs((results[3] << 8) | results[4]));
+    TEST_ASSERT_EQUAL_UINT32(20000, PollTimestamp::decodeDeltaUs((results[6] << 8) | results[7]));
+
+    // Age of the oldest unread result
+    PollDataAggregator::Stats stats;
+    aggregator.getStats(stats, (lastTimeUs + 5000) / 1000, DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+    TEST_ASSERT_EQUAL_UINT32((lastTimeUs + 5000) / 1000 - times[1] / 1000, stats.oldestUnreadAgeMs);
+
+    // Times of results read are worked back from the newest (the first result put was overwritten)
+    TEST_ASSERT_EQUAL_UINT32(2, aggregator.get(results, sizeof(results), 2, &lastTimeUs));
+    TEST_ASSERT_TRUE(lastTimeUs == t0 + 110000);
+    uint64_t timesUs[2] = {};
+    PollTimestamp::getTimesUs(PollTimestamp::FORMAT_US_DELTA16, results, 3, 2, lastTimeUs, timesUs);
+    TEST_ASSERT_TRUE(timesUs[0] == times[1]);
+    TEST_ASSERT_TRUE(timesUs[1] == times[2] - 1);
+    TEST_ASSERT_EQUAL_UINT32(2, aggregator.get(results, sizeof(results), 0, &lastTimeUs));
+    PollTimestamp::getTimesUs(PollTimestamp::FORMAT_US_DELTA16, results, 3, 2, lastTimeUs, timesUs);
+    TEST_ASSERT_TRUE(timesUs[0] == times[3] - 1);
+    TEST_ASSERT_TRUE(times[4] - timesUs[1] < 32768);
+
+    // A gap too long to code (600s) re-bases the time so the newest time isn't left behind - times before the
+    // gap can't be worked back
+    const uint64_t t1 = times[4] + 600000000ULL;
+    TEST_ASSERT_TRUE(aggregator.put({0, 0, 5}, times[4]));
+    TEST_ASSERT_TRUE(aggregator.put({0, 0, 6}, t1));
+    TEST_ASSERT_TRUE(aggregator.put({0, 0, 7}, t1 + 10000));
+    TEST_ASSERT_EQUAL_UINT32(1, aggregator.getNewest(results, sizeof(results), 1, &lastTimeUs));
+    TEST_ASSERT_TRUE(lastTimeUs == t1 + 10000);
+    aggregator.getStats(stats, (t1 + 20000) / 1000, DevicePollingInfo::POLL_RESULT_TIMESTAMP_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(20, stats.oldestUnreadAgeMs);
+    TEST_ASSERT_EQUAL_UINT32(1, aggregator.get(results, sizeof(results), 1, &lastTimeUs));
+    TEST_ASSERT_TRUE(lastTimeUs == PollTimestamp::TIME_UNKNOWN);
+    TEST_ASSERT_EQUAL_UINT32(2, aggregator.get(results, sizeof(results), 0, &lastTimeUs));
+    TEST_ASSERT_TRUE(PollTimestamp::isRebased(PollTimestamp::FORMAT_US_DELTA16, results));
+    TEST_ASSERT_TRUE(lastTimeUs == t1 + 10000);
+    PollTimestamp::getTimesUs(PollTimestamp::FORMAT_US_DELTA16, results, 3, 2, lastTimeUs, timesUs);
+    TEST_ASSERT_TRUE(timesUs[0] == t1);
+    TEST_ASSERT_TRUE(timesUs[1] == t1 + 10000);
+    TEST_ASSERT_TRUE(aggregator.put({0, 0, 8}, t1 + 20000));
+    TEST_ASSERT_TRUE(aggregator.put({0, 0, 9}, t1 + 700000000ULL));
+    TEST_ASSERT_EQUAL_UINT32(2, aggregator.get(results, sizeof(results), 0, &lastTimeUs));
+    PollTimestamp::getTimesUs(PollTimestamp::FORMAT_US_DELTA16, results, 3, 2, lastTimeUs, timesUs);
+    TEST_ASSERT_TRUE(timesUs[0] == PollTimestamp::TIME_UNKNOWN);
+    TEST_ASSERT_TRUE(timesUs[1] == t1 + 700000000ULL);
+
+    // Millisecond timestamps are timed back across wraps
+    PollDataAggregator msAggregator;
+    msAggregator.init(2, 3);
+    TEST_ASSERT_TRUE(msAggregator.put({0xff, 0xf0, 1}, 0xfff0 * 1000ULL));
+    TEST_ASSERT_TRUE(msAggregator.put({0x00, 0x10, 2}, 0x10010 * 1000ULL));
+    TEST_ASSERT_EQUAL_UINT32(2, msAggregator.get(results, sizeof(results), 0, &lastTimeUs));
+    PollTimestamp::getTimesUs(PollTimestamp::FORMAT_MS16, results, 3, 2, lastTimeUs, timesUs);
+    TEST_ASSERT_TRUE(timesUs[0] == 0xfff0 * 1000ULL);
+    TEST_ASSERT_TRUE(timesUs[1] == 0x10010 * 1000ULL);
+}
@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Comparison of I2C centrals on hardware
+//
+// Runs the same register reads through RaftI2CCentral (register-level) and ESPIDF5I2CCentral (IDF 5 driver
+// with asynchronous transactions) and reports transactions per second and the CPU used by the accessing task.
+// CPU use is measured by counting in a lower priority task on the same core - RaftI2CCentral yields while
+// waiting but doesn't block so the counting task only runs when a central blocks.
+//
+// Needs a device which supports register reads on the bus (set the pins and address below). Not run by
+// default - select it from the test menu
+//
+// Rob Dobson 2024
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "Logger.h"
+#include "RaftI2CCentral.h"
+#include "ESPIDF5I2CCentral.h"
+
+static const char* MODULE_PREFIX = "test_i2c_central_bench";
+
+// Bus and device
+static const uint8_t BENCH_I2C_PORT = 0;
+static const uint16_t BENCH_PIN_SDA = 21;
+static const uint16_t BENCH_PIN_SCL = 22;
+static const uint32_t BENCH_BUS_FREQ = 400000;
+static const uint32_t BENCH_DEV_ADDR = 0x48;
+static const uint8_t BENCH_DEV_REG = 0x00;
+static const uint32_t BENCH_READ_LEN = 6;
+static const uint32_t BENCH_NUM_TRANSACTIONS = 1000;
+
+// Task priorities (the test task is raised above the counting task while measuring)
+static const UBaseType_t BENCH_COUNT_TASK_PRIORITY = tskIDLE_PRIORITY + 1;
+static const UBaseType_t BENCH_TEST_TASK_PRIORITY = tskIDLE_PRIORITY + 5;
+
+// Counter incremented by the lower priority task
+static volatile uint32_t benchIdleCount = 0;
+static volatile bool benchCountTaskRun = false;
+
+static void benchCountTask(void* pArg)
+{
+    while (benchCountTaskRun)
+        benchIdleCount++;
+    vTaskDelete(nullptr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Result of a run
+struct CentralBenchResult
+{
+    uint32_t numOk = 0;
+    double transPerSec = 0;
+    double cpuPct = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Run register reads through a central
+/// @param central central (initialised)
+/// @param idleCountsPerUs counting task rate when nothing else is running on the core
+static CentralBenchResult benchRunCentral(RaftI2CCentralIF& central, double idleCountsPerUs)
+{
+    CentralBenchResult r;
+    uint8_t writeBuf[1] = { BENCH_DEV_REG };
+    uint8_t readBuf[BENCH_READ_LEN];
+    uint32_t startCount = benchIdleCount;
+    int64_t startUs = esp_timer_get_time();
+    for (uint32_t i = 0; i < BENCH_NUM_TRANSACTIONS; i++)
+    {
+        uint32_t numRead = 0;
+        if ((central.access(BENCH_DEV_ADDR, writeBuf, sizeof(writeBuf), readBuf, sizeof(readBuf), numRead) ==
+                    RaftI2CCentralIF::ACCESS_RESULT_OK) && (numRead == BENCH_READ_LEN))
+            r.numOk++;
+    }
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+    uint32_t idleCounts = benchIdleCount - startCount;
+    r.transPerSec = elapsedUs > 0 ? BENCH_NUM_TRANSACTIONS * 1e6 / elapsedUs : 0;
+    double idlePct = (elapsedUs > 0) && (idleCountsPerUs > 0) ? idleCounts * 100.0 / (idleCountsPerUs * elapsedUs) : 0;
+    r.cpuPct = idlePct > 100 ? 0 : 100 - idlePct;
+    return r;
+}
+
+TEST_CASE("test_i2c_central_bench", "[i2c_central_bench][ignore]")
+{
+    // Raise priority and start the counting task on this core
+    UBaseType_t prevPriority = uxTaskPriorityGet(nullptr);
+    vTaskPrioritySet(nullptr, BENCH_TEST_TASK_PRIORITY);
+    benchIdleCount = 0;
+    benchCountTaskRun = true;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(benchCountTask, "benchCount", 2048, nullptr,
+                BENCH_COUNT_TASK_PRIORITY, nullptr, xPortGetCoreID()));
+
+    // Counting rate with this task blocked
+    uint32_t startCount = benchIdleCount;
+    int64_t startUs = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(200));
+    double idleCountsPerUs = (double)(benchIdleCount - startCount) / (esp_timer_get_time() - startUs);
+
+    // Register-level central
+    CentralBenchResult raftResult;
+    {
+        RaftI2CCentral raftCentral;
+        TEST_ASSERT_TRUE(raftCentral.init(BENCH_I2C_PORT, BENCH_PIN_SDA, BENCH_PIN_SCL, BENCH_BUS_FREQ));
+        raftResult = benchRunCentral(raftCentral, idleCountsPerUs);
+        raftCentral.deinit();
+    }
+
+    // IDF 5 central
+    CentralBenchResult idfResult;
+    {
+        ESPIDF5I2CCentral idfCentral;
+        TEST_ASSERT_TRUE(idfCentral.init(BENCH_I2C_PORT, BENCH_PIN_SDA, BENCH_PIN_SCL, BENCH_BUS_FREQ));
+        idfResult = benchRunCentral(idfCentral, idleCountsPerUs);
+        idfCentral.deinit();
+    }
+
+    // Stop counting
+    benchCountTaskRun = false;
+    vTaskDelay(pdMS_TO_TICKS(10));
+    vTaskPrioritySet(nullptr, prevPriority);
+
+    // Report
+    LOG_I(MODULE_PREFIX, "RaftI2CCentral ok %d/%d transPerSec %.1f cpuPct %.1f",
+                raftResult.numOk, BENCH_NUM_TRANSACTIONS, raftResult.transPerSec, raftResult.cpuPct);
+    LOG_I(MODULE_PREFIX, "ESPIDF5I2CCentral ok %d/%d transPerSec %.1f cpuPct %.1f",
+                idfResult.numOk, BENCH_NUM_TRANSACTIONS, idfResult.transPerSec, idfResult.cpuPct);
+    if ((raftResult.numOk == 0) && (idfResult.numOk == 0))
+        TEST_IGNORE_MESSAGE("No device responding at BENCH_DEV_ADDR");
+    TEST_ASSERT_EQUAL(BENCH_NUM_TRANSACTIONS, raftResult.numOk);
+    TEST_ASSERT_EQUAL(BENCH_NUM_TRANSACTIONS, idfResult.numOk);
+}